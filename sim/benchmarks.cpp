@@ -0,0 +1,720 @@
+#include <Arduino.h>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include <time.h>
+
+#include "spscQueue.h"
+#include "dualCore.h"
+#include "controller.h"
+#include "binaryCommand.h"
+#include "sensors.h"
+#include "BME280Sensor.h"
+#include "processBus.h"
+#include "pixels.h"
+#include "settings.h"
+#include "processes.h"
+#include "simulation.h"
+
+// Each benchmark prints one or more lines of figures. The threaded ones run
+// the producer and the consumer on two host threads, which is as close as
+// the host gets to the two ESP32 cores. A thread that finds the queue full
+// or empty yields, so they still make progress on a single core host.
+
+uint64_t hostNanos()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+void printBenchmarkFigure(const char *name, const char *figure, double value, const char *units)
+{
+	printf("%-14s %-34s %12.1f %s\n", name, figure, value, units);
+}
+
+// The producer pushes numbered items as fast as it can and retries when
+// the queue is full. The consumer checks that every item arrives once, in
+// order and intact.
+
+#define SPSC_BENCHMARK_ITEMS 2000000
+#define SPSC_BENCHMARK_SLOTS 16
+
+struct SpscBenchmarkItem
+{
+	uint32_t sequence;
+	uint32_t check;
+};
+
+uint32_t spscBenchmarkCheck(uint32_t sequence)
+{
+	return sequence * 2654435761UL;
+}
+
+bool spscBenchmark()
+{
+	struct SpscQueue queue;
+	unsigned char slots[SPSC_BENCHMARK_SLOTS * sizeof(struct SpscBenchmarkItem)];
+	unsigned long retries = 0;
+	unsigned long wrong = 0;
+
+	spscQueueInit(&queue, slots, sizeof(struct SpscBenchmarkItem), SPSC_BENCHMARK_SLOTS);
+
+	uint64_t startNanos = hostNanos();
+
+	std::thread producer([&]() {
+		struct SpscBenchmarkItem item;
+
+		for (uint32_t sequence = 0; sequence < SPSC_BENCHMARK_ITEMS; sequence++)
+		{
+			item.sequence = sequence;
+			item.check = spscBenchmarkCheck(sequence);
+
+			while (!spscQueuePush(&queue, &item))
+			{
+				retries++;
+				std::this_thread::yield();
+			}
+		}
+	});
+
+	std::thread consumer([&]() {
+		struct SpscBenchmarkItem item;
+		uint32_t expected = 0;
+
+		while (expected < SPSC_BENCHMARK_ITEMS)
+		{
+			if (!spscQueuePop(&queue, &item))
+			{
+				std::this_thread::yield();
+				continue;
+			}
+
+			if (item.sequence != expected || item.check != spscBenchmarkCheck(expected))
+			{
+				wrong++;
+			}
+			expected = item.sequence + 1;
+		}
+	});
+
+	producer.join();
+	consumer.join();
+
+	double seconds = (hostNanos() - startNanos) / 1e9;
+
+	printBenchmarkFigure("spsc", "items through the queue", SPSC_BENCHMARK_ITEMS, "");
+	printBenchmarkFigure("spsc", "throughput", SPSC_BENCHMARK_ITEMS / seconds / 1e6, "million items/s");
+	printBenchmarkFigure("spsc", "time per item", seconds * 1e9 / SPSC_BENCHMARK_ITEMS, "ns");
+	printBenchmarkFigure("spsc", "pushes refused by a full queue", retries, "");
+
+	if (wrong != 0)
+	{
+		printf("spsc           %lu items were lost, repeated or damaged\n", wrong);
+		return false;
+	}
+
+	if (queue.pushFailures != retries || spscQueueDepth(&queue) != 0)
+	{
+		printf("spsc           the queue counted %lu full pushes for %lu refusals and holds %u items\n",
+			   queue.pushFailures, retries, spscQueueDepth(&queue));
+		return false;
+	}
+
+	return true;
+}
+
+// The handoffs are built and queued the way forwardCommandToRealTimeCore
+// does it, with the host clock in queuedMicros, and the consumer checks the
+// destination and the parameters before working out the latency. The first
+// run waits for each handoff to be taken before sending the next, which
+// gives the latency of the handoff itself. The second keeps the queue full,
+// which gives the throughput and the latency of a backed up queue.
+
+#define HANDOFF_BENCHMARK_ITEMS 200000
+
+void fillBenchmarkHandoff(struct CoreHandoff *handoff, uint32_t sequence)
+{
+	handoff->type = handoffCommand;
+	handoff->command = NULL;
+	snprintf(handoff->destination, DESTINATION_NAME_LENGTH, "pixel%u", sequence);
+
+	for (int i = 0; i < COMMAND_PARAMETER_BUFFER_LENGTH; i++)
+	{
+		handoff->parameters[i] = (unsigned char)(sequence + i);
+	}
+}
+
+bool benchmarkHandoffIntact(struct CoreHandoff *handoff, uint32_t sequence)
+{
+	struct CoreHandoff expected;
+
+	fillBenchmarkHandoff(&expected, sequence);
+
+	return strcmp(handoff->destination, expected.destination) == 0 &&
+		   memcmp(handoff->parameters, expected.parameters, COMMAND_PARAMETER_BUFFER_LENGTH) == 0;
+}
+
+bool runHandoffBenchmark(const char *name, bool waitForEachHandoff)
+{
+	struct SpscQueue queue;
+	unsigned char slots[DUAL_CORE_QUEUE_SLOTS * sizeof(struct CoreHandoff)];
+	std::vector<uint32_t> latencies(HANDOFF_BENCHMARK_ITEMS);
+	unsigned long queueFull = 0;
+	unsigned long wrong = 0;
+
+	spscQueueInit(&queue, slots, sizeof(struct CoreHandoff), DUAL_CORE_QUEUE_SLOTS);
+
+	uint64_t startNanos = hostNanos();
+
+	std::thread network([&]() {
+		struct CoreHandoff handoff;
+
+		for (uint32_t sequence = 0; sequence < HANDOFF_BENCHMARK_ITEMS; sequence++)
+		{
+			fillBenchmarkHandoff(&handoff, sequence);
+			handoff.queuedMicros = (unsigned long)(hostNanos() / 1000);
+
+			while (!spscQueuePush(&queue, &handoff))
+			{
+				queueFull++;
+				std::this_thread::yield();
+			}
+
+			while (waitForEachHandoff && spscQueueDepth(&queue) != 0)
+			{
+				std::this_thread::yield();
+			}
+		}
+	});
+
+	std::thread realTime([&]() {
+		struct CoreHandoff handoff;
+		uint32_t sequence = 0;
+
+		while (sequence < HANDOFF_BENCHMARK_ITEMS)
+		{
+			if (!spscQueuePop(&queue, &handoff))
+			{
+				std::this_thread::yield();
+				continue;
+			}
+
+			latencies[sequence] = (uint32_t)(hostNanos() / 1000 - handoff.queuedMicros);
+
+			if (!benchmarkHandoffIntact(&handoff, sequence))
+			{
+				wrong++;
+			}
+			sequence++;
+		}
+	});
+
+	network.join();
+	realTime.join();
+
+	double seconds = (hostNanos() - startNanos) / 1e9;
+
+	std::sort(latencies.begin(), latencies.end());
+
+	printBenchmarkFigure(name, "throughput", HANDOFF_BENCHMARK_ITEMS / seconds / 1e3, "thousand handoffs/s");
+	printBenchmarkFigure(name, "median latency", latencies[HANDOFF_BENCHMARK_ITEMS / 2], "us");
+	printBenchmarkFigure(name, "99th percentile latency", latencies[HANDOFF_BENCHMARK_ITEMS * 99 / 100], "us");
+	printBenchmarkFigure(name, "worst latency", latencies[HANDOFF_BENCHMARK_ITEMS - 1], "us");
+	printBenchmarkFigure(name, "pushes refused by a full queue", queueFull, "");
+
+	if (wrong != 0)
+	{
+		printf("%-14s %lu handoffs arrived damaged or out of order\n", name, wrong);
+		return false;
+	}
+
+	return true;
+}
+
+bool handoffBenchmark()
+{
+	return runHandoffBenchmark("handoff", true) &&
+		   runHandoffBenchmark("handoff full", false);
+}
+
+// The same pixel commands are sent as JSON and as MessagePack to a booted
+// device. Each one is performed too, which costs the same either way, so
+// the difference between the two times is the difference in decoding.
+
+#define COMMAND_BENCHMARK_REPEATS 20000
+
+bool benchmarkDeviceBooted = false;
+
+void bootBenchmarkDevice()
+{
+	if (!benchmarkDeviceBooted)
+	{
+		simulationBoot("");
+		benchmarkDeviceBooted = true;
+	}
+}
+
+int benchmarkCommandErrors;
+
+void checkBenchmarkReply(char *resultText)
+{
+	if (strncmp(resultText, "{\"error\":0,", 11) != 0)
+	{
+		benchmarkCommandErrors++;
+	}
+}
+
+struct CommandBenchmark
+{
+	const char *name;
+	const char *json;
+	void (*pack)(struct SimulationPack *pack);
+};
+
+void packSetColour(struct SimulationPack *pack)
+{
+	simulationPackMap(pack, 5);
+	simulationPackInt(pack, BINARY_COMMAND_PROCESS_KEY);
+	simulationPackText(pack, "pixels");
+	simulationPackInt(pack, BINARY_COMMAND_COMMAND_KEY);
+	simulationPackText(pack, "setcolour");
+	simulationPackInt(pack, BINARY_COMMAND_FIRST_ITEM_KEY);
+	simulationPackFloat(pack, 1.0);
+	simulationPackInt(pack, BINARY_COMMAND_FIRST_ITEM_KEY + 1);
+	simulationPackFloat(pack, 0.5);
+	simulationPackInt(pack, BINARY_COMMAND_FIRST_ITEM_KEY + 2);
+	simulationPackFloat(pack, 0.0);
+}
+
+void packSetNamedColour(struct SimulationPack *pack)
+{
+	simulationPackMap(pack, 3);
+	simulationPackInt(pack, BINARY_COMMAND_PROCESS_KEY);
+	simulationPackText(pack, "pixels");
+	simulationPackInt(pack, BINARY_COMMAND_COMMAND_KEY);
+	simulationPackText(pack, "setnamedcolour");
+	simulationPackInt(pack, BINARY_COMMAND_FIRST_ITEM_KEY);
+	simulationPackText(pack, "blue");
+}
+
+void packBrightness(struct SimulationPack *pack)
+{
+	simulationPackMap(pack, 3);
+	simulationPackInt(pack, BINARY_COMMAND_PROCESS_KEY);
+	simulationPackText(pack, "pixels");
+	simulationPackInt(pack, BINARY_COMMAND_COMMAND_KEY);
+	simulationPackText(pack, "brightness");
+	simulationPackInt(pack, BINARY_COMMAND_FIRST_ITEM_KEY);
+	simulationPackFloat(pack, 0.5);
+}
+
+struct CommandBenchmark commandBenchmarks[] = {
+	{"setcolour", "{\"process\":\"pixels\",\"command\":\"setcolour\",\"red\":1,\"blue\":0.5,\"green\":0}", packSetColour},
+	{"setnamedcolour", "{\"process\":\"pixels\",\"command\":\"setnamedcolour\",\"colourname\":\"blue\"}", packSetNamedColour},
+	{"brightness", "{\"process\":\"pixels\",\"command\":\"brightness\",\"value\":0.5}", packBrightness}};
+
+bool commandsBenchmark()
+{
+	struct SimulationPack pack;
+
+	bootBenchmarkDevice();
+
+	benchmarkCommandErrors = 0;
+
+	printf("%-14s %-16s %10s %10s %12s %12s\n", "commands", "", "json bytes", "bin bytes", "json ns", "bin ns");
+
+	for (unsigned int i = 0; i < sizeof(commandBenchmarks) / sizeof(struct CommandBenchmark); i++)
+	{
+		struct CommandBenchmark *bench = &commandBenchmarks[i];
+
+		bench->pack(&pack);
+
+		uint64_t startNanos = hostNanos();
+
+		for (int repeat = 0; repeat < COMMAND_BENCHMARK_REPEATS; repeat++)
+		{
+			act_onJson_message(bench->json, checkBenchmarkReply);
+		}
+
+		uint64_t jsonNanos = hostNanos() - startNanos;
+
+		startNanos = hostNanos();
+
+		for (int repeat = 0; repeat < COMMAND_BENCHMARK_REPEATS; repeat++)
+		{
+			act_onBinary_message((const char *)pack.data, pack.length, checkBenchmarkReply);
+		}
+
+		uint64_t binaryNanos = hostNanos() - startNanos;
+
+		// as sent over the serial port - the JSON line ends with a newline
+		// and a binary frame has a three byte header
+		printf("%-14s %-16s %10d %10d %12.0f %12.0f\n", "commands", bench->name,
+			   (int)strlen(bench->json) + 1,
+			   pack.length + 3,
+			   (double)jsonNanos / COMMAND_BENCHMARK_REPEATS,
+			   (double)binaryNanos / COMMAND_BENCHMARK_REPEATS);
+	}
+
+	if (benchmarkCommandErrors != 0)
+	{
+		printf("commands       %d commands failed\n", benchmarkCommandErrors);
+		return false;
+	}
+
+	return true;
+}
+
+// The BME280 isn't part of the host build, so this builds a sensor with the
+// same 23 triggers and looks them up as a BME280 event does - once for each
+// of humid, press, temp and all - through the trigger slots and through
+// the scan of the trigger table that the slots replace. The timing uses
+// the host clock because the simulated one only moves in delay().
+
+#define LISTENER_BENCHMARK_EVENTS 200000
+
+int bme280BenchmarkEvents[] = {BME280_ON_SECOND, BME280_ON_MIN, BME280_ON_FIVE_MIN,
+							   BME280_ON_HALF_HOUR, BME280_ON_HOUR, BME280_ON_CHANGE};
+
+int bme280BenchmarkSensorNos[] = {BME280_HUMID, BME280_PRESS, BME280_TEMP, BME280_ALL};
+
+#define BME280_BENCHMARK_NO_OF_EVENTS (int)(sizeof(bme280BenchmarkEvents) / sizeof(int))
+#define BME280_BENCHMARK_NO_OF_SENSOR_NOS (int)(sizeof(bme280BenchmarkSensorNos) / sizeof(int))
+
+bool listenersBenchmark()
+{
+	struct sensorEventBinder binders[BME280_BENCHMARK_NO_OF_EVENTS * BME280_BENCHMARK_NO_OF_SENSOR_NOS];
+	int noOfBinders = 0;
+
+	for (int event = 0; event < BME280_BENCHMARK_NO_OF_EVENTS; event++)
+	{
+		for (int sensorNo = 0; sensorNo < BME280_BENCHMARK_NO_OF_SENSOR_NOS; sensorNo++)
+		{
+			// there is no "all on change" trigger
+			if (bme280BenchmarkEvents[event] == BME280_ON_CHANGE && bme280BenchmarkSensorNos[sensorNo] == BME280_ALL)
+			{
+				continue;
+			}
+			binders[noOfBinders].listenerName = (char *)"bench";
+			binders[noOfBinders].trigger = bme280BenchmarkEvents[event] + bme280BenchmarkSensorNos[sensorNo];
+			noOfBinders++;
+		}
+	}
+
+	struct sensor benchmarkSensor;
+	memset(&benchmarkSensor, 0, sizeof(struct sensor));
+	benchmarkSensor.sensorName = (char *)"bench";
+	benchmarkSensor.sensorListenerFunctions = binders;
+	benchmarkSensor.noOfSensorListenerFunctions = noOfBinders;
+
+	// every list points at a listener of its own, so a lookup that lands on
+	// the wrong list is spotted
+	struct sensorListener listeners[BME280_BENCHMARK_NO_OF_EVENTS * BME280_BENCHMARK_NO_OF_SENSOR_NOS];
+	struct sensorListener *lists[BME280_BENCHMARK_NO_OF_EVENTS * BME280_BENCHMARK_NO_OF_SENSOR_NOS];
+	int slotBits = sensorTriggerSlotBits(noOfBinders);
+	unsigned char slots[SENSOR_TRIGGER_SLOTS_SIZE];
+
+	for (int i = 0; i < noOfBinders; i++)
+	{
+		lists[i] = &listeners[i];
+	}
+
+	benchmarkSensor.triggerListeners = lists;
+	mapSensorTriggers(&benchmarkSensor, slots, slotBits);
+
+	int wrong = 0;
+
+	for (int i = 0; i < noOfBinders; i++)
+	{
+		if (findSensorTriggerListeners(&benchmarkSensor, binders[i].trigger) != &listeners[i] ||
+			findSensorEventBinderByTrigger(&benchmarkSensor, binders[i].trigger) != &binders[i])
+		{
+			wrong++;
+		}
+	}
+
+	volatile uintptr_t found = 0;
+
+	uint64_t startNanos = hostNanos();
+
+	for (int i = 0; i < LISTENER_BENCHMARK_EVENTS; i++)
+	{
+		int event = bme280BenchmarkEvents[i % BME280_BENCHMARK_NO_OF_EVENTS];
+
+		for (int sensorNo = 0; sensorNo < BME280_BENCHMARK_NO_OF_SENSOR_NOS; sensorNo++)
+		{
+			found += (uintptr_t)findSensorTriggerListeners(&benchmarkSensor, event + bme280BenchmarkSensorNos[sensorNo]);
+		}
+	}
+
+	uint64_t slotNanos = hostNanos() - startNanos;
+
+	startNanos = hostNanos();
+
+	for (int i = 0; i < LISTENER_BENCHMARK_EVENTS; i++)
+	{
+		int event = bme280BenchmarkEvents[i % BME280_BENCHMARK_NO_OF_EVENTS];
+
+		for (int sensorNo = 0; sensorNo < BME280_BENCHMARK_NO_OF_SENSOR_NOS; sensorNo++)
+		{
+			found += (uintptr_t)findSensorEventBinderByTrigger(&benchmarkSensor, event + bme280BenchmarkSensorNos[sensorNo]);
+		}
+	}
+
+	uint64_t scanNanos = hostNanos() - startNanos;
+
+	printBenchmarkFigure("listeners", "triggers", noOfBinders, "");
+	printBenchmarkFigure("listeners", "trigger slots", 1 << slotBits, "");
+	printBenchmarkFigure("listeners", "event through the slots", (double)slotNanos / LISTENER_BENCHMARK_EVENTS, "ns");
+	printBenchmarkFigure("listeners", "event through a scan", (double)scanNanos / LISTENER_BENCHMARK_EVENTS, "ns");
+
+	if (wrong != 0)
+	{
+		printf("listeners      %d triggers found the wrong list\n", wrong);
+		return false;
+	}
+
+	return true;
+}
+
+// The same comparison as the console bus benchmark: a status value sent
+// to a listener over the process bus against the JSON command that a
+// process would otherwise be sent. The command sets the pixel brightness
+// to its current value so it has no visible effect.
+
+#define BUS_BENCHMARK_MESSAGES 100000
+#define BUS_BENCHMARK_JSON_LENGTH 100
+
+unsigned long benchmarkBusTotal;
+
+void benchmarkBusReceive(struct processMessageListener *listener, void *value)
+{
+	benchmarkBusTotal += ((struct BusStatusMessage *)value)->status;
+}
+
+struct processMessageListener benchmarkBusListener = {
+	"bus benchmark",
+	NULL,
+	benchmarkBusReceive,
+	NULL,
+	busTopicBenchmark};
+
+bool busVersusJsonBenchmark()
+{
+	struct BusStatusMessage message;
+	unsigned long expectedTotal = 0;
+
+	bootBenchmarkDevice();
+
+	benchmarkBusTotal = 0;
+	unsubscribeFromBusTopic(&benchmarkBusListener);
+	subscribeToBusTopic(&benchmarkBusListener, busTopicBenchmark);
+
+	uint64_t startNanos = hostNanos();
+
+	for (int i = 0; i < BUS_BENCHMARK_MESSAGES; i++)
+	{
+		message.status = i & 0xff;
+		expectedTotal += message.status;
+		if (!publishBusMessage(busTopicBenchmark, &message, sizeof(struct BusStatusMessage)))
+		{
+			dispatchBusMessages();
+			publishBusMessage(busTopicBenchmark, &message, sizeof(struct BusStatusMessage));
+		}
+	}
+	dispatchBusMessages();
+
+	uint64_t busNanos = hostNanos() - startNanos;
+
+	unsubscribeFromBusTopic(&benchmarkBusListener);
+
+	char json[BUS_BENCHMARK_JSON_LENGTH];
+
+	snprintf(json, BUS_BENCHMARK_JSON_LENGTH,
+			 "{\"process\":\"pixels\",\"command\":\"brightness\",\"value\":%.3f,\"steps\":1}",
+			 pixelSettings.brightness);
+
+	benchmarkCommandErrors = 0;
+
+	startNanos = hostNanos();
+
+	for (int i = 0; i < BUS_BENCHMARK_MESSAGES; i++)
+	{
+		act_onJson_message(json, checkBenchmarkReply);
+	}
+
+	uint64_t jsonNanos = hostNanos() - startNanos;
+
+	printBenchmarkFigure("bus", "messages", BUS_BENCHMARK_MESSAGES, "");
+	printBenchmarkFigure("bus", "bus message", (double)busNanos / BUS_BENCHMARK_MESSAGES, "ns");
+	printBenchmarkFigure("bus", "json command", (double)jsonNanos / BUS_BENCHMARK_MESSAGES, "ns");
+	printBenchmarkFigure("bus", "json time over bus time", (double)jsonNanos / (busNanos + 1), "x");
+
+	if (benchmarkBusTotal != expectedTotal)
+	{
+		printf("bus            the listener added up to %lu, not %lu\n", benchmarkBusTotal, expectedTotal);
+		return false;
+	}
+
+	if (benchmarkCommandErrors != 0)
+	{
+		printf("bus            %d commands failed\n", benchmarkCommandErrors);
+		return false;
+	}
+
+	return true;
+}
+
+// Adds a process with 400 settings to the booted device and makes 1000
+// edits to them as name=value commands, as they would arrive from the
+// console or a settings file. The same names are then looked up by the
+// scan of the sensor and process settings that the index replaces.
+
+#define SETTINGS_BENCHMARK_SETTINGS 400
+#define SETTINGS_BENCHMARK_EDITS 1000
+#define SETTINGS_BENCHMARK_PASSES 20
+#define SETTINGS_BENCHMARK_NAME_LENGTH 20
+#define SETTINGS_BENCHMARK_COMMAND_LENGTH 30
+
+int benchmarkSettingValues[SETTINGS_BENCHMARK_SETTINGS];
+char benchmarkSettingNames[SETTINGS_BENCHMARK_SETTINGS][SETTINGS_BENCHMARK_NAME_LENGTH];
+struct SettingItem benchmarkSettingItems[SETTINGS_BENCHMARK_SETTINGS];
+struct SettingItem *benchmarkSettingPointers[SETTINGS_BENCHMARK_SETTINGS];
+char benchmarkSettingCommands[SETTINGS_BENCHMARK_EDITS][SETTINGS_BENCHMARK_COMMAND_LENGTH];
+
+void benchmarkSettingDefault(void *dest)
+{
+	*(int *)dest = 0;
+}
+
+struct SettingItemCollection benchmarkSettingCollection = {
+	(char *)"settingsbench",
+	(char *)"settings for the settings benchmark",
+	benchmarkSettingPointers,
+	SETTINGS_BENCHMARK_SETTINGS};
+
+struct process benchmarkSettingsProcess;
+
+bool benchmarkSettingsAdded = false;
+
+void addBenchmarkSettings()
+{
+	if (benchmarkSettingsAdded)
+	{
+		return;
+	}
+
+	for (int i = 0; i < SETTINGS_BENCHMARK_SETTINGS; i++)
+	{
+		snprintf(benchmarkSettingNames[i], SETTINGS_BENCHMARK_NAME_LENGTH, "benchsetting%03d", i);
+		benchmarkSettingItems[i] = {benchmarkSettingNames[i], benchmarkSettingNames[i], &benchmarkSettingValues[i],
+									NUMBER_INPUT_LENGTH, integerValue, benchmarkSettingDefault, validateInt};
+		benchmarkSettingPointers[i] = &benchmarkSettingItems[i];
+	}
+
+	memset(&benchmarkSettingsProcess, 0, sizeof(struct process));
+	benchmarkSettingsProcess.processName = (char *)"settingsbench";
+	benchmarkSettingsProcess.settingsStoreBase = (unsigned char *)benchmarkSettingValues;
+	benchmarkSettingsProcess.settingsStoreLength = sizeof(benchmarkSettingValues);
+	benchmarkSettingsProcess.settingItems = &benchmarkSettingCollection;
+
+	addProcessToAllProcessList(&benchmarkSettingsProcess);
+	benchmarkSettingsAdded = true;
+}
+
+bool settingsBenchmark()
+{
+	bootBenchmarkDevice();
+	addBenchmarkSettings();
+
+	// the edits visit the settings in a scattered order and set each one
+	// to its own number
+	for (int i = 0; i < SETTINGS_BENCHMARK_EDITS; i++)
+	{
+		int settingNo = (i * 7) % SETTINGS_BENCHMARK_SETTINGS;
+		snprintf(benchmarkSettingCommands[i], SETTINGS_BENCHMARK_COMMAND_LENGTH, "%s=%d",
+				 benchmarkSettingNames[settingNo], settingNo);
+	}
+
+	int failed = 0;
+
+	uint64_t startNanos = hostNanos();
+
+	for (int pass = 0; pass < SETTINGS_BENCHMARK_PASSES; pass++)
+	{
+		for (int i = 0; i < SETTINGS_BENCHMARK_EDITS; i++)
+		{
+			if (processSettingCommand(benchmarkSettingCommands[i]) != setOK)
+			{
+				failed++;
+			}
+		}
+	}
+
+	uint64_t indexNanos = hostNanos() - startNanos;
+
+	int slots = settingIndexSlots();
+
+	volatile uintptr_t found = 0;
+
+	startNanos = hostNanos();
+
+	for (int pass = 0; pass < SETTINGS_BENCHMARK_PASSES; pass++)
+	{
+		for (int i = 0; i < SETTINGS_BENCHMARK_EDITS; i++)
+		{
+			SettingItem *item = FindSensorSettingByFormName(benchmarkSettingCommands[i]);
+
+			if (item == NULL)
+			{
+				item = FindProcesSettingByFormName(benchmarkSettingCommands[i]);
+			}
+			found += (uintptr_t)item;
+		}
+	}
+
+	uint64_t scanNanos = hostNanos() - startNanos;
+
+	int wrong = 0;
+
+	for (int i = 0; i < SETTINGS_BENCHMARK_SETTINGS; i++)
+	{
+		if (benchmarkSettingValues[i] != i)
+		{
+			wrong++;
+		}
+	}
+
+	int edits = SETTINGS_BENCHMARK_EDITS * SETTINGS_BENCHMARK_PASSES;
+
+	printBenchmarkFigure("settings", "benchmark settings", SETTINGS_BENCHMARK_SETTINGS, "");
+	printBenchmarkFigure("settings", "index slots", slots, "");
+	printBenchmarkFigure("settings", "edit through the index", (double)indexNanos / edits, "ns");
+	printBenchmarkFigure("settings", "lookup through a scan", (double)scanNanos / edits, "ns");
+
+	if (slots < SETTINGS_BENCHMARK_SETTINGS * 2)
+	{
+		printf("settings       the settings were not indexed\n");
+		return false;
+	}
+
+	if (failed != 0 || wrong != 0)
+	{
+		printf("settings       %d edits failed and %d settings have the wrong value\n", failed, wrong);
+		return false;
+	}
+
+	return true;
+}
+
+struct SimulationBenchmark simulationBenchmarks[] = {
+	{"spsc", "push numbered items through a queue between two threads", spscBenchmark},
+	{"handoff", "pass command handoffs between two threads as the two cores do", handoffBenchmark},
+	{"commands", "send the same pixel commands as JSON and as binary", commandsBenchmark},
+	{"listeners", "look up the BME280 triggers through the trigger slots and by a scan", listenersBenchmark},
+	{"bus", "send a status value over the process bus and as a JSON command", busVersusJsonBenchmark},
+	{"settings", "edit 400 settings by name through the setting index and by a scan", settingsBenchmark}};
+
+int noOfSimulationBenchmarks = sizeof(simulationBenchmarks) / sizeof(struct SimulationBenchmark);
@@ -0,0 +1,13 @@
+#include <Arduino.h>
+
+#include "messages.h"
+#include "settingsWebServer.h"
+
+// The parts of the device that can't run on the host. The configuration
+// website needs a real web server, so the simulation says so and carries on
+// with the boot.
+
+void startHostingConfigWebsite(bool timeout)
+{
+	alwaysDisplayMessage("The configuration website isn't available in the simulation\n");
+}
@@ -0,0 +1,901 @@
+#include <Arduino.h>
+#include <LittleFS.h>
+
+#include "settings.h"
+#include "settingsJournal.h"
+#include "settingsSnapshot.h"
+#include "commandDedup.h"
+#include "settingsArena.h"
+#include "mqtt.h"
+#include "simulation.h"
+#include "inputEdges.h"
+#include "scheduler.h"
+#include "metrics.h"
+#include "binaryCommand.h"
+#include "commandQueue.h"
+#include "loopTracer.h"
+
+// Each scenario boots a device with its settings, drives it and checks the
+// result. The pixel checks use the mock strip, which counts the frames that
+// were different from the one before.
+
+// the default button input pin, which is pulled up so pressed is LOW
+#define SIMULATION_BUTTON_PIN 14
+
+bool bootScenario(struct SimulationResult *result)
+{
+	simulationRun(10000);
+
+	if (!simulationOutputContains("Start complete"))
+	{
+		return simulationFail(result, "the device didn't finish starting");
+	}
+
+	if (result->pixels.noOfPixels == 0)
+	{
+		hostGetPixelStats(&result->pixels);
+	}
+
+	if (result->pixels.noOfPixels == 0)
+	{
+		return simulationFail(result, "no pixel strip was set up");
+	}
+
+	return true;
+}
+
+bool commandStoreScenario(struct SimulationResult *result)
+{
+	simulationRun(2000);
+
+	simulationType("{\"process\":\"pixels\",\"command\":\"setnamedcolour\",\"colourname\":\"red\",\"store\":\"demo\",\"id\":\"red\"}");
+	simulationRun(1000);
+
+	if (!LittleFS.exists("/demo/red"))
+	{
+		return simulationFail(result, "the command wasn't stored");
+	}
+
+	struct HostPixelStats before;
+	hostGetPixelStats(&before);
+
+	simulationType("{\"process\":\"controller\",\"command\":\"perform\",\"store\":\"demo\"}");
+	simulationRun(3000);
+
+	struct HostPixelStats after;
+	hostGetPixelStats(&after);
+
+	if (after.currentFrameHash == before.currentFrameHash)
+	{
+		return simulationFail(result, "performing the store didn't change the pixels");
+	}
+
+	return true;
+}
+
+// The controller performs the wifion store when the WiFi status on the
+// process bus changes to connected. The store is written straight to the
+// file system because the device joins the network before a command typed
+// on the console could be stored.
+
+bool wifiStoreScenario(struct SimulationResult *result)
+{
+	LittleFS.mkdir("/wifion");
+	// a command that can't be parsed shows up in the parse failure count
+	File storeFile = LittleFS.open("/wifion/broken", "w");
+	storeFile.print("{\"process\":\"pixels\",");
+	storeFile.close();
+
+	unsigned long failuresBefore = metricParseFailures.count;
+
+	simulationRun(20000);
+
+	if (!simulationOutputContains("simnet"))
+	{
+		return simulationFail(result, "the device didn't join the simulated network");
+	}
+
+	if (metricParseFailures.count != failuresBefore + 1)
+	{
+		return simulationFail(result, "the wifion store was performed %lu times when the network connected",
+							  metricParseFailures.count - failuresBefore);
+	}
+
+	return true;
+}
+
+bool listenerScenario(struct SimulationResult *result)
+{
+	simulationRun(2000);
+
+	// stop the sprites walking so that the frame only changes on a press
+	simulationType("{\"process\":\"pixels\",\"command\":\"pattern\",\"pattern\":\"mask\",\"colourmask\":\"W\"}");
+
+	simulationType("{\"process\":\"pixels\",\"command\":\"setnamedcolour\",\"colourname\":\"blue\",\"sensor\":\"button\",\"trigger\":\"pressed\"}");
+	simulationType("{\"process\":\"pixels\",\"command\":\"setnamedcolour\",\"colourname\":\"black\",\"sensor\":\"button\",\"trigger\":\"released\"}");
+	simulationRun(1000);
+
+	uint32_t frames[4];
+
+	for (int press = 0; press < 2; press++)
+	{
+		hostSetPin(SIMULATION_BUTTON_PIN, LOW);
+		simulationRun(1000);
+		hostGetPixelStats(&result->pixels);
+		frames[press * 2] = result->pixels.currentFrameHash;
+
+		hostSetPin(SIMULATION_BUTTON_PIN, HIGH);
+		simulationRun(1000);
+		hostGetPixelStats(&result->pixels);
+		frames[press * 2 + 1] = result->pixels.currentFrameHash;
+	}
+
+	if (frames[0] == frames[1])
+	{
+		return simulationFail(result, "pressing the button didn't change the pixels");
+	}
+
+	if (frames[0] != frames[2] || frames[1] != frames[3])
+	{
+		return simulationFail(result, "the second press didn't repeat the first");
+	}
+
+	return true;
+}
+
+bool animationScenario(struct SimulationResult *result)
+{
+	simulationRun(2000);
+
+	struct HostPixelStats before;
+	hostGetPixelStats(&before);
+
+	simulationType("{\"process\":\"pixels\",\"command\":\"twinkle\",\"steps\":10}");
+	simulationRun(60000);
+
+	struct HostPixelStats after;
+	hostGetPixelStats(&after);
+
+	if (after.changedShows - before.changedShows < 100)
+	{
+		return simulationFail(result, "only %lu new frames in a minute of twinkling",
+							  after.changedShows - before.changedShows);
+	}
+
+	return true;
+}
+
+bool clockScenario(struct SimulationResult *result)
+{
+	simulationRun(2000);
+
+	simulationType("{\"process\":\"pixels\",\"command\":\"setrandomcolour\",\"sensor\":\"clock\",\"trigger\":\"minute\"}");
+
+	struct HostPixelStats before;
+	hostGetPixelStats(&before);
+
+	simulationRun(5 * 60000);
+
+	struct HostPixelStats after;
+	hostGetPixelStats(&after);
+
+	if (!simulationOutputContains("simnet"))
+	{
+		return simulationFail(result, "the device didn't join the simulated network");
+	}
+
+	if (after.changedShows - before.changedShows < 4)
+	{
+		return simulationFail(result, "the minute listener fired %lu times in five minutes",
+							  after.changedShows - before.changedShows);
+	}
+
+	return true;
+}
+
+// Event names are written into the trace JSON as they are given, so a
+// name with a quote or a backslash in it must be escaped and a long name
+// cut short without breaking the event.
+
+bool loopTraceScenario(struct SimulationResult *result)
+{
+	simulationRun(2000);
+
+	startLoopTrace();
+	simulationRun(100);
+	recordLoopTraceEvent(traceCommand, "say \"hi\" c:\\", micros());
+	recordLoopTraceEvent(traceCommand, "a name that is far too long to fit in the event that is written out", micros());
+	stopLoopTrace();
+
+	printLoopTraceJson();
+
+	if (!simulationOutputContains("{\"name\":\"loop pass\",\"cat\":\"loop\""))
+	{
+		return simulationFail(result, "the trace has no loop passes");
+	}
+
+	if (!simulationOutputContains("{\"name\":\"say \\\"hi\\\" c:\\\\\",\"cat\":\"command\""))
+	{
+		return simulationFail(result, "the quotes and backslash in an event name weren't escaped");
+	}
+
+	if (!simulationOutputContains("\"name\":\"a name that is far too long to fit in the event\",\"cat\""))
+	{
+		return simulationFail(result, "the long event name wasn't cut short");
+	}
+
+	return true;
+}
+
+bool statsScenario(struct SimulationResult *result)
+{
+	simulationRun(5000);
+
+	simulationType("{\"process\":\"pixels\",");
+	simulationType("{\"process\":\"pixels\",\"command\":\"setnamedcolour\",\"colourname\":\"green\"}");
+	simulationRun(1000);
+	simulationType("stats");
+	simulationRun(1000);
+
+	if (!simulationOutputContains("\"cmd.parsefail\":1,"))
+	{
+		return simulationFail(result, "the bad command wasn't counted");
+	}
+
+	if (!simulationOutputContains("\"cmd.us\":{\"n\":1,"))
+	{
+		return simulationFail(result, "the command time wasn't recorded");
+	}
+
+	if (!simulationOutputContains("\"loop.rate\":[") || simulationOutputContains("\"frames.rendered\":0,"))
+	{
+		return simulationFail(result, "the loop rate or the frame count is missing");
+	}
+
+	// the rate after a reset must come from the passes since the reset
+	simulationType("stats reset");
+	simulationRun(3000);
+
+	if (metricLoopRate.count == 0 || metricLoopRate.high > metricLoopPasses.count)
+	{
+		return simulationFail(result, "a loop rate of %lu after %lu passes", metricLoopRate.high, metricLoopPasses.count);
+	}
+
+	return true;
+}
+
+bool listenerIndexScenario(struct SimulationResult *result)
+{
+	simulationRun(2000);
+
+	simulationType("listeners bench 50");
+	simulationRun(1000);
+
+	// 50 listeners over the nine clock triggers puts five on the second
+	// tick. This only checks that both paths fire the same listeners: the
+	// virtual clock doesn't move during the benchmark, so both times are
+	// always 0. "devicesim --bench listeners" times the lookups with the
+	// host clock.
+	if (!simulationOutputContains("index: 0 microseconds, 5000 listeners fired") ||
+		!simulationOutputContains("scan:  0 microseconds, 5000 listeners fired"))
+	{
+		return simulationFail(result, "the index and the scan fired different listeners");
+	}
+
+	return true;
+}
+
+// the default pot input pin
+#define SIMULATION_POT_PIN 0
+
+bool historyScenario(struct SimulationResult *result)
+{
+	hostSetAnalog(SIMULATION_POT_PIN, 100);
+	simulationRun(3000);
+	hostSetAnalog(SIMULATION_POT_PIN, 300);
+	simulationRun(3000);
+
+	simulationType("history pot s 10");
+	simulationRun(1000);
+
+	if (!simulationOutputContains("min:100.00 max:100.00 mean:100.00") ||
+		!simulationOutputContains("min:300.00 max:300.00 mean:300.00"))
+	{
+		return simulationFail(result, "the seconds tier doesn't hold both pot values");
+	}
+
+	simulationType("history pot");
+	simulationRun(1000);
+
+	if (!simulationOutputContains("this 1m min:100.00 max:300.00"))
+	{
+		return simulationFail(result, "the minutes tier didn't combine the pot values");
+	}
+
+	// the hours tier only has 24 buckets
+	simulationType("{\"process\":\"controller\",\"command\":\"history\",\"sensorname\":\"pot\",\"tier\":\"h\",\"periods\":30}");
+	simulationRun(1000);
+
+	if (!simulationOutputContains("{\"error\":-50,"))
+	{
+		return simulationFail(result, "more periods than the hours tier holds were accepted");
+	}
+
+	return true;
+}
+
+// Nobody turns the knob, so the count is held at its initial value of 50.
+// It must still turn up in every second of the history.
+
+bool heldHistoryScenario(struct SimulationResult *result)
+{
+	simulationRun(6000);
+
+	simulationType("history rotary s 5");
+	simulationRun(1000);
+
+	if (simulationOutputContains("no samples"))
+	{
+		return simulationFail(result, "a second went by without the held count");
+	}
+
+	if (simulationOutputCount("min:50.00 max:50.00 mean:50.00") != 5)
+	{
+		return simulationFail(result, "the held count isn't in each of the last five seconds");
+	}
+
+	return true;
+}
+
+// a pin that nothing on the device uses, for the synthetic edge streams
+#define SIMULATION_EDGE_PIN 20
+#define SIMULATION_EDGE_DEBOUNCE_MICROS 10000
+
+struct InputEdgeQueue simulationEdges;
+
+void simulationEdgeInterrupt()
+{
+	pushInputEdge(&simulationEdges);
+}
+
+// drives the pin through the levels with the gaps between them, without
+// running the loop
+void simulationEdgeStream(int startLevel, int noOfEdges, unsigned long gapMicros)
+{
+	int level = startLevel;
+
+	for (int i = 0; i < noOfEdges; i++)
+	{
+		hostSetPin(SIMULATION_EDGE_PIN, level);
+		hostAdvanceMicros(gapMicros);
+		level = !level;
+	}
+}
+
+// returns the number of debounced changes and puts their levels in a string
+int simulationEdgeChanges(char *levels, int length)
+{
+	int count = 0;
+	int level;
+
+	while (getInputEdgeChange(&simulationEdges, micros(), &level))
+	{
+		if (count < length - 1)
+		{
+			levels[count] = level ? 'H' : 'L';
+		}
+		count++;
+	}
+
+	levels[count < length ? count : length - 1] = 0;
+	return count;
+}
+
+bool edgesScenario(struct SimulationResult *result)
+{
+	char levels[20];
+
+	simulationRun(2000);
+
+	startInputEdgeQueue(&simulationEdges, "test", SIMULATION_EDGE_PIN, INPUT_PULLUP,
+						SIMULATION_EDGE_DEBOUNCE_MICROS, simulationEdgeInterrupt);
+
+	// a press that bounces five times over a millisecond and a half, held
+	// for 40ms and then released with three bounces
+	simulationEdgeStream(LOW, 5, 300);
+	hostAdvanceMillis(40);
+	simulationEdgeStream(HIGH, 3, 200);
+	hostAdvanceMillis(40);
+
+	if (simulationEdgeChanges(levels, sizeof(levels)) != 2 || strcmp(levels, "LH") != 0)
+	{
+		return simulationFail(result, "a bouncing press gave the changes \"%s\"", levels);
+	}
+
+	// a 2ms glitch is shorter than the debounce time
+	simulationEdgeStream(LOW, 2, 2000);
+	hostAdvanceMillis(40);
+
+	if (simulationEdgeChanges(levels, sizeof(levels)) != 0)
+	{
+		return simulationFail(result, "a glitch gave the changes \"%s\"", levels);
+	}
+
+	// more edges than the queue holds, ending low
+	simulationEdgeStream(LOW, INPUT_EDGE_QUEUE_SLOTS * 2 + 1, 1000);
+	simulationEdgeChanges(levels, sizeof(levels));
+	hostAdvanceMillis(40);
+	simulationEdgeChanges(levels, sizeof(levels));
+
+	if (simulationEdges.queue.pushFailures == 0 || simulationEdges.level != LOW)
+	{
+		return simulationFail(result, "the queue didn't recover the level after %lu lost edges",
+							  simulationEdges.queue.pushFailures);
+	}
+
+	// the button is pressed and released between two loop passes, which
+	// polling would miss
+	simulationType("{\"process\":\"pixels\",\"command\":\"pattern\",\"pattern\":\"mask\",\"colourmask\":\"W\"}");
+	simulationType("{\"process\":\"pixels\",\"command\":\"setnamedcolour\",\"colourname\":\"blue\",\"sensor\":\"button\",\"trigger\":\"pressed\"}");
+	simulationRun(1000);
+
+	struct HostPixelStats before;
+	hostGetPixelStats(&before);
+
+	hostSetPin(SIMULATION_BUTTON_PIN, LOW);
+	hostAdvanceMillis(30);
+	hostSetPin(SIMULATION_BUTTON_PIN, HIGH);
+	simulationRun(1000);
+
+	hostGetPixelStats(&result->pixels);
+
+	if (result->pixels.currentFrameHash == before.currentFrameHash)
+	{
+		return simulationFail(result, "a press between two loop passes was missed");
+	}
+
+	simulationType("edges");
+	simulationRun(100);
+
+	if (!simulationOutputContains("button pin:14 interrupt level:1 edges:2 bounces:0 changes:2"))
+	{
+		return simulationFail(result, "the button edges weren't counted");
+	}
+
+	return true;
+}
+
+int settingIntValue(const char *name)
+{
+	SettingItem *item = findSettingByName(name);
+	return item == NULL ? -1 : *(int *)item->value;
+}
+
+void clearSettingCollectionOutOfDate(SettingItemCollection *settingCollection)
+{
+	settingCollection->fileOutOfDate = false;
+}
+
+// puts the settings back to how they are when the device starts
+void simulationRestartSettings()
+{
+	iterateThroughAllSettingCollections(clearSettingCollectionOutOfDate);
+	setupSettings();
+}
+
+bool settingsJournalScenario(struct SimulationResult *result)
+{
+	simulationRun(2000);
+
+	simulationType("potsensordeadzone=77");
+	simulationRun(SETTINGS_SAVE_QUIET_MILLIS + 1000);
+
+	if (!LittleFS.exists(SETTINGS_JOURNAL_FILENAME))
+	{
+		return simulationFail(result, "the change wasn't written to the journal");
+	}
+
+	// restart the settings, which replays the journal over the snapshot,
+	// and then fold the journal into the collection files
+	simulationRestartSettings();
+	compactSettings();
+
+	if (LittleFS.exists(SETTINGS_JOURNAL_FILENAME))
+	{
+		return simulationFail(result, "the journal wasn't compacted");
+	}
+
+	// a damaged snapshot, or one from firmware with a different layout,
+	// means the settings come from the collection files
+	hostWriteFile(SETTINGS_SNAPSHOT_FILENAME, "damaged");
+	simulationRestartSettings();
+
+	if (settingIntValue("potsensordeadzone") != 77)
+	{
+		return simulationFail(result, "the setting was %d after the snapshot was lost",
+							  settingIntValue("potsensordeadzone"));
+	}
+
+	return true;
+}
+
+bool dedupScenario(struct SimulationResult *result)
+{
+	simulationRun(2000);
+
+	simulationType("{\"process\":\"pixels\",\"command\":\"pattern\",\"pattern\":\"mask\",\"colourmask\":\"W\"}");
+	simulationType("{\"process\":\"pixels\",\"command\":\"setnamedcolour\",\"colourname\":\"red\",\"steps\":1,\"seq\":7}");
+	simulationRun(1000);
+
+	struct HostPixelStats before;
+	hostGetPixelStats(&before);
+
+	// a different command that reuses the sequence number is performed
+	simulationType("{\"process\":\"pixels\",\"command\":\"setnamedcolour\",\"colourname\":\"blue\",\"steps\":1,\"seq\":7}");
+	simulationRun(1000);
+
+	struct HostPixelStats after;
+	hostGetPixelStats(&after);
+
+	if (after.currentFrameHash == before.currentFrameHash || commandDuplicatesSuppressed != 0)
+	{
+		return simulationFail(result, "a new command with an old sequence number was swallowed");
+	}
+
+	// a command store performs commands of its own, which mustn't take over
+	// the reply to the perform command
+	simulationType("{\"process\":\"pixels\",\"command\":\"setnamedcolour\",\"colourname\":\"green\",\"seq\":1,\"store\":\"nest\",\"id\":\"green\"}");
+	simulationRun(1000);
+
+	// forget the store command so the stored copy isn't answered from the cache
+	clearCommandDedupCache();
+
+	simulationType("{\"process\":\"controller\",\"command\":\"perform\",\"store\":\"nest\",\"seq\":2}");
+	simulationRun(1000);
+	simulationType("{\"process\":\"controller\",\"command\":\"perform\",\"store\":\"nest\",\"seq\":2}");
+	simulationRun(1000);
+
+	if (simulationOutputCount("Performing a command") != 1 || commandDuplicatesSuppressed != 1)
+	{
+		return simulationFail(result, "the retried perform command ran the store again");
+	}
+
+	return true;
+}
+
+int arenaSettingsFilled;
+int arenaSettingsWrong;
+
+bool isArenaSetting(SettingItem *item)
+{
+	return item->settingType == arenaText || item->settingType == arenaPassword;
+}
+
+void fillArenaSetting(SettingItem *item)
+{
+	if (!isArenaSetting(item))
+	{
+		return;
+	}
+
+	char value[MAX_SETTING_LENGTH + 1];
+	int length = item->maxLength - 1;
+
+	memset(value, 'a' + arenaSettingsFilled % 26, length);
+	value[length] = 0;
+
+	if (!item->validateValue(item->value, value) || strcmp(settingTextValue(item), value) != 0)
+	{
+		arenaSettingsWrong++;
+	}
+
+	arenaSettingsFilled++;
+}
+
+void checkArenaSetting(SettingItem *item)
+{
+	if (isArenaSetting(item) && (int)strlen(settingTextValue(item)) != item->maxLength - 1)
+	{
+		arenaSettingsWrong++;
+	}
+}
+
+bool arenaScenario(struct SimulationResult *result)
+{
+	simulationRun(2000);
+
+	// every string setting at its longest is far more than the arena holds
+	iterateThroughAllSettingItems(fillArenaSetting);
+
+	if (arenaSettingsWrong != 0 || settingsArenaStats.storeFailures != 0)
+	{
+		return simulationFail(result, "%d of %d long string settings weren't stored", arenaSettingsWrong, arenaSettingsFilled);
+	}
+
+	if (settingsArenaStats.heapStrings == 0)
+	{
+		return simulationFail(result, "the arena held every long string, so the heap wasn't tried");
+	}
+
+	// the long values survive the arena being compacted and the settings
+	// being saved and loaded again
+	simulationType("mqttuser=short");
+	simulationRun(SETTINGS_SAVE_QUIET_MILLIS + 1000);
+	char longUser[MQTT_USER_NAME_LENGTH + 10] = "mqttuser=";
+	memset(longUser + 9, 'u', MQTT_USER_NAME_LENGTH - 1);
+	longUser[MQTT_USER_NAME_LENGTH + 8] = 0;
+	simulationType(longUser);
+	simulationRun(SETTINGS_SAVE_QUIET_MILLIS + 1000);
+	setupSettings();
+
+	arenaSettingsWrong = 0;
+	iterateThroughAllSettingItems(checkArenaSetting);
+
+	if (arenaSettingsWrong != 0)
+	{
+		return simulationFail(result, "%d long string settings were lost when the settings were loaded", arenaSettingsWrong);
+	}
+
+	return true;
+}
+
+// The console reads everything that is waiting in one go, so a burst of
+// lines fills the command queue before the controller can drain it. The
+// commands that are turned away or thrown out must be sent an error reply.
+
+#define QUEUE_SCENARIO_NORMAL_COMMAND "{\"process\":\"pixels\",\"command\":\"setnamedcolour\",\"colourname\":\"red\"}"
+#define QUEUE_SCENARIO_BULK_COMMAND "{\"setting\":\"potsensordeadzone\",\"value\":5}"
+
+bool commandQueueScenario(struct SimulationResult *result)
+{
+	simulationRun(2000);
+
+	for (int i = 0; i <= COMMAND_QUEUE_NO_OF_SLOTS; i++)
+	{
+		simulationType(QUEUE_SCENARIO_NORMAL_COMMAND);
+	}
+	simulationRun(1000);
+
+	if (simulationOutputCount("{\"error\":-47,") != 1)
+	{
+		return simulationFail(result, "the command that found the queue full wasn't told");
+	}
+
+	for (int i = 0; i < COMMAND_QUEUE_NO_OF_SLOTS; i++)
+	{
+		simulationType(QUEUE_SCENARIO_BULK_COMMAND);
+	}
+	simulationType(QUEUE_SCENARIO_NORMAL_COMMAND);
+	simulationRun(1000);
+
+	if (simulationOutputCount("{\"error\":-48,") != 1)
+	{
+		return simulationFail(result, "the bulk command that was thrown out wasn't told");
+	}
+
+	// a command longer than a slot, padded out with a long colour name,
+	// is performed straight away rather than turned away. The controller
+	// rejects the colour name, which shows that it got the command.
+	char longCommand[COMMAND_QUEUE_TEXT_LENGTH + 100];
+	char padding[COMMAND_QUEUE_TEXT_LENGTH + 1];
+	memset(padding, 'x', COMMAND_QUEUE_TEXT_LENGTH);
+	padding[COMMAND_QUEUE_TEXT_LENGTH] = 0;
+	snprintf(longCommand, sizeof(longCommand),
+			 "{\"process\":\"pixels\",\"command\":\"setnamedcolour\",\"colourname\":\"%s\"}", padding);
+
+	unsigned long performedDirectly = commandQueueStats.performedDirectly;
+
+	simulationType(longCommand);
+	simulationRun(1000);
+
+	if (commandQueueStats.performedDirectly != performedDirectly + 1 ||
+		!simulationOutputContains("{\"error\":-15,"))
+	{
+		return simulationFail(result, "the long command wasn't performed");
+	}
+
+	return true;
+}
+
+// Commands typed into the console are recorded as they are performed and
+// then replayed. Every replayed command must work, which makes a recording
+// a regression test for the command path.
+
+bool replayScenario(struct SimulationResult *result)
+{
+	simulationRun(2000);
+
+	simulationType("record gate");
+	simulationRun(100);
+	simulationType("{\"process\":\"pixels\",\"command\":\"setnamedcolour\",\"colourname\":\"red\"}");
+	simulationRun(100);
+	simulationType("{\"process\":\"pixels\",\"command\":\"setcolour\",\"red\":0.2,\"green\":0.4,\"blue\":0.6}");
+	simulationRun(100);
+	simulationType("{\"process\":\"pixels\",\"command\":\"brightness\",\"value\":0.5}");
+	simulationRun(100);
+	simulationType("record");
+	simulationRun(100);
+
+	simulationType("replay gate 10");
+	simulationRun(1000);
+
+	if (!simulationOutputContains("Replayed 30 commands (0 failed)"))
+	{
+		return simulationFail(result, "the recording didn't replay 30 commands without a failure");
+	}
+
+	return true;
+}
+
+// A binary command with the command key ahead of the process key, then a
+// frame that stops part way through, which must be dropped so that the
+// next frame is read properly.
+
+bool binaryFramesScenario(struct SimulationResult *result)
+{
+	struct SimulationPack pack;
+
+	simulationRun(2000);
+
+	simulationPackMap(&pack, 3);
+	simulationPackInt(&pack, BINARY_COMMAND_COMMAND_KEY);
+	simulationPackText(&pack, "setnamedcolour");
+	simulationPackInt(&pack, BINARY_COMMAND_PROCESS_KEY);
+	simulationPackText(&pack, "pixels");
+	simulationPackText(&pack, "colourname");
+	simulationPackText(&pack, "blue");
+	simulationSendBinaryFrame(&pack, SIMULATION_PACK_LENGTH);
+	simulationRun(500);
+
+	if (simulationOutputCount("{\"error\":0,") != 1)
+	{
+		return simulationFail(result, "a command with the process key last was rejected");
+	}
+
+	simulationPackMap(&pack, 3);
+	simulationPackInt(&pack, BINARY_COMMAND_PROCESS_KEY);
+	simulationPackText(&pack, "pixels");
+	simulationPackInt(&pack, BINARY_COMMAND_COMMAND_KEY);
+	simulationPackText(&pack, "brightness");
+	simulationPackText(&pack, "value");
+	simulationPackFloat(&pack, 0.5);
+
+	// the frame start, the length and a few bytes of the command
+	simulationSendBinaryFrame(&pack, 8);
+	simulationRun(500);
+
+	if (!simulationOutputContains("Binary frame timed out after 5 bytes"))
+	{
+		return simulationFail(result, "the broken frame wasn't dropped");
+	}
+
+	simulationSendBinaryFrame(&pack, SIMULATION_PACK_LENGTH);
+	simulationRun(500);
+
+	if (simulationOutputCount("{\"error\":0,") != 2)
+	{
+		return simulationFail(result, "the frame after the broken one wasn't performed");
+	}
+
+	return true;
+}
+
+// Each loop pass is charged a fixed time on the virtual clock. The time
+// between the scheduler's sleeps is then all busy time, so the idle
+// fraction can be worked out from the passes, and nothing can be later
+// than one pass plus the one millisecond sleep step.
+
+#define SCHEDULER_SIM_PASS_COST_MICROS 3000
+#define SCHEDULER_SIM_MILLIS 20000
+
+bool schedulerScenario(struct SimulationResult *result)
+{
+	simulationRun(2000);
+
+	simulationSetPassCost(SCHEDULER_SIM_PASS_COST_MICROS);
+	simulationType("scheduler reset");
+	simulationRun(SCHEDULER_SIM_MILLIS);
+	simulationType("scheduler");
+	simulationRun(100);
+
+	unsigned long long totalMicros = schedulerStats.sleepMicros + schedulerStats.busyMicros;
+	unsigned long long expectedBusyMicros = (unsigned long long)schedulerStats.passes * SCHEDULER_SIM_PASS_COST_MICROS;
+
+	if (totalMicros < (unsigned long long)SCHEDULER_SIM_MILLIS * 1000)
+	{
+		return simulationFail(result, "the scheduler accounted for %llu of %d microseconds", totalMicros, SCHEDULER_SIM_MILLIS * 1000);
+	}
+
+	// the pass that was running when the statistics were reset isn't counted
+	if (schedulerStats.busyMicros > expectedBusyMicros + SCHEDULER_SIM_PASS_COST_MICROS ||
+		schedulerStats.busyMicros + SCHEDULER_SIM_PASS_COST_MICROS < expectedBusyMicros)
+	{
+		return simulationFail(result, "%llu busy microseconds for %lu passes", schedulerStats.busyMicros, schedulerStats.passes);
+	}
+
+	int idlePercent = (int)((schedulerStats.sleepMicros * 100) / totalMicros);
+
+	// the items that are still polled every 5ms keep the loop awake for
+	// 3ms in every 7 or so
+	if (idlePercent < 50)
+	{
+		return simulationFail(result, "the loop was idle for only %d%% of the time", idlePercent);
+	}
+
+	if (schedulerStats.worstLatenessMillis > SCHEDULER_SIM_PASS_COST_MICROS / 1000 + 1)
+	{
+		return simulationFail(result, "%s was %lums late", schedulerStats.worstLatenessName, schedulerStats.worstLatenessMillis);
+	}
+
+	return true;
+}
+
+bool timerWheelScenario(struct SimulationResult *result)
+{
+	simulationRun(2000);
+
+	simulationType("timers test");
+	simulationRun(1000);
+
+	if (!simulationOutputContains("Timer wheel self test passed") || simulationOutputContains("FAIL:"))
+	{
+		return simulationFail(result, "the timer wheel self test failed");
+	}
+
+	return true;
+}
+
+// A fast boot leaves the registration and printer processes until the
+// network has settled. With WiFi off that happens as soon as the WiFi
+// process reports it, long before the fallback timeout.
+
+bool fastBootScenario(struct SimulationResult *result)
+{
+	simulationRun(3000);
+
+	if (!simulationOutputContains("Fast boot"))
+	{
+		return simulationFail(result, "the fastboot setting wasn't loaded");
+	}
+
+	if (!simulationOutputContains("Starting deferred processes"))
+	{
+		return simulationFail(result, "the deferred processes weren't started");
+	}
+
+	simulationType("bootprofile");
+	simulationRun(1000);
+
+	if (!simulationOutputContains("Boot profile (fast boot)") ||
+		!simulationOutputContains("deferred starts"))
+	{
+		return simulationFail(result, "the boot profile doesn't show the deferred starts");
+	}
+
+	return true;
+}
+
+struct SimulationScenario simulationScenarios[] = {
+	{"boot", "boot the device and run it for ten seconds", "", bootScenario},
+	{"fastboot", "boot with fastboot=yes and check that the deferred processes start", "fastboot=yes\n", fastBootScenario},
+	{"commandstore", "store a command and then perform the store", "", commandStoreScenario},
+	{"listener", "press and release the button with listeners on both", "pushbuttonfitted=yes\n", listenerScenario},
+	{"animation", "twinkle the pixels for a minute", "", animationScenario},
+	{"listenerindex", "fire the second tick on 50 clock listeners through the trigger index", "", listenerIndexScenario},
+	{"arena", "store every string setting at its longest and load them again", "", arenaScenario},
+	{"dedup", "reuse a sequence number and retry a command that performs a store", "", dedupScenario},
+	{"settingsjournal", "set a value, restart, compact the journal and reload without the snapshot", "", settingsJournalScenario},
+	{"edges", "debounce synthetic edge streams and catch a press between two loop passes", "pushbuttonfitted=yes\n", edgesScenario},
+	{"history", "turn the pot and read back its history", "potsensorfitted=yes\npotsensorhistory=yes\n", historyScenario},
+	{"heldhistory", "leave the rotary encoder alone and check its history", "rotarysensorfitted=yes\nrotarysensorhistory=yes\n", heldHistoryScenario},
+	{"commandqueue", "overfill the command queue and check that dropped commands get a reply", "", commandQueueScenario},
+	{"replay", "record three commands from the console and replay them ten times", "", replayScenario},
+	{"binaryframes", "send binary commands in any key order and recover from a broken frame", "", binaryFramesScenario},
+	{"scheduler", "charge each loop pass 3ms and check the idle time and the worst lateness", "", schedulerScenario},
+	{"timerwheel", "run the timer wheel self test across the millis wrap", "", timerWheelScenario},
+	{"stats", "count a bad and a good command and show the metrics", "", statsScenario},
+	{"looptrace", "trace the loop and write event names that need escaping as JSON", "", loopTraceScenario},
+	{"clock", "join the simulated network and change colour every minute", "wifiactive=yes\nwifissid1=" HOST_SIMULATED_SSID "\n", clockScenario},
+	{"wifistore", "perform the wifion command store from the bus when the network connects", "wifiactive=yes\nwifissid1=" HOST_SIMULATED_SSID "\n", wifiStoreScenario}};
+
+int noOfSimulationScenarios = sizeof(simulationScenarios) / sizeof(struct SimulationScenario);
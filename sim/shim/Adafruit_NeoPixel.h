@@ -0,0 +1,31 @@
+#pragma once
+
+#include <Arduino.h>
+
+#define NEO_RGB 0x06
+#define NEO_GRB 0x52
+#define NEO_KHZ800 0x0000
+#define NEO_KHZ400 0x0100
+
+// A pixel strip that keeps the colours in memory. show() counts the frames
+// and adds them to a hash so that a run can be compared with another one.
+
+class Adafruit_NeoPixel
+{
+public:
+	Adafruit_NeoPixel(uint16_t noOfPixels, int16_t pin, uint16_t type);
+	~Adafruit_NeoPixel();
+
+	void begin();
+	void show();
+	void clear();
+	void setBrightness(uint8_t brightness) {}
+	void setPixelColor(uint16_t pixel, uint8_t red, uint8_t green, uint8_t blue);
+	void setPixelColor(uint16_t pixel, uint32_t colour);
+	uint32_t getPixelColor(uint16_t pixel);
+	uint16_t numPixels() { return noOfPixels; }
+
+private:
+	uint16_t noOfPixels;
+	uint8_t *pixels;
+};
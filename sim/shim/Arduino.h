@@ -0,0 +1,222 @@
+#pragma once
+
+// A small stand-in for the Arduino core so that the device code can be built
+// and run on the host. Time only moves when the simulation moves it (or the
+// device code calls delay), so a run is the same every time.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdarg.h>
+#include <math.h>
+#include <ctype.h>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+class __FlashStringHelper;
+
+#define HIGH 1
+#define LOW 0
+
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define INPUT_PULLDOWN 3
+
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+
+#define NOT_AN_INTERRUPT -1
+
+#define DEC 10
+#define HEX 16
+
+#define LED_BUILTIN 2
+
+#define IRAM_ATTR
+#define ICACHE_RAM_ATTR
+#define PROGMEM
+#define PGM_P const char *
+#define PGM_VOID_P const void *
+#define F(s) (s)
+#define PSTR(s) (s)
+#define memcpy_P memcpy
+#define memccpy_P memccpy
+#define strcpy_P strcpy
+#define strlen_P strlen
+#define strcmp_P strcmp
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_byte_near(p) (*(const uint8_t *)(p))
+#define pgm_read_word(p) (*(const uint16_t *)(p))
+#define pgm_read_dword(p) (*(const uint32_t *)(p))
+
+// the pin names of a Wemos D1 mini, which the default settings use
+#define D0 16
+#define D1 5
+#define D2 4
+#define D3 0
+#define D4 2
+#define D5 14
+#define D6 12
+#define D7 13
+#define D8 15
+#define A0 17
+
+#define HOST_NO_OF_PINS 40
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+void pinMode(int pin, int mode);
+int digitalRead(int pin);
+void digitalWrite(int pin, int value);
+int analogRead(int pin);
+void analogWrite(int pin, int value);
+
+int digitalPinToInterrupt(int pin);
+void attachInterrupt(int interrupt, void (*handler)(), int mode);
+void detachInterrupt(int interrupt);
+void noInterrupts();
+void interrupts();
+
+inline bool isAlpha(int ch) { return isalpha(ch) != 0; }
+inline bool isDigit(int ch) { return isdigit(ch) != 0; }
+inline bool isAlphaNumeric(int ch) { return isalnum(ch) != 0; }
+inline bool isWhitespace(int ch) { return ch == ' ' || ch == '\t'; }
+inline bool isSpace(int ch) { return isspace(ch) != 0; }
+inline bool isUpperCase(int ch) { return isupper(ch) != 0; }
+inline bool isLowerCase(int ch) { return islower(ch) != 0; }
+inline int toLowerCase(int ch) { return tolower(ch); }
+inline int toUpperCase(int ch) { return toupper(ch); }
+
+long random(long limit);
+long random(long low, long high);
+void randomSeed(unsigned long seed);
+
+class String
+{
+public:
+	String(const char *text = "");
+	String(const String &other);
+	String(int value);
+	~String();
+
+	String &operator=(const String &other);
+	String &operator=(const char *text);
+	String &operator+=(const String &other);
+	String &operator+=(const char *text);
+	String &operator+=(char ch);
+
+	friend String operator+(const String &left, const String &right);
+	friend String operator+(const String &left, const char *right);
+
+	bool operator==(const char *text) const;
+
+	const char *c_str() const { return buffer; }
+	unsigned int length() const { return (unsigned int)strlen(buffer); }
+	void toCharArray(char *dest, unsigned int destLength) const;
+
+private:
+	char *buffer;
+};
+
+extern const String emptyString;
+
+class Print
+{
+public:
+	virtual ~Print() {}
+	virtual size_t write(uint8_t ch) = 0;
+	virtual size_t write(const uint8_t *data, size_t length);
+
+	size_t write(const char *text) { return write((const uint8_t *)text, strlen(text)); }
+
+	size_t print(const char *text);
+	size_t print(const String &text);
+	size_t print(char ch);
+	size_t print(int value, int base = DEC);
+	size_t print(unsigned int value, int base = DEC);
+	size_t print(long value, int base = DEC);
+	size_t print(unsigned long value, int base = DEC);
+	size_t print(double value, int digits = 2);
+
+	size_t println();
+	size_t println(const char *text);
+	size_t println(const String &text);
+	size_t println(char ch);
+	size_t println(int value, int base = DEC);
+	size_t println(unsigned int value, int base = DEC);
+	size_t println(long value, int base = DEC);
+	size_t println(unsigned long value, int base = DEC);
+	size_t println(double value, int digits = 2);
+
+	size_t printf(const char *format, ...);
+};
+
+class Stream : public Print
+{
+public:
+	virtual int available() = 0;
+	virtual int read() = 0;
+	virtual int peek() = 0;
+
+	size_t readBytes(char *buffer, size_t length);
+	size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
+	String readStringUntil(char terminator);
+	void setTimeout(unsigned long timeout) {}
+};
+
+// Serial input comes from the simulation, which queues text for the
+// console. Output goes to the simulation's serial sink.
+
+class HardwareSerial : public Stream
+{
+public:
+	HardwareSerial(int portNo) : portNo(portNo) {}
+
+	void begin(unsigned long baud) {}
+	void begin(unsigned long baud, int config, int rxPin = -1, int txPin = -1) {}
+	void end() {}
+	void flush() {}
+	void swap() {}
+	operator bool() { return true; }
+
+	size_t write(uint8_t ch) override;
+	size_t write(const uint8_t *data, size_t length) override;
+	using Print::write;
+
+	int available() override;
+	int read() override;
+	int peek() override;
+
+private:
+	int portNo;
+};
+
+#define SERIAL_8N1 0
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
+
+class EspClass
+{
+public:
+	uint32_t getFreeHeap();
+	uint32_t getMaxFreeBlockSize();
+	uint8_t getHeapFragmentation();
+	uint32_t getChipId();
+	uint64_t getEfuseMac();
+	uint32_t getCycleCount();
+	void restart();
+};
+
+extern EspClass ESP;
@@ -0,0 +1,3 @@
+#pragma once
+
+// the trace macros are not used on the host
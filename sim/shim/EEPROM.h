@@ -0,0 +1,5 @@
+#pragma once
+
+#include <Arduino.h>
+
+// the device code includes EEPROM.h but keeps its data in the file system
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <memory>
+
+// An in-memory file system with the parts of the LittleFS API that the
+// device code uses. Folders are listed in name order and a file name is the
+// name within its folder, as on the ESP8266.
+
+struct HostFileHandle;
+
+class File : public Stream
+{
+public:
+	File() {}
+	File(std::shared_ptr<HostFileHandle> handle) : handle(handle) {}
+
+	operator bool() const;
+	bool isDirectory();
+	File openNextFile();
+	const char *name();
+	size_t size();
+	size_t position();
+	bool seek(uint32_t position);
+	void flush() {}
+	void close();
+
+	size_t write(uint8_t ch) override;
+	size_t write(const uint8_t *data, size_t length) override;
+	using Print::write;
+
+	int available() override;
+	int read() override;
+	int peek() override;
+	size_t read(uint8_t *buffer, size_t length);
+
+private:
+	std::shared_ptr<HostFileHandle> handle;
+};
+
+class FSClass
+{
+public:
+	bool begin(bool formatOnFail = false);
+	bool format();
+	File open(const char *path, const char *mode);
+	bool exists(const char *path);
+	bool mkdir(const char *path);
+	bool remove(const char *path);
+	bool rmdir(const char *path);
+	bool rename(const char *fromPath, const char *toPath);
+};
+
+extern FSClass LittleFS;
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "WiFi.h"
+
+#define MQTT_CONNECTION_TIMEOUT -4
+#define MQTT_CONNECTION_LOST -3
+#define MQTT_CONNECT_FAILED -2
+#define MQTT_DISCONNECTED -1
+#define MQTT_CONNECTED 0
+#define MQTT_CONNECT_BAD_PROTOCOL 1
+#define MQTT_CONNECT_BAD_CLIENT_ID 2
+#define MQTT_CONNECT_UNAVAILABLE 3
+#define MQTT_CONNECT_BAD_CREDENTIALS 4
+#define MQTT_CONNECT_UNAUTHORIZED 5
+
+// There is no broker on the simulated network, so a connect always fails.
+
+class PubSubClient
+{
+public:
+	PubSubClient(WiFiClient &client) {}
+
+	bool setBufferSize(uint16_t size) { return true; }
+	PubSubClient &setServer(const char *host, uint16_t port) { return *this; }
+	PubSubClient &setCallback(void (*callback)(char *topic, uint8_t *payload, unsigned int length)) { return *this; }
+
+	bool connect(const char *id, const char *user, const char *password) { return false; }
+	void disconnect() {}
+	bool connected() { return false; }
+	int state() { return MQTT_CONNECT_UNAVAILABLE; }
+	bool subscribe(const char *topic) { return false; }
+	bool publish(const char *topic, const char *payload) { return false; }
+	bool loop() { return false; }
+};
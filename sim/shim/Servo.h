@@ -0,0 +1,23 @@
+#pragma once
+
+#include <Arduino.h>
+
+// A servo that remembers where it was last told to go
+
+class Servo
+{
+public:
+	uint8_t attach(int pin, int minMicros = 544, int maxMicros = 2400)
+	{
+		this->pin = pin;
+		return 0;
+	}
+	void detach() { pin = -1; }
+	void write(int value) { position = value; }
+	int read() { return position; }
+	bool attached() { return pin >= 0; }
+
+private:
+	int pin = -1;
+	int position = 0;
+};
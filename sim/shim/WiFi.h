@@ -0,0 +1,66 @@
+#pragma once
+
+#include <Arduino.h>
+
+// The simulated network has one access point, HOST_SIMULATED_SSID. A scan
+// finishes straight away and joining that access point always works.
+
+#define WL_IDLE_STATUS 0
+#define WL_NO_SSID_AVAIL 1
+#define WL_SCAN_COMPLETED 2
+#define WL_CONNECTED 3
+#define WL_CONNECT_FAILED 4
+#define WL_CONNECTION_LOST 5
+#define WL_DISCONNECTED 6
+
+#define WIFI_SCAN_RUNNING (-1)
+#define WIFI_SCAN_FAILED (-2)
+
+enum WiFiMode_t
+{
+	WIFI_OFF,
+	WIFI_STA,
+	WIFI_AP,
+	WIFI_AP_STA
+};
+
+class IPAddress
+{
+public:
+	IPAddress(uint8_t first, uint8_t second, uint8_t third, uint8_t fourth);
+	String toString() const;
+
+private:
+	uint8_t address[4];
+};
+
+class WiFiClass
+{
+public:
+	bool mode(WiFiMode_t mode);
+	int begin(const char *ssid, const char *password = NULL);
+	bool disconnect(bool wifiOff = false);
+	int status();
+	int scanNetworks(bool async = false);
+	int scanComplete();
+	void scanDelete();
+	String SSID(int networkNo);
+	String SSID();
+	IPAddress localIP();
+	uint8_t *macAddress(uint8_t *mac);
+	bool softAP(const char *ssid, const char *password = NULL);
+};
+
+extern WiFiClass WiFi;
+
+class WiFiClient
+{
+public:
+	virtual ~WiFiClient() {}
+};
+
+class WiFiClientSecure : public WiFiClient
+{
+public:
+	void setInsecure() {}
+};
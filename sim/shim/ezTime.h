@@ -0,0 +1,41 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <time.h>
+
+// The time on the simulated network is HOST_SIMULATED_EPOCH plus the
+// virtual clock. It is set once the simulated WiFi is connected.
+
+#define RFC3339 "Y-m-d\\TH:i:sP"
+
+enum timeStatus_t
+{
+	timeNotSet,
+	timeSet,
+	timeNeedsSync
+};
+
+class Timezone
+{
+public:
+	bool setLocation(const String location = "");
+	time_t now();
+	uint8_t hour();
+	uint8_t minute();
+	uint8_t second();
+	uint8_t day();
+	uint8_t weekday();
+	uint8_t month();
+	uint16_t year();
+	String dateTime(const String format = RFC3339);
+
+private:
+	struct tm localTime();
+};
+
+extern Timezone UTC;
+
+void events();
+timeStatus_t timeStatus();
+bool waitForSync(uint16_t timeout = 0);
@@ -0,0 +1,629 @@
+#include <Arduino.h>
+
+#include <string>
+
+#include "hostShim.h"
+
+// virtual clock
+
+uint64_t hostMicrosNow = 0;
+
+uint64_t hostMicros()
+{
+	return hostMicrosNow;
+}
+
+void hostAdvanceMicros(uint64_t micros)
+{
+	hostMicrosNow += micros;
+}
+
+void hostAdvanceMillis(unsigned long millis)
+{
+	hostMicrosNow += (uint64_t)millis * 1000;
+}
+
+unsigned long millis()
+{
+	// wraps like the device clock does
+	return (uint32_t)(hostMicrosNow / 1000);
+}
+
+unsigned long micros()
+{
+	return (uint32_t)hostMicrosNow;
+}
+
+void delay(unsigned long ms)
+{
+	hostAdvanceMillis(ms);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+	hostAdvanceMicros(us);
+}
+
+void yield()
+{
+}
+
+// pins
+
+struct HostPin
+{
+	int mode;
+	int input;
+	int output;
+	int analog;
+	void (*handler)();
+	int interruptMode;
+};
+
+HostPin hostPins[HOST_NO_OF_PINS];
+
+HostPin *findHostPin(int pin)
+{
+	if (pin < 0 || pin >= HOST_NO_OF_PINS)
+	{
+		return NULL;
+	}
+	return &hostPins[pin];
+}
+
+void pinMode(int pin, int mode)
+{
+	HostPin *hostPin = findHostPin(pin);
+
+	if (hostPin == NULL)
+	{
+		return;
+	}
+
+	hostPin->mode = mode;
+
+	if (mode == INPUT_PULLUP)
+	{
+		hostPin->input = HIGH;
+	}
+}
+
+int digitalRead(int pin)
+{
+	HostPin *hostPin = findHostPin(pin);
+
+	if (hostPin == NULL)
+	{
+		return LOW;
+	}
+
+	if (hostPin->mode == OUTPUT)
+	{
+		return hostPin->output;
+	}
+
+	return hostPin->input;
+}
+
+void digitalWrite(int pin, int value)
+{
+	HostPin *hostPin = findHostPin(pin);
+
+	if (hostPin != NULL)
+	{
+		hostPin->output = value;
+	}
+}
+
+int analogRead(int pin)
+{
+	HostPin *hostPin = findHostPin(pin);
+
+	if (hostPin == NULL)
+	{
+		return 0;
+	}
+	return hostPin->analog;
+}
+
+void analogWrite(int pin, int value)
+{
+	digitalWrite(pin, value);
+}
+
+int digitalPinToInterrupt(int pin)
+{
+	return pin;
+}
+
+void attachInterrupt(int interrupt, void (*handler)(), int mode)
+{
+	HostPin *hostPin = findHostPin(interrupt);
+
+	if (hostPin != NULL)
+	{
+		hostPin->handler = handler;
+		hostPin->interruptMode = mode;
+	}
+}
+
+void detachInterrupt(int interrupt)
+{
+	HostPin *hostPin = findHostPin(interrupt);
+
+	if (hostPin != NULL)
+	{
+		hostPin->handler = NULL;
+	}
+}
+
+void noInterrupts()
+{
+}
+
+void interrupts()
+{
+}
+
+void hostSetPin(int pin, int value)
+{
+	HostPin *hostPin = findHostPin(pin);
+
+	if (hostPin == NULL)
+	{
+		return;
+	}
+
+	int oldValue = hostPin->input;
+	hostPin->input = value ? HIGH : LOW;
+
+	if (hostPin->handler == NULL || oldValue == hostPin->input)
+	{
+		return;
+	}
+
+	switch (hostPin->interruptMode)
+	{
+	case RISING:
+		if (hostPin->input == HIGH)
+		{
+			hostPin->handler();
+		}
+		break;
+	case FALLING:
+		if (hostPin->input == LOW)
+		{
+			hostPin->handler();
+		}
+		break;
+	default:
+		hostPin->handler();
+		break;
+	}
+}
+
+void hostSetAnalog(int pin, int value)
+{
+	HostPin *hostPin = findHostPin(pin);
+
+	if (hostPin != NULL)
+	{
+		hostPin->analog = value;
+	}
+}
+
+int hostPinOutput(int pin)
+{
+	HostPin *hostPin = findHostPin(pin);
+
+	if (hostPin == NULL)
+	{
+		return LOW;
+	}
+	return hostPin->output;
+}
+
+// random numbers - a fixed generator so that runs repeat
+
+unsigned long hostRandomState = 1;
+
+long random(long limit)
+{
+	if (limit <= 0)
+	{
+		return 0;
+	}
+	hostRandomState = hostRandomState * 1103515245UL + 12345UL;
+	return (long)((hostRandomState >> 16) & 0x7fff) % limit;
+}
+
+long random(long low, long high)
+{
+	if (high <= low)
+	{
+		return low;
+	}
+	return low + random(high - low);
+}
+
+void randomSeed(unsigned long seed)
+{
+	hostRandomState = seed;
+}
+
+// String
+
+char *copyHostText(const char *text)
+{
+	if (text == NULL)
+	{
+		text = "";
+	}
+	size_t length = strlen(text);
+	char *result = (char *)malloc(length + 1);
+	memcpy(result, text, length + 1);
+	return result;
+}
+
+String::String(const char *text) : buffer(copyHostText(text))
+{
+}
+
+String::String(const String &other) : buffer(copyHostText(other.buffer))
+{
+}
+
+String::String(int value)
+{
+	char text[12];
+	snprintf(text, sizeof(text), "%d", value);
+	buffer = copyHostText(text);
+}
+
+String::~String()
+{
+	free(buffer);
+}
+
+String &String::operator=(const String &other)
+{
+	if (this != &other)
+	{
+		*this = other.buffer;
+	}
+	return *this;
+}
+
+String &String::operator=(const char *text)
+{
+	char *newBuffer = copyHostText(text);
+	free(buffer);
+	buffer = newBuffer;
+	return *this;
+}
+
+String &String::operator+=(const char *text)
+{
+	std::string joined = std::string(buffer) + (text == NULL ? "" : text);
+	return *this = joined.c_str();
+}
+
+String &String::operator+=(const String &other)
+{
+	return *this += other.buffer;
+}
+
+String &String::operator+=(char ch)
+{
+	char text[2] = {ch, 0};
+	return *this += text;
+}
+
+String operator+(const String &left, const char *right)
+{
+	String result(left);
+	result += right;
+	return result;
+}
+
+String operator+(const String &left, const String &right)
+{
+	return left + right.buffer;
+}
+
+bool String::operator==(const char *text) const
+{
+	return strcmp(buffer, text) == 0;
+}
+
+void String::toCharArray(char *dest, unsigned int destLength) const
+{
+	if (destLength == 0)
+	{
+		return;
+	}
+	strncpy(dest, buffer, destLength - 1);
+	dest[destLength - 1] = 0;
+}
+
+const String emptyString;
+
+// Print and Stream
+
+size_t Print::write(const uint8_t *data, size_t length)
+{
+	for (size_t i = 0; i < length; i++)
+	{
+		write(data[i]);
+	}
+	return length;
+}
+
+size_t Print::printf(const char *format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	char *text = NULL;
+	int length = vasprintf(&text, format, args);
+	va_end(args);
+
+	if (length < 0)
+	{
+		return 0;
+	}
+
+	write((const uint8_t *)text, length);
+	free(text);
+	return length;
+}
+
+size_t Print::print(const char *text)
+{
+	return write((const uint8_t *)text, strlen(text));
+}
+
+size_t Print::print(const String &text)
+{
+	return print(text.c_str());
+}
+
+size_t Print::print(char ch)
+{
+	return write((uint8_t)ch);
+}
+
+size_t Print::print(long value, int base)
+{
+	return printf(base == HEX ? "%lx" : "%ld", value);
+}
+
+size_t Print::print(unsigned long value, int base)
+{
+	return printf(base == HEX ? "%lx" : "%lu", value);
+}
+
+size_t Print::print(int value, int base)
+{
+	return print((long)value, base);
+}
+
+size_t Print::print(unsigned int value, int base)
+{
+	return print((unsigned long)value, base);
+}
+
+size_t Print::print(double value, int digits)
+{
+	return printf("%.*f", digits, value);
+}
+
+size_t Print::println()
+{
+	return print("\r\n");
+}
+
+size_t Print::println(const char *text)
+{
+	return print(text) + println();
+}
+
+size_t Print::println(const String &text)
+{
+	return print(text) + println();
+}
+
+size_t Print::println(char ch)
+{
+	return print(ch) + println();
+}
+
+size_t Print::println(int value, int base)
+{
+	return print(value, base) + println();
+}
+
+size_t Print::println(unsigned int value, int base)
+{
+	return print(value, base) + println();
+}
+
+size_t Print::println(long value, int base)
+{
+	return print(value, base) + println();
+}
+
+size_t Print::println(unsigned long value, int base)
+{
+	return print(value, base) + println();
+}
+
+size_t Print::println(double value, int digits)
+{
+	return print(value, digits) + println();
+}
+
+size_t Stream::readBytes(char *buffer, size_t length)
+{
+	size_t count = 0;
+
+	while (count < length && available())
+	{
+		buffer[count++] = (char)read();
+	}
+	return count;
+}
+
+String Stream::readStringUntil(char terminator)
+{
+	std::string text;
+
+	while (available())
+	{
+		int ch = read();
+
+		if (ch == terminator)
+		{
+			break;
+		}
+		text += (char)ch;
+	}
+	return String(text.c_str());
+}
+
+// Serial
+
+std::string hostSerialInputText;
+size_t hostSerialInputPos = 0;
+
+void hostSerialToStdout(const char *text, size_t length)
+{
+	fwrite(text, 1, length, stdout);
+}
+
+void (*hostSerialSink)(const char *text, size_t length) = hostSerialToStdout;
+
+void hostSetSerialSink(void (*sink)(const char *text, size_t length))
+{
+	hostSerialSink = sink;
+}
+
+void hostSerialInput(const char *text)
+{
+	if (hostSerialInputPos == hostSerialInputText.length())
+	{
+		hostSerialInputText.clear();
+		hostSerialInputPos = 0;
+	}
+	hostSerialInputText += text;
+}
+
+void hostSerialInputBytes(const char *data, size_t length)
+{
+	if (hostSerialInputPos == hostSerialInputText.length())
+	{
+		hostSerialInputText.clear();
+		hostSerialInputPos = 0;
+	}
+	hostSerialInputText.append(data, length);
+}
+
+size_t HardwareSerial::write(uint8_t ch)
+{
+	return write(&ch, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t *data, size_t length)
+{
+	// only the first port is connected to anything
+	if (portNo == 0 && hostSerialSink != NULL)
+	{
+		hostSerialSink((const char *)data, length);
+	}
+	return length;
+}
+
+int HardwareSerial::available()
+{
+	if (portNo != 0)
+	{
+		return 0;
+	}
+	return (int)(hostSerialInputText.length() - hostSerialInputPos);
+}
+
+int HardwareSerial::read()
+{
+	if (available() == 0)
+	{
+		return -1;
+	}
+	return (unsigned char)hostSerialInputText[hostSerialInputPos++];
+}
+
+int HardwareSerial::peek()
+{
+	if (available() == 0)
+	{
+		return -1;
+	}
+	return (unsigned char)hostSerialInputText[hostSerialInputPos];
+}
+
+HardwareSerial Serial(0);
+HardwareSerial Serial1(1);
+HardwareSerial Serial2(2);
+
+// ESP
+
+uint32_t EspClass::getFreeHeap()
+{
+	// the simulation has no heap limit, so report a healthy device
+	return 40000;
+}
+
+uint32_t EspClass::getMaxFreeBlockSize()
+{
+	return 40000;
+}
+
+uint8_t EspClass::getHeapFragmentation()
+{
+	return 0;
+}
+
+uint32_t EspClass::getChipId()
+{
+	return 0x51a17e;
+}
+
+uint64_t EspClass::getEfuseMac()
+{
+	return 0x51a17e;
+}
+
+uint32_t EspClass::getCycleCount()
+{
+	// an 80MHz clock
+	return (uint32_t)(hostMicrosNow * 80);
+}
+
+void hostRestartExit()
+{
+	fflush(stdout);
+	fprintf(stderr, "\nThe device restarted - the simulation has ended\n");
+	exit(0);
+}
+
+void (*hostRestartHandler)() = hostRestartExit;
+
+void hostSetRestartHandler(void (*handler)())
+{
+	hostRestartHandler = handler;
+}
+
+void EspClass::restart()
+{
+	hostRestartHandler();
+}
+
+EspClass ESP;
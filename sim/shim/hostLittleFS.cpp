@@ -0,0 +1,390 @@
+#include <Arduino.h>
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "FS.h"
+#include "hostShim.h"
+
+std::map<std::string, std::string> hostFiles;
+std::set<std::string> hostFolders = {"/"};
+
+struct HostFileHandle
+{
+	std::string path;
+	std::string name;
+	bool isFolder;
+	bool open;
+	size_t position;
+	// the entries of a folder, made when the folder is opened
+	std::vector<std::string> entries;
+	size_t nextEntry;
+};
+
+std::string hostPath(const char *path)
+{
+	std::string result = path == NULL ? "/" : path;
+
+	if (result.empty() || result[0] != '/')
+	{
+		result = "/" + result;
+	}
+
+	while (result.length() > 1 && result[result.length() - 1] == '/')
+	{
+		result.erase(result.length() - 1);
+	}
+	return result;
+}
+
+std::string hostParentFolder(const std::string &path)
+{
+	size_t slash = path.rfind('/');
+
+	if (slash == 0)
+	{
+		return "/";
+	}
+	return path.substr(0, slash);
+}
+
+std::string hostBaseName(const std::string &path)
+{
+	return path.substr(path.rfind('/') + 1);
+}
+
+void addHostParentFolders(const std::string &path)
+{
+	std::string parent = hostParentFolder(path);
+
+	while (hostFolders.count(parent) == 0)
+	{
+		hostFolders.insert(parent);
+		parent = hostParentFolder(parent);
+	}
+}
+
+std::shared_ptr<HostFileHandle> makeHostFileHandle(const std::string &path, bool isFolder)
+{
+	std::shared_ptr<HostFileHandle> handle = std::make_shared<HostFileHandle>();
+
+	handle->path = path;
+	handle->name = hostBaseName(path);
+	handle->isFolder = isFolder;
+	handle->open = true;
+	handle->position = 0;
+	handle->nextEntry = 0;
+
+	if (isFolder)
+	{
+		std::string prefix = path == "/" ? "/" : path + "/";
+		std::set<std::string> entries;
+
+		for (auto &file : hostFiles)
+		{
+			if (file.first.compare(0, prefix.length(), prefix) == 0 &&
+				file.first.find('/', prefix.length()) == std::string::npos)
+			{
+				entries.insert(file.first);
+			}
+		}
+
+		for (auto &folder : hostFolders)
+		{
+			if (folder != path && folder.compare(0, prefix.length(), prefix) == 0 &&
+				folder.find('/', prefix.length()) == std::string::npos)
+			{
+				entries.insert(folder);
+			}
+		}
+
+		handle->entries.assign(entries.begin(), entries.end());
+	}
+
+	return handle;
+}
+
+File::operator bool() const
+{
+	return handle != nullptr && handle->open;
+}
+
+bool File::isDirectory()
+{
+	return *this && handle->isFolder;
+}
+
+File File::openNextFile()
+{
+	if (!isDirectory())
+	{
+		return File();
+	}
+
+	while (handle->nextEntry < handle->entries.size())
+	{
+		std::string path = handle->entries[handle->nextEntry++];
+
+		// skip anything removed since the folder was opened
+		if (hostFiles.count(path) != 0)
+		{
+			return File(makeHostFileHandle(path, false));
+		}
+
+		if (hostFolders.count(path) != 0)
+		{
+			return File(makeHostFileHandle(path, true));
+		}
+	}
+
+	return File();
+}
+
+const char *File::name()
+{
+	if (handle == nullptr)
+	{
+		return "";
+	}
+	return handle->name.c_str();
+}
+
+std::string *hostFileContents(std::shared_ptr<HostFileHandle> &handle)
+{
+	if (handle == nullptr || !handle->open || handle->isFolder)
+	{
+		return NULL;
+	}
+
+	auto file = hostFiles.find(handle->path);
+
+	if (file == hostFiles.end())
+	{
+		return NULL;
+	}
+	return &file->second;
+}
+
+size_t File::size()
+{
+	std::string *contents = hostFileContents(handle);
+
+	if (contents == NULL)
+	{
+		return 0;
+	}
+	return contents->length();
+}
+
+size_t File::position()
+{
+	if (handle == nullptr)
+	{
+		return 0;
+	}
+	return handle->position;
+}
+
+bool File::seek(uint32_t position)
+{
+	if (position > size())
+	{
+		return false;
+	}
+	handle->position = position;
+	return true;
+}
+
+void File::close()
+{
+	if (handle != nullptr)
+	{
+		handle->open = false;
+	}
+}
+
+size_t File::write(uint8_t ch)
+{
+	return write(&ch, 1);
+}
+
+size_t File::write(const uint8_t *data, size_t length)
+{
+	std::string *contents = hostFileContents(handle);
+
+	if (contents == NULL)
+	{
+		return 0;
+	}
+
+	contents->replace(handle->position, length, (const char *)data, length);
+	handle->position += length;
+	return length;
+}
+
+int File::available()
+{
+	std::string *contents = hostFileContents(handle);
+
+	if (contents == NULL || handle->position >= contents->length())
+	{
+		return 0;
+	}
+	return (int)(contents->length() - handle->position);
+}
+
+int File::read()
+{
+	if (available() == 0)
+	{
+		return -1;
+	}
+	return (unsigned char)(*hostFileContents(handle))[handle->position++];
+}
+
+int File::peek()
+{
+	if (available() == 0)
+	{
+		return -1;
+	}
+	return (unsigned char)(*hostFileContents(handle))[handle->position];
+}
+
+size_t File::read(uint8_t *buffer, size_t length)
+{
+	return readBytes(buffer, length);
+}
+
+bool FSClass::begin(bool formatOnFail)
+{
+	return true;
+}
+
+bool FSClass::format()
+{
+	hostFileSystemClear();
+	return true;
+}
+
+File FSClass::open(const char *path, const char *mode)
+{
+	std::string fullPath = hostPath(path);
+
+	if (hostFolders.count(fullPath) != 0)
+	{
+		return File(makeHostFileHandle(fullPath, true));
+	}
+
+	bool exists = hostFiles.count(fullPath) != 0;
+
+	if (mode[0] == 'r')
+	{
+		if (!exists)
+		{
+			return File();
+		}
+		return File(makeHostFileHandle(fullPath, false));
+	}
+
+	// write and append both make the file and any folders above it
+	addHostParentFolders(fullPath);
+
+	if (mode[0] == 'w' || !exists)
+	{
+		hostFiles[fullPath] = "";
+	}
+
+	std::shared_ptr<HostFileHandle> handle = makeHostFileHandle(fullPath, false);
+
+	if (mode[0] == 'a')
+	{
+		handle->position = hostFiles[fullPath].length();
+	}
+
+	return File(handle);
+}
+
+bool FSClass::exists(const char *path)
+{
+	std::string fullPath = hostPath(path);
+	return hostFiles.count(fullPath) != 0 || hostFolders.count(fullPath) != 0;
+}
+
+bool FSClass::mkdir(const char *path)
+{
+	std::string fullPath = hostPath(path);
+
+	if (hostFiles.count(fullPath) != 0)
+	{
+		return false;
+	}
+
+	addHostParentFolders(fullPath);
+	hostFolders.insert(fullPath);
+	return true;
+}
+
+bool FSClass::remove(const char *path)
+{
+	return hostFiles.erase(hostPath(path)) != 0;
+}
+
+bool FSClass::rmdir(const char *path)
+{
+	std::string fullPath = hostPath(path);
+
+	if (fullPath == "/")
+	{
+		return false;
+	}
+	return hostFolders.erase(fullPath) != 0;
+}
+
+bool FSClass::rename(const char *fromPath, const char *toPath)
+{
+	std::string from = hostPath(fromPath);
+	std::string to = hostPath(toPath);
+
+	auto file = hostFiles.find(from);
+
+	if (file == hostFiles.end() || hostFiles.count(to) != 0)
+	{
+		return false;
+	}
+
+	addHostParentFolders(to);
+	hostFiles[to] = file->second;
+	hostFiles.erase(from);
+	return true;
+}
+
+FSClass LittleFS;
+
+void hostFileSystemClear()
+{
+	hostFiles.clear();
+	hostFolders.clear();
+	hostFolders.insert("/");
+}
+
+bool hostWriteFile(const char *path, const char *contents)
+{
+	File file = LittleFS.open(path, "w");
+
+	if (!file)
+	{
+		return false;
+	}
+
+	file.print(contents);
+	file.close();
+	return true;
+}
+
+int hostNoOfFiles()
+{
+	return (int)hostFiles.size();
+}
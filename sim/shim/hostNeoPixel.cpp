@@ -0,0 +1,89 @@
+#include <Arduino.h>
+
+#include "Adafruit_NeoPixel.h"
+#include "hostShim.h"
+
+struct HostPixelStats hostPixelStats;
+
+Adafruit_NeoPixel::Adafruit_NeoPixel(uint16_t noOfPixels, int16_t pin, uint16_t type) : noOfPixels(noOfPixels)
+{
+	pixels = (uint8_t *)calloc(noOfPixels * 3, 1);
+	hostPixelStats.noOfPixels = noOfPixels;
+}
+
+Adafruit_NeoPixel::~Adafruit_NeoPixel()
+{
+	free(pixels);
+}
+
+void Adafruit_NeoPixel::begin()
+{
+}
+
+// FNV-1a
+
+uint32_t hostHashBytes(uint32_t hash, const uint8_t *data, size_t length)
+{
+	for (size_t i = 0; i < length; i++)
+	{
+		hash = (hash ^ data[i]) * 16777619UL;
+	}
+	return hash;
+}
+
+void Adafruit_NeoPixel::show()
+{
+	uint32_t frameHash = hostHashBytes(2166136261UL, pixels, noOfPixels * 3);
+
+	hostPixelStats.shows++;
+
+	if (frameHash != hostPixelStats.currentFrameHash)
+	{
+		hostPixelStats.changedShows++;
+		hostPixelStats.currentFrameHash = frameHash;
+	}
+
+	hostPixelStats.frameHash = hostHashBytes(hostPixelStats.frameHash, (const uint8_t *)&frameHash, sizeof(frameHash));
+}
+
+void Adafruit_NeoPixel::clear()
+{
+	memset(pixels, 0, noOfPixels * 3);
+}
+
+void Adafruit_NeoPixel::setPixelColor(uint16_t pixel, uint8_t red, uint8_t green, uint8_t blue)
+{
+	if (pixel >= noOfPixels)
+	{
+		return;
+	}
+	pixels[pixel * 3] = red;
+	pixels[pixel * 3 + 1] = green;
+	pixels[pixel * 3 + 2] = blue;
+}
+
+void Adafruit_NeoPixel::setPixelColor(uint16_t pixel, uint32_t colour)
+{
+	setPixelColor(pixel, (uint8_t)(colour >> 16), (uint8_t)(colour >> 8), (uint8_t)colour);
+}
+
+uint32_t Adafruit_NeoPixel::getPixelColor(uint16_t pixel)
+{
+	if (pixel >= noOfPixels)
+	{
+		return 0;
+	}
+	return ((uint32_t)pixels[pixel * 3] << 16) | ((uint32_t)pixels[pixel * 3 + 1] << 8) | pixels[pixel * 3 + 2];
+}
+
+void hostGetPixelStats(struct HostPixelStats *stats)
+{
+	*stats = hostPixelStats;
+}
+
+void hostResetPixelStats()
+{
+	int noOfPixels = hostPixelStats.noOfPixels;
+	hostPixelStats = {};
+	hostPixelStats.noOfPixels = noOfPixels;
+}
@@ -0,0 +1,186 @@
+#include <Arduino.h>
+
+#include "WiFi.h"
+#include "ezTime.h"
+#include "hostShim.h"
+
+IPAddress::IPAddress(uint8_t first, uint8_t second, uint8_t third, uint8_t fourth)
+{
+	address[0] = first;
+	address[1] = second;
+	address[2] = third;
+	address[3] = fourth;
+}
+
+String IPAddress::toString() const
+{
+	char text[16];
+	snprintf(text, sizeof(text), "%d.%d.%d.%d", address[0], address[1], address[2], address[3]);
+	return String(text);
+}
+
+int hostWiFiStatus = WL_DISCONNECTED;
+int hostScanResult = WIFI_SCAN_FAILED;
+
+bool WiFiClass::mode(WiFiMode_t mode)
+{
+	if (mode == WIFI_OFF)
+	{
+		hostWiFiStatus = WL_DISCONNECTED;
+	}
+	return true;
+}
+
+int WiFiClass::begin(const char *ssid, const char *password)
+{
+	if (strcmp(ssid, HOST_SIMULATED_SSID) == 0)
+	{
+		hostWiFiStatus = WL_CONNECTED;
+	}
+	else
+	{
+		hostWiFiStatus = WL_NO_SSID_AVAIL;
+	}
+	return hostWiFiStatus;
+}
+
+bool WiFiClass::disconnect(bool wifiOff)
+{
+	hostWiFiStatus = WL_DISCONNECTED;
+	return true;
+}
+
+int WiFiClass::status()
+{
+	return hostWiFiStatus;
+}
+
+int WiFiClass::scanNetworks(bool async)
+{
+	hostScanResult = 1;
+	return hostScanResult;
+}
+
+int WiFiClass::scanComplete()
+{
+	return hostScanResult;
+}
+
+void WiFiClass::scanDelete()
+{
+	hostScanResult = WIFI_SCAN_FAILED;
+}
+
+String WiFiClass::SSID(int networkNo)
+{
+	return String(HOST_SIMULATED_SSID);
+}
+
+String WiFiClass::SSID()
+{
+	return String(hostWiFiStatus == WL_CONNECTED ? HOST_SIMULATED_SSID : "");
+}
+
+IPAddress WiFiClass::localIP()
+{
+	if (hostWiFiStatus != WL_CONNECTED)
+	{
+		return IPAddress(0, 0, 0, 0);
+	}
+	return IPAddress(192, 168, 4, 2);
+}
+
+uint8_t *WiFiClass::macAddress(uint8_t *mac)
+{
+	static const uint8_t hostMac[6] = {0x02, 0x00, 0x00, 0x51, 0xa1, 0x7e};
+	memcpy(mac, hostMac, sizeof(hostMac));
+	return mac;
+}
+
+bool WiFiClass::softAP(const char *ssid, const char *password)
+{
+	return true;
+}
+
+WiFiClass WiFi;
+
+// ezTime
+
+bool Timezone::setLocation(const String location)
+{
+	// every time zone is UTC in the simulation
+	return true;
+}
+
+time_t Timezone::now()
+{
+	return (time_t)(HOST_SIMULATED_EPOCH + hostMicros() / 1000000);
+}
+
+struct tm Timezone::localTime()
+{
+	time_t time = now();
+	struct tm result;
+	gmtime_r(&time, &result);
+	return result;
+}
+
+uint8_t Timezone::hour()
+{
+	return localTime().tm_hour;
+}
+
+uint8_t Timezone::minute()
+{
+	return localTime().tm_min;
+}
+
+uint8_t Timezone::second()
+{
+	return localTime().tm_sec;
+}
+
+uint8_t Timezone::day()
+{
+	return localTime().tm_mday;
+}
+
+uint8_t Timezone::weekday()
+{
+	// ezTime counts the days of the week from 1 for Sunday
+	return localTime().tm_wday + 1;
+}
+
+uint8_t Timezone::month()
+{
+	return localTime().tm_mon + 1;
+}
+
+uint16_t Timezone::year()
+{
+	return localTime().tm_year + 1900;
+}
+
+String Timezone::dateTime(const String format)
+{
+	struct tm time = localTime();
+	char text[32];
+	strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%S+00:00", &time);
+	return String(text);
+}
+
+Timezone UTC;
+
+void events()
+{
+}
+
+timeStatus_t timeStatus()
+{
+	return hostWiFiStatus == WL_CONNECTED ? timeSet : timeNotSet;
+}
+
+bool waitForSync(uint16_t timeout)
+{
+	return timeStatus() == timeSet;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <Arduino.h>
+
+// The controls that the simulation uses to drive the Arduino shim. None of
+// these exist on a device.
+
+// virtual clock - starts at zero and only moves when it is told to
+uint64_t hostMicros();
+void hostAdvanceMicros(uint64_t micros);
+void hostAdvanceMillis(unsigned long millis);
+
+// input pins - a change on a pin with an interrupt attached calls the handler
+void hostSetPin(int pin, int value);
+void hostSetAnalog(int pin, int value);
+
+// the last value written to an output pin
+int hostPinOutput(int pin);
+
+// text that the console will read from the serial port
+void hostSerialInput(const char *text);
+// for binary frames, which can contain zero bytes
+void hostSerialInputBytes(const char *data, size_t length);
+
+// everything written to the serial port is passed to the sink, which
+// defaults to stdout. A NULL sink throws the output away.
+void hostSetSerialSink(void (*sink)(const char *text, size_t length));
+
+// called when the device code restarts the device - the default prints a
+// message and ends the program
+void hostSetRestartHandler(void (*handler)());
+
+// the in-memory file system
+void hostFileSystemClear();
+bool hostWriteFile(const char *path, const char *contents);
+int hostNoOfFiles();
+
+// the mock pixel strip
+struct HostPixelStats
+{
+	int noOfPixels;
+	unsigned long shows;
+	unsigned long changedShows;
+	// a running hash of every frame that was shown
+	uint32_t frameHash;
+	// a hash of the frame on the strip now
+	uint32_t currentFrameHash;
+};
+
+void hostGetPixelStats(struct HostPixelStats *stats);
+void hostResetPixelStats();
+
+// the simulated network has a single access point with this name, which
+// any password will connect to
+#define HOST_SIMULATED_SSID "simnet"
+
+// the clock on the simulated network - the virtual clock starts at this time
+#define HOST_SIMULATED_EPOCH 1704067200UL
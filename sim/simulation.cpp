@@ -0,0 +1,402 @@
+#include <Arduino.h>
+
+#include <string>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "settings.h"
+#include "binaryCommand.h"
+#include "simulation.h"
+
+// the device code in src/main.cpp
+void setup();
+void loop();
+
+std::string simulationOutput;
+bool simulationEcho = false;
+
+unsigned long simulationLoopPasses = 0;
+unsigned long simulationPassCostMicros = 0;
+uint64_t simulationCpuMicros = 0;
+uint64_t simulationStartMicros = 0;
+uint32_t simulationSerialHash = 2166136261UL;
+
+void simulationSerialSink(const char *text, size_t length)
+{
+	simulationOutput.append(text, length);
+
+	for (size_t i = 0; i < length; i++)
+	{
+		simulationSerialHash = (simulationSerialHash ^ (uint8_t)text[i]) * 16777619UL;
+	}
+
+	if (simulationEcho)
+	{
+		fwrite(text, 1, length, stdout);
+	}
+}
+
+uint64_t processCpuMicros()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+	return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+void simulationBoot(const char *settings)
+{
+	hostSetSerialSink(simulationSerialSink);
+
+	std::string settingsFile = SIMULATION_BASE_SETTINGS;
+	settingsFile += settings;
+	hostWriteFile(SETTINGS_FILENAME, settingsFile.c_str());
+
+	setup();
+
+	simulationStartMicros = hostMicros();
+}
+
+void simulationRun(unsigned long millis)
+{
+	uint64_t endMicros = hostMicros() + (uint64_t)millis * 1000;
+
+	uint64_t cpuStart = processCpuMicros();
+
+	while (hostMicros() < endMicros)
+	{
+		hostAdvanceMicros(simulationPassCostMicros);
+		loop();
+		simulationLoopPasses++;
+	}
+
+	simulationCpuMicros += processCpuMicros() - cpuStart;
+}
+
+void simulationSetPassCost(unsigned long micros)
+{
+	simulationPassCostMicros = micros;
+}
+
+void simulationType(const char *line)
+{
+	hostSerialInput(line);
+	hostSerialInput("\n");
+}
+
+void simulationPackByte(struct SimulationPack *pack, unsigned char value)
+{
+	if (pack->length < SIMULATION_PACK_LENGTH)
+	{
+		pack->data[pack->length++] = value;
+	}
+}
+
+void simulationPackMap(struct SimulationPack *pack, int noOfPairs)
+{
+	pack->length = 0;
+	simulationPackByte(pack, 0x80 | noOfPairs);
+}
+
+void simulationPackInt(struct SimulationPack *pack, long value)
+{
+	if (value >= 0 && value <= 0x7f)
+	{
+		simulationPackByte(pack, (unsigned char)value);
+		return;
+	}
+
+	// int 32
+	simulationPackByte(pack, 0xd2);
+	for (int shift = 24; shift >= 0; shift -= 8)
+	{
+		simulationPackByte(pack, (unsigned char)(value >> shift));
+	}
+}
+
+void simulationPackFloat(struct SimulationPack *pack, float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(float));
+
+	// float 32
+	simulationPackByte(pack, 0xca);
+	for (int shift = 24; shift >= 0; shift -= 8)
+	{
+		simulationPackByte(pack, (unsigned char)(bits >> shift));
+	}
+}
+
+void simulationPackText(struct SimulationPack *pack, const char *text)
+{
+	int length = strlen(text);
+
+	// fixstr
+	simulationPackByte(pack, 0xa0 | length);
+	for (int i = 0; i < length; i++)
+	{
+		simulationPackByte(pack, text[i]);
+	}
+}
+
+void simulationSendBinaryFrame(struct SimulationPack *pack, int bytesToSend)
+{
+	char frame[SIMULATION_PACK_LENGTH + 3];
+
+	frame[0] = (char)BINARY_COMMAND_SERIAL_FRAME_START;
+	frame[1] = (char)(pack->length >> 8);
+	frame[2] = (char)pack->length;
+	memcpy(frame + 3, pack->data, pack->length);
+
+	if (bytesToSend > pack->length + 3)
+	{
+		bytesToSend = pack->length + 3;
+	}
+
+	hostSerialInputBytes(frame, bytesToSend);
+}
+
+bool simulationOutputContains(const char *text)
+{
+	return simulationOutput.find(text) != std::string::npos;
+}
+
+int simulationOutputCount(const char *text)
+{
+	int count = 0;
+	size_t position = simulationOutput.find(text);
+
+	while (position != std::string::npos)
+	{
+		count++;
+		position = simulationOutput.find(text, position + 1);
+	}
+
+	return count;
+}
+
+bool simulationFail(struct SimulationResult *result, const char *format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	vsnprintf(result->message, SIMULATION_MESSAGE_LENGTH, format, args);
+	va_end(args);
+	return false;
+}
+
+void runScenario(struct SimulationScenario *scenario, struct SimulationResult *result)
+{
+	memset(result, 0, sizeof(struct SimulationResult));
+	snprintf(result->name, SIMULATION_NAME_LENGTH, "%s", scenario->name);
+
+	simulationBoot(scenario->settings);
+
+	result->passed = scenario->run(result);
+
+	if (result->passed)
+	{
+		snprintf(result->message, SIMULATION_MESSAGE_LENGTH, "OK");
+	}
+
+	result->simulatedMillis = (unsigned long)((hostMicros() - simulationStartMicros) / 1000);
+	result->loopPasses = simulationLoopPasses;
+	result->cpuMicros = simulationCpuMicros;
+	result->serialBytes = simulationOutput.length();
+	result->serialHash = simulationSerialHash;
+	hostGetPixelStats(&result->pixels);
+}
+
+// The device code keeps its state in globals, so each run gets a fresh
+// device in a child process. A device that restarts or crashes doesn't send
+// back a result.
+
+void runScenarioInChild(struct SimulationScenario *scenario, struct SimulationResult *result)
+{
+	int pipeEnds[2];
+
+	fflush(stdout);
+
+	if (pipe(pipeEnds) != 0)
+	{
+		memset(result, 0, sizeof(struct SimulationResult));
+		simulationFail(result, "could not make a pipe for the scenario");
+		return;
+	}
+
+	pid_t child = fork();
+
+	if (child == 0)
+	{
+		close(pipeEnds[0]);
+		runScenario(scenario, result);
+		ssize_t written = write(pipeEnds[1], result, sizeof(struct SimulationResult));
+		_exit(written == sizeof(struct SimulationResult) ? 0 : 1);
+	}
+
+	close(pipeEnds[1]);
+
+	size_t received = 0;
+
+	while (received < sizeof(struct SimulationResult))
+	{
+		ssize_t count = read(pipeEnds[0], (char *)result + received, sizeof(struct SimulationResult) - received);
+
+		if (count <= 0)
+		{
+			break;
+		}
+		received += count;
+	}
+
+	close(pipeEnds[0]);
+	waitpid(child, NULL, 0);
+
+	if (received != sizeof(struct SimulationResult))
+	{
+		memset(result, 0, sizeof(struct SimulationResult));
+		snprintf(result->name, SIMULATION_NAME_LENGTH, "%s", scenario->name);
+		simulationFail(result, "the device restarted or crashed");
+	}
+}
+
+bool sameSimulationRun(struct SimulationResult *first, struct SimulationResult *second)
+{
+	return first->passed == second->passed &&
+		   first->simulatedMillis == second->simulatedMillis &&
+		   first->loopPasses == second->loopPasses &&
+		   first->serialBytes == second->serialBytes &&
+		   first->serialHash == second->serialHash &&
+		   first->pixels.shows == second->pixels.shows &&
+		   first->pixels.frameHash == second->pixels.frameHash;
+}
+
+struct SimulationScenario *findSimulationScenario(const char *name)
+{
+	for (int i = 0; i < noOfSimulationScenarios; i++)
+	{
+		if (strcasecmp(simulationScenarios[i].name, name) == 0)
+		{
+			return &simulationScenarios[i];
+		}
+	}
+	return NULL;
+}
+
+void printSimulationResult(struct SimulationResult *result, bool repeatable)
+{
+	double simulatedSeconds = result->simulatedMillis / 1000.0;
+	double cpuPerSecond = simulatedSeconds > 0 ? result->cpuMicros / simulatedSeconds : 0;
+	double speedUp = result->cpuMicros > 0 ? (result->simulatedMillis * 1000.0) / result->cpuMicros : 0;
+
+	printf("%-14s %-4s %8.1f %9lu %10.0f %9.0fx %8lu %08x  %s%s\n",
+		   result->name,
+		   result->passed && repeatable ? "pass" : "FAIL",
+		   simulatedSeconds,
+		   result->loopPasses,
+		   cpuPerSecond,
+		   speedUp,
+		   result->pixels.changedShows,
+		   result->pixels.frameHash,
+		   result->message,
+		   repeatable ? "" : " - the second run was different");
+}
+
+// runs the named benchmark, or all of them if there is no name
+
+int runSimulationBenchmarks(const char *name)
+{
+	int failures = 0;
+	int run = 0;
+
+	for (int i = 0; i < noOfSimulationBenchmarks; i++)
+	{
+		if (name != NULL && strcasecmp(simulationBenchmarks[i].name, name) != 0)
+		{
+			continue;
+		}
+
+		run++;
+
+		if (!simulationBenchmarks[i].run())
+		{
+			printf("%-14s FAIL\n", simulationBenchmarks[i].name);
+			failures++;
+		}
+	}
+
+	if (run == 0)
+	{
+		printf("Benchmark %s not found - use --list to see them\n", name);
+		return 1;
+	}
+
+	return failures == 0 ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc > 1 && strcmp(argv[1], "--list") == 0)
+	{
+		for (int i = 0; i < noOfSimulationScenarios; i++)
+		{
+			printf("%-14s %s\n", simulationScenarios[i].name, simulationScenarios[i].description);
+		}
+		printf("\nbenchmarks - run with --bench [name]\n");
+		for (int i = 0; i < noOfSimulationBenchmarks; i++)
+		{
+			printf("%-14s %s\n", simulationBenchmarks[i].name, simulationBenchmarks[i].description);
+		}
+		return 0;
+	}
+
+	if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+	{
+		return runSimulationBenchmarks(argc > 2 ? argv[2] : NULL);
+	}
+
+	if (argc > 1)
+	{
+		// one scenario in this process with the serial output shown
+		struct SimulationScenario *scenario = findSimulationScenario(argv[1]);
+
+		if (scenario == NULL)
+		{
+			printf("Scenario %s not found - use --list to see them\n", argv[1]);
+			return 1;
+		}
+
+		struct SimulationResult result;
+		simulationEcho = true;
+		runScenario(scenario, &result);
+		printf("\n\n");
+		printSimulationResult(&result, true);
+		return result.passed ? 0 : 1;
+	}
+
+	printf("%-14s %-4s %8s %9s %10s %10s %8s %-8s  %s\n",
+		   "scenario", "", "sim s", "passes", "cpu us/s", "speed", "frames", "hash", "result");
+
+	int failures = 0;
+
+	for (int i = 0; i < noOfSimulationScenarios; i++)
+	{
+		struct SimulationResult first;
+		struct SimulationResult second;
+
+		runScenarioInChild(&simulationScenarios[i], &first);
+		runScenarioInChild(&simulationScenarios[i], &second);
+
+		bool repeatable = sameSimulationRun(&first, &second);
+
+		printSimulationResult(&first, repeatable);
+
+		if (!first.passed || !repeatable)
+		{
+			failures++;
+		}
+	}
+
+	printf("\n%d of %d scenarios passed\n", noOfSimulationScenarios - failures, noOfSimulationScenarios);
+
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "hostShim.h"
+
+// Runs the device code on the host against the Arduino shim in sim/shim.
+// Each scenario boots a fresh device in a child process, drives it through
+// the serial console and the input pins, and then checks what it did. The
+// virtual clock only moves when the device waits, so a scenario runs much
+// faster than real time and gives the same result every time. Every
+// scenario is run twice and the two runs must match exactly.
+//
+// The CPU time is measured around the calls to loop() and reported per
+// simulated second, which gives a like for like measure of how much work
+// the device code does.
+
+#define SIMULATION_NAME_LENGTH 24
+#define SIMULATION_MESSAGE_LENGTH 120
+
+struct SimulationResult
+{
+	char name[SIMULATION_NAME_LENGTH];
+	bool passed;
+	char message[SIMULATION_MESSAGE_LENGTH];
+	unsigned long simulatedMillis;
+	unsigned long loopPasses;
+	uint64_t cpuMicros;
+	unsigned long serialBytes;
+	uint32_t serialHash;
+	struct HostPixelStats pixels;
+};
+
+struct SimulationScenario
+{
+	const char *name;
+	const char *description;
+	// name=value lines written to the settings file before the device boots
+	const char *settings;
+	// returns false and sets the message if a check fails
+	bool (*run)(struct SimulationResult *result);
+};
+
+// the settings every scenario starts with - no WiFi or MQTT so the device
+// doesn't go looking for a network
+#define SIMULATION_BASE_SETTINGS "wifiactive=no\nmqttactive=no\n"
+
+// boots the device - called before the scenario runs
+void simulationBoot(const char *settings);
+
+// runs the loop until the virtual clock has moved on by the given time
+void simulationRun(unsigned long millis);
+
+// The virtual clock doesn't move while the device code runs, so a loop
+// pass takes no time at all. This charges each pass the given time, which
+// stands in for the work the device would be doing.
+void simulationSetPassCost(unsigned long micros);
+
+// types a line into the serial console
+void simulationType(const char *line);
+
+// MessagePack for the binary command tests - only the types that commands use
+
+#define SIMULATION_PACK_LENGTH 200
+
+struct SimulationPack
+{
+	unsigned char data[SIMULATION_PACK_LENGTH];
+	int length;
+};
+
+void simulationPackMap(struct SimulationPack *pack, int noOfPairs);
+void simulationPackInt(struct SimulationPack *pack, long value);
+void simulationPackFloat(struct SimulationPack *pack, float value);
+void simulationPackText(struct SimulationPack *pack, const char *text);
+
+// sends the first bytesToSend bytes of the framed pack to the serial
+// console - fewer than the whole frame leaves it part way through
+void simulationSendBinaryFrame(struct SimulationPack *pack, int bytesToSend);
+
+// true if the device has written the text to the serial port since it booted
+bool simulationOutputContains(const char *text);
+
+// the number of times the device has written the text since it booted
+int simulationOutputCount(const char *text);
+
+// sets the message in the result and returns false
+bool simulationFail(struct SimulationResult *result, const char *format, ...);
+
+extern struct SimulationScenario simulationScenarios[];
+extern int noOfSimulationScenarios;
+
+// Benchmarks time device code on the host CPU rather than on the virtual
+// clock, so their figures change from run to run and from machine to
+// machine. They run in the simulator process without booting a device and
+// still check what they measured.
+
+struct SimulationBenchmark
+{
+	const char *name;
+	const char *description;
+	// prints its figures and returns false if a check fails
+	bool (*run)();
+};
+
+// nanoseconds on the host's monotonic clock
+uint64_t hostNanos();
+
+extern struct SimulationBenchmark simulationBenchmarks[];
+extern int noOfSimulationBenchmarks;
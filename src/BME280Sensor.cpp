@@ -9,9 +9,11 @@
 #include "sensors.h"
 #include "settings.h"
 #include "mqtt.h"
+#include "sensorHistory.h"
 #include "controller.h"
 #include "pixels.h"
 #include "clock.h"
+#include "scheduler.h"
 
 struct BME280SensorSettings bme280SensorSettings;
 bool BME280firstRun;
@@ -31,6 +33,15 @@ struct SettingItem bme280SensorFittedSetting = {
 	setFalse,
 	validateYesNo};
 
+struct SettingItem bme280HistorySetting = {
+	"BME 280 keeps a temperature history (yes or no)",
+	"bme280history",
+	&bme280SensorSettings.bme280History,
+	ONOFF_INPUT_LENGTH,
+	yesNo,
+	setFalse,
+	validateYesNo};
+
 struct SettingItem envNoOfAveragesSetting = {
 	"Environment Number of averages",
 	"bme280envnoOfAverages",
@@ -188,6 +199,7 @@ struct SettingItem *bme280SensorSettingItemPointers[] =
 		&BME280HumidNormMin,
 		&BME280HumidNormMax,
 		&envNoOfAveragesSetting,
+		&bme280HistorySetting,
 };
 
 struct SettingItemCollection bme280SensorSettingItems = {
@@ -278,7 +290,7 @@ void sendBME280Humidity(BME280SensorReading *reading, sensorListener *pos)
 										  bme280SensorSettings.humidNormMin, bme280SensorSettings.humidNormMax);
 
 	putUnalignedFloat(humidityNormalised, (unsigned char *)optionBuffer);
-	pos->receiveMessage(pos->config->destination, pos->config->optionBuffer);
+	fireSensorListener(pos);
 }
 
 void sendBME280Temp(BME280SensorReading *reading, sensorListener *pos)
@@ -294,7 +306,7 @@ void sendBME280Temp(BME280SensorReading *reading, sensorListener *pos)
 										  bme280SensorSettings.tempNormMin, bme280SensorSettings.tempNormMax);
 
 	putUnalignedFloat(tempNormalised, (unsigned char *)optionBuffer);
-	pos->receiveMessage(pos->config->destination, pos->config->optionBuffer);
+	fireSensorListener(pos);
 }
 
 void sendBME280Press(BME280SensorReading *reading, sensorListener *pos)
@@ -309,7 +321,7 @@ void sendBME280Press(BME280SensorReading *reading, sensorListener *pos)
 										  bme280SensorSettings.pressNormMin, bme280SensorSettings.pressNormMax);
 
 	putUnalignedFloat(pressNormalised, (unsigned char *)optionBuffer);
-	pos->receiveMessage(pos->config->destination, pos->config->optionBuffer);
+	fireSensorListener(pos);
 }
 
 void sendBME280All(BME280SensorReading *reading, sensorListener *pos)
@@ -326,7 +338,7 @@ void sendBME280All(BME280SensorReading *reading, sensorListener *pos)
 										  bme280SensorSettings.tempNormMin, bme280SensorSettings.tempNormMax);
 	putUnalignedFloat(tempNormalised, (unsigned char *)optionBuffer);
 
-	pos->receiveMessage(pos->config->destination, pos->config->optionBuffer);
+	fireSensorListener(pos);
 }
 
 void sendBME280Reading(BME280SensorReading *reading, int sensorNo, sensorListener *pos)
@@ -347,6 +359,11 @@ void sendBME280Reading(BME280SensorReading *reading, int sensorNo, sensorListene
 		sendBME280All(reading, pos);
 }
 
+// Each trigger is an event and a sensor number added together, so the
+// listeners for an event are in one trigger list for each sensor number.
+// The lists are sent in turn - humid, press, temp and then all - rather
+// than in the order that the listeners were added.
+
 void sendToBME280SensorListeners(int event, int sensorNo)
 {
 	TRACELOG("sendToBME280SensorListeners event:");
@@ -356,24 +373,12 @@ void sendToBME280SensorListeners(int event, int sensorNo)
 	struct BME280SensorReading *bme280activeReading =
 		(struct BME280SensorReading *)bme280Sensor.activeReading;
 
-	sensorListener *pos = bme280Sensor.listeners;
+	sensorListener *pos = findSensorTriggerListeners(&bme280Sensor, event + sensorNo);
 
 	while (pos != NULL)
 	{
-		struct sensorListenerConfiguration *config = pos->config;
-		int configMask = config->sendOptionMask;
-
-		if ((configMask & BME280_EVENT_MASK) == event)
-		{
-			// we have a match for the event
-			int configSensorNo = configMask & BME280_SENSOR_MASK;
-
-			if (configSensorNo == sensorNo)
-			{
-				sendBME280Reading(bme280activeReading, configSensorNo, pos);
-			}
-		}
-		pos = pos->nextMessageListener;
+		sendBME280Reading(bme280activeReading, sensorNo, pos);
+		pos = pos->nextTriggerListener;
 	}
 }
 
@@ -382,27 +387,10 @@ void sendToBME280SensorListeners(int event)
 	TRACELOG("Sending BME20 listener to event:");
 	TRACE_HEXLN(event);
 
-	struct BME280SensorReading *bme280activeReading =
-		(struct BME280SensorReading *)bme280Sensor.activeReading;
-
-	sensorListener *pos = bme280Sensor.listeners;
-
-	while (pos != NULL)
-	{
-		struct sensorListenerConfiguration *config = pos->config;
-		int configMask = config->sendOptionMask;
-		TRACELOG(" checking listener with ");
-		TRACE_HEXLN(configMask);
-
-		if ((configMask & BME280_EVENT_MASK) == event)
-		{
-			TRACELOGLN("    match");
-			// we have a match for the event
-			int configSensorNo = configMask & BME280_SENSOR_MASK;
-			sendBME280Reading(bme280activeReading, configSensorNo, pos);
-		}
-		pos = pos->nextMessageListener;
-	}
+	sendToBME280SensorListeners(event, BME280_HUMID);
+	sendToBME280SensorListeners(event, BME280_PRESS);
+	sendToBME280SensorListeners(event, BME280_TEMP);
+	sendToBME280SensorListeners(event, BME280_ALL);
 }
 
 void updateBME280Sensor()
@@ -411,6 +399,8 @@ void updateBME280Sensor()
 	static int lastClockMinute = -1;
 	static int lastClockHour = -1;
 
+	scheduleSensorUpdate(&bme280Sensor, BME280_UPDATE_MILLIS);
+
 	struct clockReading *clockReading = (struct clockReading *)clockSensor.activeReading;
 
 	struct BME280SensorReading *bme280activeReading =
@@ -431,6 +421,7 @@ void updateBME280Sensor()
 		bme280Sensor.millisAtLastReading = millis();
 		bme280Sensor.readingNumber++;
 		updateEnvAverages(bme280activeReading);
+		recordSensorHistory(&bme280Sensor, temp);
 	}
 
 	bme280Sensor.millisAtLastReading = millis();
@@ -520,7 +511,7 @@ void startBME280Sensor()
 
 	if (bme280Sensor.activeReading == NULL)
 	{
-		bme280Sensor.activeReading = new BME280SensorReading();
+		bme280Sensor.activeReading = allocateSensorReading(sizeof(struct BME280SensorReading));
 	}
 
 	struct BME280SensorReading *bme280activeReading =
@@ -541,6 +532,11 @@ void startBME280Sensor()
 			bme280activeReading->activeBMEAddress = bmeAddresses[i];
 
 			bme280Sensor.status = SENSOR_OK;
+
+			if (bme280SensorSettings.bme280History)
+			{
+				startSensorHistory(&bme280Sensor);
+			}
 			return;
 		}
 	}
@@ -5,6 +5,9 @@
 
 #define ENV_READING_LIFETIME_MSECS 5000
 
+// the sensor is read over I2C so it isn't read on every pass of the loop
+#define BME280_UPDATE_MILLIS 250
+
 #define BME280SENSOR_NOT_FITTED -1
 #define BME280SENSOR_NOT_CONNECTED -2
 
@@ -88,6 +91,7 @@ struct BME280SensorSettings {
 	float humidDelta;
 	float humidNormMin;
 	float humidNormMax;
+	bool bme280History;
 };
 
 extern struct BME280SensorSettings bme280SensorSettings;
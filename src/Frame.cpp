@@ -2,7 +2,21 @@
 
 #include "messages.h"
 #include "Frame.h"
+#include "blockPool.h"
+#include "timerWheel.h"
 #include <math.h>
+#include <new>
+
+// the sprites are made once, so they live in static memory rather than
+// being spread over the heap
+
+unsigned char spritePoolStorage[BLOCK_POOL_STORAGE_SIZE(sizeof(Sprite), MAX_NO_OF_SPRITES)] BLOCK_POOL_ALIGNED;
+
+struct BlockPool spritePool = {
+	"sprites",
+	spritePoolStorage,
+	sizeof(Sprite),
+	MAX_NO_OF_SPRITES};
 
 Frame::Frame(Leds *inLeds, Colour inBackground)
 {
@@ -18,16 +32,27 @@ Frame::Frame(Leds *inLeds, Colour inBackground)
 	brightness = 0;
 	colourBackSteps=0;
 
+	// a frame short of memory runs with the sprites it managed to get
+	noOfAllocatedSprites = 0;
+
 	for (int i = 0; i < MAX_NO_OF_SPRITES; i++)
 	{
-		sprites[i] = new Sprite(this);
+		Sprite *sprite = blockPoolNew<Sprite>(&spritePool, this);
+
+		if (sprite == NULL)
+		{
+			displayMessage("No room for sprite %d\n", i);
+			break;
+		}
+
+		sprites[noOfAllocatedSprites++] = sprite;
 	}
 }
 
 Sprite *Frame::getSprite(int spriteNo)
 {
 
-	if (spriteNo >= MAX_NO_OF_SPRITES || spriteNo < 0)
+	if (spriteNo >= noOfAllocatedSprites || spriteNo < 0)
 	{
 		return NULL;
 	}
@@ -39,7 +64,7 @@ void Frame::overlayColour(Colour col, int timeMins)
 {
 	overlay = col;
 	overlayActive = true;
-	overlayEndTicks = millis() + ((60 * timeMins)*1000);
+	overlayEndMillis = monotonicMillis() + ((60 * timeMins)*1000);
 }
 
 void Frame::render()
@@ -47,13 +72,13 @@ void Frame::render()
 	leds->clear(background);
 
  	if(overlayActive){
-		for (int i = 0; i < MAX_NO_OF_SPRITES; i++)
+		for (int i = 0; i < noOfAllocatedSprites; i++)
 		{
 			sprites[i]->renderColour(overlay);
 		}
 	}
 	else {
-		for (int i = 0; i < MAX_NO_OF_SPRITES; i++)
+		for (int i = 0; i < noOfAllocatedSprites; i++)
 		{
 			sprites[i]->render();
 		}
@@ -70,7 +95,7 @@ void Frame::dump()
 
 	leds->dump();
 
-	for (int i = 0; i < MAX_NO_OF_SPRITES; i++)
+	for (int i = 0; i < noOfAllocatedSprites; i++)
 	{
 		sprites[i]->dump();
 	}
@@ -90,7 +115,7 @@ void Frame::update()
 		}
 	}
 
-	for (int i = 0; i < MAX_NO_OF_SPRITES; i++)
+	for (int i = 0; i < noOfAllocatedSprites; i++)
 	{
 		sprites[i]->update();
 	}
@@ -106,7 +131,7 @@ void Frame::update()
 	}
 
 	if(overlayActive){
-		if(millis()>overlayEndTicks){
+		if(monotonicMillis()>overlayEndMillis){
 			overlayActive = false;
 		}
 	}
@@ -129,7 +154,7 @@ void Frame::fadeToColour(Colour target, int noOfSteps)
 		noOfSteps = 10;
 	}
 
-	for (int i = 0; i < MAX_NO_OF_SPRITES; i++)
+	for (int i = 0; i < noOfAllocatedSprites; i++)
 	{
 		sprites[i]->fadeToColour(target, noOfSteps);
 	}
@@ -137,7 +162,7 @@ void Frame::fadeToColour(Colour target, int noOfSteps)
 
 void Frame::setColour(Colour target)
 {
-	for (int i = 0; i < MAX_NO_OF_SPRITES; i++)
+	for (int i = 0; i < noOfAllocatedSprites; i++)
 	{
 		sprites[i]->setColour(target);
 	}
@@ -200,13 +225,13 @@ void Frame::fadeSpritesToColourCharMask(char *colourMask, int steps)
 
 	int pixelLimit;
 
-	if (MAX_NO_OF_SPRITES > noOfPixels)
+	if (noOfAllocatedSprites > noOfPixels)
 	{
 		pixelLimit = noOfPixels;
 	}
 	else
 	{
-		pixelLimit = MAX_NO_OF_SPRITES;
+		pixelLimit = noOfAllocatedSprites;
 	}
 
 	for (int i = 0; i < pixelLimit; i++)
@@ -242,7 +267,7 @@ void Frame::fadeSpritesToColourCharMask(char *colourMask, int steps)
 
 void Frame::disableAllSprites()
 {
-	for (int i = 0; i < MAX_NO_OF_SPRITES; i++)
+	for (int i = 0; i < noOfAllocatedSprites; i++)
 	{
 		sprites[i]->enabled = false;
 	}
@@ -252,14 +277,16 @@ int Frame::getNumberOfActiveSprites()
 {
 	int noOfPixels = width * height;
 
-	if (noOfPixels < 12)
-		return 3;
+	int activeSprites;
 
-	int activeSprites = (int)round(noOfPixels / 4) + 1;
+	if (noOfPixels < 12)
+		activeSprites = 3;
+	else
+		activeSprites = (int)round(noOfPixels / 4) + 1;
 
-	if (activeSprites > MAX_NO_OF_SPRITES)
+	if (activeSprites > noOfAllocatedSprites)
 	{
-		activeSprites = MAX_NO_OF_SPRITES;
+		activeSprites = noOfAllocatedSprites;
 	}
 
 	return activeSprites;
@@ -299,8 +326,13 @@ void Frame::fadeSpritesToWalkingColours(char *colours, int steps)
 
 	int noOfSprites = getNumberOfActiveSprites();
 
+	if (noOfSprites == 0)
+	{
+		return;
+	}
+
 	// fade out and disable all the sprites we aren't using
-	for(int i=noOfSprites; i< MAX_NO_OF_SPRITES; i++)
+	for(int i=noOfSprites; i< noOfAllocatedSprites; i++)
 	{
 		sprites[i]->fadeToBrightness(0,steps);
 	}
@@ -21,7 +21,7 @@ public:
     int colourBackSteps;
 	
 	Colour overlay;
-	unsigned long overlayEndTicks;
+	uint64_t overlayEndMillis; // monotonic, so it survives the millis() wrap
 	bool overlayActive;
 	Leds * leds;
 	float brightness;
@@ -30,6 +30,7 @@ public:
 	float targetBrightness;
 
 	Sprite * sprites [MAX_NO_OF_SPRITES];
+	int noOfAllocatedSprites;
 	Frame(Leds* inLeds, Colour inBackground); 
 
 	Sprite * getSprite(int spriteNo);
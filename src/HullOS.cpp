@@ -6,6 +6,7 @@
 #include "HullOSVariables.h"
 #include "HullOSScript.h"
 #include "HullOS.h"
+#include "timerWheel.h"
 
 struct HullOSSettings hullosSettings;
 
@@ -97,7 +98,7 @@ void updateHullOS()
         exeuteProgramStatement();
         break;
     case PROGRAM_AWAITING_DELAY_COMPLETION:
-        if (millis() > delayEndTime)
+        if (monotonicMillis() > delayEndTime)
         {
             programState = PROGRAM_ACTIVE;
         }
@@ -15,13 +15,14 @@
 #include "HullOSScript.h"
 #include "HullOS.h"
 #include "otaupdate.h"
+#include "timerWheel.h"
 
 ProgramState programState = PROGRAM_STOPPED;
 DeviceState deviceState = EXECUTE_IMMEDIATELY;
 
 uint8_t diagnosticsOutputLevel = 0;
 
-unsigned long delayEndTime;
+uint64_t delayEndTime;
 
 char programCommand[COMMAND_BUFFER_SIZE];
 char *commandPos;
@@ -472,7 +473,7 @@ void remoteDelay()
 	}
 #endif
 
-	delayEndTime = millis() + delayValueInTenthsIOfASecond * 100;
+	delayEndTime = monotonicMillis() + delayValueInTenthsIOfASecond * 100;
 
 	programState = PROGRAM_AWAITING_DELAY_COMPLETION;
 }
@@ -45,7 +45,7 @@ extern DeviceState deviceState;
 
 extern uint8_t diagnosticsOutputLevel;
 
-extern unsigned long delayEndTime;
+extern uint64_t delayEndTime;
 
 extern char programCommand[];
 extern char *commandPos;
@@ -337,9 +337,21 @@ int processSingleValue()
 
 		struct reading * reader = getReading(bufferPos);
 
-		if (reader == NULL)
+		int readerLength;
+
+		if (reader != NULL)
+		{
+			readerLength = strlen(reader->name);
+		}
+		else
 		{
-			return ERROR_INVALID_HARDWARE_READ_DEVICE;
+			struct historyReading history;
+			readerLength = decodeHistoryReading(bufferPos, &history);
+
+			if (readerLength == 0)
+			{
+				return ERROR_INVALID_HARDWARE_READ_DEVICE;
+			}
 		}
 
 		// Drop out the char to start the hardware name
@@ -348,8 +360,6 @@ int processSingleValue()
 
 		// copy the variable into the instruction
 
-		int readerLength = strlen(reader->name);
-
 		for (int i = 0; i < readerLength; i++)
 		{
 			outputFunction(*bufferPos);
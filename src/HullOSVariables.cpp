@@ -265,6 +265,150 @@ struct reading * getReading(char * text)
 	return NULL;
 }
 
+const char * historyStatisticNames[] = { "min", "max", "mean" };
+
+#define NO_OF_HISTORY_STATISTICS 3
+
+int decodeHistoryReading(char * text, struct historyReading * reading)
+{
+	char name[SENSOR_NAME_LENGTH];
+	char * pos = text;
+	int length = 0;
+
+	if (!isReadingNameStart(pos))
+	{
+		return 0;
+	}
+
+	while (isReadingNameChar(pos))
+	{
+		if (length == SENSOR_NAME_LENGTH - 1)
+		{
+			return 0;
+		}
+		name[length++] = *pos++;
+	}
+	name[length] = 0;
+
+	reading->s = findSensorByName(name);
+
+	if (reading->s == NULL)
+	{
+		return 0;
+	}
+
+	reading->statistic = HISTORY_LATEST;
+	reading->tier = historySeconds;
+	reading->periods = 1;
+
+	if (*pos != '.')
+	{
+		return pos - text;
+	}
+
+	pos++;
+
+	char * statisticStart = pos;
+
+	while (isalpha(*pos))
+	{
+		pos++;
+	}
+
+	int statisticLength = pos - statisticStart;
+	int statistic;
+
+	for (statistic = 0; statistic < NO_OF_HISTORY_STATISTICS; statistic++)
+	{
+		if (strlen(historyStatisticNames[statistic]) == (size_t)statisticLength &&
+			strncmp(statisticStart, historyStatisticNames[statistic], statisticLength) == 0)
+		{
+			break;
+		}
+	}
+
+	if (statistic == NO_OF_HISTORY_STATISTICS || !isdigit(*pos))
+	{
+		return 0;
+	}
+
+	reading->statistic = (historyStatistic)(statistic + HISTORY_MIN);
+
+	int periods = 0;
+
+	while (isdigit(*pos))
+	{
+		periods = periods * 10 + (*pos - '0');
+		pos++;
+	}
+
+	reading->periods = periods;
+
+	if (!decodeSensorHistoryTier(*pos, &reading->tier))
+	{
+		return 0;
+	}
+
+	if (periods < 1 || periods > sensorHistoryTierLength(reading->tier))
+	{
+		return 0;
+	}
+
+	pos++;
+
+	if (isReadingNameChar(pos))
+	{
+		return 0;
+	}
+
+	return pos - text;
+}
+
+bool getHistoryReading(struct historyReading * reading, int * result)
+{
+	struct SensorHistory * history = reading->s->history;
+
+	if (history == NULL)
+	{
+		return false;
+	}
+
+	float value;
+
+	if (reading->statistic == HISTORY_LATEST)
+	{
+		if (!getLatestSensorHistoryValue(history, &value))
+		{
+			return false;
+		}
+	}
+	else
+	{
+		struct SensorHistoryStats stats;
+
+		if (!getSensorHistoryStats(history, reading->tier, reading->periods, &stats))
+		{
+			return false;
+		}
+
+		switch (reading->statistic)
+		{
+		case HISTORY_MIN:
+			value = stats.min;
+			break;
+		case HISTORY_MAX:
+			value = stats.max;
+			break;
+		default:
+			value = stats.mean;
+			break;
+		}
+	}
+
+	*result = (int)round(value);
+	return true;
+}
+
 variable variables[NUMBER_OF_VARIABLES];
 
 void clearVariableSlot(int position)
@@ -665,7 +809,22 @@ parseOperandResult parseOperand(int * result)
 
 		if (reader == NULL)
 		{
-			return parseOperandResult::INVALID_HARDWARE_READING_NAME;
+			struct historyReading history;
+			int historyLength = decodeHistoryReading(decodePos, &history);
+
+			if (historyLength == 0)
+			{
+				return parseOperandResult::INVALID_HARDWARE_READING_NAME;
+			}
+
+			decodePos = decodePos + historyLength;
+
+			if (!getHistoryReading(&history, result))
+			{
+				return parseOperandResult::NO_SENSOR_HISTORY_READING;
+			}
+
+			return parseOperandResult::OPERAND_OK;
 		}
 
 		decodePos = decodePos + strlen(reader->name);
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "sensorHistory.h"
+
 
 // Performs the variable management 
 // Variables can be given names, stored and evaluated
@@ -24,6 +26,7 @@ enum parseOperandResult {
 	INVALID_OPERATOR=13,
 	SECOND_VARIABLE_NOT_FOUND=14,
 	SECOND_VARIABLE_USED_BEFORE_DEFINITION=15,
+	NO_SENSOR_HISTORY_READING=16,
 };
 
 //#define VAR_DEBUG
@@ -113,6 +116,28 @@ extern struct reading * readers[];
 bool validReading(char * text);
 struct reading * getReading(char * text);
 
+// @<sensor> reads the latest value in a sensor history and
+// @<sensor>.<min|max|mean><periods><s|m|h> reads a statistic over the last
+// periods buckets of a tier, so @pot.mean5m is the mean over five minutes
+
+enum historyStatistic {
+	HISTORY_LATEST,
+	HISTORY_MIN,
+	HISTORY_MAX,
+	HISTORY_MEAN
+};
+
+struct historyReading {
+	struct sensor * s;
+	historyStatistic statistic;
+	SensorHistoryTierType tier;
+	int periods;
+};
+
+// returns the length of the reading text, or 0 if it isn't a history reading
+int decodeHistoryReading(char * text, struct historyReading * reading);
+bool getHistoryReading(struct historyReading * reading, int * result);
+
 struct variable
 {
 	bool empty;
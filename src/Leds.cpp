@@ -18,9 +18,12 @@ Leds::Leds(int inWidth, int inHeight,
 
 	leds = new Led *[ledWidth];
 
+	// one block for all the leds rather than one for each column
+	Led *columns = new Led[ledWidth * ledHeight];
+
 	for (int i = 0; i < ledWidth; i++)
 	{
-		leds[i] = new Led[ledHeight];
+		leds[i] = columns + i * ledHeight;
 	}
 }
 
@@ -524,7 +524,9 @@ struct CommandItem MAX7219floatValueItem = {
     MAX7219_FLOAT_VALUE_OFFSET,
     floatCommand,
     validateFloat,
-    noDefaultAvailable};
+    noDefaultAvailable,
+    NULL,
+    validateFloatCommandValue};
 
 struct CommandItem MAX7219CommandOptionName = {
     "options",
@@ -0,0 +1,580 @@
+#include <Arduino.h>
+#include <strings.h>
+
+#include "debug.h"
+#include "utils.h"
+#include "errors.h"
+#include "processes.h"
+#include "controller.h"
+#include "binaryCommand.h"
+#include "commandDedup.h"
+#include "dualCore.h"
+#include "loopTracer.h"
+#include "metrics.h"
+
+// A minimal MessagePack reader. Only the types that can appear in a command
+// are understood: integers, floats, strings, nil, booleans and a single
+// top level map. Anything else makes the message invalid.
+
+enum BinaryValueType { binaryNil, binaryBool, binaryInt, binaryFloat, binaryString };
+
+struct BinaryValue
+{
+	BinaryValueType type;
+	long intValue;
+	float floatValue;
+	const char *text;
+	int textLength;
+};
+
+struct BinaryReader
+{
+	const unsigned char *pos;
+	const unsigned char *end;
+};
+
+bool binaryReadBytes(BinaryReader *reader, int count, unsigned long *result)
+{
+	if (reader->end - reader->pos < count)
+	{
+		return false;
+	}
+
+	unsigned long value = 0;
+
+	for (int i = 0; i < count; i++)
+	{
+		value = (value << 8) | *reader->pos;
+		reader->pos++;
+	}
+
+	*result = value;
+	return true;
+}
+
+bool binaryReadText(BinaryReader *reader, int length, BinaryValue *value)
+{
+	if (reader->end - reader->pos < length)
+	{
+		return false;
+	}
+
+	value->type = binaryString;
+	value->text = (const char *)reader->pos;
+	value->textLength = length;
+	reader->pos += length;
+	return true;
+}
+
+bool binaryReadValue(BinaryReader *reader, BinaryValue *value)
+{
+	unsigned long raw;
+
+	if (!binaryReadBytes(reader, 1, &raw))
+	{
+		return false;
+	}
+
+	unsigned char tag = (unsigned char)raw;
+
+	if (tag <= 0x7f)
+	{
+		// positive fixint
+		value->type = binaryInt;
+		value->intValue = tag;
+		return true;
+	}
+
+	if (tag >= 0xe0)
+	{
+		// negative fixint
+		value->type = binaryInt;
+		value->intValue = (signed char)tag;
+		return true;
+	}
+
+	if ((tag & 0xe0) == 0xa0)
+	{
+		// fixstr
+		return binaryReadText(reader, tag & 0x1f, value);
+	}
+
+	switch (tag)
+	{
+	case 0xc0:
+		value->type = binaryNil;
+		return true;
+
+	case 0xc2:
+	case 0xc3:
+		value->type = binaryBool;
+		value->intValue = tag == 0xc3;
+		return true;
+
+	case 0xcc:
+	case 0xcd:
+	case 0xce:
+		// uint 8, 16 and 32
+		if (!binaryReadBytes(reader, 1 << (tag - 0xcc), &raw))
+			return false;
+		value->type = binaryInt;
+		value->intValue = (long)raw;
+		return true;
+
+	case 0xd0:
+		if (!binaryReadBytes(reader, 1, &raw))
+			return false;
+		value->type = binaryInt;
+		value->intValue = (int8_t)raw;
+		return true;
+
+	case 0xd1:
+		if (!binaryReadBytes(reader, 2, &raw))
+			return false;
+		value->type = binaryInt;
+		value->intValue = (int16_t)raw;
+		return true;
+
+	case 0xd2:
+		if (!binaryReadBytes(reader, 4, &raw))
+			return false;
+		value->type = binaryInt;
+		value->intValue = (int32_t)raw;
+		return true;
+
+	case 0xca:
+	{
+		// float 32
+		if (!binaryReadBytes(reader, 4, &raw))
+			return false;
+		uint32_t bits = (uint32_t)raw;
+		value->type = binaryFloat;
+		memcpy(&value->floatValue, &bits, sizeof(float));
+		return true;
+	}
+
+	case 0xcb:
+	{
+		// float 64 - read as two halves so that we don't need 64 bit longs
+		unsigned long high, low;
+		if (!binaryReadBytes(reader, 4, &high))
+			return false;
+		if (!binaryReadBytes(reader, 4, &low))
+			return false;
+		uint64_t bits = ((uint64_t)high << 32) | (uint32_t)low;
+		double d;
+		memcpy(&d, &bits, sizeof(double));
+		value->type = binaryFloat;
+		value->floatValue = (float)d;
+		return true;
+	}
+
+	case 0xd9:
+		if (!binaryReadBytes(reader, 1, &raw))
+			return false;
+		return binaryReadText(reader, (int)raw, value);
+
+	case 0xda:
+		if (!binaryReadBytes(reader, 2, &raw))
+			return false;
+		return binaryReadText(reader, (int)raw, value);
+	}
+
+	return false;
+}
+
+bool binaryReadMapSize(BinaryReader *reader, int *size)
+{
+	unsigned long raw;
+
+	if (!binaryReadBytes(reader, 1, &raw))
+	{
+		return false;
+	}
+
+	if ((raw & 0xf0) == 0x80)
+	{
+		*size = raw & 0x0f;
+		return true;
+	}
+
+	if (raw == 0xde)
+	{
+		if (!binaryReadBytes(reader, 2, &raw))
+			return false;
+		*size = (int)raw;
+		return true;
+	}
+
+	return false;
+}
+
+// copies a binary string into a terminated buffer
+
+bool binaryValueToText(BinaryValue *value, char *dest, int destLength)
+{
+	if (value->type != binaryString || value->textLength >= destLength)
+	{
+		return false;
+	}
+
+	memcpy(dest, value->text, value->textLength);
+	dest[value->textLength] = 0;
+	return true;
+}
+
+bool binaryMatchName(BinaryValue *value, const char *name)
+{
+	int nameLength = strlen(name);
+
+	if (value->textLength != nameLength)
+	{
+		return false;
+	}
+
+	return strncasecmp(value->text, name, nameLength) == 0;
+}
+
+int findCommandItemIndex(Command *command, BinaryValue *key)
+{
+	if (key->type == binaryInt)
+	{
+		int index = (int)key->intValue - BINARY_COMMAND_FIRST_ITEM_KEY;
+
+		if (index >= 0 && index < command->noOfItems)
+		{
+			return index;
+		}
+		return -1;
+	}
+
+	for (int i = 0; i < command->noOfItems; i++)
+	{
+		if (binaryMatchName(key, command->items[i]->name))
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+// Stores a decoded value in the parameter buffer using the item validators.
+// Numbers go to the typed validators when the item has them, so they are
+// never converted into text.
+
+bool storeBinaryCommandItem(CommandItem *item, BinaryValue *value, unsigned char *dest)
+{
+	char buffer[BINARY_COMMAND_TEXT_LENGTH];
+
+	switch (value->type)
+	{
+	case binaryInt:
+	case binaryBool:
+		if (item->validateIntValue != NULL)
+		{
+			return item->validateIntValue(dest, (int)value->intValue);
+		}
+		if (item->validateFloatValue != NULL)
+		{
+			return item->validateFloatValue(dest, (float)value->intValue);
+		}
+		snprintf(buffer, BINARY_COMMAND_TEXT_LENGTH, "%ld", value->intValue);
+		return item->validateValue(dest, buffer);
+
+	case binaryFloat:
+		if (item->validateFloatValue != NULL)
+		{
+			return item->validateFloatValue(dest, value->floatValue);
+		}
+		snprintf(buffer, BINARY_COMMAND_TEXT_LENGTH, "%f", value->floatValue);
+		return item->validateValue(dest, buffer);
+
+	case binaryString:
+		if (!binaryValueToText(value, buffer, BINARY_COMMAND_TEXT_LENGTH))
+		{
+			return false;
+		}
+		return item->validateValue(dest, buffer);
+
+	default:
+		return false;
+	}
+}
+
+#define BINARY_COMMAND_MAX_ITEMS 32
+
+int decodeBinaryCommand(const unsigned char *data, int length, unsigned char *parameterBuffer, int *sequenceNo)
+{
+	BinaryReader reader = {data, data + length};
+	BinaryValue key, value;
+	int mapSize;
+
+	char nameBuffer[BINARY_COMMAND_TEXT_LENGTH];
+	char destination[DESTINATION_NAME_LENGTH];
+
+	struct process *process = NULL;
+	Command *command = NULL;
+	destination[0] = 0;
+
+	// MessagePack maps are unordered, so the process and the command are
+	// only looked up once both have been found
+	BinaryValue processValue, commandValue;
+	bool processSupplied = false;
+	bool commandSupplied = false;
+
+	if (!binaryReadMapSize(&reader, &mapSize))
+	{
+		return BINARY_MESSAGE_COULD_NOT_BE_DECODED;
+	}
+
+	const unsigned char *itemStart = reader.pos;
+
+	// First pass - find the process, command, sequence number and destination
+
+	for (int i = 0; i < mapSize; i++)
+	{
+		if (!binaryReadValue(&reader, &key) || !binaryReadValue(&reader, &value))
+		{
+			return BINARY_MESSAGE_COULD_NOT_BE_DECODED;
+		}
+
+		if (key.type != binaryInt)
+		{
+			continue;
+		}
+
+		switch (key.intValue)
+		{
+		case BINARY_COMMAND_PROCESS_KEY:
+			processValue = value;
+			processSupplied = true;
+			break;
+
+		case BINARY_COMMAND_COMMAND_KEY:
+			commandValue = value;
+			commandSupplied = true;
+			break;
+
+		case BINARY_COMMAND_SEQ_KEY:
+			if (value.type == binaryInt)
+			{
+				*sequenceNo = (int)value.intValue;
+			}
+			break;
+
+		case BINARY_COMMAND_TO_KEY:
+			if (!binaryValueToText(&value, destination, DESTINATION_NAME_LENGTH))
+			{
+				return JSON_MESSAGE_DESTINATION_STRING_TOO_LONG;
+			}
+			break;
+		}
+	}
+
+	if (!processSupplied)
+	{
+		return JSON_MESSAGE_PROCESS_NAME_MISSING;
+	}
+
+	if (processValue.type == binaryInt)
+	{
+		process = findProcessByID((int)processValue.intValue);
+	}
+	else if (binaryValueToText(&processValue, nameBuffer, BINARY_COMMAND_TEXT_LENGTH))
+	{
+		process = findProcessByName(nameBuffer);
+	}
+
+	if (process == NULL)
+	{
+		return JSON_MESSAGE_PROCESS_NAME_INVALID;
+	}
+
+	if (!commandSupplied)
+	{
+		return JSON_MESSAGE_COMMAND_MISSING_COMMAND;
+	}
+
+	if (process->commands == NULL)
+	{
+		return JSON_MESSAGE_COMMAND_COMMAND_NOT_FOUND;
+	}
+
+	if (commandValue.type == binaryInt)
+	{
+		if (commandValue.intValue >= 0 && commandValue.intValue < process->commands->noOfCommands)
+		{
+			command = process->commands->commands[commandValue.intValue];
+		}
+	}
+	else if (binaryValueToText(&commandValue, nameBuffer, BINARY_COMMAND_TEXT_LENGTH))
+	{
+		command = FindCommandInProcess(process, nameBuffer);
+	}
+
+	if (command == NULL)
+	{
+		return JSON_MESSAGE_COMMAND_COMMAND_NOT_FOUND;
+	}
+
+	if (command->noOfItems > BINARY_COMMAND_MAX_ITEMS)
+	{
+		return JSON_MESSAGE_COMMAND_ITEM_INVALID;
+	}
+
+	// Second pass - store the command items
+
+	unsigned long suppliedItems = 0;
+	int failcount = 0;
+
+	reader.pos = itemStart;
+
+	for (int i = 0; i < mapSize; i++)
+	{
+		binaryReadValue(&reader, &key);
+		binaryReadValue(&reader, &value);
+
+		if (key.type == binaryInt && key.intValue < BINARY_COMMAND_FIRST_ITEM_KEY)
+		{
+			// one of the header keys we dealt with above
+			continue;
+		}
+
+		int itemIndex = findCommandItemIndex(command, &key);
+
+		if (itemIndex < 0)
+		{
+			return BINARY_MESSAGE_ITEM_KEY_INVALID;
+		}
+
+		CommandItem *item = command->items[itemIndex];
+
+		if (!storeBinaryCommandItem(item, &value, parameterBuffer + item->commandSettingOffset))
+		{
+			TRACELOG("Binary value fails validation:");
+			TRACELOGLN(item->name);
+			failcount++;
+		}
+
+		suppliedItems |= 1UL << itemIndex;
+	}
+
+	for (int i = 0; i < command->noOfItems; i++)
+	{
+		if (suppliedItems & (1UL << i))
+		{
+			continue;
+		}
+
+		CommandItem *item = command->items[i];
+
+		if (!item->setDefaultValue(parameterBuffer + item->commandSettingOffset))
+		{
+			return JSON_MESSAGE_COMMAND_ITEM_NOT_FOUND;
+		}
+	}
+
+	if (failcount != 0)
+	{
+		return JSON_MESSAGE_COMMAND_ITEM_INVALID;
+	}
+
+	startDeferredProcess(process);
+
+	if (dualCoreTasksRunning() && process->core == realTimeCore && *destination == 0)
+	{
+		return forwardCommandToRealTimeCore(command, destination, parameterBuffer);
+	}
+
+	unsigned long startMicros = micros();
+	int result = command->performCommand(destination, parameterBuffer);
+	LOOP_TRACE(traceCommand, command->name, startMicros);
+	recordHistogramMetric(&metricCommandMicros, ulongDiff(micros(), startMicros));
+
+	return result;
+}
+
+// Finds the sequence number in a binary command without performing it.
+// Returns -1 if the command doesn't have one.
+
+int findBinaryCommandSequenceNo(const unsigned char *data, int length)
+{
+	BinaryReader reader = {data, data + length};
+	BinaryValue key, value;
+	int mapSize;
+
+	if (!binaryReadMapSize(&reader, &mapSize))
+	{
+		return -1;
+	}
+
+	for (int i = 0; i < mapSize; i++)
+	{
+		if (!binaryReadValue(&reader, &key) || !binaryReadValue(&reader, &value))
+		{
+			return -1;
+		}
+
+		if (key.type == binaryInt && key.intValue == BINARY_COMMAND_SEQ_KEY && value.type == binaryInt)
+		{
+			return (int)value.intValue;
+		}
+	}
+
+	return -1;
+}
+
+#define BINARY_REPLY_BUFFER_SIZE 160
+#define BINARY_REPLY_ERROR_SIZE 100
+
+void performBinaryMessage(const char *data, int length, void (*deliverResult)(char *resultText))
+{
+	TRACELOG("Received binary message length:");
+	TRACELOGLN(length);
+
+	int sequenceNo = findBinaryCommandSequenceNo((const unsigned char *)data, length);
+
+	if (sequenceNo >= 0)
+	{
+		// a retried command gets the reply it had the first time
+		if (deliverCachedCommandReply(NULL, sequenceNo, data, length, deliverResult))
+		{
+			return;
+		}
+
+		deliverResult = cacheCommandReply(NULL, sequenceNo, data, length, deliverResult);
+	}
+
+	int error = decodeBinaryCommand((const unsigned char *)data, length, commandParameterBuffer, &sequenceNo);
+
+	if (error == BINARY_MESSAGE_COULD_NOT_BE_DECODED)
+	{
+		countMetric(&metricParseFailures);
+	}
+
+	char errorDescription[BINARY_REPLY_ERROR_SIZE];
+	char reply[BINARY_REPLY_BUFFER_SIZE];
+
+	decodeError(error, errorDescription, BINARY_REPLY_ERROR_SIZE);
+
+	if (sequenceNo >= 0)
+	{
+		snprintf(reply, BINARY_REPLY_BUFFER_SIZE, "{\"error\":%d,\"message\":\"%s\",\"seq\":%d}", error, errorDescription, sequenceNo);
+	}
+	else
+	{
+		snprintf(reply, BINARY_REPLY_BUFFER_SIZE, "{\"error\":%d,\"message\":\"%s\"}", error, errorDescription);
+	}
+
+	deliverResult(reply);
+}
+
+void act_onBinary_message(const char *data, int length, void (*deliverResult)(char *resultText))
+{
+	struct CommandDedupPending savedPending;
+
+	saveCommandDedupPending(&savedPending);
+	performBinaryMessage(data, length, deliverResult);
+	restoreCommandDedupPending(&savedPending);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+// Binary commands are MessagePack maps. They are an alternative to JSON for
+// senders that transmit a lot of commands. The map keys are either small
+// integers or item names:
+//
+//   0  - process  (process ID number or process name)
+//   1  - command  (command ID number or command name)
+//   2  - seq      (sequence number echoed in the reply)
+//   3  - to       (destination device name)
+//   16 upwards    - command item by position (16 is the first item)
+//   any string    - command item by name
+//
+// Process IDs are the position of the process in the process list and
+// command IDs are the position of the command in the process. Both are
+// included in the registration and command descriptions.
+//
+// A pixels setcolour command with its process and command named is 41
+// bytes as a serial frame against 72 for the same JSON line. The commands
+// host benchmark in sim/benchmarks.cpp measures this and the decode times.
+//
+// The keys can come in any order - the process and the command are looked
+// up once the whole map has been read.
+
+#define BINARY_COMMAND_PROCESS_KEY 0
+#define BINARY_COMMAND_COMMAND_KEY 1
+#define BINARY_COMMAND_SEQ_KEY 2
+#define BINARY_COMMAND_TO_KEY 3
+#define BINARY_COMMAND_FIRST_ITEM_KEY 16
+
+// MessagePack never uses this byte, so it marks the start of a binary
+// frame on the serial port. It is followed by a two byte (big endian)
+// length and then the MessagePack data.
+#define BINARY_COMMAND_SERIAL_FRAME_START 0xC1
+
+#define BINARY_COMMAND_TEXT_LENGTH 100
+
+void act_onBinary_message(const char *data, int length, void (*deliverResult)(char *resultText));
+
+int decodeBinaryCommand(const unsigned char *data, int length, unsigned char *parameterBuffer, int *sequenceNo);
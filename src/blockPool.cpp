@@ -0,0 +1,115 @@
+#include <Arduino.h>
+
+#include "debug.h"
+#include "blockPool.h"
+
+struct BlockPool *allBlockPools = NULL;
+
+void setUpBlockPool(struct BlockPool *pool)
+{
+	int blockSize = BLOCK_POOL_BLOCK_SIZE(pool->objectSize);
+
+	pool->freeList = NULL;
+
+	// build the free list backwards so that the first block is used first
+	for (int i = pool->noOfBlocks - 1; i >= 0; i--)
+	{
+		void **block = (void **)(pool->storage + i * blockSize);
+		*block = pool->freeList;
+		pool->freeList = block;
+	}
+
+	pool->inUse = 0;
+	pool->maxInUse = 0;
+	pool->heapFallbacks = 0;
+	pool->setUp = true;
+
+	pool->nextPool = allBlockPools;
+	allBlockPools = pool;
+}
+
+bool blockInPool(struct BlockPool *pool, void *block)
+{
+	unsigned char *address = (unsigned char *)block;
+
+	return address >= pool->storage &&
+		   address < pool->storage + BLOCK_POOL_STORAGE_SIZE(pool->objectSize, pool->noOfBlocks);
+}
+
+void *blockPoolAlloc(struct BlockPool *pool)
+{
+	if (!pool->setUp)
+	{
+		setUpBlockPool(pool);
+	}
+
+	void *block;
+
+	if (pool->freeList != NULL)
+	{
+		block = pool->freeList;
+		pool->freeList = *(void **)block;
+		pool->inUse++;
+
+		if (pool->inUse > pool->maxInUse)
+		{
+			pool->maxInUse = pool->inUse;
+		}
+	}
+	else
+	{
+		TRACELOG("Block pool empty:");
+		TRACELOGLN(pool->name);
+		pool->heapFallbacks++;
+		block = malloc(pool->objectSize);
+
+		if (block == NULL)
+		{
+			return NULL;
+		}
+	}
+
+	memset(block, 0, pool->objectSize);
+
+	return block;
+}
+
+void blockPoolFree(struct BlockPool *pool, void *block)
+{
+	if (block == NULL)
+	{
+		return;
+	}
+
+	if (!blockInPool(pool, block))
+	{
+		free(block);
+		return;
+	}
+
+	*(void **)block = pool->freeList;
+	pool->freeList = block;
+	pool->inUse--;
+}
+
+void iterateThroughBlockPools(void (*func)(struct BlockPool *pool))
+{
+	struct BlockPool *pool = allBlockPools;
+
+	while (pool != NULL)
+	{
+		func(pool);
+		pool = pool->nextPool;
+	}
+}
+
+void blockPoolStatusMessage(struct BlockPool *pool, char *buffer, int bufferLength)
+{
+	snprintf(buffer, bufferLength, "%s: %d bytes x %d, in use:%d max:%d heap fallbacks:%lu",
+			 pool->name,
+			 BLOCK_POOL_BLOCK_SIZE(pool->objectSize),
+			 pool->noOfBlocks,
+			 pool->inUse,
+			 pool->maxInUse,
+			 pool->heapFallbacks);
+}
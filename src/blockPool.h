@@ -0,0 +1,84 @@
+#pragma once
+
+#include <Arduino.h>
+#include <new>
+#include <utility>
+
+// A pool of fixed size blocks in static memory, for small objects that
+// would otherwise each be a separate heap allocation. Blocks are handed
+// out from a free list and given back to it, so the pool never fragments
+// the heap. When a pool is empty the block comes from the heap instead
+// and the fallback is counted, so a pool that is too small shows up in the
+// heap monitor rather than failing.
+//
+// A pool is declared with its storage as a positional aggregate and sets
+// itself up on its first allocation:
+//
+//   unsigned char fredPoolStorage[BLOCK_POOL_STORAGE_SIZE(sizeof(Fred), 8)] BLOCK_POOL_ALIGNED;
+//   struct BlockPool fredPool = {"fred", fredPoolStorage, sizeof(Fred), 8};
+//
+// Objects with constructors are built in a block with blockPoolNew, which
+// returns NULL rather than constructing into a NULL block, and given back
+// with blockPoolDelete:
+//
+//   Fred *fred = blockPoolNew<Fred>(&fredPool, 99);
+//   ...
+//   blockPoolDelete(&fredPool, fred);
+
+#define BLOCK_POOL_ALIGNMENT 8
+
+#define BLOCK_POOL_ALIGNED __attribute__((aligned(BLOCK_POOL_ALIGNMENT)))
+
+#define BLOCK_POOL_BLOCK_SIZE(size) ((((size) + BLOCK_POOL_ALIGNMENT - 1) / BLOCK_POOL_ALIGNMENT) * BLOCK_POOL_ALIGNMENT)
+
+#define BLOCK_POOL_STORAGE_SIZE(size, noOfBlocks) (BLOCK_POOL_BLOCK_SIZE(size) * (noOfBlocks))
+
+struct BlockPool
+{
+	const char *name;
+	unsigned char *storage;
+	int objectSize;
+	int noOfBlocks;
+	// set up on the first allocation
+	bool setUp;
+	void *freeList;
+	int inUse;
+	int maxInUse;
+	unsigned long heapFallbacks;
+	struct BlockPool *nextPool;
+};
+
+// returns a zeroed block, or NULL if the pool is empty and the heap is full
+void *blockPoolAlloc(struct BlockPool *pool);
+
+// takes blocks from the pool or from the heap fallback
+void blockPoolFree(struct BlockPool *pool, void *block);
+
+void iterateThroughBlockPools(void (*func)(struct BlockPool *pool));
+
+void blockPoolStatusMessage(struct BlockPool *pool, char *buffer, int bufferLength);
+
+template <typename T, typename... Args>
+T *blockPoolNew(struct BlockPool *pool, Args &&...args)
+{
+	void *block = blockPoolAlloc(pool);
+
+	if (block == NULL)
+	{
+		return NULL;
+	}
+
+	return new (block) T(std::forward<Args>(args)...);
+}
+
+template <typename T>
+void blockPoolDelete(struct BlockPool *pool, T *object)
+{
+	if (object == NULL)
+	{
+		return;
+	}
+
+	object->~T();
+	blockPoolFree(pool, object);
+}
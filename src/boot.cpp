@@ -1,9 +1,14 @@
 #include <Arduino.h>
 #include <limits.h>
+#include <strings.h>
 
 #include "connectwifi.h"
 #include "utils.h"
 #include "boot.h"
+#include "settingsJournal.h"
+#include "processes.h"
+#include "processBus.h"
+#include "scheduler.h"
 
 struct BootSettings bootSettings;
 
@@ -41,9 +46,18 @@ struct SettingItem accessPointTimeoutSecs = {"Access Point Timeout seconds",
                                              setDefaultAccessPointTimeoutSecs,
                                              validateBootTimeout};
 
+struct SettingItem fastBootSetting = {"Fast boot",
+                                      "fastboot",
+                                      &bootSettings.fastBoot,
+                                      ONOFF_INPUT_LENGTH,
+                                      yesNo,
+                                      setFalse,
+                                      validateYesNo};
+
 struct SettingItem *bootSettingItemPointers[] =
     {
-        &accessPointTimeoutSecs};
+        &accessPointTimeoutSecs,
+        &fastBootSetting};
 
 struct SettingItemCollection bootSettingItems = {
     "boot",
@@ -176,6 +190,12 @@ void getBootReasonMessage(char *buffer, int bufferlength)
         break;
     };
 
+#endif
+
+#if defined(ARDUINO_ARCH_HOST)
+
+    snprintf(buffer, bufferlength, "Simulation started");
+
 #endif
 }
 
@@ -222,7 +242,7 @@ int getInternalBootCode()
     return bootCode;
 #endif
 
-#if defined(ARDUINO_ARCH_PICO)
+#if defined(ARDUINO_ARCH_PICO) || defined(ARDUINO_ARCH_HOST)
 
 return COLD_BOOT_MODE;
 
@@ -257,7 +277,7 @@ bool isSoftwareReset()
     return getRestartCode() == ESP_RST_SW;
 #endif
 
-#if defined(ARDUINO_ARCH_PICO)
+#if defined(ARDUINO_ARCH_PICO) || defined(ARDUINO_ARCH_HOST)
     return false;
 #endif
 }
@@ -314,6 +334,9 @@ void getBootMode()
 
 void internalReboot(unsigned char rebootCode)
 {
+    // don't lose settings that are waiting to be written
+    flushPendingSettings();
+
     setInternalBootCode(rebootCode);
 
 
@@ -324,8 +347,150 @@ void internalReboot(unsigned char rebootCode)
 #if defined(ARDUINO_ARCH_ESP32)
     ESP.restart();
 #endif
-#if defined(ARDUINO_ARCH_ESP8266)
+#if defined(ARDUINO_ARCH_ESP8266) || defined(ARDUINO_ARCH_HOST)
     ESP.restart();
 #endif
 }
 
+struct BootPhase bootPhases[BOOT_PROFILE_MAX_PHASES];
+int noOfBootPhases = 0;
+
+void recordBootPhase(const char *name)
+{
+    unsigned long now = micros();
+
+    if (noOfBootPhases == BOOT_PROFILE_MAX_PHASES)
+    {
+        return;
+    }
+
+    for (int i = 0; i < noOfBootPhases; i++)
+    {
+        if (strcasecmp(bootPhases[i].name, name) == 0)
+        {
+            return;
+        }
+    }
+
+    bootPhases[noOfBootPhases].name = name;
+    bootPhases[noOfBootPhases].micros = now;
+    noOfBootPhases++;
+}
+
+void printBootProfile()
+{
+    unsigned long lastMicros = 0;
+
+    alwaysDisplayMessage("\nBoot profile (%s boot)\n", bootSettings.fastBoot ? "fast" : "normal");
+
+    for (int i = 0; i < noOfBootPhases; i++)
+    {
+        alwaysDisplayMessage("   %-16s at %6lums took %6lums\n",
+                             bootPhases[i].name,
+                             bootPhases[i].micros / 1000,
+                             ulongDiff(bootPhases[i].micros, lastMicros) / 1000);
+        lastMicros = bootPhases[i].micros;
+    }
+}
+
+unsigned long deferredStartMillis = 0;
+bool deferredStartNetworkSettled = false;
+
+void deferredStartWiFiStatus(struct processMessageListener *listener, void *value)
+{
+    struct BusStatusMessage *message = (struct BusStatusMessage *)value;
+
+    if (message->status == WIFI_OK || message->status == WIFI_TURNED_OFF)
+    {
+        deferredStartNetworkSettled = true;
+    }
+}
+
+struct processMessageListener deferredStartListener = {
+    "deferred starts",
+    NULL,
+    deferredStartWiFiStatus,
+    NULL,
+    busTopicWiFiStatus};
+
+void beginDeferredStarts()
+{
+    deferProcessStarts();
+    deferredStartMillis = millis();
+    subscribeToBusTopic(&deferredStartListener, busTopicWiFiStatus);
+}
+
+void updateDeferredStarts()
+{
+    if (!processStartsDeferred())
+    {
+        return;
+    }
+
+    if (deferredStartNetworkSettled ||
+        ulongDiff(millis(), deferredStartMillis) > BOOT_DEFERRED_START_TIMEOUT_MILLIS)
+    {
+        unsubscribeFromBusTopic(&deferredStartListener);
+        startDeferredProcesses();
+        recordBootPhase("deferred starts");
+    }
+}
+
+// The boot process has nothing to do in the loop. It is there so that the
+// boot settings are found, saved and loaded with those of the other
+// processes, which happens before startDevice reads fastboot.
+
+void initBootProcess()
+{
+    bootProcessDescriptor.status = BOOT_PROCESS_OK;
+}
+
+void startBootProcess()
+{
+    bootProcessDescriptor.status = BOOT_PROCESS_OK;
+}
+
+void updateBootProcess()
+{
+    // the deferred starts are checked from the loop
+    scheduleProcessUpdate(&bootProcessDescriptor, SCHEDULER_IDLE_MILLIS);
+}
+
+void stopBootProcess()
+{
+}
+
+bool bootProcessStatusOK()
+{
+    return bootProcessDescriptor.status == BOOT_PROCESS_OK;
+}
+
+void bootProcessStatusMessage(char *buffer, int bufferLength)
+{
+    snprintf(buffer, bufferLength, "%s boot%s",
+             bootSettings.fastBoot ? "Fast" : "Normal",
+             processStartsDeferred() ? ", deferred starts pending" : "");
+}
+
+struct process bootProcessDescriptor = {
+    "boot",
+    initBootProcess,
+    startBootProcess,
+    updateBootProcess,
+    stopBootProcess,
+    bootProcessStatusOK,
+    bootProcessStatusMessage,
+    false,
+    0,
+    0,
+    0,
+    NULL,
+    (unsigned char *)&bootSettings, sizeof(BootSettings), &bootSettingItems,
+    NULL,
+    BOOT_PROCESS + ACTIVE_PROCESS + CONFIG_PROCESS + WIFI_CONFIG_PROCESS,
+    NULL,
+    NULL,
+    NULL,
+    NULL, // no command options
+    0     // no command options
+};
@@ -1,10 +1,14 @@
 #pragma once
 
+// holds the boot settings - see the end of boot.cpp
 extern struct process bootProcessDescriptor;
 
+#define BOOT_PROCESS_OK 0
+
 struct BootSettings 
 {
     int accessPointTimeoutSecs;
+    bool fastBoot;
 };
 
 extern struct BootSettings bootSettings;
@@ -35,4 +39,42 @@ extern unsigned char bootMode;
 
 void getBootMode();
 
-void internalReboot(unsigned char rebootCode);
\ No newline at end of file
+void internalReboot(unsigned char rebootCode);
+
+// The boot profiler records the time at which each phase of startDevice
+// finished, measured from reset. A phase is only recorded once so that
+// events which repeat (for example the network coming back up) keep the
+// time of the first one.
+
+#define BOOT_PROFILE_MAX_PHASES 12
+
+struct BootPhase
+{
+    const char *name;
+    unsigned long micros;
+};
+
+void recordBootPhase(const char *name);
+
+void printBootProfile();
+
+// A fast boot leaves out the serial settle delay in startDevice and starts
+// the processes marked for a deferred start once WiFi is connected, or
+// turned off, or after BOOT_DEFERRED_START_TIMEOUT_MILLIS.
+//
+// The other boot waits end on the event they are waiting for. The window
+// for a key that forces console mode closes as soon as a key arrives, and
+// a fast boot only opens it when the robot could take the serial port. The
+// status display is held on the pixels by a timer while the loop runs.
+
+#define BOOT_DEFERRED_START_TIMEOUT_MILLIS 15000
+
+#define CONSOLE_FORCE_WINDOW_MILLIS 1000
+#define CONSOLE_FORCE_POLL_MILLIS 10
+#define STATUS_DISPLAY_HOLD_MILLIS 1000
+
+// called from startDevice in place of deferProcessStarts
+void beginDeferredStarts();
+
+// called from the loop
+void updateDeferredStarts();
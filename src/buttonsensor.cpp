@@ -5,6 +5,7 @@
 #include "sensors.h"
 #include "mqtt.h"
 #include "pixels.h"
+#include "inputEdges.h"
 
 struct ButtonSensorSettings buttonSensorSettings;
 
@@ -64,36 +65,33 @@ struct sensorEventBinder ButtonSensorListenerFunctions[] = {
 	{"released", BUTTONSENSOR_BUTTON_RELEASED},
 	{"changed", BUTTONSENSOR_SEND_ON_CHANGE}};
 
-int lastButtonInputValue;
-long buttonInputDebounceStartTime;
-unsigned long millisAtLastButtonInputChange;
+struct InputEdgeQueue buttonEdges;
 
-void readButtonSensor(struct buttonSensorReading *buttonSensorActiveReading)
+void ICACHE_RAM_ATTR buttonEdgeInterrupt()
 {
-	int newInputValue = digitalRead(buttonSensorSettings.buttonSensorInputPinNo);
+	pushInputEdge(&buttonEdges);
+}
+
+void startButtonEdges()
+{
+	startInputEdgeQueue(&buttonEdges, "button", buttonSensorSettings.buttonSensorInputPinNo, INPUT_PULLUP,
+						BUTTON_INPUT_DEBOUNCE_TIME * 1000UL, buttonEdgeInterrupt);
+}
+
+// applies the next debounced change to the reading - returns false if there isn't one
 
-	if (newInputValue == lastButtonInputValue)
+bool readButtonSensor(struct buttonSensorReading *buttonSensorActiveReading)
+{
+	int level;
+
+	if (!getInputEdgeChange(&buttonEdges, micros(), &level))
 	{
-		buttonInputDebounceStartTime = millis();
+		return false;
 	}
-	else
-	{
-		long currentMillis = millis();
-		long millisSinceChange = ulongDiff(currentMillis, buttonInputDebounceStartTime);
 
-		if (++millisSinceChange > BUTTON_INPUT_DEBOUNCE_TIME)
-		{
-			if (newInputValue)
-			{
-				buttonSensorActiveReading->pressed = false;
-			}
-			else
-			{
-				buttonSensorActiveReading->pressed = true;
-			}
-			lastButtonInputValue = newInputValue;
-		}
-	}
+	// the input is pulled up, so pressed is low
+	buttonSensorActiveReading->pressed = (level == LOW);
+	return true;
 }
 
 void buttonSensorTest()
@@ -101,18 +99,17 @@ void buttonSensorTest()
 	struct buttonSensorReading *buttonSensorActiveReading =
 		(struct buttonSensorReading *)buttonSensor.activeReading;
 
-	pinMode(buttonSensorSettings.buttonSensorInputPinNo, INPUT_PULLUP);
-
 	if (buttonSensorSettings.buttonGroundPin != -1)
 	{
 		pinMode(buttonSensorSettings.buttonGroundPin, OUTPUT);
 		digitalWrite(buttonSensorSettings.buttonGroundPin, LOW);
 	}
 
+	startButtonEdges();
+
 	alwaysDisplayMessage("Button Sensor test\nPress the ESC key to end the test");
 
 	int count = 0;
-	bool triggered = false;
 
 	while (true)
 	{
@@ -125,53 +122,23 @@ void buttonSensorTest()
 			}
 		}
 
-		readButtonSensor(buttonSensorActiveReading);
-
-		if (buttonSensorActiveReading->pressed)
+		// a press during the delay is waiting in the queue
+		while (readButtonSensor(buttonSensorActiveReading))
 		{
-			if (triggered == false)
+			if (buttonSensorActiveReading->pressed)
 			{
 				count++;
 				alwaysDisplayMessage("    pressed: %d\n", count);
-				triggered = true;
 			}
 		}
-		else
-		{
-			triggered = false;
-		}
 		delay(100);
 	}
 
 	alwaysDisplayMessage("Button test ended");
 }
 
-bool updateButtonSensor()
+void fireButtonSensorListeners(struct buttonSensorReading *buttonSensoractiveReading)
 {
-	if (!buttonSensor.beingUpdated)
-	{
-		return false;
-	}
-
-	struct buttonSensorReading *buttonSensoractiveReading =
-		(struct buttonSensorReading *)buttonSensor.activeReading;
-
-	bool previousReading = buttonSensoractiveReading->pressed;
-
-	readButtonSensor(buttonSensoractiveReading);
-
-	buttonSensor.millisAtLastReading = millis();
-
-	if (buttonSensoractiveReading->pressed == previousReading)
-	{
-		// we have read the button but the value has not changed
-		// just return that we worked OK
-		return true;
-	}
-
-	// if we get here we have a change in the reading
-	// see who wants to know
-
 	sensorListener *pos = buttonSensor.listeners;
 
 	while (pos != NULL)
@@ -191,7 +158,7 @@ bool updateButtonSensor()
 				snprintf(messageBuffer, MAX_MESSAGE_LENGTH, "up  ");
 			}
 
-			pos->receiveMessage(pos->config->destination, pos->config->optionBuffer);
+			fireSensorListener(pos);
 			pos->lastReadingMillis = buttonSensor.millisAtLastReading;
 			// move on to the next one
 			pos = pos->nextMessageListener;
@@ -203,7 +170,7 @@ bool updateButtonSensor()
 			// send on pressed - is the button pressed now?
 			if (buttonSensoractiveReading->pressed)
 			{
-				pos->receiveMessage(pos->config->destination, pos->config->optionBuffer);
+				fireSensorListener(pos);
 				pos->lastReadingMillis = buttonSensor.millisAtLastReading;
 				// move on to the next one
 				pos = pos->nextMessageListener;
@@ -216,7 +183,7 @@ bool updateButtonSensor()
 			// send on pressed - is the button pressed now?
 			if (!buttonSensoractiveReading->pressed)
 			{
-				pos->receiveMessage(pos->config->destination, pos->config->optionBuffer);
+				fireSensorListener(pos);
 				pos->lastReadingMillis = buttonSensor.millisAtLastReading;
 				// move on to the next one
 				pos = pos->nextMessageListener;
@@ -227,6 +194,26 @@ bool updateButtonSensor()
 		// move on to the next one
 		pos = pos->nextMessageListener;
 	}
+}
+
+bool updateButtonSensor()
+{
+	if (!buttonSensor.beingUpdated)
+	{
+		return false;
+	}
+
+	struct buttonSensorReading *buttonSensoractiveReading =
+		(struct buttonSensorReading *)buttonSensor.activeReading;
+
+	buttonSensor.millisAtLastReading = millis();
+
+	// a press and release between two updates comes out as two changes
+	while (readButtonSensor(buttonSensoractiveReading))
+	{
+		fireButtonSensorListeners(buttonSensoractiveReading);
+	}
+
 	return true;
 }
 
@@ -234,7 +221,7 @@ void startbuttonSensor()
 {
 	if (buttonSensor.activeReading == NULL)
 	{
-		buttonSensor.activeReading = new buttonSensorReading();
+		buttonSensor.activeReading = allocateSensorReading(sizeof(struct buttonSensorReading));
 	}
 
 	if (!buttonSensorSettings.buttonSensorFitted)
@@ -243,14 +230,19 @@ void startbuttonSensor()
 	}
 	else
 	{
-		pinMode(buttonSensorSettings.buttonSensorInputPinNo, INPUT_PULLUP);
-
 		if (buttonSensorSettings.buttonGroundPin != -1)
 		{
 			pinMode(buttonSensorSettings.buttonGroundPin, OUTPUT);
 			digitalWrite(buttonSensorSettings.buttonGroundPin, LOW);
 		}
 
+		startButtonEdges();
+
+		struct buttonSensorReading *buttonSensoractiveReading =
+			(struct buttonSensorReading *)buttonSensor.activeReading;
+
+		buttonSensoractiveReading->pressed = (buttonEdges.level == LOW);
+
 		buttonSensor.status = SENSOR_OK;
 	}
 }
@@ -493,6 +493,22 @@ void checkTimers(struct clockReading *reading)
 
 // Look for any listeners who want to get the time delivered to them as a string...
 
+// Fills in the message for each listener on a tick and fires it. Only the
+// listeners for the tick are visited.
+
+void fireClockTickListeners(int trigger, const char *format, int first, int second, int third)
+{
+	struct sensorListener *pos = findSensorTriggerListeners(&clockSensor, trigger);
+
+	while (pos != NULL)
+	{
+		char *messageBuffer = (char *)pos->config->optionBuffer + MESSAGE_START_POSITION;
+		snprintf(messageBuffer, MAX_MESSAGE_LENGTH, format, first, second, third);
+		fireSensorListener(pos);
+		pos = pos->nextTriggerListener;
+	}
+}
+
 void checkClock(struct clockReading *reading)
 {
 	static int lastClockSecond = -1;
@@ -507,56 +523,28 @@ void checkClock(struct clockReading *reading)
 
 	lastClockSecond = reading->second;
 
-	struct sensorListener *pos = clockSensor.listeners;
+	TRACELOGLN("Second Tick");
+	fireClockTickListeners(CLOCK_SECOND_TICK, "%02d:%02d:%02d", reading->hour, reading->minute, reading->second);
 
-	while (pos != NULL)
+	if (lastClockMinute != reading->minute)
 	{
-		char *messageBuffer = (char *)pos->config->optionBuffer + MESSAGE_START_POSITION;
-
-		if (pos->config->sendOptionMask == CLOCK_SECOND_TICK)
-		{
-			TRACELOGLN("Second Tick");
-			snprintf(messageBuffer, MAX_MESSAGE_LENGTH, "%02d:%02d:%02d",
-					 reading->hour,
-					 reading->minute,
-					 reading->second);
-			pos->receiveMessage(pos->config->destination, pos->config->optionBuffer);
-		}
-
-		if (pos->config->sendOptionMask == CLOCK_MINUTE_TICK)
-		{
-			if (lastClockMinute != reading->minute)
-			{
-				TRACELOGLN("Minute Tick");
-				snprintf(messageBuffer, MAX_MESSAGE_LENGTH, "%02d:%02d", reading->hour, reading->minute);
-				pos->receiveMessage(pos->config->destination, pos->config->optionBuffer);
-				lastClockMinute = reading->minute;
-			}
-		}
-
-		if (pos->config->sendOptionMask == CLOCK_HOUR_TICK)
-		{
-			if (lastClockHour != reading->hour)
-			{
-				TRACELOGLN("Hour Tick");
-				snprintf(messageBuffer, MAX_MESSAGE_LENGTH, "%02d:%02d", reading->hour, reading->minute);
-				pos->receiveMessage(pos->config->destination, pos->config->optionBuffer);
-				lastClockHour = reading->hour;
-			}
-		}
+		TRACELOGLN("Minute Tick");
+		fireClockTickListeners(CLOCK_MINUTE_TICK, "%02d:%02d", reading->hour, reading->minute, 0);
+		lastClockMinute = reading->minute;
+	}
 
-		if (pos->config->sendOptionMask == CLOCK_DAY_TICK)
-		{
-			if (lastClockDay != reading->day)
-			{
-				TRACELOGLN("Day Tick");
-				snprintf(messageBuffer, MAX_MESSAGE_LENGTH, "%02d:%02d:%02d", reading->day, reading->month, reading->year);
-				pos->receiveMessage(pos->config->destination, pos->config->optionBuffer);
-				lastClockDay = reading->day;
-			}
-		}
+	if (lastClockHour != reading->hour)
+	{
+		TRACELOGLN("Hour Tick");
+		fireClockTickListeners(CLOCK_HOUR_TICK, "%02d:%02d", reading->hour, reading->minute, 0);
+		lastClockHour = reading->hour;
+	}
 
-		pos = pos->nextMessageListener;
+	if (lastClockDay != reading->day)
+	{
+		TRACELOGLN("Day Tick");
+		fireClockTickListeners(CLOCK_DAY_TICK, "%02d:%02d:%02d", reading->day, reading->month, reading->year);
+		lastClockDay = reading->day;
 	}
 }
 
@@ -599,7 +587,7 @@ void startClockSensor()
 
 	if (clockSensor.activeReading == NULL)
 	{
-		clockActiveReading = new ClockReading();
+		clockActiveReading = (struct ClockReading *)allocateSensorReading(sizeof(struct ClockReading));
 		clockSensor.activeReading = clockActiveReading;
 	}
 	else
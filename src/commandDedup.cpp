@@ -0,0 +1,154 @@
+#include <Arduino.h>
+
+#include "debug.h"
+#include "commandDedup.h"
+
+struct CommandDedupEntry commandDedupEntries[COMMAND_DEDUP_NO_OF_ENTRIES];
+
+unsigned long commandDedupUseCount = 0;
+
+unsigned long commandDuplicatesSuppressed = 0;
+
+#define COMMAND_HASH_OFFSET_BASIS 2166136261UL
+
+// FNV-1a hash of the from text. A missing from value hashes to the offset basis.
+
+unsigned long hashCommandSource(const char *from)
+{
+	unsigned long hash = COMMAND_HASH_OFFSET_BASIS;
+
+	if (from == NULL)
+	{
+		return hash;
+	}
+
+	while (*from)
+	{
+		hash ^= (unsigned char)*from;
+		hash *= 16777619UL;
+		from++;
+	}
+
+	return hash;
+}
+
+unsigned long hashCommandMessage(const char *message, int messageLength)
+{
+	unsigned long hash = COMMAND_HASH_OFFSET_BASIS;
+
+	for (int i = 0; i < messageLength; i++)
+	{
+		hash ^= (unsigned char)message[i];
+		hash *= 16777619UL;
+	}
+
+	return hash;
+}
+
+struct CommandDedupEntry *findCommandDedupEntry(CommandResultDeliverer transport, unsigned long fromHash,
+												unsigned long messageHash, int seq)
+{
+	for (int i = 0; i < COMMAND_DEDUP_NO_OF_ENTRIES; i++)
+	{
+		struct CommandDedupEntry *entry = &commandDedupEntries[i];
+
+		if (entry->inUse && entry->seq == seq && entry->fromHash == fromHash &&
+			entry->messageHash == messageHash && entry->transport == transport)
+		{
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+bool deliverCachedCommandReply(const char *from, int seq, const char *message, int messageLength,
+							   CommandResultDeliverer deliverResult)
+{
+	struct CommandDedupEntry *entry = findCommandDedupEntry(deliverResult, hashCommandSource(from),
+															hashCommandMessage(message, messageLength), seq);
+
+	if (entry == NULL)
+	{
+		return false;
+	}
+
+	TRACELOG("Duplicate command seq:");
+	TRACELOGLN(seq);
+
+	entry->lastUsed = ++commandDedupUseCount;
+	commandDuplicatesSuppressed++;
+
+	deliverResult(entry->reply);
+	return true;
+}
+
+// The command that is being performed. A command performed by another
+// command saves and restores this around itself, so a single pending entry
+// is enough.
+
+struct CommandDedupPending commandDedupPending;
+
+void deliverAndCacheCommandReply(char *resultText)
+{
+	if ((int)strlen(resultText) < COMMAND_DEDUP_REPLY_LENGTH)
+	{
+		// replace the least recently used entry
+
+		struct CommandDedupEntry *victim = &commandDedupEntries[0];
+
+		for (int i = 0; i < COMMAND_DEDUP_NO_OF_ENTRIES; i++)
+		{
+			struct CommandDedupEntry *entry = &commandDedupEntries[i];
+
+			if (!entry->inUse)
+			{
+				victim = entry;
+				break;
+			}
+
+			if (entry->lastUsed < victim->lastUsed)
+			{
+				victim = entry;
+			}
+		}
+
+		victim->transport = commandDedupPending.deliverResult;
+		victim->fromHash = commandDedupPending.fromHash;
+		victim->messageHash = commandDedupPending.messageHash;
+		victim->seq = commandDedupPending.seq;
+		victim->lastUsed = ++commandDedupUseCount;
+		victim->inUse = true;
+		strcpy(victim->reply, resultText);
+	}
+
+	commandDedupPending.deliverResult(resultText);
+}
+
+CommandResultDeliverer cacheCommandReply(const char *from, int seq, const char *message, int messageLength,
+										 CommandResultDeliverer deliverResult)
+{
+	commandDedupPending.deliverResult = deliverResult;
+	commandDedupPending.fromHash = hashCommandSource(from);
+	commandDedupPending.messageHash = hashCommandMessage(message, messageLength);
+	commandDedupPending.seq = seq;
+
+	return deliverAndCacheCommandReply;
+}
+
+void saveCommandDedupPending(struct CommandDedupPending *saved)
+{
+	*saved = commandDedupPending;
+}
+
+void restoreCommandDedupPending(struct CommandDedupPending *saved)
+{
+	commandDedupPending = *saved;
+}
+
+void clearCommandDedupCache()
+{
+	for (int i = 0; i < COMMAND_DEDUP_NO_OF_ENTRIES; i++)
+	{
+		commandDedupEntries[i].inUse = false;
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+// Remembers the replies to recently performed commands that carry a sequence
+// number. If a sender retries a command (perhaps because the reply was lost)
+// the cached reply is sent back and the command is not performed again.
+//
+// The source of a command is the transport it arrived on (identified by the
+// function that delivers the reply) along with the optional "from" value in
+// the command. A retry is sent byte for byte as before, so the cache also
+// holds a hash of the whole message. A different command that reuses a
+// sequence number (a binary command has no from value, and a backend may
+// start its numbering again) doesn't match and is performed.
+
+#define COMMAND_DEDUP_NO_OF_ENTRIES 6
+
+// replies longer than this are not cached
+#define COMMAND_DEDUP_REPLY_LENGTH 100
+
+typedef void (*CommandResultDeliverer)(char *resultText);
+
+struct CommandDedupEntry
+{
+	CommandResultDeliverer transport;
+	unsigned long fromHash;
+	unsigned long messageHash;
+	int seq;
+	unsigned long lastUsed;
+	bool inUse;
+	char reply[COMMAND_DEDUP_REPLY_LENGTH];
+};
+
+// Sends the cached reply and returns true if this command has been seen before
+
+bool deliverCachedCommandReply(const char *from, int seq, const char *message, int messageLength,
+							   CommandResultDeliverer deliverResult);
+
+// Returns a deliverer to be used in place of deliverResult that caches the
+// reply before passing it on. Only one reply can be pending at a time.
+
+CommandResultDeliverer cacheCommandReply(const char *from, int seq, const char *message, int messageLength,
+										 CommandResultDeliverer deliverResult);
+
+// A command can perform other commands - a command store does - so the
+// pending reply is saved before each command is acted on and put back
+// afterwards. Otherwise the outer reply would be cached under the key of
+// the last inner command.
+
+struct CommandDedupPending
+{
+	CommandResultDeliverer deliverResult;
+	unsigned long fromHash;
+	unsigned long messageHash;
+	int seq;
+};
+
+void saveCommandDedupPending(struct CommandDedupPending *saved);
+void restoreCommandDedupPending(struct CommandDedupPending *saved);
+
+void clearCommandDedupCache();
+
+extern unsigned long commandDuplicatesSuppressed;
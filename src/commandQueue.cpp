@@ -0,0 +1,317 @@
+#include <Arduino.h>
+#include <strings.h>
+
+#include "debug.h"
+#include "utils.h"
+#include "errors.h"
+#include "commandQueue.h"
+#include "controller.h"
+#include "commandRecorder.h"
+#include "processes.h"
+#include "scheduler.h"
+
+// The queue is held in a fixed set of slots so that it never touches the heap.
+// Free slots are kept on a free list and used slots are kept on one FIFO list
+// per priority class. Urgent commands are always performed before normal ones,
+// which are performed before bulk (settings and store) commands.
+
+struct CommandQueueItem commandQueueSlots[COMMAND_QUEUE_NO_OF_SLOTS];
+
+struct CommandQueueItem *freeCommandQueueItems = NULL;
+
+struct CommandQueueItem *commandQueueHeads[COMMAND_QUEUE_NO_OF_PRIORITIES];
+struct CommandQueueItem *commandQueueTails[COMMAND_QUEUE_NO_OF_PRIORITIES];
+
+struct CommandQueueStats commandQueueStats;
+
+bool commandQueueSetUp = false;
+
+void setupCommandQueue()
+{
+	freeCommandQueueItems = NULL;
+
+	for (int i = 0; i < COMMAND_QUEUE_NO_OF_SLOTS; i++)
+	{
+		commandQueueSlots[i].nextItem = freeCommandQueueItems;
+		freeCommandQueueItems = &commandQueueSlots[i];
+	}
+
+	for (int i = 0; i < COMMAND_QUEUE_NO_OF_PRIORITIES; i++)
+	{
+		commandQueueHeads[i] = NULL;
+		commandQueueTails[i] = NULL;
+	}
+
+	memset(&commandQueueStats, 0, sizeof(commandQueueStats));
+
+	commandQueueSetUp = true;
+}
+
+// Works out the priority of a JSON command without parsing it. Settings and
+// commands that are being added to a store cause flash writes, so they are
+// treated as bulk. Everything else is a normal command.
+
+CommandPriority classifyCommandPriority(const char *text)
+{
+	if (strstr(text, "\"setting\"") != NULL)
+	{
+		return bulkCommand;
+	}
+
+	if (strstr(text, "\"store\"") != NULL)
+	{
+		return bulkCommand;
+	}
+
+	return normalCommand;
+}
+
+// A command that never gets performed still gets a reply, so that the
+// sender isn't left waiting for one
+
+#define DROPPED_COMMAND_REPLY_LENGTH 120
+#define DROPPED_COMMAND_ERROR_LENGTH 80
+
+void replyToDroppedCommand(int error, void (*deliverResult)(char *resultText))
+{
+	char description[DROPPED_COMMAND_ERROR_LENGTH];
+	char reply[DROPPED_COMMAND_REPLY_LENGTH];
+
+	decodeError(error, description, DROPPED_COMMAND_ERROR_LENGTH);
+	snprintf(reply, DROPPED_COMMAND_REPLY_LENGTH, "{\"error\":%d,\"message\":\"%s\"}", error, description);
+	deliverResult(reply);
+}
+
+// Removes the newest entry from the lowest priority list that is below
+// the given priority. Returns false if there is nothing that can be dropped.
+
+bool dropLowerPriorityCommand(CommandPriority priority)
+{
+	for (int p = COMMAND_QUEUE_NO_OF_PRIORITIES - 1; p > (int)priority; p--)
+	{
+		struct CommandQueueItem *head = commandQueueHeads[p];
+
+		if (head == NULL)
+		{
+			continue;
+		}
+
+		struct CommandQueueItem *victim = commandQueueTails[p];
+
+		if (head == victim)
+		{
+			commandQueueHeads[p] = NULL;
+			commandQueueTails[p] = NULL;
+		}
+		else
+		{
+			struct CommandQueueItem *pos = head;
+
+			while (pos->nextItem != victim)
+			{
+				pos = pos->nextItem;
+			}
+
+			pos->nextItem = NULL;
+			commandQueueTails[p] = pos;
+		}
+
+		victim->nextItem = freeCommandQueueItems;
+		freeCommandQueueItems = victim;
+		commandQueueStats.depth--;
+		commandQueueStats.dropped[p]++;
+
+		// the slot is free again but the reply function is still in it
+		replyToDroppedCommand(JSON_MESSAGE_COMMAND_DROPPED_FOR_PRIORITY, victim->deliverResult);
+		return true;
+	}
+
+	return false;
+}
+
+void actOnQueuedJsonCommand(const char *text, int length, void (*deliverResult)(char *resultText));
+
+// A JSON command is recorded here, when it is performed in the loop, rather
+// than when it arrives, which can be in the MQTT callback where a file write
+// would hold up the network client.
+
+void performCommand(const char *text, int length,
+					void (*actOnCommand)(const char *text, int length, void (*deliverResult)(char *resultText)),
+					void (*deliverResult)(char *resultText))
+{
+	if (actOnCommand == actOnQueuedJsonCommand)
+	{
+		recordCommand(text);
+	}
+
+	actOnCommand(text, length, deliverResult);
+}
+
+bool enqueueCommand(const char *text, int length, CommandPriority priority,
+					void (*actOnCommand)(const char *text, int length, void (*deliverResult)(char *resultText)),
+					void (*deliverResult)(char *resultText))
+{
+	if (!commandQueueSetUp)
+	{
+		setupCommandQueue();
+	}
+
+	if (length >= COMMAND_QUEUE_TEXT_LENGTH)
+	{
+		// too long for a slot - it jumps the queue and is recorded and
+		// performed by the transport that received it
+		TRACELOGLN("Command too long for the queue - performing it now");
+		commandQueueStats.performedDirectly++;
+		performCommand(text, length, actOnCommand, deliverResult);
+		return true;
+	}
+
+	if (freeCommandQueueItems == NULL)
+	{
+		// queue full - make room by throwing away something less important
+		if (!dropLowerPriorityCommand(priority))
+		{
+			TRACELOGLN("Command queue full");
+			commandQueueStats.dropped[priority]++;
+			replyToDroppedCommand(JSON_MESSAGE_COMMAND_QUEUE_FULL, deliverResult);
+			return false;
+		}
+	}
+
+	struct CommandQueueItem *item = freeCommandQueueItems;
+	freeCommandQueueItems = item->nextItem;
+
+	memcpy(item->text, text, length);
+	item->text[length] = 0;
+	item->length = length;
+	item->priority = priority;
+	item->enqueuedMicros = micros();
+	item->actOnCommand = actOnCommand;
+	item->deliverResult = deliverResult;
+	item->nextItem = NULL;
+
+	if (commandQueueHeads[priority] == NULL)
+	{
+		commandQueueHeads[priority] = item;
+	}
+	else
+	{
+		commandQueueTails[priority]->nextItem = item;
+	}
+	commandQueueTails[priority] = item;
+
+	commandQueueStats.enqueued++;
+	commandQueueStats.depth++;
+
+	wakeProcess(&controllerProcess);
+
+	if (commandQueueStats.depth > commandQueueStats.maxDepth)
+	{
+		commandQueueStats.maxDepth = commandQueueStats.depth;
+	}
+
+	return true;
+}
+
+void actOnQueuedJsonCommand(const char *text, int length, void (*deliverResult)(char *resultText))
+{
+	act_onJson_message(text, deliverResult);
+}
+
+bool enqueueJsonCommand(const char *text, void (*deliverResult)(char *resultText))
+{
+	return enqueueCommand(text, strlen(text), classifyCommandPriority(text), actOnQueuedJsonCommand, deliverResult);
+}
+
+struct CommandQueueItem *takeNextQueuedCommand()
+{
+	for (int p = 0; p < COMMAND_QUEUE_NO_OF_PRIORITIES; p++)
+	{
+		struct CommandQueueItem *item = commandQueueHeads[p];
+
+		if (item != NULL)
+		{
+			commandQueueHeads[p] = item->nextItem;
+			if (commandQueueHeads[p] == NULL)
+			{
+				commandQueueTails[p] = NULL;
+			}
+			return item;
+		}
+	}
+	return NULL;
+}
+
+// Performs queued commands until the queue is empty or the budget has been used.
+// At least one command is performed on each call so that the queue always moves.
+
+void drainCommandQueue(unsigned long budgetMicros)
+{
+	if (!commandQueueSetUp)
+	{
+		return;
+	}
+
+	unsigned long startMicros = micros();
+
+	while (true)
+	{
+		struct CommandQueueItem *item = takeNextQueuedCommand();
+
+		if (item == NULL)
+		{
+			break;
+		}
+
+		unsigned long waitMicros = ulongDiff(micros(), item->enqueuedMicros);
+
+		commandQueueStats.totalWaitMicros += waitMicros;
+
+		if (waitMicros > commandQueueStats.maxWaitMicros)
+		{
+			commandQueueStats.maxWaitMicros = waitMicros;
+		}
+
+		// the item is off the queue lists while it runs, so a command that
+		// enqueues another command can't disturb it
+
+		performCommand(item->text, item->length, item->actOnCommand, item->deliverResult);
+
+		item->nextItem = freeCommandQueueItems;
+		freeCommandQueueItems = item;
+		commandQueueStats.depth--;
+		commandQueueStats.performed++;
+
+		if (ulongDiff(micros(), startMicros) > budgetMicros)
+		{
+			break;
+		}
+	}
+}
+
+int commandQueueDepth()
+{
+	return commandQueueStats.depth;
+}
+
+void commandQueueStatusMessage(char *buffer, int bufferLength)
+{
+	unsigned long averageWaitMicros = 0;
+
+	if (commandQueueStats.performed > 0)
+	{
+		averageWaitMicros = (unsigned long)(commandQueueStats.totalWaitMicros / commandQueueStats.performed);
+	}
+
+	snprintf(buffer, bufferLength,
+			 "queued:%d max:%d performed:%lu wait avg:%luus max:%luus dropped urgent:%lu normal:%lu bulk:%lu performed directly:%lu",
+			 commandQueueStats.depth,
+			 commandQueueStats.maxDepth,
+			 commandQueueStats.performed,
+			 averageWaitMicros,
+			 commandQueueStats.maxWaitMicros,
+			 commandQueueStats.dropped[urgentCommand],
+			 commandQueueStats.dropped[normalCommand],
+			 commandQueueStats.dropped[bulkCommand],
+			 commandQueueStats.performedDirectly);
+}
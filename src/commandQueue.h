@@ -0,0 +1,65 @@
+#pragma once
+
+// Incoming commands from the transports (MQTT and the serial console) are
+// placed in this queue rather than being performed straight away. The
+// controller process drains the queue each time it is updated, so a slow
+// command doesn't hold up the network stack.
+//
+// A command that the queue turns away, or throws out to make room for a
+// more urgent one, is sent an error reply through its deliverResult.
+//
+// The slots are sized for everyday commands. The transports take longer
+// ones - up to the 1000 byte MQTT buffer and the 1499 byte serial buffer -
+// and a command that doesn't fit in a slot is performed straight away, as
+// all commands were before the queue, rather than being turned away.
+// Making every slot big enough for the serial buffer would take 9K of RAM.
+
+#define COMMAND_QUEUE_NO_OF_SLOTS 6
+#define COMMAND_QUEUE_TEXT_LENGTH 500
+
+// Maximum time the controller will spend draining the queue in one update
+#define COMMAND_QUEUE_DRAIN_BUDGET_MICROS 20000
+
+enum CommandPriority { urgentCommand, normalCommand, bulkCommand };
+
+#define COMMAND_QUEUE_NO_OF_PRIORITIES 3
+
+struct CommandQueueItem
+{
+    char text[COMMAND_QUEUE_TEXT_LENGTH];
+    int length;
+    CommandPriority priority;
+    // time the command was queued, used to measure how long commands wait
+    unsigned long enqueuedMicros;
+    void (*actOnCommand)(const char *text, int length, void (*deliverResult)(char *resultText));
+    void (*deliverResult)(char *resultText);
+    struct CommandQueueItem *nextItem;
+};
+
+struct CommandQueueStats
+{
+    int depth;
+    int maxDepth;
+    unsigned long enqueued;
+    unsigned long performed;
+    unsigned long dropped[COMMAND_QUEUE_NO_OF_PRIORITIES];
+    unsigned long performedDirectly;
+    unsigned long maxWaitMicros;
+    unsigned long long totalWaitMicros;
+};
+
+extern struct CommandQueueStats commandQueueStats;
+
+CommandPriority classifyCommandPriority(const char *text);
+
+bool enqueueCommand(const char *text, int length, CommandPriority priority,
+                    void (*actOnCommand)(const char *text, int length, void (*deliverResult)(char *resultText)),
+                    void (*deliverResult)(char *resultText));
+
+bool enqueueJsonCommand(const char *text, void (*deliverResult)(char *resultText));
+
+void drainCommandQueue(unsigned long budgetMicros);
+
+int commandQueueDepth();
+
+void commandQueueStatusMessage(char *buffer, int bufferLength);
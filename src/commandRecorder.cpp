@@ -0,0 +1,203 @@
+#include <Arduino.h>
+#include <strings.h>
+#include <LittleFS.h>
+
+#include "debug.h"
+#include "utils.h"
+#include "controller.h"
+#include "commandDedup.h"
+#include "commandRecorder.h"
+
+File recordFile;
+
+bool recordingCommands = false;
+
+bool buildRecordingFilename(char *dest, const char *name)
+{
+	if (strlen(name) == 0 || strchr(name, '/') != NULL)
+	{
+		return false;
+	}
+
+	int length = snprintf(dest, COMMAND_RECORDING_NAME_LENGTH, "/%s.rec", name);
+
+	return length < COMMAND_RECORDING_NAME_LENGTH;
+}
+
+bool startCommandRecording(const char *name)
+{
+	char filename[COMMAND_RECORDING_NAME_LENGTH];
+
+	if (!buildRecordingFilename(filename, name))
+	{
+		return false;
+	}
+
+	stopCommandRecording();
+
+	recordFile = LittleFS.open(filename, "w");
+
+	if (!recordFile)
+	{
+		TRACELOG("Could not create recording:");
+		TRACELOGLN(filename);
+		return false;
+	}
+
+	recordingCommands = true;
+	return true;
+}
+
+void stopCommandRecording()
+{
+	if (recordingCommands)
+	{
+		recordFile.close();
+		recordingCommands = false;
+	}
+}
+
+bool commandRecordingActive()
+{
+	return recordingCommands;
+}
+
+void recordCommand(const char *text)
+{
+	if (!recordingCommands)
+	{
+		return;
+	}
+
+	// commands are stored one per line so they must not contain line breaks
+
+	if (strchr(text, '\n') != NULL || strchr(text, '\r') != NULL)
+	{
+		return;
+	}
+
+	recordFile.printf("%s\n", text);
+}
+
+// The replies from replayed commands are not sent anywhere, but failures are counted
+
+int replayFailures;
+
+void discardReplayResult(char *resultText)
+{
+	if (strstr(resultText, "\"error\":0,") == NULL)
+	{
+		replayFailures++;
+	}
+}
+
+unsigned long replaySamples[COMMAND_REPLAY_NO_OF_SAMPLES];
+
+int compareReplaySamples(const void *a, const void *b)
+{
+	unsigned long sampleA = *(const unsigned long *)a;
+	unsigned long sampleB = *(const unsigned long *)b;
+
+	if (sampleA < sampleB)
+		return -1;
+	if (sampleA > sampleB)
+		return 1;
+	return 0;
+}
+
+bool replayCommandRecording(const char *name, int repeats, struct CommandReplayResults *results)
+{
+	char filename[COMMAND_RECORDING_NAME_LENGTH];
+	if (!buildRecordingFilename(filename, name))
+	{
+		return false;
+	}
+
+	// make sure we are not replaying the file we are writing
+	stopCommandRecording();
+
+	memset(results, 0, sizeof(struct CommandReplayResults));
+	results->startHeap = ESP.getFreeHeap();
+	results->lowestHeap = results->startHeap;
+	replayFailures = 0;
+
+	for (int repeat = 0; repeat < repeats; repeat++)
+	{
+		// each pass must perform the commands rather than answer them as retries
+		clearCommandDedupCache();
+
+		File replayFile = LittleFS.open(filename, "r");
+
+		if (!replayFile || replayFile.isDirectory())
+		{
+			return false;
+		}
+
+		while (replayFile.available())
+		{
+			String line = replayFile.readStringUntil('\n');
+
+			if (line.length() == 0)
+			{
+				continue;
+			}
+
+			unsigned long startMicros = micros();
+			act_onJson_message(line.c_str(), discardReplayResult);
+			unsigned long commandMicros = ulongDiff(micros(), startMicros);
+
+			results->elapsedMicros += commandMicros;
+
+			if (commandMicros > results->maxMicros)
+			{
+				results->maxMicros = commandMicros;
+			}
+
+			// keep a random sample of the command times for the percentiles
+
+			if (results->noOfCommands < COMMAND_REPLAY_NO_OF_SAMPLES)
+			{
+				replaySamples[results->noOfCommands] = commandMicros;
+			}
+			else
+			{
+				long slot = random(0, results->noOfCommands + 1);
+				if (slot < COMMAND_REPLAY_NO_OF_SAMPLES)
+				{
+					replaySamples[slot] = commandMicros;
+				}
+			}
+
+			results->noOfCommands++;
+
+			unsigned long heap = ESP.getFreeHeap();
+			if (heap < results->lowestHeap)
+			{
+				results->lowestHeap = heap;
+			}
+
+			// keep the network stack and watchdog happy during long replays
+			yield();
+		}
+
+		replayFile.close();
+	}
+
+	results->noOfFailures = replayFailures;
+
+	int noOfSamples = results->noOfCommands;
+
+	if (noOfSamples > COMMAND_REPLAY_NO_OF_SAMPLES)
+	{
+		noOfSamples = COMMAND_REPLAY_NO_OF_SAMPLES;
+	}
+
+	if (noOfSamples > 0)
+	{
+		qsort(replaySamples, noOfSamples, sizeof(unsigned long), compareReplaySamples);
+		results->p50Micros = replaySamples[(noOfSamples * 50) / 100];
+		results->p99Micros = replaySamples[(noOfSamples * 99) / 100];
+	}
+
+	return true;
+}
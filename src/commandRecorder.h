@@ -0,0 +1,40 @@
+#pragma once
+
+// Records incoming JSON commands to a file and replays them through the
+// controller as fast as possible. The replay reports the command rate, the
+// 50th and 99th percentile command times and the lowest free heap seen,
+// which gives a repeatable measure of the command path on a real device.
+//
+// Recordings are held one command per line in the root of the file system
+// with the extension .rec
+//
+// A command is recorded when the controller takes it from the command queue
+// in the loop, so the file is never written from the MQTT callback. A
+// command that the queue drops isn't recorded.
+
+#define COMMAND_RECORDING_NAME_LENGTH 30
+
+// the percentiles are worked out from a random sample of this many command times
+#define COMMAND_REPLAY_NO_OF_SAMPLES 128
+
+struct CommandReplayResults
+{
+	int noOfCommands;
+	int noOfFailures;
+	unsigned long elapsedMicros;
+	unsigned long p50Micros;
+	unsigned long p99Micros;
+	unsigned long maxMicros;
+	unsigned long startHeap;
+	unsigned long lowestHeap;
+};
+
+bool startCommandRecording(const char *name);
+
+void stopCommandRecording();
+
+bool commandRecordingActive();
+
+void recordCommand(const char *text);
+
+bool replayCommandRecording(const char *name, int repeats, struct CommandReplayResults *results);
@@ -8,6 +8,8 @@
 #include "boot.h"
 #include "pixels.h"
 #include "controller.h"
+#include "settingsArena.h"
+#include "processBus.h"
 
 #if defined(ARDUINO_ARCH_ESP32)
 
@@ -18,12 +20,12 @@
 
 boolean validateWifiSSID(void *dest, const char *newValueStr)
 {
-	return (validateString((char *)dest, newValueStr, WIFI_SSID_LENGTH));
+	return (validateArenaString(dest, newValueStr, WIFI_SSID_LENGTH));
 }
 
 boolean validateWifiPWD(void *dest, const char *newValueStr)
 {
-	return (validateString((char *)dest, newValueStr, WIFI_PASSWORD_LENGTH));
+	return (validateArenaString(dest, newValueStr, WIFI_PASSWORD_LENGTH));
 }
 
 struct WifiConnectionSettings wifiConnectionSettings;
@@ -33,38 +35,38 @@ struct SettingItem wifiOnOff = {
 
 void setDefaultWiFi1SSID(void *dest)
 {
-	strcpy((char *)dest, DEFAULT_WIFI1_SSID);
+	setDefaultArenaString(dest, DEFAULT_WIFI1_SSID);
 }
 
 void setDefaultWiFi1Pwd(void *dest)
 {
-	strcpy((char *)dest, DEFAULT_WIFI1_PWD);
+	setDefaultArenaString(dest, DEFAULT_WIFI1_PWD);
 }
 
 struct SettingItem wifi1SSIDSetting = {
-	"WiFiSSID1", "wifissid1", wifiConnectionSettings.wifi1SSID, WIFI_SSID_LENGTH, text, setDefaultWiFi1SSID, validateWifiSSID};
+	"WiFiSSID1", "wifissid1", &wifiConnectionSettings.wifi1SSID, WIFI_SSID_LENGTH, arenaText, setDefaultWiFi1SSID, validateWifiSSID};
 struct SettingItem wifi1PWDSetting = {
-	"WiFiPassword1", "wifipwd1", wifiConnectionSettings.wifi1PWD, WIFI_PASSWORD_LENGTH, password, setDefaultWiFi1Pwd, validateWifiPWD};
+	"WiFiPassword1", "wifipwd1", &wifiConnectionSettings.wifi1PWD, WIFI_PASSWORD_LENGTH, arenaPassword, setDefaultWiFi1Pwd, validateWifiPWD};
 
 struct SettingItem wifi2SSIDSetting = {
-	"WiFiSSID2", "wifissid2", wifiConnectionSettings.wifi2SSID, WIFI_SSID_LENGTH, text, setEmptyString, validateWifiSSID};
+	"WiFiSSID2", "wifissid2", &wifiConnectionSettings.wifi2SSID, WIFI_SSID_LENGTH, arenaText, setEmptyArenaString, validateWifiSSID};
 struct SettingItem wifi2PWDSetting = {
-	"WiFiPassword2", "wifipwd2", wifiConnectionSettings.wifi2PWD, WIFI_PASSWORD_LENGTH, password, setEmptyString, validateWifiPWD};
+	"WiFiPassword2", "wifipwd2", &wifiConnectionSettings.wifi2PWD, WIFI_PASSWORD_LENGTH, arenaPassword, setEmptyArenaString, validateWifiPWD};
 
 struct SettingItem wifi3SSIDSetting = {
-	"WiFiSSID3", "wifissid3", wifiConnectionSettings.wifi3SSID, WIFI_SSID_LENGTH, text, setEmptyString, validateWifiSSID};
+	"WiFiSSID3", "wifissid3", &wifiConnectionSettings.wifi3SSID, WIFI_SSID_LENGTH, arenaText, setEmptyArenaString, validateWifiSSID};
 struct SettingItem wifi3PWDSetting = {
-	"WiFiPassword3", "wifipwd3", wifiConnectionSettings.wifi3PWD, WIFI_PASSWORD_LENGTH, password, setEmptyString, validateWifiPWD};
+	"WiFiPassword3", "wifipwd3", &wifiConnectionSettings.wifi3PWD, WIFI_PASSWORD_LENGTH, arenaPassword, setEmptyArenaString, validateWifiPWD};
 
 struct SettingItem wifi4SSIDSetting = {
-	"WiFiSSID4", "wifissid4", wifiConnectionSettings.wifi4SSID, WIFI_SSID_LENGTH, text, setEmptyString, validateWifiSSID};
+	"WiFiSSID4", "wifissid4", &wifiConnectionSettings.wifi4SSID, WIFI_SSID_LENGTH, arenaText, setEmptyArenaString, validateWifiSSID};
 struct SettingItem wifi4PWDSetting = {
-	"WiFiPassword4", "wifipwd4", wifiConnectionSettings.wifi4PWD, WIFI_PASSWORD_LENGTH, password, setEmptyString, validateWifiPWD};
+	"WiFiPassword4", "wifipwd4", &wifiConnectionSettings.wifi4PWD, WIFI_PASSWORD_LENGTH, arenaPassword, setEmptyArenaString, validateWifiPWD};
 
 struct SettingItem wifi5SSIDSetting = {
-	"WiFiSSID5", "wifissid5", wifiConnectionSettings.wifi5SSID, WIFI_SSID_LENGTH, text, setEmptyString, validateWifiSSID};
+	"WiFiSSID5", "wifissid5", &wifiConnectionSettings.wifi5SSID, WIFI_SSID_LENGTH, arenaText, setEmptyArenaString, validateWifiSSID};
 struct SettingItem wifi5PWDSetting = {
-	"WiFiPassword5", "wifipwd5", wifiConnectionSettings.wifi5PWD, WIFI_PASSWORD_LENGTH, password, setEmptyString, validateWifiPWD};
+	"WiFiPassword5", "wifipwd5", &wifiConnectionSettings.wifi5PWD, WIFI_PASSWORD_LENGTH, arenaPassword, setEmptyArenaString, validateWifiPWD};
 
 struct SettingItem *wifiConnectionSettingItemPointers[] =
 	{
@@ -95,11 +97,11 @@ struct SettingItemCollection wifiConnectionSettingItems = {
 
 struct WiFiSetting wifiSettings[] =
 	{
-		{wifiConnectionSettings.wifi1SSID, wifiConnectionSettings.wifi1PWD},
-		{wifiConnectionSettings.wifi2SSID, wifiConnectionSettings.wifi2PWD},
-		{wifiConnectionSettings.wifi3SSID, wifiConnectionSettings.wifi3PWD},
-		{wifiConnectionSettings.wifi4SSID, wifiConnectionSettings.wifi4PWD},
-		{wifiConnectionSettings.wifi5SSID, wifiConnectionSettings.wifi5PWD}};
+		{&wifiConnectionSettings.wifi1SSID, &wifiConnectionSettings.wifi1PWD},
+		{&wifiConnectionSettings.wifi2SSID, &wifiConnectionSettings.wifi2PWD},
+		{&wifiConnectionSettings.wifi3SSID, &wifiConnectionSettings.wifi3PWD},
+		{&wifiConnectionSettings.wifi4SSID, &wifiConnectionSettings.wifi4PWD},
+		{&wifiConnectionSettings.wifi5SSID, &wifiConnectionSettings.wifi5PWD}};
 
 bool needWifiConfigBootMode()
 {
@@ -110,7 +112,7 @@ bool needWifiConfigBootMode()
 
 	for (unsigned int i = 0; i < sizeof(wifiSettings) / sizeof(struct WiFiSetting); i++)
 	{
-		if (wifiSettings[i].wifiSsid[0] != 0)
+		if ((*wifiSettings[i].wifiSsid)[0] != 0)
 		{
 			return false;
 		}
@@ -130,7 +132,7 @@ int findWifiSetting(String ssidName)
 
 	for (unsigned int i = 0; i < sizeof(wifiSettings) / sizeof(struct WiFiSetting); i++)
 	{
-		if (strcasecmp(wifiSettings[i].wifiSsid, ssidBuffer) == 0)
+		if (strcasecmp(*wifiSettings[i].wifiSsid, ssidBuffer) == 0)
 		{
 			return i;
 		}
@@ -234,10 +236,10 @@ void checkWiFiScanResult()
 
 		if (settingNumber != WIFI_SETTING_NOT_FOUND)
 		{
-			snprintf(wifiActiveAPName, WIFI_SSID_LENGTH, "%s", wifiSettings[settingNumber].wifiSsid);
+			snprintf(wifiActiveAPName, WIFI_SSID_LENGTH, "%s", *wifiSettings[settingNumber].wifiSsid);
 			displayMessage("*       Connecting to %s\n", wifiActiveAPName);
-			WiFi.begin(wifiSettings[settingNumber].wifiSsid,
-					   wifiSettings[settingNumber].wifiPassword);
+			WiFi.begin(*wifiSettings[settingNumber].wifiSsid,
+					   *wifiSettings[settingNumber].wifiPassword);
 			WiFiTimerStart = millis();
 			WiFiProcessDescriptor.status = WIFI_CONNECTING;
 			return;
@@ -308,7 +310,7 @@ bool syncWiFiConnect()
 
 			if (settingNumber != WIFI_SETTING_NOT_FOUND)
 			{
-				return syncConnectToAP(wifiSettings[settingNumber].wifiSsid,wifiSettings[settingNumber].wifiPassword );
+				return syncConnectToAP(*wifiSettings[settingNumber].wifiSsid,*wifiSettings[settingNumber].wifiPassword );
 			}
 		}
 	}
@@ -344,11 +346,13 @@ void checkWiFiConnectResult()
 	{
 		TRACELOGLN("Wifi OK");
 		WiFiProcessDescriptor.status = WIFI_OK;
+		recordBootPhase("network ready");
+		publishBusStatus(busTopicWiFiStatus, WIFI_OK);
 		char messageBuffer[WIFI_MESSAGE_BUFFER_SIZE];
 		snprintf(messageBuffer, WIFI_MESSAGE_BUFFER_SIZE, "%s %s", WIFI_STATUS_OK_MESSAGE_TEXT, WiFi.localIP().toString().c_str());
 		hardwareDisplayMessage(WIFI_STATUS_OK_MESSAGE_NUMBER, ledFlashNormalState, messageBuffer);
 		wifiConnectAttempts = 0;
-		performCommandsInStore(WIFI_CONNECT_COMMAND_STORE);
+		// the controller performs the wifion store when it gets the status
 		return;
 	}
 
@@ -396,8 +400,9 @@ void checkWiFIOK()
 
 	if (wifiStatusValue != WL_CONNECTED)
 	{
-		performCommandsInStore(WIFI_DISCONNECT_COMMAND_STORE);
+		// the controller performs the wifioff store when it gets the status
 		startReconnectTimer();
+		publishBusStatus(busTopicWiFiStatus, WiFiProcessDescriptor.status);
 	}
 }
 
@@ -407,6 +412,7 @@ void stopWiFi()
 
 	WiFiProcessDescriptor.status = WIFI_TURNED_OFF;
 	WiFi.mode(WIFI_OFF);
+	publishBusStatus(busTopicWiFiStatus, WIFI_TURNED_OFF);
 	delay(500);
 }
 
@@ -425,6 +431,7 @@ void startWifi()
 	{
 		WiFiProcessDescriptor.status = WIFI_TURNED_OFF;
 		WiFi.mode(WIFI_OFF);
+		publishBusStatus(busTopicWiFiStatus, WIFI_TURNED_OFF);
 	}
 }
 
@@ -48,26 +48,28 @@
 struct WifiConnectionSettings
 {
 	boolean wiFiOn;
-	char wifi1SSID[WIFI_SSID_LENGTH];
-	char wifi1PWD[WIFI_PASSWORD_LENGTH];
+	// the strings are held in the settings arena
+	char *wifi1SSID;
+	char *wifi1PWD;
 
-	char wifi2SSID[WIFI_SSID_LENGTH];
-	char wifi2PWD[WIFI_PASSWORD_LENGTH];
+	char *wifi2SSID;
+	char *wifi2PWD;
 
-	char wifi3SSID[WIFI_SSID_LENGTH];
-	char wifi3PWD[WIFI_PASSWORD_LENGTH];
+	char *wifi3SSID;
+	char *wifi3PWD;
 
-	char wifi4SSID[WIFI_SSID_LENGTH];
-	char wifi4PWD[WIFI_PASSWORD_LENGTH];
+	char *wifi4SSID;
+	char *wifi4PWD;
 
-	char wifi5SSID[WIFI_SSID_LENGTH];
-	char wifi5PWD[WIFI_PASSWORD_LENGTH];
+	char *wifi5SSID;
+	char *wifi5PWD;
 };
 
+// Points at the settings so that the table follows the strings when they move
 struct WiFiSetting
 {
-	char * wifiSsid;
-	char * wifiPassword;
+	char ** wifiSsid;
+	char ** wifiPassword;
 };
 
 extern struct WifiConnectionSettings wifiConnectionSettings;
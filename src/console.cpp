@@ -13,6 +13,20 @@
 #include "HullOS.h"
 #include "boot.h"
 #include "robotProcess.h"
+#include "commandQueue.h"
+#include "binaryCommand.h"
+#include "commandRecorder.h"
+#include "settingsJournal.h"
+#include "scheduler.h"
+#include "dualCore.h"
+#include "processBus.h"
+#include "heapMonitor.h"
+#include "timerWheel.h"
+#include "loopTracer.h"
+#include "metrics.h"
+#include "clock.h"
+#include "sensorHistory.h"
+#include "inputEdges.h"
 #include <LittleFS.h>
 
 struct ConsoleSettings consoleSettings;
@@ -143,8 +157,149 @@ void doClear(char *commandLine)
 
 void doSaveSettings(char *commandline)
 {
-	saveSettings();
+	commitSettings();
 	alwaysDisplayMessage("\nSettings saved");
+	alwaysDisplayMessage("\n   %lu save requests, %lu journal writes of %lu bytes, %lu collection rewrites of %lu bytes\n",
+						 settingsSaveStats.saveRequests,
+						 settingsSaveStats.journalWrites,
+						 settingsSaveStats.journalBytes,
+						 settingsSaveStats.fullWrites,
+						 settingsSaveStats.fullWriteBytes);
+}
+
+#define SCHEDULER_STATUS_LENGTH 150
+
+void doSchedulerStatus(char *commandLine)
+{
+	char *option = skipCommand(commandLine);
+
+	char statusBuffer[SCHEDULER_STATUS_LENGTH];
+
+	schedulerStatusMessage(statusBuffer, SCHEDULER_STATUS_LENGTH);
+	alwaysDisplayMessage("\nScheduler %s\n", statusBuffer);
+
+	char coreBuffer[DUAL_CORE_STATUS_LENGTH];
+
+	dualCoreStatusMessage(coreBuffer, DUAL_CORE_STATUS_LENGTH);
+	alwaysDisplayMessage("Cores %s\n", coreBuffer);
+
+	if (strcasecmp(option, "reset") == 0)
+	{
+		resetSchedulerStats();
+		alwaysDisplayMessage("Scheduler statistics reset\n");
+	}
+}
+
+#define TIMER_WHEEL_STATUS_LENGTH 100
+
+void doTimers(char *commandLine)
+{
+	char *option = skipCommand(commandLine);
+
+	if (strcasecmp(option, "test") == 0)
+	{
+		timerWheelSelfTest();
+		return;
+	}
+
+	char statusBuffer[TIMER_WHEEL_STATUS_LENGTH];
+
+	timerWheelStatusMessage(statusBuffer, TIMER_WHEEL_STATUS_LENGTH);
+	alwaysDisplayMessage("\nTimers %s\n", statusBuffer);
+}
+
+void doLoopTrace(char *commandLine)
+{
+	char *option = skipCommand(commandLine);
+
+	if (strcasecmp(option, "on") == 0)
+	{
+		startLoopTrace();
+	}
+	else if (strcasecmp(option, "off") == 0)
+	{
+		stopLoopTrace();
+	}
+	else if (strcasecmp(option, "clear") == 0)
+	{
+		clearLoopTrace();
+	}
+	else if (strcasecmp(option, "dump") == 0)
+	{
+		printLoopTraceJson();
+		return;
+	}
+
+	char statusBuffer[LOOP_TRACE_STATUS_LENGTH];
+
+	loopTraceStatusMessage(statusBuffer, LOOP_TRACE_STATUS_LENGTH);
+	alwaysDisplayMessage("\nLoop trace %s\n", statusBuffer);
+}
+
+void doMetrics(char *commandLine)
+{
+	char *option = skipCommand(commandLine);
+
+	if (strcasecmp(option, "reset") == 0)
+	{
+		clearMetrics();
+		alwaysDisplayMessage("\nMetrics cleared\n");
+		return;
+	}
+
+	if (strcasecmp(option, "publish") == 0)
+	{
+		publishMetrics();
+		return;
+	}
+
+	char buffer[METRICS_JSON_LENGTH];
+
+	metricsJson(buffer, METRICS_JSON_LENGTH);
+	alwaysDisplayMessage("\n%s\n", buffer);
+}
+
+void doInputEdges(char *commandLine)
+{
+	alwaysDisplayMessage("\nInput edge queues\n");
+	iterateThroughInputEdgeQueues(printInputEdgeQueue);
+}
+
+#define HISTORY_DEFAULT_PERIODS 10
+
+void doSensorHistory(char *commandLine)
+{
+	char *option = skipCommand(commandLine);
+
+	char sensorName[SENSOR_NAME_LENGTH];
+	char tier = 0;
+	int periods = HISTORY_DEFAULT_PERIODS;
+
+	if (sscanf(option, "%9s %c %d", sensorName, &tier, &periods) < 1)
+	{
+		alwaysDisplayMessage("\nGive the sensor name, then s, m or h and the number of buckets to see a tier\n");
+		return;
+	}
+
+	struct sensor *s = findSensorByName(sensorName);
+
+	if (s == NULL)
+	{
+		alwaysDisplayMessage("\nSensor %s not found\n", sensorName);
+		return;
+	}
+
+	printSensorHistory(s, tier, periods);
+}
+
+void doHeapMonitor(char *commandLine)
+{
+	printHeapMonitor();
+}
+
+void doBootProfile(char *commandLine)
+{
+	printBootProfile();
 }
 
 void doTestButtonSensor(char *commandline)
@@ -167,8 +322,142 @@ void doTestPotSensor(char *commandline)
 	potSensorTest();
 }
 
+// The listener benchmark builds a copy of the clock sensor with count
+// listeners spread over its triggers and times firing the second tick.
+// The trigger index is compared with a scan of every listener on the
+// sensor. The copy means that the real clock listeners don't fire.
+
+#define LISTENER_BENCHMARK_DEFAULT_COUNT 50
+#define LISTENER_BENCHMARK_FIRINGS 1000
+
+unsigned long listenerBenchmarkFired;
+
+int listenerBenchmarkReceive(char *destination, unsigned char *options)
+{
+	listenerBenchmarkFired++;
+	return WORKED_OK;
+}
+
+void scanSensorListenersOnTrigger(struct sensor *sensor, int trigger)
+{
+	struct sensorListener *pos = sensor->listeners;
+
+	while (pos != NULL)
+	{
+		if (pos->config->sendOptionMask == trigger)
+		{
+			fireSensorListener(pos);
+		}
+		pos = pos->nextMessageListener;
+	}
+}
+
+void listenerBenchmark(int count)
+{
+	struct sensor *clock = findSensorByName("clock");
+
+	if (clock == NULL || clock->noOfSensorListenerFunctions == 0)
+	{
+		alwaysDisplayMessage("\nNo clock sensor to benchmark\n");
+		return;
+	}
+
+	int noOfTriggers = clock->noOfSensorListenerFunctions;
+
+	struct sensor benchmarkSensor;
+	memset(&benchmarkSensor, 0, sizeof(struct sensor));
+	benchmarkSensor.sensorName = (char *)"bench";
+	benchmarkSensor.sensorListenerFunctions = clock->sensorListenerFunctions;
+	benchmarkSensor.noOfSensorListenerFunctions = noOfTriggers;
+
+	// listeners on the same trigger share a configuration
+	struct sensorListenerConfiguration *configs =
+		(struct sensorListenerConfiguration *)calloc(noOfTriggers, sizeof(struct sensorListenerConfiguration));
+	benchmarkSensor.triggerListeners = (struct sensorListener **)calloc(noOfTriggers, sizeof(struct sensorListener *));
+	int slotBits = sensorTriggerSlotBits(noOfTriggers);
+	unsigned char *slots = (unsigned char *)malloc(1 << slotBits);
+
+	if (configs == NULL || benchmarkSensor.triggerListeners == NULL || slots == NULL)
+	{
+		alwaysDisplayMessage("\nNo memory for the listener benchmark\n");
+		free(configs);
+		free(benchmarkSensor.triggerListeners);
+		free(slots);
+		return;
+	}
+
+	mapSensorTriggers(&benchmarkSensor, slots, slotBits);
+
+	for (int i = 0; i < noOfTriggers; i++)
+	{
+		configs[i].sendOptionMask = clock->sensorListenerFunctions[i].trigger;
+	}
+
+	int added = 0;
+
+	for (; added < count; added++)
+	{
+		struct sensorListener *listener = getNewSensorListener();
+
+		if (listener == NULL)
+		{
+			break;
+		}
+
+		listener->sensor = &benchmarkSensor;
+		listener->config = &configs[added % noOfTriggers];
+		listener->receiveMessage = listenerBenchmarkReceive;
+		addMessageListenerToSensor(&benchmarkSensor, listener);
+	}
+
+	listenerBenchmarkFired = 0;
+	unsigned long startMicros = micros();
+
+	for (int i = 0; i < LISTENER_BENCHMARK_FIRINGS; i++)
+	{
+		fireSensorListenersOnTrigger(&benchmarkSensor, CLOCK_SECOND_TICK);
+	}
+
+	unsigned long indexMicros = ulongDiff(micros(), startMicros);
+	unsigned long indexFired = listenerBenchmarkFired;
+
+	listenerBenchmarkFired = 0;
+	startMicros = micros();
+
+	for (int i = 0; i < LISTENER_BENCHMARK_FIRINGS; i++)
+	{
+		scanSensorListenersOnTrigger(&benchmarkSensor, CLOCK_SECOND_TICK);
+	}
+
+	unsigned long scanMicros = ulongDiff(micros(), startMicros);
+
+	removeAllMessageListenersFromSensor(&benchmarkSensor);
+	free(benchmarkSensor.triggerListeners);
+	free(slots);
+	free(configs);
+
+	alwaysDisplayMessage("\nListener benchmark %d listeners over %d triggers, %d second ticks\n",
+						 added, noOfTriggers, LISTENER_BENCHMARK_FIRINGS);
+	alwaysDisplayMessage("    index: %lu microseconds, %lu listeners fired\n", indexMicros, indexFired);
+	alwaysDisplayMessage("    scan:  %lu microseconds, %lu listeners fired\n", scanMicros, listenerBenchmarkFired);
+}
+
 void doDumpListeners(char *commandline)
 {
+	char *option = skipCommand(commandline);
+
+	if (strncasecmp(option, "bench", 5) == 0)
+	{
+		int count = atoi(option + 5);
+
+		if (count < 1)
+		{
+			count = LISTENER_BENCHMARK_DEFAULT_COUNT;
+		}
+		listenerBenchmark(count);
+		return;
+	}
+
 	alwaysDisplayMessage("\nSensor Listeners\n");
 	printControllerListeners();
 }
@@ -187,13 +476,13 @@ void printCommandsJson(process *p)
 	{
 		// have got some commands in the collection
 
-		alwaysDisplayMessage("{\"name\":\"%s\",\"desc\":\"%s\",\n\"commands\":[", p->processName, c->description);
+		alwaysDisplayMessage("{\"name\":\"%s\",\"id\":%d,\"desc\":\"%s\",\n\"commands\":[", p->processName, getProcessID(p), c->description);
 
 		for (int i = 0; i < c->noOfCommands; i++)
 		{
 			Command *com = c->commands[i];
 			snprintf(consoleMessageBuffer, CONSOLE_MESSAGE_SIZE, "   ");
-			appendCommandDescriptionToJson(com, consoleMessageBuffer, CONSOLE_MESSAGE_SIZE);
+			appendCommandDescriptionToJson(com, i, consoleMessageBuffer, CONSOLE_MESSAGE_SIZE);
 			alwaysDisplayMessage(consoleMessageBuffer);
 			if(i < (c->noOfCommands-1)){
 				alwaysDisplayMessage(",");
@@ -360,6 +649,224 @@ void doClearSensorListeners(char *commandLine)
 	}
 }
 
+void doDumpCommandQueue(char *commandLine)
+{
+	commandQueueStatusMessage(consoleMessageBuffer, CONSOLE_MESSAGE_SIZE);
+	alwaysDisplayMessage("\nCommand queue %s\n", consoleMessageBuffer);
+}
+
+// The bus benchmark compares sending a small value to a process over the
+// bus with sending it as a JSON command. The command sets the pixel
+// brightness to its current value so that it has no visible effect.
+
+#define BUS_BENCHMARK_DEFAULT_COUNT 1000
+#define JSON_BENCHMARK_COMMAND_LENGTH 100
+
+unsigned long busBenchmarkTotal;
+
+void busBenchmarkReceive(struct processMessageListener *listener, void *value)
+{
+	busBenchmarkTotal += ((struct BusStatusMessage *)value)->status;
+}
+
+struct processMessageListener busBenchmarkListener = {
+	"bus benchmark",
+	NULL,
+	busBenchmarkReceive,
+	NULL,
+	busTopicBenchmark};
+
+void discardBenchmarkReply(char *resultText)
+{
+}
+
+void busBenchmark(int count)
+{
+	struct BusStatusMessage message;
+
+	busBenchmarkTotal = 0;
+	subscribeToBusTopic(&busBenchmarkListener, busTopicBenchmark);
+
+	unsigned long startMicros = micros();
+
+	for (int i = 0; i < count; i++)
+	{
+		message.status = i;
+		if (!publishBusMessage(busTopicBenchmark, &message, sizeof(struct BusStatusMessage)))
+		{
+			dispatchBusMessages();
+			publishBusMessage(busTopicBenchmark, &message, sizeof(struct BusStatusMessage));
+		}
+	}
+	dispatchBusMessages();
+
+	unsigned long busMicros = ulongDiff(micros(), startMicros);
+
+	unsubscribeFromBusTopic(&busBenchmarkListener);
+
+	char json[JSON_BENCHMARK_COMMAND_LENGTH];
+
+	snprintf(json, JSON_BENCHMARK_COMMAND_LENGTH,
+			 "{\"process\":\"pixels\",\"command\":\"brightness\",\"value\":%.3f,\"steps\":1}",
+			 pixelSettings.brightness);
+
+	startMicros = micros();
+
+	for (int i = 0; i < count; i++)
+	{
+		act_onJson_message(json, discardBenchmarkReply);
+		// keep the watchdog happy
+		if (i % 100 == 0)
+		{
+			yield();
+		}
+	}
+
+	unsigned long jsonMicros = ulongDiff(micros(), startMicros);
+
+	alwaysDisplayMessage("\nBus benchmark %d messages (total %lu)\n", count, busBenchmarkTotal);
+	alwaysDisplayMessage("    bus:  %lu microseconds, %lu messages per second\n",
+						 busMicros, (unsigned long)((count * 1000000ULL) / (busMicros + 1)));
+	alwaysDisplayMessage("    json: %lu microseconds, %lu messages per second\n",
+						 jsonMicros, (unsigned long)((count * 1000000ULL) / (jsonMicros + 1)));
+}
+
+void doProcessBus(char *commandLine)
+{
+	char *option = skipCommand(commandLine);
+
+	if (strncasecmp(option, "bench", 5) == 0)
+	{
+		int count = atoi(option + 5);
+
+		if (count < 1)
+		{
+			count = BUS_BENCHMARK_DEFAULT_COUNT;
+		}
+		busBenchmark(count);
+		return;
+	}
+
+	busStatusMessage(consoleMessageBuffer, CONSOLE_MESSAGE_SIZE);
+	alwaysDisplayMessage("\nProcess bus %s\n", consoleMessageBuffer);
+}
+
+void displayProcessUpdateTiming(struct process *proc)
+{
+	if (proc->updateTiming.updates == 0)
+	{
+		return;
+	}
+	updateTimingText(&proc->updateTiming, consoleMessageBuffer, CONSOLE_MESSAGE_SIZE);
+	alwaysDisplayMessage("    %s %s\n", proc->processName, consoleMessageBuffer);
+}
+
+void displaySensorUpdateTiming(struct sensor *s)
+{
+	if (s->updateTiming.updates == 0)
+	{
+		return;
+	}
+	updateTimingText(&s->updateTiming, consoleMessageBuffer, CONSOLE_MESSAGE_SIZE);
+	alwaysDisplayMessage("    %s %s\n", s->sensorName, consoleMessageBuffer);
+}
+
+void clearProcessUpdateTiming(struct process *proc)
+{
+	clearUpdateTiming(&proc->updateTiming);
+}
+
+void clearSensorUpdateTiming(struct sensor *s)
+{
+	clearUpdateTiming(&s->updateTiming);
+}
+
+void doDumpUpdateTimings(char *commandLine)
+{
+	char *option = skipCommand(commandLine);
+
+	alwaysDisplayMessage("\nUpdate timings (budget %d microseconds)\n", controllerSettings.updateBudgetMicros);
+	alwaysDisplayMessage("Processes\n");
+	iterateThroughAllProcesses(displayProcessUpdateTiming);
+	alwaysDisplayMessage("Sensors\n");
+	iterateThroughSensors(displaySensorUpdateTiming);
+
+	if (strcasecmp(option, "reset") == 0)
+	{
+		iterateThroughAllProcesses(clearProcessUpdateTiming);
+		iterateThroughSensors(clearSensorUpdateTiming);
+		alwaysDisplayMessage("Update timings reset\n");
+	}
+}
+
+void doRecordCommands(char *commandLine)
+{
+	char *name = skipCommand(commandLine);
+
+	if (*name == 0)
+	{
+		if (commandRecordingActive())
+		{
+			stopCommandRecording();
+			alwaysDisplayMessage("\nRecording stopped\n");
+		}
+		else
+		{
+			alwaysDisplayMessage("\nGive a name to start recording commands\n");
+		}
+		return;
+	}
+
+	if (startCommandRecording(name))
+	{
+		alwaysDisplayMessage("\nRecording commands to %s\n", name);
+	}
+	else
+	{
+		alwaysDisplayMessage("\nCould not start recording %s\n", name);
+	}
+}
+
+void doReplayCommands(char *commandLine)
+{
+	char *name = skipCommand(commandLine);
+
+	// an optional repeat count can follow the name
+
+	int repeats = 1;
+
+	char *repeatText = strchr(name, ' ');
+
+	if (repeatText != NULL)
+	{
+		*repeatText = 0;
+		repeats = atoi(repeatText + 1);
+		if (repeats < 1)
+		{
+			repeats = 1;
+		}
+	}
+
+	struct CommandReplayResults results;
+
+	if (!replayCommandRecording(name, repeats, &results))
+	{
+		alwaysDisplayMessage("\nRecording %s not found\n", name);
+		return;
+	}
+
+	unsigned long commandsPerSecond = 0;
+
+	if (results.elapsedMicros > 0)
+	{
+		commandsPerSecond = (unsigned long)((results.noOfCommands * 1000000.0) / results.elapsedMicros);
+	}
+
+	alwaysDisplayMessage("\nReplayed %d commands (%d failed) in %lu us\n", results.noOfCommands, results.noOfFailures, results.elapsedMicros);
+	alwaysDisplayMessage("   %lu commands/sec p50:%lu us p99:%lu us max:%lu us\n", commandsPerSecond, results.p50Micros, results.p99Micros, results.maxMicros);
+	alwaysDisplayMessage("   heap start:%lu lowest:%lu peak use:%lu\n", results.startHeap, results.lowestHeap, results.startHeap - results.lowestHeap);
+}
+
 void doDumpStorage(char *commandLine)
 {
 	PrintStorage();
@@ -517,7 +1024,7 @@ void deleteFileInStore(char *deleteName)
 				buildStoreFilename(compareFileName, STORE_FILENAME_LENGTH, storeName, deleteName);
 #endif
 
-#if defined(ARDUINO_ARCH_ESP8266)
+#if defined(ARDUINO_ARCH_ESP8266) || defined(ARDUINO_ARCH_HOST)
 				strcpy(compareFileName, deleteName);
 #endif
 
@@ -529,7 +1036,7 @@ void deleteFileInStore(char *deleteName)
 					strcpy(fullDeleteFileName, compareFileName);
 #endif
 
-#if defined(ARDUINO_ARCH_ESP8266)
+#if defined(ARDUINO_ARCH_ESP8266) || defined(ARDUINO_ARCH_HOST)
 					buildStoreFilename(fullDeleteFileName, STORE_FILENAME_LENGTH, storeName, filename);
 #endif
 				}
@@ -574,32 +1081,45 @@ void doDeleteCommand(char *commandLine)
 
 struct consoleCommand userCommands[] =
 	{
+		{"bus", "show the process message bus counts, bench [count] to compare it with json commands", doProcessBus},
 		{"buttontest", "test the button sensor", doTestButtonSensor},
 		{"clearalllisteners", "clear all the command listeners", doClearAllListeners},
 		{"clear", "clear all settings and restart the device", doClear},
 		{"clearsensorlisteners", "clear the command listeners for a sensor", doClearSensorListeners},
 		{"colours", "step through all the colours", doColourDisplay},
 		{"commands", "show all the remote commands", doShowRemoteCommandsText},
+		{"bootprofile", "show how long each phase of the boot took", doBootProfile},
 		{"commandsjson", "show all the remote commands in json", doShowRemoteCommandsJson},
 		{"deletecommand", "delete the named command", doDeleteCommand},
 		{"dump", "dump all the setting values", doDumpSettings},
+		{"edges", "show the edge and bounce counts of the interrupt driven inputs", doInputEdges},
+		{"heap", "show the free heap, largest block and fragmentation over time and the block pools", doHeapMonitor},
 		{"help", "show all the commands", doHelp},
 		{"host", "start the configuration web host", doStartWebServer},
+		{"history", "show a sensor history, add s, m or h and a count to see the buckets in a tier", doSensorHistory},
 		{"hullos", "HullOS commands", doHullOS},
-		{"listeners", "list the command listeners", doDumpListeners},
+		{"listeners", "list the command listeners, bench [count] to time the trigger index on the clock sensor", doDumpListeners},
 		{"help", "show all the commands", doHelp},
 		{"otaupdate", "start an over-the-air firmware update", doOTAUpdate},
 		{"pirtest", "test the PIR sensor", doTestPIRSensor},
 		{"pottest", "test the pot sensor", doTestPotSensor},
+		{"queue", "show the command queue depth and drop counts", doDumpCommandQueue},
+		{"record", "record incoming commands to the named file, no name to stop", doRecordCommands},
+		{"replay", "replay a recording with optional repeat count and show the timings", doReplayCommands},
 		{"rotarytest", "test the rotary sensor", doTestRotarySensor},
 		{"restart", "restart the device", doRestart},
 		{"save", "save all the setting values", doSaveSettings},
+		{"scheduler", "show loop idle time and worst update lateness, reset to clear them", doSchedulerStatus},
 		{"sensors", "list all the sensor triggers", doShowSensorsText},
 		{"sensorsjson", "list all the sensor triggers in json", doShowSensorsJson},
 		{"settings", "show all the setting values", doShowSettings},
 		{"sprites", "dump sprite data", doDumpSprites},
+		{"stats", "show the metrics as json, reset to clear them, publish to send them over MQTT", doMetrics},
 		{"status", "show the sensor status", doDumpStatus},
 		{"stores", "dump all the command stores", doDumpStores},
+		{"timers", "show the timer wheel, test to run the timers on a fake clock across the millis wrap", doTimers},
+		{"trace", "record sensor, process, MQTT and command timings with on, off or clear, dump writes Chrome trace JSON", doLoopTrace},
+		{"timings", "show the update time histograms of sensors and processes, reset to clear them", doDumpUpdateTimings},
 		{"storage", "show the storage use of sensors and processes", doDumpStorage},
 };
 
@@ -671,8 +1191,12 @@ boolean performCommand(char *commandLine, consoleCommand *commands, int noOfComm
 
 	if (commandLine[0] == '{')
 	{
-		// treat the command as JSON
-		performRemoteCommand(commandLine);
+		// treat the command as JSON - the controller performs it from the command queue
+		if (!enqueueJsonCommand(commandLine, showRemoteCommandResult))
+		{
+			alwaysDisplayMessage("command dropped by the command queue");
+			return false;
+		}
 		return true;
 	}
 
@@ -721,6 +1245,7 @@ void showHelp()
 }
 
 #define SERIAL_BUFFER_LIMIT SERIAL_BUFFER_SIZE - 1
+#define SERIAL_BINARY_FRAME_TIMEOUT_MILLIS 100
 
 char serialReceiveBuffer[SERIAL_BUFFER_SIZE];
 
@@ -736,10 +1261,90 @@ void actOnSerialCommand(char * buffer)
 	performCommand(buffer, userCommands, sizeof(userCommands) / sizeof(struct consoleCommand));
 }
 
+// Binary command frames are read into the serial buffer without being echoed.
+// A frame is the frame start byte, a two byte big endian length and then the
+// MessagePack data. A frame that stops part way through is dropped once
+// nothing more has arrived for SERIAL_BINARY_FRAME_TIMEOUT_MILLIS, so that a
+// lost byte can't leave the console reading the next command as frame data.
+// The sender can resynchronise by waiting for longer than the timeout.
+
+enum SerialFrameState
+{
+	serialText,
+	serialBinaryLengthHigh,
+	serialBinaryLengthLow,
+	serialBinaryData
+};
+
+SerialFrameState serialFrameState = serialText;
+
+int serialBinaryFrameLength;
+
+unsigned long serialBinaryLastByteMillis;
+unsigned long serialBinaryFramesTimedOut = 0;
+
+void bufferSerialBinaryChar(char ch)
+{
+	serialBinaryLastByteMillis = millis();
+
+	switch (serialFrameState)
+	{
+	case serialBinaryLengthHigh:
+		serialBinaryFrameLength = (unsigned char)ch << 8;
+		serialFrameState = serialBinaryLengthLow;
+		break;
+
+	case serialBinaryLengthLow:
+		serialBinaryFrameLength |= (unsigned char)ch;
+		if (serialBinaryFrameLength == 0 || serialBinaryFrameLength > SERIAL_BUFFER_LIMIT)
+		{
+			alwaysDisplayMessage("Binary frame length invalid\n");
+			serialFrameState = serialText;
+		}
+		else
+		{
+			serialFrameState = serialBinaryData;
+		}
+		break;
+
+	case serialBinaryData:
+		serialReceiveBuffer[serialReceiveBufferPos] = ch;
+		serialReceiveBufferPos++;
+		if (serialReceiveBufferPos == serialBinaryFrameLength)
+		{
+			if (!enqueueCommand(serialReceiveBuffer, serialBinaryFrameLength, normalCommand,
+								act_onBinary_message, showRemoteCommandResult))
+			{
+				alwaysDisplayMessage("Binary command dropped by the command queue\n");
+			}
+			reset_serial_buffer();
+			serialFrameState = serialText;
+		}
+		break;
+
+	default:
+		serialFrameState = serialText;
+		break;
+	}
+}
+
 #define BACKSPACE_CHAR 0x08
 
 void bufferSerialChar(char ch)
 {
+	if (serialFrameState != serialText)
+	{
+		bufferSerialBinaryChar(ch);
+		return;
+	}
+
+	if ((unsigned char)ch == BINARY_COMMAND_SERIAL_FRAME_START && serialReceiveBufferPos == 0)
+	{
+		serialFrameState = serialBinaryLengthHigh;
+		serialBinaryLastByteMillis = millis();
+		return;
+	}
+
 	if (consoleSettings.echoInput)
 	{
 		Serial.print(ch);
@@ -782,6 +1387,21 @@ void checkSerialBuffer()
 		return;
 	}
 
+	if (!Serial.available())
+	{
+		// bytes that are waiting arrived while the loop was busy, so only
+		// a frame with nothing waiting can have stalled
+		if (serialFrameState != serialText &&
+			ulongDiff(millis(), serialBinaryLastByteMillis) > SERIAL_BINARY_FRAME_TIMEOUT_MILLIS)
+		{
+			alwaysDisplayMessage("Binary frame timed out after %d bytes\n", serialReceiveBufferPos);
+			serialBinaryFramesTimedOut++;
+			reset_serial_buffer();
+			serialFrameState = serialText;
+		}
+		return;
+	}
+
 	while (Serial.available())
 	{
 		bufferSerialChar(Serial.read());
@@ -883,7 +1503,9 @@ struct CommandItem ConsolefloatValueItem = {
 	CONSOLE_FLOAT_VALUE_OFFSET,
 	floatCommand,
 	validateFloat,
-	noDefaultAvailable};
+	noDefaultAvailable,
+	NULL,
+	validateFloatCommandValue};
 
 struct CommandItem ConsoleReportText = {
 	"text",
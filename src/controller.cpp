@@ -10,6 +10,16 @@
 #include "errors.h"
 #include "settings.h"
 #include "otaupdate.h"
+#include "commandQueue.h"
+#include "commandDedup.h"
+#include "scheduler.h"
+#include "updateTiming.h"
+#include "dualCore.h"
+#include "loopTracer.h"
+#include "metrics.h"
+#include "sensorHistory.h"
+#include "connectwifi.h"
+#include "processBus.h"
 #include "errors.h"
 #include "ArduinoJson-v5.13.2.h"
 #include "FS.h"
@@ -158,9 +168,57 @@ struct SettingItem controllerActive = {
 	setTrue,
 	validateYesNo};
 
+void setDefaultUpdateBudget(void *dest)
+{
+	int *destInt = (int *)dest;
+	*destInt = UPDATE_TIMING_DEFAULT_BUDGET_MICROS;
+}
+
+struct SettingItem controllerUpdateBudget = {
+	"Update budget (microseconds)",
+	"updatebudget",
+	&controllerSettings.updateBudgetMicros,
+	NUMBER_INPUT_LENGTH,
+	integerValue,
+	setDefaultUpdateBudget,
+	validateInt};
+
+void setDefaultOverrunLogCount(void *dest)
+{
+	int *destInt = (int *)dest;
+	*destInt = UPDATE_TIMING_DEFAULT_OVERRUN_LOG_COUNT;
+}
+
+struct SettingItem controllerOverrunLogCount = {
+	"Overruns in a row before logging",
+	"overrunlog",
+	&controllerSettings.overrunLogCount,
+	NUMBER_INPUT_LENGTH,
+	integerValue,
+	setDefaultOverrunLogCount,
+	validateInt};
+
+void setDefaultMetricsPublish(void *dest)
+{
+	int *destInt = (int *)dest;
+	*destInt = 0;
+}
+
+struct SettingItem controllerMetricsPublish = {
+	"Seconds between metrics messages (0 for none)",
+	"metricspublish",
+	&controllerSettings.metricsPublishSeconds,
+	NUMBER_INPUT_LENGTH,
+	integerValue,
+	setDefaultMetricsPublish,
+	validateInt};
+
 struct SettingItem *controllerSettingItemPointers[] =
 	{
-		&controllerActive};
+		&controllerActive,
+		&controllerUpdateBudget,
+		&controllerOverrunLogCount,
+		&controllerMetricsPublish};
 
 struct SettingItemCollection controllerSettingItems = {
 	"Controller",
@@ -258,6 +316,33 @@ bool setDefaultFloatZero(void *dest)
 	return true;
 }
 
+// Typed validators for command items. These are called by decodeCommand
+// when the JSON value is already a number, which saves converting the
+// value to text and then parsing it back again.
+
+bool validateIntCommandValue(void *dest, int newValue)
+{
+	putUnalignedInt(newValue, (unsigned char *)dest);
+	return true;
+}
+
+bool validateFloatCommandValue(void *dest, float newValue)
+{
+	putUnalignedFloat(newValue, (unsigned char *)dest);
+	return true;
+}
+
+bool validateFloat0to1CommandValue(void *dest, float newValue)
+{
+	if (newValue < 0 || newValue > 1)
+	{
+		return false;
+	}
+
+	putUnalignedFloat(newValue, (unsigned char *)dest);
+	return true;
+}
+
 sensorListener *makeSensorListenerFromConfiguration(struct sensorListenerConfiguration *source)
 {
 	TRACELOGLN("Making sensor listener from configuration..");
@@ -297,15 +382,21 @@ sensorListener *makeSensorListenerFromConfiguration(struct sensorListenerConfigu
 		return NULL;
 	}
 
-	// getListener will get a listener from the discarded list or create a new one
-	// as required
+	// getNewSensorListener takes a listener from the listener pool
 
 	struct sensorListener *result = getNewSensorListener();
 
+	if (result == NULL)
+	{
+		return NULL;
+	}
+
 	result->config = source;
 	result->sensor = sensorListener;
 	result->lastReadingMillis = 0;
 	result->receiveMessage = targetCommand->performCommand;
+	result->command = targetCommand;
+	result->commandProcess = findProcessByName(source->commandProcess);
 
 	return result;
 }
@@ -499,10 +590,10 @@ void appendCommandItemType(CommandItem *item, char *buffer, int bufferSize)
 	}
 }
 
-void appendCommandDescriptionToJson(Command *command, char *buffer, int bufferSize)
+void appendCommandDescriptionToJson(Command *command, int commandID, char *buffer, int bufferSize)
 {
-	snprintf(buffer, bufferSize, "%s{\"name\":\"%s\",\"version\":\"%s\",\"desc\":\"%s\",\"items\":[",
-			 buffer, command->name, Version, command->description);
+	snprintf(buffer, bufferSize, "%s{\"name\":\"%s\",\"id\":%d,\"version\":\"%s\",\"desc\":\"%s\",\"items\":[",
+			 buffer, command->name, commandID, Version, command->description);
 
 	for (int i = 0; i < command->noOfItems; i++)
 	{
@@ -854,6 +945,16 @@ int performCommandsInStore(char *commandStoreName)
 	TRACELOG("Performing the commands in command store folder:");
 	TRACELOGLN(commandStoreName);
 
+	int forwardResult;
+
+	// a sensor on the real time core can't use the file system or the
+	// controller, so the store is performed by the network core
+
+	if (forwardCommandStoreToNetworkCore(commandStoreName, &forwardResult))
+	{
+		return forwardResult;
+	}
+
 	char fullStoreName[STORE_FILENAME_LENGTH];
 
 	if (!buildStoreFolderName(fullStoreName, STORE_FILENAME_LENGTH, commandStoreName))
@@ -949,17 +1050,64 @@ int decodeCommand(const char *rawCommandText, process *process, Command *command
 			}
 		}
 
-		const char *inputSource = NULL;
+		unsigned char *itemDest = parameterBuffer + item->commandSettingOffset;
 
 		if (root[item->name].is<int>())
 		{
-			TRACELOG("Got an int:");
-			// need to convert the input value into a string
-			// as our value parser uses strings as inputs
 			int iv = root[item->name];
+			TRACELOG("Got an int:");
 			TRACELOG(iv);
 			TRACELOG(" for ");
 			TRACELOGLN(item->name);
+
+			if (item->validateIntValue != NULL)
+			{
+				if (!item->validateIntValue(itemDest, iv))
+				{
+					TRACELOGLN("Value fails validation");
+					failcount++;
+				}
+				continue;
+			}
+
+			if (item->validateFloatValue != NULL)
+			{
+				if (!item->validateFloatValue(itemDest, (float)iv))
+				{
+					TRACELOGLN("Value fails validation");
+					failcount++;
+				}
+				continue;
+			}
+		}
+		else
+		{
+			if (root[item->name].is<float>() && item->validateFloatValue != NULL)
+			{
+				float fv = root[item->name];
+				TRACELOG("Got a float:");
+				TRACELOG(fv);
+				TRACELOG(" for ");
+				TRACELOGLN(item->name);
+
+				if (!item->validateFloatValue(itemDest, fv))
+				{
+					TRACELOGLN("Value fails validation");
+					failcount++;
+				}
+				continue;
+			}
+		}
+
+		// No typed validator for this value - use the string parser
+
+		const char *inputSource = NULL;
+
+		if (root[item->name].is<int>())
+		{
+			// need to convert the input value into a string
+			// as our value parser uses strings as inputs
+			int iv = root[item->name];
 			snprintf(buffer, 120, "%d", iv);
 			inputSource = buffer;
 		}
@@ -1004,7 +1152,7 @@ int decodeCommand(const char *rawCommandText, process *process, Command *command
 		}
 		else
 		{
-			if (!item->validateValue(parameterBuffer + item->commandSettingOffset, inputSource))
+			if (!item->validateValue(itemDest, inputSource))
 			{
 				TRACELOGLN("Value fails validation");
 				failcount++;
@@ -1070,7 +1218,20 @@ int decodeCommand(const char *rawCommandText, process *process, Command *command
 	{
 		// Performing a command now
 		TRACELOGLN("   performing a command");
-		result = command->performCommand(destination, parameterBuffer);
+
+		startDeferredProcess(process);
+
+		if (dualCoreTasksRunning() && process->core == realTimeCore && *destination == 0)
+		{
+			result = forwardCommandToRealTimeCore(command, destination, parameterBuffer);
+		}
+		else
+		{
+			unsigned long startMicros = micros();
+			result = command->performCommand(destination, parameterBuffer);
+			LOOP_TRACE(traceCommand, command->name, startMicros);
+			recordHistogramMetric(&metricCommandMicros, ulongDiff(micros(), startMicros));
+		}
 	}
 
 	if (result == WORKED_OK)
@@ -1150,7 +1311,7 @@ void do_Json_command(const char *rawCommandText, JsonObject &root, void (*delive
 
 StaticJsonBuffer<1000> jsonBuffer;
 
-void act_onJson_message(const char *json, void (*deliverResult)(char *resultText))
+void performJsonMessage(const char *json, void (*deliverResult)(char *resultText))
 {
 	TRACELOGLN();
 	TRACELOG("Received message:");
@@ -1169,12 +1330,27 @@ void act_onJson_message(const char *json, void (*deliverResult)(char *resultText
 	if (!root.success())
 	{
 		TRACELOGLN("JSON could not be parsed");
+		countMetric(&metricParseFailures);
 		abort_json_command(JSON_MESSAGE_COULD_NOT_BE_PARSED, root, deliverResult);
 		return;
 	}
 
 	TRACELOGLN("  JSON parsed OK");
 
+	if (root.containsKey("seq"))
+	{
+		// a retried command gets the reply it had the first time
+		int sequenceNo = root["seq"];
+		const char *from = root["from"];
+
+		if (deliverCachedCommandReply(from, sequenceNo, json, strlen(json), deliverResult))
+		{
+			return;
+		}
+
+		deliverResult = cacheCommandReply(from, sequenceNo, json, strlen(json), deliverResult);
+	}
+
 	const char *setting = root["setting"];
 
 	if (setting)
@@ -1198,6 +1374,15 @@ void act_onJson_message(const char *json, void (*deliverResult)(char *resultText
 	return;
 }
 
+void act_onJson_message(const char *json, void (*deliverResult)(char *resultText))
+{
+	struct CommandDedupPending savedPending;
+
+	saveCommandDedupPending(&savedPending);
+	performJsonMessage(json, deliverResult);
+	restoreCommandDedupPending(&savedPending);
+}
+
 void createJSONfromSettings(char *processName, struct Command *command, char *destination, unsigned char *settingBase, char *buffer, int bufferLength)
 {
 	TRACELOG("Creating json for command:");
@@ -1304,8 +1489,210 @@ int doPerformCommandStore(char *destination, unsigned char *settingBase)
 	return performCommandsInStore(command);
 }
 
+struct CommandItem *updateStatsItems[] =
+	{};
+
+int doSendUpdateStats(char *destination, unsigned char *settingBase);
+
+struct Command sendUpdateStats
+{
+	"stats",
+		"Publishes the metrics and the update timings of each sensor and process",
+		updateStatsItems,
+		sizeof(updateStatsItems) / sizeof(struct CommandItem *),
+		doSendUpdateStats
+};
+
+#define UPDATE_STATS_BUFFER_SIZE 250
+
+void publishProcessUpdateStats(struct process *proc)
+{
+	char buffer[UPDATE_STATS_BUFFER_SIZE];
+
+	if (proc->updateTiming.updates == 0)
+	{
+		return;
+	}
+
+	updateTimingJson(proc->processName, &proc->updateTiming, buffer, UPDATE_STATS_BUFFER_SIZE);
+	publishBufferToMQTT(buffer);
+}
+
+void publishSensorUpdateStats(struct sensor *s)
+{
+	char buffer[UPDATE_STATS_BUFFER_SIZE];
+
+	if (s->updateTiming.updates == 0)
+	{
+		return;
+	}
+
+	updateTimingJson(s->sensorName, &s->updateTiming, buffer, UPDATE_STATS_BUFFER_SIZE);
+	publishBufferToMQTT(buffer);
+}
+
+// Each sensor and process that has been updated gets its own message
+// so that the messages fit in the MQTT buffer
+
+int doSendUpdateStats(char *destination, unsigned char *settingBase)
+{
+	if (*destination != 0)
+	{
+		// we have a destination for the command. Build the string
+		char buffer[JSON_BUFFER_SIZE];
+		createJSONfromSettings("controller", &sendUpdateStats, destination, settingBase, buffer, JSON_BUFFER_SIZE);
+		return publishCommandToRemoteDevice(buffer, destination);
+	}
+
+	publishMetrics();
+	iterateThroughAllProcesses(publishProcessUpdateStats);
+	iterateThroughSensors(publishSensorUpdateStats);
+
+	return WORKED_OK;
+}
+
+#define CONTROLLER_HISTORY_SENSOR_OFFSET 0
+#define CONTROLLER_HISTORY_TIER_OFFSET (CONTROLLER_HISTORY_SENSOR_OFFSET + SENSOR_NAME_LENGTH)
+#define CONTROLLER_HISTORY_TIER_LENGTH 2
+#define CONTROLLER_HISTORY_PERIODS_OFFSET (CONTROLLER_HISTORY_TIER_OFFSET + CONTROLLER_HISTORY_TIER_LENGTH)
+
+boolean validateHistorySensorName(void *dest, const char *newValueStr)
+{
+	return (validateString((char *)dest, newValueStr, SENSOR_NAME_LENGTH));
+}
+
+boolean validateHistoryTier(void *dest, const char *newValueStr)
+{
+	enum SensorHistoryTierType tier;
+
+	if (!decodeSensorHistoryTier(newValueStr[0], &tier) || newValueStr[1] != 0)
+	{
+		return false;
+	}
+
+	return (validateString((char *)dest, newValueStr, CONTROLLER_HISTORY_TIER_LENGTH));
+}
+
+boolean setDefaultHistoryTier(void *dest)
+{
+	strcpy((char *)dest, "m");
+	return true;
+}
+
+// The items are validated one at a time, so this can only check against
+// the longest tier. The periods are checked against the tier that was
+// asked for when the command is performed.
+
+boolean validateHistoryPeriodsValue(void *dest, int value)
+{
+	if (value < 1 || value > SENSOR_HISTORY_SECONDS)
+	{
+		return false;
+	}
+
+	putUnalignedInt(value, (unsigned char *)dest);
+	return true;
+}
+
+boolean validateHistoryPeriods(void *dest, const char *newValueStr)
+{
+	int value;
+
+	if (!validateInt(&value, newValueStr))
+	{
+		return false;
+	}
+
+	return validateHistoryPeriodsValue(dest, value);
+}
+
+boolean setDefaultHistoryPeriods(void *dest)
+{
+	putUnalignedInt(5, (unsigned char *)dest);
+	return true;
+}
+
+// not "sensor", which would make the command a listener on the sensor
+struct CommandItem historySensorName = {
+	"sensorname",
+	"sensor keeping the history",
+	CONTROLLER_HISTORY_SENSOR_OFFSET,
+	textCommand,
+	validateHistorySensorName,
+	noDefaultAvailable};
+
+struct CommandItem historyTier = {
+	"tier",
+	"tier to read - s, m or h",
+	CONTROLLER_HISTORY_TIER_OFFSET,
+	textCommand,
+	validateHistoryTier,
+	setDefaultHistoryTier};
+
+struct CommandItem historyPeriods = {
+	"periods",
+	"number of periods to combine (1-60, or 1-24 for h)",
+	CONTROLLER_HISTORY_PERIODS_OFFSET,
+	integerCommand,
+	validateHistoryPeriods,
+	setDefaultHistoryPeriods,
+	validateHistoryPeriodsValue,
+	NULL};
+
+struct CommandItem *sendSensorHistoryItems[] =
+	{
+		&historySensorName,
+		&historyTier,
+		&historyPeriods};
+
+int doSendSensorHistory(char *destination, unsigned char *settingBase);
+
+struct Command sendSensorHistory
+{
+	"history",
+		"Publishes the min, max and mean of a sensor history",
+		sendSensorHistoryItems,
+		sizeof(sendSensorHistoryItems) / sizeof(struct CommandItem *),
+		doSendSensorHistory
+};
+
+int doSendSensorHistory(char *destination, unsigned char *settingBase)
+{
+	if (*destination != 0)
+	{
+		// we have a destination for the command. Build the string
+		char buffer[JSON_BUFFER_SIZE];
+		createJSONfromSettings("controller", &sendSensorHistory, destination, settingBase, buffer, JSON_BUFFER_SIZE);
+		return publishCommandToRemoteDevice(buffer, destination);
+	}
+
+	struct sensor *s = findSensorByName((char *)(settingBase + CONTROLLER_HISTORY_SENSOR_OFFSET));
+
+	if (s == NULL || s->history == NULL)
+	{
+		return JSON_MESSAGE_NO_SENSOR_HISTORY;
+	}
+
+	enum SensorHistoryTierType tier;
+	decodeSensorHistoryTier(*(char *)(settingBase + CONTROLLER_HISTORY_TIER_OFFSET), &tier);
+
+	int periods = getUnalignedInt(settingBase + CONTROLLER_HISTORY_PERIODS_OFFSET);
+
+	if (periods > sensorHistoryTierLength(tier))
+	{
+		return JSON_MESSAGE_HISTORY_PERIODS_TOO_MANY;
+	}
+
+	char buffer[SENSOR_HISTORY_JSON_LENGTH];
+	sensorHistoryJson(s, tier, periods, buffer, SENSOR_HISTORY_JSON_LENGTH);
+
+	return publishBufferToMQTT(buffer);
+}
+
 struct Command *controlCommandList[] = {
-	&performCommandStore};
+	&performCommandStore,
+	&sendUpdateStats,
+	&sendSensorHistory};
 
 struct CommandItemCollection controllerCommands =
 	{
@@ -1318,6 +1705,55 @@ void initcontroller()
 	controllerProcess.status = CONTROLLER_STOPPED;
 }
 
+// The command stores that run when the network comes and goes are
+// performed by the controller when the WiFi and MQTT processes publish
+// their status on the bus, so those processes don't call into the
+// controller and the file system from the middle of their updates.
+
+bool mqttStoreCommandsPerformed = false;
+
+void controllerWiFiStatus(struct processMessageListener *listener, void *value)
+{
+	struct BusStatusMessage *message = (struct BusStatusMessage *)value;
+
+	switch (message->status)
+	{
+	case WIFI_OK:
+		performCommandsInStore(WIFI_CONNECT_COMMAND_STORE);
+		break;
+	case WIFI_RECONNECT_TIMER:
+		// the connection has been lost
+		performCommandsInStore(WIFI_DISCONNECT_COMMAND_STORE);
+		break;
+	}
+}
+
+// the mqtt store is only performed for the first connection after a boot
+void controllerMQTTStatus(struct processMessageListener *listener, void *value)
+{
+	struct BusStatusMessage *message = (struct BusStatusMessage *)value;
+
+	if (message->status == MQTT_OK && !mqttStoreCommandsPerformed)
+	{
+		mqttStoreCommandsPerformed = true;
+		performCommandsInStore(MQTT_CONNECTED_COMMAND_STORE);
+	}
+}
+
+struct processMessageListener controllerWiFiListener = {
+	"controller wifi",
+	NULL,
+	controllerWiFiStatus,
+	NULL,
+	busTopicWiFiStatus};
+
+struct processMessageListener controllerMQTTListener = {
+	"controller mqtt",
+	NULL,
+	controllerMQTTStatus,
+	NULL,
+	busTopicMQTTStatus};
+
 void startcontroller()
 {
 	controllerProcess.status = CONTROLLER_OK;
@@ -1326,11 +1762,28 @@ void startcontroller()
 	// need to iterate through all the controllers and add to each sensor.
 	iterateThroughListenerConfigurations(startSensorListener);
 
+	// a restarted controller mustn't be in the topic lists twice
+	unsubscribeFromBusTopic(&controllerWiFiListener);
+	unsubscribeFromBusTopic(&controllerMQTTListener);
+	subscribeToBusTopic(&controllerWiFiListener, busTopicWiFiStatus);
+	subscribeToBusTopic(&controllerMQTTListener, busTopicMQTTStatus);
+
 	performCommandsInStore(BOOT_FOLDER_NAME);
 }
 
 void updatecontroller()
 {
+	drainCommandQueue(COMMAND_QUEUE_DRAIN_BUDGET_MICROS);
+
+	// the controller is woken when a command is queued
+	if (commandQueueDepth() == 0)
+	{
+		scheduleProcessUpdate(&controllerProcess, SCHEDULER_IDLE_MILLIS);
+	}
+	else
+	{
+		scheduleProcessUpdate(&controllerProcess, 0);
+	}
 }
 
 void stopcontroller()
@@ -1343,12 +1796,18 @@ bool controlerStatusOK()
 	return controllerProcess.status == CONTROLLER_OK;
 }
 
+#define CONTROLLER_QUEUE_STATUS_LENGTH 160
+
 void controllerStatusMessage(char *buffer, int bufferLength)
 {
+	char queueStatus[CONTROLLER_QUEUE_STATUS_LENGTH];
+
+	commandQueueStatusMessage(queueStatus, CONTROLLER_QUEUE_STATUS_LENGTH);
+
 	if (controllerProcess.status == CONTROLLER_STOPPED)
-		snprintf(buffer, bufferLength, "Controller stopped");
+		snprintf(buffer, bufferLength, "Controller stopped %s duplicates:%lu", queueStatus, commandDuplicatesSuppressed);
 	else
-		snprintf(buffer, bufferLength, "Controller active");
+		snprintf(buffer, bufferLength, "Controller active %s duplicates:%lu", queueStatus, commandDuplicatesSuppressed);
 }
 
 struct process controllerProcess = {
@@ -20,6 +20,11 @@
 struct controllerSettings 
 {
     bool active;
+    // sensor and process update timing - see updateTiming.h
+    int updateBudgetMicros;
+    int overrunLogCount;
+    // seconds between metrics messages, 0 for none - see metrics.h
+    int metricsPublishSeconds;
 };
 
 extern struct controllerSettings controllerSettings;
@@ -37,6 +42,10 @@ struct CommandItem
     CommandItem_Type type;
     bool (*validateValue)(void * dest, const char * newValueStr);
     bool (*setDefaultValue)(void * dest);
+    // optional typed validators - used in preference to validateValue when the incoming
+    // JSON value is already a number so that it doesn't have to go via a string
+    bool (*validateIntValue)(void * dest, int newValue);
+    bool (*validateFloatValue)(void * dest, float newValue);
 };
 
 struct Command
@@ -57,11 +66,17 @@ struct CommandItemCollection
 
 void act_onJson_message(const char *json, void (*deliverResult)(char *resultText));
 
+extern unsigned char *commandParameterBuffer;
+
 bool setDefaultEmptyString(void * dest);
 bool noDefaultAvailable(void * dest);
 bool setDefaultIntZero(void * dest);
 bool setDefaultFloatZero(void *dest);
 
+bool validateIntCommandValue(void *dest, int newValue);
+bool validateFloatCommandValue(void *dest, float newValue);
+bool validateFloat0to1CommandValue(void *dest, float newValue);
+
 void resetControllerListenersToDefaults();
 
 void printControllerListeners();
@@ -76,7 +91,7 @@ void dumpCommand(const char * processName,const char * commandName, unsigned cha
 bool buildStoreFilename(char *dest, int length, const char *store, const char *name);
 int performCommandsInStore(char *commandStoreName);
 
-void appendCommandDescriptionToJson(Command * command, char * buffer, int bufferSize);
+void appendCommandDescriptionToJson(Command * command, int commandID, char * buffer, int bufferSize);
 void appendCommandDescriptionToText(Command * command, char * buffer, int bufferSize);
 void appendCommandItemType(CommandItem * item, char * buffer, int bufferSize);
 void clearAllListeners();
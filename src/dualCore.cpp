@@ -0,0 +1,250 @@
+#include <Arduino.h>
+#include <strings.h>
+
+#include "debug.h"
+#include "utils.h"
+#include "errors.h"
+#include "messages.h"
+#include "controller.h"
+#include "scheduler.h"
+#include "spscQueue.h"
+#include "dualCore.h"
+#include "loopTracer.h"
+
+struct CoreHandoffStats networkToRealTimeStats;
+struct CoreHandoffStats realTimeToNetworkStats;
+
+#if defined(DUAL_CORE_LAYOUT)
+
+struct SpscQueue networkToRealTimeQueue;
+struct SpscQueue realTimeToNetworkQueue;
+
+unsigned char networkToRealTimeSlots[DUAL_CORE_QUEUE_SLOTS * sizeof(struct CoreHandoff)];
+unsigned char realTimeToNetworkSlots[DUAL_CORE_QUEUE_SLOTS * sizeof(struct CoreHandoff)];
+
+TaskHandle_t realTimeTaskHandle = NULL;
+
+bool dualCoreRunning = false;
+
+bool dualCoreTasksRunning()
+{
+	return dualCoreRunning;
+}
+
+bool onRealTimeTask()
+{
+	return dualCoreRunning && xTaskGetCurrentTaskHandle() == realTimeTaskHandle;
+}
+
+int pushHandoff(struct SpscQueue *queue, struct CoreHandoffStats *stats, struct CoreHandoff *handoff)
+{
+	handoff->queuedMicros = micros();
+
+	if (!spscQueuePush(queue, handoff))
+	{
+		stats->queueFull++;
+		return JSON_MESSAGE_CORE_HANDOFF_QUEUE_FULL;
+	}
+
+	stats->forwarded++;
+	return WORKED_OK;
+}
+
+void performHandoff(struct CoreHandoff *handoff, struct CoreHandoffStats *stats)
+{
+	unsigned long latency = ulongDiff(micros(), handoff->queuedMicros);
+
+	if (latency > stats->maxLatencyMicros)
+	{
+		stats->maxLatencyMicros = latency;
+	}
+
+	stats->performed++;
+
+	switch (handoff->type)
+	{
+	case handoffCommand:
+	{
+		unsigned long startMicros = micros();
+		handoff->command->performCommand(handoff->destination, handoff->parameters);
+		LOOP_TRACE(traceCommand, handoff->command->name, startMicros);
+		break;
+	}
+
+	case handoffCommandStore:
+		performCommandsInStore((char *)handoff->parameters);
+		break;
+	}
+}
+
+int forwardCommandToRealTimeCore(struct Command *command, char *destination, unsigned char *parameters)
+{
+	struct CoreHandoff handoff;
+
+	handoff.type = handoffCommand;
+	handoff.command = command;
+	snprintf(handoff.destination, DESTINATION_NAME_LENGTH, "%s", destination);
+	memcpy(handoff.parameters, parameters, COMMAND_PARAMETER_BUFFER_LENGTH);
+
+	return pushHandoff(&networkToRealTimeQueue, &networkToRealTimeStats, &handoff);
+}
+
+int forwardListenerToNetworkCore(struct sensorListener *listener)
+{
+	struct CoreHandoff handoff;
+
+	if (listener->command == NULL)
+	{
+		return JSON_MESSAGE_COMMAND_COMMAND_NOT_FOUND;
+	}
+
+	handoff.type = handoffCommand;
+	handoff.command = listener->command;
+	snprintf(handoff.destination, DESTINATION_NAME_LENGTH, "%s", listener->config->destination);
+	memcpy(handoff.parameters, listener->config->optionBuffer, OPTION_STORAGE_SIZE);
+
+	int result = pushHandoff(&realTimeToNetworkQueue, &realTimeToNetworkStats, &handoff);
+
+	requestSchedulerWake();
+
+	return result;
+}
+
+bool forwardCommandStoreToNetworkCore(char *commandStoreName, int *result)
+{
+	if (!onRealTimeTask())
+	{
+		return false;
+	}
+
+	struct CoreHandoff handoff;
+
+	handoff.type = handoffCommandStore;
+	handoff.command = NULL;
+	handoff.destination[0] = 0;
+	snprintf((char *)handoff.parameters, COMMAND_PARAMETER_BUFFER_LENGTH, "%s", commandStoreName);
+
+	*result = pushHandoff(&realTimeToNetworkQueue, &realTimeToNetworkStats, &handoff);
+
+	requestSchedulerWake();
+
+	return true;
+}
+
+void performRealTimeHandoffs()
+{
+	struct CoreHandoff handoff;
+
+	while (spscQueuePop(&realTimeToNetworkQueue, &handoff))
+	{
+		performHandoff(&handoff, &realTimeToNetworkStats);
+	}
+}
+
+void realTimeTask(void *parameters)
+{
+	struct CoreHandoff handoff;
+
+	while (true)
+	{
+		unsigned long passStartMicros = micros();
+
+		while (spscQueuePop(&networkToRealTimeQueue, &handoff))
+		{
+			performHandoff(&handoff, &networkToRealTimeStats);
+		}
+
+		updateRealTimeSensors();
+		updateRealTimeProcesses();
+
+		LOOP_TRACE(traceLoop, "real time pass", passStartMicros);
+
+		// one tick lets the idle task on this core run
+		vTaskDelay(1);
+	}
+}
+
+void startDualCoreTasks()
+{
+	spscQueueInit(&networkToRealTimeQueue, networkToRealTimeSlots, sizeof(struct CoreHandoff), DUAL_CORE_QUEUE_SLOTS);
+	spscQueueInit(&realTimeToNetworkQueue, realTimeToNetworkSlots, sizeof(struct CoreHandoff), DUAL_CORE_QUEUE_SLOTS);
+
+	// set before the task starts so that neither side updates the
+	// other's sensors and processes
+	dualCoreRunning = true;
+
+	if (xTaskCreatePinnedToCore(realTimeTask, "realtime", DUAL_CORE_REAL_TIME_STACK_SIZE, NULL,
+								DUAL_CORE_REAL_TIME_PRIORITY, &realTimeTaskHandle, DUAL_CORE_REAL_TIME_CORE) != pdPASS)
+	{
+		TRACELOGLN("Could not start the real time task");
+		dualCoreRunning = false;
+		return;
+	}
+
+	displayMessage("Real time task started on core %d\n", DUAL_CORE_REAL_TIME_CORE);
+}
+
+void dualCoreStatusMessage(char *buffer, int bufferLength)
+{
+	if (!dualCoreRunning)
+	{
+		snprintf(buffer, bufferLength, "single core");
+		return;
+	}
+
+	snprintf(buffer, bufferLength,
+			 "to real time forwarded:%lu performed:%lu full:%lu max latency:%luus "
+			 "to network forwarded:%lu performed:%lu full:%lu max latency:%luus",
+			 networkToRealTimeStats.forwarded,
+			 networkToRealTimeStats.performed,
+			 networkToRealTimeStats.queueFull,
+			 networkToRealTimeStats.maxLatencyMicros,
+			 realTimeToNetworkStats.forwarded,
+			 realTimeToNetworkStats.performed,
+			 realTimeToNetworkStats.queueFull,
+			 realTimeToNetworkStats.maxLatencyMicros);
+}
+
+#else
+
+// Everything runs on the main loop so nothing is ever forwarded
+
+bool dualCoreTasksRunning()
+{
+	return false;
+}
+
+bool onRealTimeTask()
+{
+	return false;
+}
+
+void startDualCoreTasks()
+{
+}
+
+int forwardCommandToRealTimeCore(struct Command *command, char *destination, unsigned char *parameters)
+{
+	return command->performCommand(destination, parameters);
+}
+
+int forwardListenerToNetworkCore(struct sensorListener *listener)
+{
+	return listener->receiveMessage(listener->config->destination, listener->config->optionBuffer);
+}
+
+bool forwardCommandStoreToNetworkCore(char *commandStoreName, int *result)
+{
+	return false;
+}
+
+void performRealTimeHandoffs()
+{
+}
+
+void dualCoreStatusMessage(char *buffer, int bufferLength)
+{
+	snprintf(buffer, bufferLength, "single core");
+}
+
+#endif
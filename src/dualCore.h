@@ -0,0 +1,98 @@
+#pragma once
+
+#include "processes.h"
+#include "sensors.h"
+
+// On ESP32 the device can split its work over two tasks. The Arduino loop
+// task keeps the network side: WiFi, MQTT, the console, the web server and
+// the controller, which parses the incoming JSON commands. A second task
+// updates the sensors and the processes that have been given to the real
+// time side (pixels, servos, HullOS and so on).
+//
+// The real time task is pinned to core 1 rather than core 0. Core 0 runs
+// the WiFi driver and the TCP/IP stack at priorities far above anything the
+// device starts, so real time work there would stall whenever the radio is
+// busy, and a real time pass that kept the core would starve its idle task
+// and trip the task watchdog. On core 1 the only competition is the loop
+// task, and the real time task runs at a higher priority than the loop, so
+// it takes the core as soon as it is due and hands it back when it waits
+// for the next tick. The network side still gets core 0 for the radio and
+// the stack, which is where most of its time goes.
+//
+// The two sides only talk through a pair of single producer, single
+// consumer queues:
+//
+//   network to real time - a command for a real time process, decoded and
+//                          validated by the controller and then performed
+//                          on the real time core
+//   real time to network - a sensor listener whose command belongs to a
+//                          network process or is going to another device
+//
+// A forwarded command is replied to as soon as it is queued, so its reply
+// says the command was valid rather than reporting what happened when it
+// ran.
+//
+// The layout is turned on by building with DUAL_CORE_TASKS defined, which
+// the ESP32_DOIT_DUAL_CORE environment in platformio.ini does. The tasks
+// are started once the device has booted, after which the active process
+// list must not change.
+
+#if defined(ARDUINO_ARCH_ESP32) && defined(DUAL_CORE_TASKS)
+#define DUAL_CORE_LAYOUT
+#endif
+
+#define DUAL_CORE_QUEUE_SLOTS 8
+
+#define DUAL_CORE_REAL_TIME_CORE 1
+#define DUAL_CORE_REAL_TIME_STACK_SIZE 8192
+// one above the Arduino loop task
+#define DUAL_CORE_REAL_TIME_PRIORITY 2
+
+// A command passed between the two sides. For a command store the
+// parameters hold the name of the store.
+
+enum CoreHandoffType { handoffCommand, handoffCommandStore };
+
+struct CoreHandoff
+{
+	CoreHandoffType type;
+	struct Command *command;
+	unsigned long queuedMicros;
+	char destination[DESTINATION_NAME_LENGTH];
+	unsigned char parameters[COMMAND_PARAMETER_BUFFER_LENGTH];
+};
+
+struct CoreHandoffStats
+{
+	unsigned long forwarded;
+	unsigned long performed;
+	unsigned long queueFull;
+	unsigned long maxLatencyMicros;
+};
+
+extern struct CoreHandoffStats networkToRealTimeStats;
+extern struct CoreHandoffStats realTimeToNetworkStats;
+
+bool dualCoreTasksRunning();
+
+// true when called from the real time task
+bool onRealTimeTask();
+
+void startDualCoreTasks();
+
+// used by the controller for a command that is performed now
+int forwardCommandToRealTimeCore(struct Command *command, char *destination, unsigned char *parameters);
+
+// used by the sensors when a listener fires
+int forwardListenerToNetworkCore(struct sensorListener *listener);
+
+// returns false if the caller isn't on the real time task, in which case the
+// store should be performed directly
+bool forwardCommandStoreToNetworkCore(char *commandStoreName, int *result);
+
+// performs the commands forwarded from the real time core - called from the loop
+void performRealTimeHandoffs();
+
+#define DUAL_CORE_STATUS_LENGTH 250
+
+void dualCoreStatusMessage(char *buffer, int bufferLength);
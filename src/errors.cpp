@@ -157,6 +157,27 @@ void decodeError(int errorNo, char *buffer, int bufferLength)
     case JSON_MESSAGE_ROBOT_NOT_ENABLED:
         message =  F("Robot not enabled");
         break;
+    case BINARY_MESSAGE_COULD_NOT_BE_DECODED:
+        message =  F("The binary message could not be decoded");
+        break;
+    case BINARY_MESSAGE_ITEM_KEY_INVALID:
+        message =  F("The binary message contains an invalid item key");
+        break;
+    case JSON_MESSAGE_CORE_HANDOFF_QUEUE_FULL:
+        message =  F("The command could not be passed to the other core");
+        break;
+    case JSON_MESSAGE_NO_SENSOR_HISTORY:
+        message =  F("The sensor is not keeping a history");
+        break;
+    case JSON_MESSAGE_COMMAND_QUEUE_FULL:
+        message =  F("The command queue is full");
+        break;
+    case JSON_MESSAGE_COMMAND_DROPPED_FOR_PRIORITY:
+        message =  F("The command was dropped to make room for a higher priority one");
+        break;
+    case JSON_MESSAGE_HISTORY_PERIODS_TOO_MANY:
+        message =  F("The history tier doesn't hold that many periods");
+        break;
     }
 
     snprintf(buffer, bufferLength, message.c_str());
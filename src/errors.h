@@ -47,6 +47,13 @@
 #define JSON_MESSAGE_STORE_FOLDER_DOES_NOT_EXIST -40
 #define JSON_MESSAGE_OUTPIN_NOT_AVAILABLE -41
 #define JSON_MESSAGE_ROBOT_NOT_ENABLED -42
+#define BINARY_MESSAGE_COULD_NOT_BE_DECODED -43
+#define BINARY_MESSAGE_ITEM_KEY_INVALID -44
+#define JSON_MESSAGE_CORE_HANDOFF_QUEUE_FULL -45
+#define JSON_MESSAGE_NO_SENSOR_HISTORY -46
+#define JSON_MESSAGE_COMMAND_QUEUE_FULL -47
+#define JSON_MESSAGE_COMMAND_DROPPED_FOR_PRIORITY -48
+#define JSON_MESSAGE_HISTORY_PERIODS_TOO_MANY -50
 
 
 void decodeError(int errorNo, char *buffer, int bufferLength);
@@ -0,0 +1,126 @@
+#include <Arduino.h>
+
+#include "utils.h"
+#include "messages.h"
+#include "blockPool.h"
+#include "timerWheel.h"
+#include "heapMonitor.h"
+#include "metrics.h"
+
+struct HeapMonitor heapMonitor;
+
+void takeHeapSample(struct HeapSample *sample)
+{
+#if defined(ARDUINO_ARCH_ESP8266) || defined(ARDUINO_ARCH_HOST)
+	sample->freeHeap = ESP.getFreeHeap();
+	sample->largestBlock = ESP.getMaxFreeBlockSize();
+#endif
+
+#if defined(ARDUINO_ARCH_ESP32)
+	sample->freeHeap = ESP.getFreeHeap();
+	sample->largestBlock = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+#endif
+
+#if defined(ARDUINO_ARCH_PICO)
+	sample->freeHeap = rp2040.getFreeHeap();
+	sample->largestBlock = sample->freeHeap;
+#endif
+
+	if (sample->freeHeap == 0 || sample->largestBlock >= sample->freeHeap)
+	{
+		sample->fragmentation = 0;
+	}
+	else
+	{
+		sample->fragmentation = 100 - (uint8_t)((sample->largestBlock * 100ULL) / sample->freeHeap);
+	}
+}
+
+void recordHeapSample()
+{
+	struct HeapSample *sample = &heapMonitor.history[heapMonitor.nextSample];
+
+	takeHeapSample(sample);
+	setGaugeMetric(&metricHeapFree, sample->freeHeap);
+
+	if (heapMonitor.noOfSamples == 0 || sample->freeHeap < heapMonitor.minFreeHeap)
+	{
+		heapMonitor.minFreeHeap = sample->freeHeap;
+	}
+
+	if (heapMonitor.noOfSamples == 0 || sample->largestBlock < heapMonitor.minLargestBlock)
+	{
+		heapMonitor.minLargestBlock = sample->largestBlock;
+	}
+
+	if (sample->fragmentation > heapMonitor.maxFragmentation)
+	{
+		heapMonitor.maxFragmentation = sample->fragmentation;
+	}
+
+	heapMonitor.nextSample = (heapMonitor.nextSample + 1) % HEAP_MONITOR_HISTORY_LENGTH;
+
+	if (heapMonitor.noOfSamples < HEAP_MONITOR_HISTORY_LENGTH)
+	{
+		heapMonitor.noOfSamples++;
+	}
+
+}
+
+void heapSampleTimerFired(struct WheelTimer *timer)
+{
+	recordHeapSample();
+}
+
+struct WheelTimer heapSampleTimer = {"heap monitor", heapSampleTimerFired};
+
+void startHeapMonitor()
+{
+	recordHeapSample();
+	scheduleTimer(&heapSampleTimer, HEAP_MONITOR_SAMPLE_MILLIS, HEAP_MONITOR_SAMPLE_MILLIS);
+}
+
+#define HEAP_POOL_STATUS_LENGTH 120
+
+void printBlockPool(struct BlockPool *pool)
+{
+	char buffer[HEAP_POOL_STATUS_LENGTH];
+
+	blockPoolStatusMessage(pool, buffer, HEAP_POOL_STATUS_LENGTH);
+	alwaysDisplayMessage("    %s\n", buffer);
+}
+
+void printHeapMonitor()
+{
+	struct HeapSample now;
+
+	takeHeapSample(&now);
+
+	alwaysDisplayMessage("\nHeap free:%lu largest block:%lu fragmentation:%d%%\n",
+						 (unsigned long)now.freeHeap, (unsigned long)now.largestBlock, now.fragmentation);
+	alwaysDisplayMessage("Worst free:%lu largest block:%lu fragmentation:%d%%\n",
+						 (unsigned long)heapMonitor.minFreeHeap, (unsigned long)heapMonitor.minLargestBlock,
+						 heapMonitor.maxFragmentation);
+
+	alwaysDisplayMessage("Last %d samples, %d seconds apart, oldest first\n",
+						 heapMonitor.noOfSamples, HEAP_MONITOR_SAMPLE_MILLIS / 1000);
+
+	int sampleNo = heapMonitor.nextSample - heapMonitor.noOfSamples;
+
+	if (sampleNo < 0)
+	{
+		sampleNo += HEAP_MONITOR_HISTORY_LENGTH;
+	}
+
+	for (int i = 0; i < heapMonitor.noOfSamples; i++)
+	{
+		struct HeapSample *sample = &heapMonitor.history[sampleNo];
+		alwaysDisplayMessage("    free:%lu largest block:%lu fragmentation:%d%%\n",
+							 (unsigned long)sample->freeHeap, (unsigned long)sample->largestBlock,
+							 sample->fragmentation);
+		sampleNo = (sampleNo + 1) % HEAP_MONITOR_HISTORY_LENGTH;
+	}
+
+	alwaysDisplayMessage("Block pools\n");
+	iterateThroughBlockPools(printBlockPool);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <Arduino.h>
+
+// The heap monitor samples the free heap and the largest free block every
+// HEAP_MONITOR_SAMPLE_MILLIS and keeps the recent samples along with the
+// worst values seen since the device started. Fragmentation is the share
+// of the free heap that isn't in the largest block, so 0% means all the
+// free memory is in one piece. On the Pico the largest block isn't known
+// and fragmentation is always shown as 0%.
+
+#define HEAP_MONITOR_SAMPLE_MILLIS 10000
+#define HEAP_MONITOR_HISTORY_LENGTH 12
+
+struct HeapSample
+{
+	uint32_t freeHeap;
+	uint32_t largestBlock;
+	uint8_t fragmentation;
+};
+
+struct HeapMonitor
+{
+	struct HeapSample history[HEAP_MONITOR_HISTORY_LENGTH];
+	int noOfSamples;
+	int nextSample;
+	uint32_t minFreeHeap;
+	uint32_t minLargestBlock;
+	uint8_t maxFragmentation;
+};
+
+extern struct HeapMonitor heapMonitor;
+
+void takeHeapSample(struct HeapSample *sample);
+
+// takes the first sample and starts the sample timer
+void startHeapMonitor();
+
+// prints the samples and the block pools
+void printHeapMonitor();
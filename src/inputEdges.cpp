@@ -0,0 +1,195 @@
+#include <Arduino.h>
+
+#include "debug.h"
+#include "utils.h"
+#include "messages.h"
+#include "inputEdges.h"
+
+struct InputEdgeQueue *allInputEdgeQueues = NULL;
+
+bool inputEdgeQueueListed(struct InputEdgeQueue *edges)
+{
+	for (struct InputEdgeQueue *pos = allInputEdgeQueues; pos != NULL; pos = pos->nextInputEdgeQueue)
+	{
+		if (pos == edges)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void startInputEdgeQueue(struct InputEdgeQueue *edges, const char *name, int pin, int inputMode,
+						 unsigned long debounceMicros, void (*handler)())
+{
+	int interrupt = digitalPinToInterrupt(pin);
+
+	if (interrupt != NOT_AN_INTERRUPT)
+	{
+		detachInterrupt(interrupt);
+	}
+
+	pinMode(pin, inputMode);
+
+	edges->name = name;
+	edges->pin = pin;
+	edges->debounceMicros = debounceMicros;
+	spscQueueInit(&edges->queue, edges->slots, sizeof(struct InputEdge), INPUT_EDGE_QUEUE_SLOTS);
+
+	edges->level = digitalRead(pin);
+	edges->lastRawLevel = edges->level;
+	edges->pending = false;
+	edges->overflowsSeen = 0;
+
+	if (!inputEdgeQueueListed(edges))
+	{
+		edges->nextInputEdgeQueue = allInputEdgeQueues;
+		allInputEdgeQueues = edges;
+	}
+
+	edges->interruptDriven = interrupt != NOT_AN_INTERRUPT;
+
+	if (edges->interruptDriven)
+	{
+		attachInterrupt(interrupt, handler, CHANGE);
+	}
+	else
+	{
+		displayMessage("The %s input on pin %d has no interrupt and will be polled\n", name, pin);
+	}
+}
+
+void ICACHE_RAM_ATTR pushInputEdge(struct InputEdgeQueue *edges)
+{
+	struct InputEdge edge;
+
+	edge.micros = micros();
+	edge.level = digitalRead(edges->pin);
+
+	// a full queue is counted by the queue and picked up by the reader
+	spscQueuePush(&edges->queue, &edge);
+}
+
+// The next edge from the queue. When the queue is empty a polled pin is
+// read, as is an interrupt driven one that has lost edges to a full queue.
+
+bool nextInputEdge(struct InputEdgeQueue *edges, unsigned long nowMicros, struct InputEdge *edge)
+{
+	if (spscQueuePop(&edges->queue, edge))
+	{
+		edges->lastRawLevel = edge->level;
+		return true;
+	}
+
+	unsigned long overflows = edges->queue.pushFailures;
+
+	if (edges->interruptDriven && overflows == edges->overflowsSeen)
+	{
+		return false;
+	}
+
+	edges->overflowsSeen = overflows;
+
+	int rawLevel = digitalRead(edges->pin);
+
+	if (rawLevel == edges->lastRawLevel)
+	{
+		return false;
+	}
+
+	edges->lastRawLevel = rawLevel;
+	edge->micros = nowMicros;
+	edge->level = rawLevel;
+	return true;
+}
+
+// An edge away from the stable level starts a pending change. An edge back
+// again before the change has lasted for the debounce time is a bounce and
+// cancels it. The handler reads the pin a little after the edge, so two
+// edges in a row can have the same level - the second one is ignored.
+
+void applyInputEdge(struct InputEdgeQueue *edges, struct InputEdge *edge)
+{
+	edges->edges++;
+
+	if (edges->pending)
+	{
+		if (edge->level != edges->pendingLevel)
+		{
+			edges->pending = false;
+			edges->bounces++;
+		}
+		return;
+	}
+
+	if (edge->level != edges->level)
+	{
+		edges->pending = true;
+		edges->pendingLevel = edge->level;
+		edges->pendingMicros = edge->micros;
+	}
+}
+
+// the interrupt can push an edge that is newer than the time the caller
+// read, so the difference is signed
+bool pendingInputChangeSettled(struct InputEdgeQueue *edges, unsigned long nowMicros)
+{
+	return edges->pending && (long)(nowMicros - edges->pendingMicros) >= (long)edges->debounceMicros;
+}
+
+void settlePendingInputChange(struct InputEdgeQueue *edges)
+{
+	edges->level = edges->pendingLevel;
+	edges->pending = false;
+	edges->changes++;
+}
+
+bool getInputEdgeChange(struct InputEdgeQueue *edges, unsigned long nowMicros, int *level)
+{
+	struct InputEdge edge;
+
+	while (nextInputEdge(edges, nowMicros, &edge))
+	{
+		if (pendingInputChangeSettled(edges, edge.micros))
+		{
+			// the pending level held until this edge, so it counts
+			settlePendingInputChange(edges);
+			applyInputEdge(edges, &edge);
+			*level = edges->level;
+			return true;
+		}
+
+		applyInputEdge(edges, &edge);
+	}
+
+	if (pendingInputChangeSettled(edges, nowMicros))
+	{
+		settlePendingInputChange(edges);
+		*level = edges->level;
+		return true;
+	}
+
+	return false;
+}
+
+void iterateThroughInputEdgeQueues(void (*func)(struct InputEdgeQueue *edges))
+{
+	for (struct InputEdgeQueue *pos = allInputEdgeQueues; pos != NULL; pos = pos->nextInputEdgeQueue)
+	{
+		func(pos);
+	}
+}
+
+void printInputEdgeQueue(struct InputEdgeQueue *edges)
+{
+	alwaysDisplayMessage("    %s pin:%d %s level:%d edges:%lu bounces:%lu changes:%lu overflows:%lu queued:%u\n",
+						 edges->name,
+						 edges->pin,
+						 edges->interruptDriven ? "interrupt" : "polled",
+						 edges->level,
+						 edges->edges,
+						 edges->bounces,
+						 edges->changes,
+						 edges->queue.pushFailures,
+						 spscQueueDepth(&edges->queue));
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "spscQueue.h"
+
+// A digital input that is read by a pin change interrupt rather than being
+// polled from the loop. The interrupt handler pushes the time and the level
+// of each edge into a single producer, single consumer queue, and the
+// sensor drains the queue in its update. The debounce works on the edge
+// times, so a press that comes and goes between two loop passes - or while
+// the pixels are being sent - still turns up as a press and a release.
+//
+// Each input needs a tiny interrupt handler of its own, because
+// attachInterrupt doesn't pass an argument:
+//
+//   struct InputEdgeQueue buttonEdges;
+//
+//   void ICACHE_RAM_ATTR buttonEdgeInterrupt()
+//   {
+//       pushInputEdge(&buttonEdges);
+//   }
+//
+//   startInputEdgeQueue(&buttonEdges, "button", pin, INPUT_PULLUP, debounceMicros, buttonEdgeInterrupt);
+//   ...
+//   int level;
+//   while (getInputEdgeChange(&buttonEdges, micros(), &level))
+//       ... act on each debounced change, oldest first
+//
+// A pin that can't raise an interrupt is polled instead, and if the queue
+// fills up the pin is read to pick up the level that the lost edges left
+// behind.
+
+#define INPUT_EDGE_QUEUE_SLOTS 16
+
+struct InputEdge
+{
+	unsigned long micros;
+	int level;
+};
+
+struct InputEdgeQueue
+{
+	const char *name;
+	int pin;
+	unsigned long debounceMicros;
+	bool interruptDriven;
+	struct SpscQueue queue;
+	unsigned char slots[INPUT_EDGE_QUEUE_SLOTS * sizeof(struct InputEdge)];
+	// the level that has been stable for the debounce time
+	int level;
+	// a change that hasn't been stable for long enough yet
+	bool pending;
+	int pendingLevel;
+	unsigned long pendingMicros;
+	// the level of the last edge taken from the queue or read from the pin
+	int lastRawLevel;
+	unsigned long overflowsSeen;
+	unsigned long edges;
+	unsigned long bounces;
+	unsigned long changes;
+	struct InputEdgeQueue *nextInputEdgeQueue;
+};
+
+// sets the pin up as an input with the given mode and attaches the handler
+void startInputEdgeQueue(struct InputEdgeQueue *edges, const char *name, int pin, int inputMode,
+						 unsigned long debounceMicros, void (*handler)());
+
+// called from the interrupt handler
+void ICACHE_RAM_ATTR pushInputEdge(struct InputEdgeQueue *edges);
+
+// returns true and sets the level for each debounced change, oldest first
+bool getInputEdgeChange(struct InputEdgeQueue *edges, unsigned long nowMicros, int *level);
+
+void iterateThroughInputEdgeQueues(void (*func)(struct InputEdgeQueue *edges));
+
+void printInputEdgeQueue(struct InputEdgeQueue *edges);
@@ -3,6 +3,7 @@
 #include "utils.h"
 #include "inputswitch.h"
 #include "settings.h"
+#include "inputEdges.h"
 
 // Input switch sensor
 
@@ -92,9 +93,6 @@ struct SettingItemCollection inputSwitchSettingItems = {
 	inputSwitchSettingItemPointers,
 	sizeof(inputSwitchSettingItemPointers) / sizeof(struct SettingItem *)};
 
-int lastInputValue;
-long inputDebounceStartTime;
-
 boolean switchValue;
 
 boolean getInputSwitchValue()
@@ -102,13 +100,26 @@ boolean getInputSwitchValue()
 	return switchValue;
 }
 
-unsigned long millisAtLastInputChange;
-
 // number of milliseconds that the signal must be stable
 // before we read it
 
 #define INPUT_DEBOUNCE_TIME 10
 
+struct InputEdgeQueue inputSwitchEdges;
+
+void ICACHE_RAM_ATTR inputSwitchEdgeInterrupt()
+{
+	pushInputEdge(&inputSwitchEdges);
+}
+
+boolean inputSwitchLevelValue(int level)
+{
+	if (level)
+		return !inputSwitchSettings.activeLow;
+	else
+		return inputSwitchSettings.activeLow;
+}
+
 void initInputSwitch()
 {
 	inputSwitchProcess.status = INPUT_SWITCH_STOPPED;
@@ -116,13 +127,16 @@ void initInputSwitch()
 
 void enableInputSwitch()
 {
-	pinMode(inputSwitchSettings.inputPin, INPUT_PULLUP);
-
 	if (inputSwitchSettings.groundPin != -1)
 	{
 		pinMode(inputSwitchSettings.groundPin, OUTPUT);
 		digitalWrite(inputSwitchSettings.groundPin, LOW);
 	}
+
+	startInputEdgeQueue(&inputSwitchEdges, "inputswitch", inputSwitchSettings.inputPin, INPUT_PULLUP,
+						INPUT_DEBOUNCE_TIME * 1000UL, inputSwitchEdgeInterrupt);
+
+	switchValue = inputSwitchLevelValue(inputSwitchEdges.level);
 	inputSwitchProcess.status = INPUT_SWITCH_OK;
 }
 
@@ -147,25 +161,11 @@ void updateInputSwitch()
 		return;
 	}
 
-	int newInputValue = digitalRead(inputSwitchSettings.inputPin);
+	int level;
 
-	if (newInputValue == lastInputValue)
-	{
-		inputDebounceStartTime = millis();
-	}
-	else
+	while (getInputEdgeChange(&inputSwitchEdges, micros(), &level))
 	{
-		long currentMillis = millis();
-		long millisSinceChange = ulongDiff(currentMillis, inputDebounceStartTime);
-
-		if (++millisSinceChange > INPUT_DEBOUNCE_TIME)
-		{
-			if (newInputValue)
-				switchValue = !inputSwitchSettings.activeLow;
-			else
-				switchValue = inputSwitchSettings.activeLow;
-			lastInputValue = newInputValue;
-		}
+		switchValue = inputSwitchLevelValue(level);
 	}
 }
 
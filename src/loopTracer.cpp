@@ -0,0 +1,225 @@
+#include <Arduino.h>
+
+#include "utils.h"
+#include "messages.h"
+#include "dualCore.h"
+#include "loopTracer.h"
+
+volatile bool loopTraceActive = false;
+
+// each thread has a ring of its own so that it is the only writer
+struct LoopTraceRing loopTraceRings[LOOP_TRACE_THREADS];
+
+const char *loopTraceCategoryNames[] = {"loop", "sensor", "process", "mqtt", "command"};
+
+const char *loopTraceThreadNames[] = {"main loop", "real time task"};
+
+struct LoopTraceRing *loopTraceRingForCaller()
+{
+#if defined(DUAL_CORE_LAYOUT)
+	if (onRealTimeTask())
+	{
+		return &loopTraceRings[1];
+	}
+#endif
+	return &loopTraceRings[0];
+}
+
+void recordLoopTraceEvent(LoopTraceCategory category, const char *name, unsigned long startMicros)
+{
+	struct LoopTraceRing *ring = loopTraceRingForCaller();
+
+	struct LoopTraceEvent *event = &ring->events[ring->nextEvent];
+
+	event->name = name;
+	event->startMicros = startMicros;
+	event->durationMicros = ulongDiff(micros(), startMicros);
+	event->category = category;
+
+	ring->nextEvent = (ring->nextEvent + 1) % LOOP_TRACE_EVENTS;
+	ring->eventsRecorded++;
+}
+
+void clearLoopTrace()
+{
+	for (int thread = 0; thread < LOOP_TRACE_THREADS; thread++)
+	{
+		loopTraceRings[thread].nextEvent = 0;
+		loopTraceRings[thread].eventsRecorded = 0;
+	}
+}
+
+void startLoopTrace()
+{
+	clearLoopTrace();
+	loopTraceActive = true;
+}
+
+void stopLoopTrace()
+{
+	loopTraceActive = false;
+}
+
+int loopTraceRingLength(struct LoopTraceRing *ring)
+{
+	if (ring->eventsRecorded < LOOP_TRACE_EVENTS)
+	{
+		return ring->eventsRecorded;
+	}
+	return LOOP_TRACE_EVENTS;
+}
+
+struct LoopTraceEvent *loopTraceRingEvent(struct LoopTraceRing *ring, int eventNo)
+{
+	// event 0 is the oldest one
+	int first = ring->nextEvent - loopTraceRingLength(ring);
+
+	if (first < 0)
+	{
+		first += LOOP_TRACE_EVENTS;
+	}
+
+	return &ring->events[(first + eventNo) % LOOP_TRACE_EVENTS];
+}
+
+#define LOOP_TRACE_JSON_EVENT_LENGTH 160
+
+// the longest event name in the JSON, after escaping
+#define LOOP_TRACE_JSON_NAME_LENGTH 48
+
+// copies the name as the contents of a JSON string - quotes and backslashes
+// are escaped and control characters are left out
+void copyLoopTraceName(char *dest, int destLength, const char *name)
+{
+	int pos = 0;
+
+	for (int i = 0; name[i] != 0; i++)
+	{
+		char ch = name[i];
+
+		if ((unsigned char)ch < ' ')
+		{
+			continue;
+		}
+
+		if (ch == '"' || ch == '\\')
+		{
+			if (pos + 2 >= destLength)
+			{
+				break;
+			}
+			dest[pos++] = '\\';
+		}
+		else if (pos + 1 >= destLength)
+		{
+			break;
+		}
+
+		dest[pos++] = ch;
+	}
+
+	dest[pos] = 0;
+}
+
+void writeLoopTraceJson(void (*writeText)(const char *text))
+{
+	bool wasActive = loopTraceActive;
+
+	loopTraceActive = false;
+
+#if defined(DUAL_CORE_LAYOUT)
+	if (dualCoreTasksRunning())
+	{
+		// let the real time task finish any event it is writing
+		delay(2);
+	}
+#endif
+
+	// Work out the age of each event relative to now so that the micros()
+	// wrap doesn't matter, then count the timestamps from the oldest event
+
+	uint32_t nowMicros = micros();
+	uint32_t oldestAge = 0;
+
+	for (int thread = 0; thread < LOOP_TRACE_THREADS; thread++)
+	{
+		struct LoopTraceRing *ring = &loopTraceRings[thread];
+		int length = loopTraceRingLength(ring);
+
+		for (int eventNo = 0; eventNo < length; eventNo++)
+		{
+			uint32_t age = nowMicros - loopTraceRingEvent(ring, eventNo)->startMicros;
+
+			if (age > oldestAge)
+			{
+				oldestAge = age;
+			}
+		}
+	}
+
+	char buffer[LOOP_TRACE_JSON_EVENT_LENGTH];
+	char name[LOOP_TRACE_JSON_NAME_LENGTH];
+
+	writeText("{\"traceEvents\":[\n");
+
+	const char *separator = "";
+
+	for (int thread = 0; thread < LOOP_TRACE_THREADS; thread++)
+	{
+		snprintf(buffer, LOOP_TRACE_JSON_EVENT_LENGTH,
+				 "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+				 separator, thread, loopTraceThreadNames[thread]);
+		writeText(buffer);
+		separator = ",\n";
+
+		struct LoopTraceRing *ring = &loopTraceRings[thread];
+		int length = loopTraceRingLength(ring);
+
+		for (int eventNo = 0; eventNo < length; eventNo++)
+		{
+			struct LoopTraceEvent *event = loopTraceRingEvent(ring, eventNo);
+
+			copyLoopTraceName(name, LOOP_TRACE_JSON_NAME_LENGTH, event->name);
+
+			snprintf(buffer, LOOP_TRACE_JSON_EVENT_LENGTH,
+					 "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%lu,\"dur\":%lu,\"pid\":1,\"tid\":%d}",
+					 separator,
+					 name,
+					 loopTraceCategoryNames[event->category],
+					 (unsigned long)(oldestAge - (nowMicros - event->startMicros)),
+					 (unsigned long)event->durationMicros,
+					 thread);
+			writeText(buffer);
+		}
+	}
+
+	writeText("\n],\"displayTimeUnit\":\"ms\"}\n");
+
+	loopTraceActive = wasActive;
+}
+
+void printLoopTraceText(const char *text)
+{
+	Serial.print(text);
+}
+
+void printLoopTraceJson()
+{
+	writeLoopTraceJson(printLoopTraceText);
+}
+
+void loopTraceStatusMessage(char *buffer, int bufferLength)
+{
+	unsigned long recorded = 0;
+	int held = 0;
+
+	for (int thread = 0; thread < LOOP_TRACE_THREADS; thread++)
+	{
+		recorded += loopTraceRings[thread].eventsRecorded;
+		held += loopTraceRingLength(&loopTraceRings[thread]);
+	}
+
+	snprintf(buffer, bufferLength, "%s events recorded:%lu held:%d of %d",
+			 loopTraceActive ? "tracing" : "stopped",
+			 recorded, held, LOOP_TRACE_EVENTS * LOOP_TRACE_THREADS);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "dualCore.h"
+
+// The loop tracer records how long each sensor update, process update,
+// MQTT callback and command took, and when it started, in a ring buffer in
+// RAM. It is off until it is started from the console and then costs one
+// test of loopTraceActive for each traced call. Once the ring is full the
+// oldest events are overwritten, so the buffer always holds the last
+// LOOP_TRACE_EVENTS calls.
+//
+// The buffer is written out in the Chrome trace event format, which can be
+// loaded into chrome://tracing or ui.perfetto.dev to see which call blew
+// the frame budget. Each event is a complete ("X") event, so an event that
+// is overwritten never leaves a begin without an end. The threads in the
+// trace are the main loop and, in the dual core layout, the real time task.
+//
+// Event names are not copied. They must be the names of sensors, processes
+// and commands, or string constants. They are escaped when the trace is
+// written, and long names are cut short.
+
+#define LOOP_TRACE_EVENTS 192
+
+#if defined(DUAL_CORE_LAYOUT)
+#define LOOP_TRACE_THREADS 2
+#else
+#define LOOP_TRACE_THREADS 1
+#endif
+
+enum LoopTraceCategory
+{
+	traceLoop,
+	traceSensor,
+	traceProcess,
+	traceMQTT,
+	traceCommand
+};
+
+struct LoopTraceEvent
+{
+	const char *name;
+	uint32_t startMicros;
+	uint32_t durationMicros;
+	uint8_t category;
+};
+
+struct LoopTraceRing
+{
+	struct LoopTraceEvent events[LOOP_TRACE_EVENTS];
+	int nextEvent;
+	unsigned long eventsRecorded;
+};
+
+extern volatile bool loopTraceActive;
+
+// records a call that started at startMicros and has just finished
+void recordLoopTraceEvent(LoopTraceCategory category, const char *name, unsigned long startMicros);
+
+#define LOOP_TRACE(category, name, startMicros)                \
+	do                                                         \
+	{                                                          \
+		if (loopTraceActive)                                   \
+		{                                                      \
+			recordLoopTraceEvent(category, name, startMicros); \
+		}                                                      \
+	} while (0)
+
+void startLoopTrace();
+void stopLoopTrace();
+void clearLoopTrace();
+
+// writes the trace as Chrome trace event JSON, a piece at a time. Tracing is
+// paused while the trace is written. The timestamps count from the oldest
+// event, which must be less than 71 minutes old (the micros() wrap).
+void writeLoopTraceJson(void (*writeText)(const char *text));
+
+void printLoopTraceJson();
+
+#define LOOP_TRACE_STATUS_LENGTH 120
+
+void loopTraceStatusMessage(char *buffer, int bufferLength);
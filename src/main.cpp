@@ -22,6 +22,50 @@
 #include "registration.h"
 #include "boot.h" 
 #include "robotProcess.h"
+#include "settingsJournal.h"
+#include "scheduler.h"
+#include "dualCore.h"
+#include "processBus.h"
+#include "heapMonitor.h"
+#include "timerWheel.h"
+#include "loopTracer.h"
+#include "metrics.h"
+
+#elif defined(ARDUINO_ARCH_HOST)
+
+#include "settings.h"
+#include "pixels.h"
+#include "processes.h"
+#include "sensors.h"
+#include "pirSensor.h"
+#include "buttonsensor.h"
+#include "inputswitch.h"
+#include "controller.h"
+#include "statusled.h"
+#include "messages.h"
+#include "console.h"
+#include "connectwifi.h"
+#include "mqtt.h"
+#include "servoproc.h"
+#include "clock.h"
+#include "registration.h"
+#include "rotarySensor.h"
+#include "potSensor.h"
+#include "settingsWebServer.h"
+#include "printer.h"
+#include "HullOS.h"
+#include "boot.h" 
+#include "otaupdate.h"
+#include "outpin.h"
+#include "robotProcess.h"
+#include "settingsJournal.h"
+#include "scheduler.h"
+#include "dualCore.h"
+#include "processBus.h"
+#include "heapMonitor.h"
+#include "timerWheel.h"
+#include "loopTracer.h"
+#include "metrics.h"
 
 #else
 
@@ -52,6 +96,14 @@
 #include "otaupdate.h"
 #include "outpin.h"
 #include "robotProcess.h"
+#include "settingsJournal.h"
+#include "scheduler.h"
+#include "dualCore.h"
+#include "processBus.h"
+#include "heapMonitor.h"
+#include "timerWheel.h"
+#include "loopTracer.h"
+#include "metrics.h"
 
 #endif
 
@@ -61,6 +113,7 @@
 void populateProcessList()
 {
 #if defined(ARDUINO_ARCH_PICO)
+  addProcessToAllProcessList(&bootProcessDescriptor);
   addProcessToAllProcessList(&pixelProcess);
   addProcessToAllProcessList(&statusLedProcess);
   addProcessToAllProcessList(&messagesProcess);
@@ -70,7 +123,55 @@ void populateProcessList()
   addProcessToAllProcessList(&controllerProcess);
   addProcessToAllProcessList(&RegistrationProcess);
   addProcessToAllProcessList(&robotProcess);
+
+  // network, serial and command handling first on every pass
+  setProcessPriority(&consoleProcessDescriptor, highPriorityProcess, 0);
+  setProcessPriority(&WiFiProcessDescriptor, highPriorityProcess, 0);
+  setProcessPriority(&MQTTProcessDescriptor, highPriorityProcess, 0);
+  setProcessPriority(&robotProcess, highPriorityProcess, 0);
+  setProcessPriority(&controllerProcess, highPriorityProcess, 0);
+
+  // display work shares the low priority budget
+  setProcessPriority(&pixelProcess, lowPriorityProcess, 3000);
+  setProcessPriority(&statusLedProcess, lowPriorityProcess, 200);
+  setProcessPriority(&RegistrationProcess, lowPriorityProcess, 500);
+
+  // not needed until the network is up when the device boots fast
+  setProcessDeferredStart(&RegistrationProcess);
+#elif defined(ARDUINO_ARCH_HOST)
+  // the host simulation has no MAX7219 display
+  addProcessToAllProcessList(&bootProcessDescriptor);
+  addProcessToAllProcessList(&pixelProcess);
+  addProcessToAllProcessList(&statusLedProcess);
+  addProcessToAllProcessList(&inputSwitchProcess);
+  addProcessToAllProcessList(&messagesProcess);
+  addProcessToAllProcessList(&consoleProcessDescriptor);
+  addProcessToAllProcessList(&WiFiProcessDescriptor);
+  addProcessToAllProcessList(&MQTTProcessDescriptor);
+  addProcessToAllProcessList(&controllerProcess);
+  addProcessToAllProcessList(&ServoProcess);
+  addProcessToAllProcessList(&RegistrationProcess);
+  addProcessToAllProcessList(&printerProcess);
+  addProcessToAllProcessList(&hullosProcess);
+  addProcessToAllProcessList(&outPinProcess);
+  addProcessToAllProcessList(&robotProcess);
+
+  setProcessPriority(&consoleProcessDescriptor, highPriorityProcess, 0);
+  setProcessPriority(&WiFiProcessDescriptor, highPriorityProcess, 0);
+  setProcessPriority(&MQTTProcessDescriptor, highPriorityProcess, 0);
+  setProcessPriority(&inputSwitchProcess, highPriorityProcess, 0);
+  setProcessPriority(&robotProcess, highPriorityProcess, 0);
+  setProcessPriority(&controllerProcess, highPriorityProcess, 0);
+
+  setProcessPriority(&pixelProcess, lowPriorityProcess, 3000);
+  setProcessPriority(&statusLedProcess, lowPriorityProcess, 200);
+  setProcessPriority(&printerProcess, lowPriorityProcess, 2000);
+  setProcessPriority(&RegistrationProcess, lowPriorityProcess, 500);
+
+  setProcessDeferredStart(&RegistrationProcess);
+  setProcessDeferredStart(&printerProcess);
 #else
+  addProcessToAllProcessList(&bootProcessDescriptor);
   addProcessToAllProcessList(&pixelProcess);
   addProcessToAllProcessList(&statusLedProcess);
   addProcessToAllProcessList(&inputSwitchProcess);
@@ -86,6 +187,32 @@ void populateProcessList()
   addProcessToAllProcessList(&hullosProcess);
   addProcessToAllProcessList(&outPinProcess);
   addProcessToAllProcessList(&robotProcess);
+
+  // network, input, serial and command handling first on every pass
+  setProcessPriority(&consoleProcessDescriptor, highPriorityProcess, 0);
+  setProcessPriority(&WiFiProcessDescriptor, highPriorityProcess, 0);
+  setProcessPriority(&MQTTProcessDescriptor, highPriorityProcess, 0);
+  setProcessPriority(&inputSwitchProcess, highPriorityProcess, 0);
+  setProcessPriority(&robotProcess, highPriorityProcess, 0);
+  setProcessPriority(&controllerProcess, highPriorityProcess, 0);
+
+  // display and printing work shares the low priority budget
+  setProcessPriority(&pixelProcess, lowPriorityProcess, 3000);
+  setProcessPriority(&statusLedProcess, lowPriorityProcess, 200);
+  setProcessPriority(&max7219MessagesProcess, lowPriorityProcess, 2000);
+  setProcessPriority(&printerProcess, lowPriorityProcess, 2000);
+  setProcessPriority(&RegistrationProcess, lowPriorityProcess, 500);
+
+  // not needed until the network is up when the device boots fast
+  setProcessDeferredStart(&RegistrationProcess);
+  setProcessDeferredStart(&max7219MessagesProcess);
+  setProcessDeferredStart(&printerProcess);
+
+  // output hardware runs on its own core when the dual core layout is used
+  setProcessCore(&pixelProcess, realTimeCore);
+  setProcessCore(&ServoProcess, realTimeCore);
+  setProcessCore(&hullosProcess, realTimeCore);
+  setProcessCore(&outPinProcess, realTimeCore);
 #endif
 }
 
@@ -94,6 +221,18 @@ void populateSensorList()
 #if defined(ARDUINO_ARCH_PICO)
   addSensorToAllSensorsList(&clockSensor);
   addSensorToActiveSensorsList(&clockSensor);
+#elif defined(ARDUINO_ARCH_HOST)
+  // the host simulation has no BME280 sensor
+  addSensorToAllSensorsList(&pirSensor);
+  addSensorToActiveSensorsList(&pirSensor);
+  addSensorToAllSensorsList(&buttonSensor);
+  addSensorToActiveSensorsList(&buttonSensor);
+  addSensorToAllSensorsList(&clockSensor);
+  addSensorToActiveSensorsList(&clockSensor);
+  addSensorToAllSensorsList(&rotarySensor);
+  addSensorToActiveSensorsList(&rotarySensor);
+  addSensorToAllSensorsList(&potSensor);
+  addSensorToActiveSensorsList(&potSensor);
 #else
   addSensorToAllSensorsList(&pirSensor);
   addSensorToActiveSensorsList(&pirSensor);
@@ -119,13 +258,35 @@ void displayControlMessage(int messageNumber, ledFlashBehaviour severity, char *
   displayMessage("%s: %d %s\n", buffer, messageNumber, messageText);
 }
 
-unsigned long heapPrintTime = 0;
-
 void startDevice()
 {
   Serial.begin(115200);
 
-  delay(100);
+  recordBootPhase("serial");
+
+  // the settings are loaded first so that a fast boot can leave out the
+  // delays that give a terminal time to connect
+
+  START_MEMORY_MONITOR();
+
+  populateProcessList();
+
+  DISPLAY_MEMORY_MONITOR("Populate process list");
+
+  populateSensorList();
+
+  DISPLAY_MEMORY_MONITOR("Populate sensor list");
+
+  recordBootPhase("populate lists");
+
+  SettingsSetupStatus status = setupSettings();
+
+  recordBootPhase("setup settings");
+
+  if (!bootSettings.fastBoot)
+  {
+    delay(100);
+  }
 
   alwaysDisplayMessage("\n\n\n\n");
 
@@ -143,9 +304,26 @@ void startDevice()
   // it will be impossible to interact with the serial terminal
   // this lets you interrupt the start process and retail the serial connection if you are using a terminal
 
-  alwaysDisplayMessage("Press any key to force console mode.\n");
+  // The window closes as soon as a key arrives. Forcing the console only
+  // stops the robot taking over the serial port, so a fast boot doesn't
+  // open the window unless the robot is enabled.
+
+  if (bootSettings.fastBoot && !robotSettings.robotEnabled)
+  {
+    // only a key pressed while the device was resetting is seen
+    alwaysDisplayMessage("Fast boot - no wait for console mode.\n");
+  }
+  else
+  {
+    alwaysDisplayMessage("Press any key to force console mode.\n");
+
+    unsigned long windowStartMillis = millis();
 
-  delay(1000);
+    while (!Serial.available() && ulongDiff(millis(), windowStartMillis) < CONSOLE_FORCE_WINDOW_MILLIS)
+    {
+      delay(CONSOLE_FORCE_POLL_MILLIS);
+    }
+  }
 
   if(Serial.available()){
     forceConsole = true;
@@ -163,20 +341,8 @@ void startDevice()
   messageLogf("**** Debug output enabled");
 #endif
 
-  START_MEMORY_MONITOR();
-
-  populateProcessList();
-
-  DISPLAY_MEMORY_MONITOR("Populate process list");
-
-  populateSensorList();
-
-  DISPLAY_MEMORY_MONITOR("Populate sensor list");
-
   PixelStatusLevels settingsStatus;
 
-  SettingsSetupStatus status = setupSettings();
-
   switch (status)
   {
   case SETTINGS_SETUP_OK:
@@ -229,10 +395,17 @@ void startDevice()
 
   startstatusLedFlash(1000);
 
+  if (bootSettings.fastBoot)
+  {
+    beginDeferredStarts();
+  }
+
   initialiseAllProcesses();
 
   DISPLAY_MEMORY_MONITOR("Initialise all processes");
 
+  recordBootPhase("init processes");
+
   beginStatusDisplay(VERY_DARK_RED_COLOUR);
 
   addStatusItem(settingsStatus);
@@ -244,44 +417,36 @@ void startDevice()
 
   DISPLAY_MEMORY_MONITOR("Initialise all processes");
 
+  recordBootPhase("start processes");
+
   bindMessageHandler(displayControlMessage);
 
   startSensors();
 
   DISPLAY_MEMORY_MONITOR("Start all sensors");
 
+  recordBootPhase("start sensors");
+
   addStatusItem(PIXEL_STATUS_OK);
   renderStatusDisplay();
 
-  delay(1000); // show the status for a while
-  if (messagesSettings.messagesEnabled)
-  {
-    displayMessage("Start complete\n\nType help and press enter for help\n\n");
-  }
-}
+  // show the status for a while - the loop runs in the meantime
+  holdStatusDisplay(STATUS_DISPLAY_HOLD_MILLIS);
 
-#if defined(ARDUINO_ARCH_ESP8266) || defined(ARDUINO_ARCH_ESP32)
-uint32_t oldHeap = 0;
+#if defined(DUAL_CORE_LAYOUT)
+  startDualCoreTasks();
+#endif
 
-#define HEAP_PRINT_INTERVAL 500
+  startHeapMonitor();
+  startMetrics();
 
-void heapMonitor()
-{
-  unsigned long m = millis();
-  if ((m - heapPrintTime) > HEAP_PRINT_INTERVAL)
+  recordBootPhase("start complete");
+
+  if (messagesSettings.messagesEnabled)
   {
-    uint32_t newHeap = ESP.getFreeHeap();
-    if (newHeap != oldHeap)
-    {
-      Serial.print("Heap: ");
-      displayMessage("%lu",newHeap);
-      oldHeap = newHeap;
-    }
-    heapPrintTime = millis();
+    displayMessage("Start complete\n\nType help and press enter for help\n\n");
   }
 }
-#endif
-
 
 void setup()
 {
@@ -290,8 +455,17 @@ void setup()
 
 void loop()
 {
+  unsigned long passStartMicros = micros();
+
   updateSensors();
   updateProcesses();
-  delay(5);
+  performRealTimeHandoffs();
+  updateDeferredStarts();
+  dispatchBusMessages();
+  updateTimers();
+  updateSettingsSave();
+  LOOP_TRACE(traceLoop, "loop pass", passStartMicros);
+  countMetric(&metricLoopPasses);
+  sleepUntilNextDeadline();
   DISPLAY_MEMORY_MONITOR("System");
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include "messages.h"
 #include "processes.h"
 #include "robotProcess.h"
+#include "scheduler.h"
 
 struct MessagesSettings messagesSettings;
 
@@ -160,6 +161,8 @@ void startMessages()
 
 void updateMessages()
 {
+    // messages are sent when they are displayed so there is nothing to poll
+    scheduleProcessUpdate(&messagesProcess, SCHEDULER_IDLE_MILLIS);
 }
 
 void stopmessages()
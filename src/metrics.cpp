@@ -0,0 +1,197 @@
+#include <Arduino.h>
+
+#include "utils.h"
+#include "processes.h"
+#include "controller.h"
+#include "mqtt.h"
+#include "timerWheel.h"
+#include "metrics.h"
+
+uint16_t metricCommandBuckets[UPDATE_TIMING_NO_OF_BUCKETS];
+
+struct Metric metricMqttIn = {"mqtt.in", counterMetric};
+struct Metric metricMqttOut = {"mqtt.out", counterMetric};
+struct Metric metricMqttReconnects = {"mqtt.reconnects", counterMetric};
+struct Metric metricParseFailures = {"cmd.parsefail", counterMetric};
+struct Metric metricCommandMicros = {"cmd.us", histogramMetric, metricCommandBuckets};
+struct Metric metricLoopPasses = {"loop.passes", counterMetric};
+struct Metric metricLoopRate = {"loop.rate", gaugeMetric};
+struct Metric metricHeapFree = {"heap.free", gaugeMetric};
+struct Metric metricFramesRendered = {"frames.rendered", counterMetric};
+struct Metric metricFramesDropped = {"frames.dropped", counterMetric};
+
+struct Metric *allMetrics[] = {
+	&metricMqttIn,
+	&metricMqttOut,
+	&metricMqttReconnects,
+	&metricParseFailures,
+	&metricCommandMicros,
+	&metricLoopPasses,
+	&metricLoopRate,
+	&metricHeapFree,
+	&metricFramesRendered,
+	&metricFramesDropped};
+
+void setGaugeMetric(struct Metric *metric, unsigned long value)
+{
+	if (metric->count == 0 || value < metric->low)
+	{
+		metric->low = value;
+	}
+
+	if (value > metric->high)
+	{
+		metric->high = value;
+	}
+
+	metric->value = value;
+	metric->count++;
+}
+
+void recordHistogramMetric(struct Metric *metric, unsigned long micros)
+{
+	int bucket = updateTimingBucket(micros);
+
+	// halve the buckets when one fills up so they keep their shape
+	if (metric->buckets[bucket] == 0xFFFF)
+	{
+		for (int i = 0; i < UPDATE_TIMING_NO_OF_BUCKETS; i++)
+		{
+			metric->buckets[i] = metric->buckets[i] / 2;
+		}
+	}
+
+	metric->buckets[bucket]++;
+	metric->count++;
+
+	if (micros > metric->high)
+	{
+		metric->high = micros;
+	}
+}
+
+void iterateThroughMetrics(void (*func)(struct Metric *metric))
+{
+	for (unsigned int i = 0; i < sizeof(allMetrics) / sizeof(struct Metric *); i++)
+	{
+		func(allMetrics[i]);
+	}
+}
+
+void clearMetric(struct Metric *metric)
+{
+	metric->count = 0;
+	metric->value = 0;
+	metric->low = 0;
+	metric->high = 0;
+
+	if (metric->buckets != NULL)
+	{
+		memset(metric->buckets, 0, UPDATE_TIMING_NO_OF_BUCKETS * sizeof(uint16_t));
+	}
+}
+
+// the loop pass count when the loop rate was last worked out
+unsigned long loopPassesAtLastRate;
+
+void clearMetrics()
+{
+	iterateThroughMetrics(clearMetric);
+	// the pass count has gone back to zero
+	loopPassesAtLastRate = 0;
+}
+
+int appendMetricJson(struct Metric *metric, char *buffer, int bufferLength)
+{
+	int length = 0;
+
+	switch (metric->type)
+	{
+	case counterMetric:
+		length = snprintf(buffer, bufferLength, "\"%s\":%lu", metric->name, metric->count);
+		break;
+
+	case gaugeMetric:
+		length = snprintf(buffer, bufferLength, "\"%s\":[%lu,%lu,%lu]",
+						  metric->name, metric->value, metric->low, metric->high);
+		break;
+
+	case histogramMetric:
+		length = snprintf(buffer, bufferLength, "\"%s\":{\"n\":%lu,\"max\":%lu,\"hist\":[",
+						  metric->name, metric->count, metric->high);
+
+		for (int i = 0; i < UPDATE_TIMING_NO_OF_BUCKETS && length < bufferLength; i++)
+		{
+			length += snprintf(buffer + length, bufferLength - length, i == 0 ? "%u" : ",%u", metric->buckets[i]);
+		}
+
+		if (length < bufferLength)
+		{
+			length += snprintf(buffer + length, bufferLength - length, "]}");
+		}
+		break;
+	}
+
+	return length;
+}
+
+// Gauges are sent as [now,low,high] and histograms as the sample count,
+// the longest sample and the buckets, so the message fits in one MQTT
+// publish.
+
+void metricsJson(char *buffer, int bufferLength)
+{
+	int length = snprintf(buffer, bufferLength, "{\"stats\":{\"up\":%lu", millis() / 1000);
+
+	for (unsigned int i = 0; i < sizeof(allMetrics) / sizeof(struct Metric *) && length < bufferLength - 1; i++)
+	{
+		buffer[length++] = ',';
+		length += appendMetricJson(allMetrics[i], buffer + length, bufferLength - length);
+	}
+
+	if (length < bufferLength)
+	{
+		snprintf(buffer + length, bufferLength - length, "}}");
+	}
+}
+
+int publishMetrics()
+{
+	char buffer[METRICS_JSON_LENGTH];
+
+	metricsJson(buffer, METRICS_JSON_LENGTH);
+
+	return publishBufferToMQTT(buffer);
+}
+
+void metricsRateTimerFired(struct WheelTimer *timer)
+{
+	unsigned long passes = metricLoopPasses.count;
+
+	setGaugeMetric(&metricLoopRate, ((passes - loopPassesAtLastRate) * 1000UL) / METRICS_RATE_MILLIS);
+	loopPassesAtLastRate = passes;
+}
+
+void metricsPublishTimerFired(struct WheelTimer *timer)
+{
+	// a box without MQTT would flash an error each time
+	if (MQTTProcessDescriptor.status == MQTT_OK)
+	{
+		publishMetrics();
+	}
+}
+
+struct WheelTimer metricsRateTimer = {"metrics rate", metricsRateTimerFired};
+struct WheelTimer metricsPublishTimer = {"metrics publish", metricsPublishTimerFired};
+
+void startMetrics()
+{
+	loopPassesAtLastRate = metricLoopPasses.count;
+	scheduleTimer(&metricsRateTimer, METRICS_RATE_MILLIS, METRICS_RATE_MILLIS);
+
+	if (controllerSettings.metricsPublishSeconds > 0)
+	{
+		unsigned long publishMillis = controllerSettings.metricsPublishSeconds * 1000UL;
+		scheduleTimer(&metricsPublishTimer, publishMillis, publishMillis);
+	}
+}
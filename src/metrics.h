@@ -0,0 +1,82 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "updateTiming.h"
+
+// Counters, gauges and histograms that any module can update with a single
+// store. Every metric is a static struct declared in metrics.cpp, so the
+// names are interned there and the registry is just the list of them. The
+// values are not locked - an update from the other core can be lost now
+// and then, which doesn't matter for statistics.
+//
+// A counter counts up from zero. A gauge holds the last value it was set
+// to along with the lowest and highest values since the device started. A
+// histogram holds microsecond timings in the same buckets as the update
+// timings in updateTiming.h.
+//
+// The stats command sends all the metrics as one compact JSON object, and
+// the controller can publish it over MQTT every metricspublish seconds.
+
+enum MetricType
+{
+	counterMetric,
+	gaugeMetric,
+	histogramMetric
+};
+
+struct Metric
+{
+	const char *name;
+	enum MetricType type;
+	// UPDATE_TIMING_NO_OF_BUCKETS buckets for a histogram, NULL otherwise
+	uint16_t *buckets;
+	// counter total, or the number of gauge settings or histogram samples
+	unsigned long count;
+	unsigned long value;
+	unsigned long low;
+	// highest gauge value or longest histogram sample
+	unsigned long high;
+};
+
+extern struct Metric metricMqttIn;
+extern struct Metric metricMqttOut;
+extern struct Metric metricMqttReconnects;
+extern struct Metric metricParseFailures;
+extern struct Metric metricCommandMicros;
+extern struct Metric metricLoopPasses;
+extern struct Metric metricLoopRate;
+extern struct Metric metricHeapFree;
+extern struct Metric metricFramesRendered;
+extern struct Metric metricFramesDropped;
+
+#define METRICS_RATE_MILLIS 1000
+
+#define METRICS_JSON_LENGTH 500
+
+inline void countMetric(struct Metric *metric)
+{
+	metric->count++;
+}
+
+inline void addToMetric(struct Metric *metric, unsigned long amount)
+{
+	metric->count += amount;
+}
+
+void setGaugeMetric(struct Metric *metric, unsigned long value);
+
+void recordHistogramMetric(struct Metric *metric, unsigned long micros);
+
+void iterateThroughMetrics(void (*func)(struct Metric *metric));
+
+void clearMetrics();
+
+// writes {"stats":{...}} into the buffer
+void metricsJson(char *buffer, int bufferLength);
+
+// starts the loop rate timer and the periodic publish
+void startMetrics();
+
+// publishes the metrics to the MQTT publish topic
+int publishMetrics();
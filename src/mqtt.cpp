@@ -3,19 +3,27 @@
 #include "mqtt.h"
 #include "controller.h"
 #include "robotProcess.h"
+#include "commandQueue.h"
+#include "binaryCommand.h"
+#include "settingsArena.h"
+#include "processBus.h"
+#include "blockPool.h"
+#include "loopTracer.h"
+#include "metrics.h"
 
 #include <PubSubClient.h>
+#include <new>
 
 struct MqttSettings mqttSettings;
 
 void setDefaultMQTThost(void *dest)
 {
-	strcpy((char *)dest, DEFAULT_MQTT_HOST);
+	setDefaultArenaString(dest, DEFAULT_MQTT_HOST);
 }
 
 boolean validateMQTThost(void *dest, const char *newValueStr)
 {
-	return (validateString((char *)dest, newValueStr, SERVER_NAME_LENGTH));
+	return (validateArenaString(dest, newValueStr, SERVER_NAME_LENGTH));
 }
 
 void setDefaultMQTTport(void *dest)
@@ -26,52 +34,52 @@ void setDefaultMQTTport(void *dest)
 
 boolean validateMQTTtopic(void *dest, const char *newValueStr)
 {
-	return (validateString((char *)dest, newValueStr, MQTT_TOPIC_LENGTH));
+	return (validateArenaString(dest, newValueStr, MQTT_TOPIC_LENGTH));
 }
 
 boolean validateMQTTtopicPrefix(void *dest, const char *newValueStr)
 {
-	return (validateString((char *)dest, newValueStr, MQTT_TOPIC_PREFIX_LENGTH));
+	return (validateArenaString(dest, newValueStr, MQTT_TOPIC_PREFIX_LENGTH));
 }
 
 void setDefaultMQTTusername(void *dest)
 {
-	strcpy((char *)dest, DEFAULT_MQTT_USER);
+	setDefaultArenaString(dest, DEFAULT_MQTT_USER);
 }
 
 void setDefaultMQTTpwd(void *dest)
 {
-	strcpy((char *)dest, DEFAULT_MQTT_PWD);
+	setDefaultArenaString(dest, DEFAULT_MQTT_PWD);
 }
 
 boolean validateMQTTusername(void *dest, const char *newValueStr)
 {
-	return (validateString((char *)dest, newValueStr, MQTT_USER_NAME_LENGTH));
+	return (validateArenaString(dest, newValueStr, MQTT_USER_NAME_LENGTH));
 }
 
 boolean validateMQTTPWD(void *dest, const char *newValueStr)
 {
-	return (validateString((char *)dest, newValueStr, MQTT_PASSWORD_LENGTH));
+	return (validateArenaString(dest, newValueStr, MQTT_PASSWORD_LENGTH));
 }
 
 void setDefaultMQTTTopicPrefix(void *dest)
 {
-	snprintf((char *)dest, MQTT_TOPIC_LENGTH, "lb");
+	setDefaultArenaString(dest, "lb");
 }
 
 void setDefaultMQTTpublishTopic(void *dest)
 {
-	snprintf((char *)dest, MQTT_TOPIC_LENGTH, "data");
+	setDefaultArenaString(dest, "data");
 }
 
 void setDefaultMQTTsubscribeTopic(void *dest)
 {
-	snprintf((char *)dest, MQTT_TOPIC_LENGTH, "command");
+	setDefaultArenaString(dest, "command");
 }
 
 void setDefaultMQTTreportTopic(void *dest)
 {
-	snprintf((char *)dest, MQTT_TOPIC_LENGTH, "report");
+	setDefaultArenaString(dest, "report");
 }
 
 void setDefaultMQTTsecsPerUpdate(void *dest)
@@ -117,7 +125,7 @@ struct SettingItem mqttOnOffSetting = {
 	"MQTT Active (yes or no)", "mqttactive", &mqttSettings.mqtt_enabled, ONOFF_INPUT_LENGTH, yesNo, setTrue, validateYesNo};
 
 struct SettingItem mqttServerSetting = {
-	"MQTT Host", "mqtthost", mqttSettings.mqttServer, SERVER_NAME_LENGTH, text, setDefaultMQTThost, validateServerName};
+	"MQTT Host", "mqtthost", &mqttSettings.mqttServer, SERVER_NAME_LENGTH, arenaText, setDefaultMQTThost, validateMQTThost};
 
 struct SettingItem mqttPortSetting = {
 	"MQTT Port number", "mqttport", &mqttSettings.mqttPort, NUMBER_INPUT_LENGTH, integerValue, setDefaultMQTTport, validateInt};
@@ -126,22 +134,22 @@ struct SettingItem mqttSecureSocketsSetting = {
 	"MQTT Secure sockets active (yes or no)", "mqttsecure", &mqttSettings.mqttSecureSockets, YESNO_INPUT_LENGTH, yesNo, setFalse, validateYesNo};
 
 struct SettingItem mqttUserSetting = {
-	"MQTT UserName", "mqttuser", mqttSettings.mqttUser, MQTT_USER_NAME_LENGTH, text, setDefaultMQTTusername, validateMQTTusername};
+	"MQTT UserName", "mqttuser", &mqttSettings.mqttUser, MQTT_USER_NAME_LENGTH, arenaText, setDefaultMQTTusername, validateMQTTusername};
 
 struct SettingItem mqttPasswordSetting = {
-	"MQTT Password", "mqttpwd", mqttSettings.mqttPassword, MQTT_PASSWORD_LENGTH, password, setDefaultMQTTpwd, validateMQTTPWD};
+	"MQTT Password", "mqttpwd", &mqttSettings.mqttPassword, MQTT_PASSWORD_LENGTH, arenaPassword, setDefaultMQTTpwd, validateMQTTPWD};
 
 struct SettingItem mqttTopicPrefixSetting = {
-	"MQTT Topic prefix", "mqttpre", mqttSettings.mqttTopicPrefix, MQTT_TOPIC_PREFIX_LENGTH, text, setDefaultMQTTTopicPrefix, validateMQTTtopicPrefix};
+	"MQTT Topic prefix", "mqttpre", &mqttSettings.mqttTopicPrefix, MQTT_TOPIC_PREFIX_LENGTH, arenaText, setDefaultMQTTTopicPrefix, validateMQTTtopicPrefix};
 
 struct SettingItem mqttPublishTopicSetting = {
-	"MQTT Publish topic", "mqttpub", mqttSettings.mqttPublishTopic, MQTT_TOPIC_LENGTH, text, setDefaultMQTTpublishTopic, validateMQTTtopic};
+	"MQTT Publish topic", "mqttpub", &mqttSettings.mqttPublishTopic, MQTT_TOPIC_LENGTH, arenaText, setDefaultMQTTpublishTopic, validateMQTTtopic};
 
 struct SettingItem mqttSubscribeTopicSetting = {
-	"MQTT Subscribe topic", "mqttsub", mqttSettings.mqttSubscribeTopic, MQTT_TOPIC_LENGTH, text, setDefaultMQTTsubscribeTopic, validateMQTTtopic};
+	"MQTT Subscribe topic", "mqttsub", &mqttSettings.mqttSubscribeTopic, MQTT_TOPIC_LENGTH, arenaText, setDefaultMQTTsubscribeTopic, validateMQTTtopic};
 
 struct SettingItem mqttReportTopicSetting = {
-	"MQTT Reporting topic", "mqttreport", mqttSettings.mqttReportTopic, MQTT_TOPIC_LENGTH, text, setDefaultMQTTreportTopic, validateMQTTtopic};
+	"MQTT Reporting topic", "mqttreport", &mqttSettings.mqttReportTopic, MQTT_TOPIC_LENGTH, arenaText, setDefaultMQTTreportTopic, validateMQTTtopic};
 
 struct SettingItem mqttSecsPerUpdateSetting = {
 	"MQTT Seconds per update", "mqttsecsperupdate", &mqttSettings.mqttSecsPerUpdate, NUMBER_INPUT_LENGTH, integerValue, setDefaultMQTTsecsPerUpdate, validateInt};
@@ -175,6 +183,29 @@ unsigned long mqtt_timer_start;
 
 PubSubClient *mqttPubSubClient = NULL;
 
+// The clients are made once, when MQTT first connects, by which time the
+// network stack has made its own allocations. They are built in static
+// storage so that they don't sit in the middle of the heap.
+
+#define MQTT_NETWORK_CLIENT_SIZE \
+	(sizeof(WiFiClientSecure) > sizeof(WiFiClient) ? sizeof(WiFiClientSecure) : sizeof(WiFiClient))
+
+unsigned char mqttNetworkClientPoolStorage[BLOCK_POOL_STORAGE_SIZE(MQTT_NETWORK_CLIENT_SIZE, 1)] BLOCK_POOL_ALIGNED;
+
+struct BlockPool mqttNetworkClientPool = {
+	"mqtt network client",
+	mqttNetworkClientPoolStorage,
+	MQTT_NETWORK_CLIENT_SIZE,
+	1};
+
+unsigned char mqttPubSubClientPoolStorage[BLOCK_POOL_STORAGE_SIZE(sizeof(PubSubClient), 1)] BLOCK_POOL_ALIGNED;
+
+struct BlockPool mqttPubSubClientPool = {
+	"mqtt client",
+	mqttPubSubClientPoolStorage,
+	sizeof(PubSubClient),
+	1};
+
 #define MQTT_RECEIVE_BUFFER_SIZE 1000
 char mqtt_receive_buffer[MQTT_RECEIVE_BUFFER_SIZE];
 
@@ -192,13 +223,43 @@ void mqtt_deliver_command_result(char *result)
 	publishBufferToMQTT(result);
 }
 
+void clearIncomingMQTTMessage()
+{
+	mqtt_receive_buffer[0] = 0;
+}
+
+void actOnRobotMessage(const char *text, int length, void (*deliverResult)(char *resultText))
+{
+	sendMessageToRobot((char *)text);
+}
+
+// Binary (MessagePack) commands arrive on their own topic, which is the
+// subscribe topic with MQTT_BINARY_TOPIC_SUFFIX added to it
+
+boolean isBinaryCommandTopic(const char *topic)
+{
+	char topicBuffer[MQTT_TOPIC_PREFIX_LENGTH + MQTT_TOPIC_LENGTH];
+
+	snprintf(topicBuffer, MQTT_TOPIC_PREFIX_LENGTH + MQTT_TOPIC_LENGTH, "%s/%s%s/%s",
+			 mqttSettings.mqttTopicPrefix, mqttSettings.mqttSubscribeTopic, MQTT_BINARY_TOPIC_SUFFIX, mqttSettings.mqttDeviceName);
+
+	return strcasecmp(topic, topicBuffer) == 0;
+}
+
 // do not process incoming messages on this thread because it is a callback from the MQTT driver
-// that might fire from a network interrupt
+// that might fire from a network interrupt. Messages are put in the command queue and
+// performed when the controller is next updated.
 
 void callback(char *topic, byte *payload, unsigned int length)
 {
+	unsigned long startMicros = micros();
 	unsigned int i;
 
+	if (length >= MQTT_RECEIVE_BUFFER_SIZE)
+	{
+		length = MQTT_RECEIVE_BUFFER_SIZE - 1;
+	}
+
 	for (i = 0; i < length; i++)
 	{
 		mqtt_receive_buffer[i] = (char)payload[i];
@@ -208,40 +269,45 @@ void callback(char *topic, byte *payload, unsigned int length)
 	mqtt_receive_buffer[i] = 0;
 
 	messagesReceived++;
-}
+	countMetric(&metricMqttIn);
 
-void clearIncomingMQTTMessage()
-{
-	mqtt_receive_buffer[0] = 0;
-}
-
-bool receivedIncomingMQTTMessage()
-{
-	return mqtt_receive_buffer[0] != 0;
-}
+	bool queued;
 
-void handleIncomingMQTTMessage()
-{
-	if (receivedIncomingMQTTMessage())
+	if (isBinaryCommandTopic(topic))
+	{
+		displayMessage("Received binary from MQTT: %d bytes\n", length);
+		queued = enqueueCommand(mqtt_receive_buffer, length, normalCommand,
+								act_onBinary_message, mqtt_deliver_command_result);
+	}
+	else if ((mqtt_receive_buffer[0] == '*') && (mqtt_receive_buffer[1] == '*'))
+	{
+		queued = enqueueCommand(&mqtt_receive_buffer[2], length - 2, urgentCommand,
+								actOnRobotMessage, mqtt_deliver_command_result);
+	}
+	else
 	{
 		displayMessage("Received from MQTT: %s\n", mqtt_receive_buffer);
-		if((mqtt_receive_buffer[0]=='*') && (mqtt_receive_buffer[1]=='*')){
-			sendMessageToRobot(&mqtt_receive_buffer[2]);
-		}
-		else {
-			act_onJson_message(mqtt_receive_buffer, mqtt_deliver_command_result);
-		}
-		clearIncomingMQTTMessage();
+		queued = enqueueJsonCommand(mqtt_receive_buffer, mqtt_deliver_command_result);
 	}
+
+	if (!queued)
+	{
+		displayMessage("MQTT message dropped by the command queue\n");
+	}
+
+	clearIncomingMQTTMessage();
+
+	LOOP_TRACE(traceMQTT, "mqtt message", startMicros);
 }
 
 int mqttConnectErrorNumber;
-bool mqttStartCommandsPerformed ;
+
+// every connection after the first one is counted as a reconnect
+bool mqttHasConnected = false;
 
 void initMQTT()
 {
 	MQTTProcessDescriptor.status = MQTT_OFF;
-	mqttStartCommandsPerformed = false;
 }
 
 void startMQTT()
@@ -276,26 +342,56 @@ void restartMQTT()
 
 	if (mqttPubSubClient == NULL)
 	{
+		// the clients are built in the network client pool as the type that
+		// was made, and freed as that type if the second one can't be made
 		if (mqttSettings.mqttSecureSockets)
 		{
-			WiFiClientSecure *secureClient = new WiFiClientSecure();
+			WiFiClientSecure *secureClient = blockPoolNew<WiFiClientSecure>(&mqttNetworkClientPool);
+
+			if (secureClient != NULL)
+			{
 #if defined(ARDUINO_ARCH_ESP8266)
-			secureClient->setInsecure();
+				secureClient->setInsecure();
 #endif
-			mqttPubSubClient = new PubSubClient(*secureClient);
+				mqttPubSubClient = blockPoolNew<PubSubClient>(&mqttPubSubClientPool, *secureClient);
+
+				if (mqttPubSubClient == NULL)
+				{
+					blockPoolDelete(&mqttNetworkClientPool, secureClient);
+				}
+			}
 		}
 		else
 		{
-			WiFiClient *espClient = new WiFiClient();
-			mqttPubSubClient = new PubSubClient(*espClient);
+			WiFiClient *espClient = blockPoolNew<WiFiClient>(&mqttNetworkClientPool);
+
+			if (espClient != NULL)
+			{
+				mqttPubSubClient = blockPoolNew<PubSubClient>(&mqttPubSubClientPool, *espClient);
+
+				if (mqttPubSubClient == NULL)
+				{
+					blockPoolDelete(&mqttNetworkClientPool, espClient);
+				}
+			}
+		}
+
+		if (mqttPubSubClient == NULL)
+		{
+			displayMessage("No memory for the MQTT client\n");
+			MQTTProcessDescriptor.status = MQTT_ERROR_NO_MEMORY;
+			return;
 		}
 
 		mqttPubSubClient->setBufferSize(MQTT_BUFFER_SIZE_MAX);
 
-		mqttPubSubClient->setServer(mqttSettings.mqttServer, mqttSettings.mqttPort);
 		mqttPubSubClient->setCallback(callback);
 	}
 
+	// The client keeps a pointer to the server name, which is in the settings
+	// arena and can move when another setting changes, so set it each time.
+	mqttPubSubClient->setServer(mqttSettings.mqttServer, mqttSettings.mqttPort);
+
 	if (!mqttPubSubClient->connect(mqttSettings.mqttDeviceName, mqttSettings.mqttUser, mqttSettings.mqttPassword))
 	{
 		
@@ -352,6 +448,12 @@ void restartMQTT()
 
 	mqttPubSubClient->subscribe(topicBuffer);
 
+	snprintf(topicBuffer,MQTT_TOPIC_PREFIX_LENGTH+MQTT_TOPIC_LENGTH,"%s/%s%s/%s", mqttSettings.mqttTopicPrefix,mqttSettings.mqttSubscribeTopic,MQTT_BINARY_TOPIC_SUFFIX,mqttSettings.mqttDeviceName);
+
+	displayMessage("Subscribing to:%s\n", topicBuffer);
+
+	mqttPubSubClient->subscribe(topicBuffer);
+
 	//snprintf(mqtt_send_buffer, MQTT_SEND_BUFFER_SIZE,
 	//	"{\"dev\":\"%s\", \"status\":\"starting\"}",
 	//	mqttSettings.name);
@@ -365,7 +467,14 @@ void restartMQTT()
 
 	hardwareDisplayMessage(MQTT_STATUS_OK_MESSAGE_NUMBER, ledFlashNormalState, MQTT_STATUS_OK_MESSAGE_TEXT);
 
+	if (mqttHasConnected)
+	{
+		countMetric(&metricMqttReconnects);
+	}
+	mqttHasConnected = true;
+
 	MQTTProcessDescriptor.status = MQTT_OK;
+	publishBusStatus(busTopicMQTTStatus, MQTT_OK);
 }
 
 int mqttRetries = 0;
@@ -395,6 +504,7 @@ int publishBufferToMQTTTopic(char *buffer, char *topic)
 
 		if(result)
 		{
+			countMetric(&metricMqttOut);
 			displayMessage("\n");
 			hardwareDisplayMessage(MQTT_STATUS_TRANSMIT_OK_MESSAGE_NUMBER, ledFlashNormalState, MQTT_STATUS_TRANSMIT_OK_MESSAGE_TEXT);
 			return MQTT_STATUS_TRANSMIT_OK_MESSAGE_NUMBER;
@@ -443,8 +553,6 @@ unsigned long timeOfLastMQTTsuccess = 0;
 
 void updateMQTT()
 {
-	handleIncomingMQTTMessage();
-
 	switch (MQTTProcessDescriptor.status)
 	{
 
@@ -454,6 +562,7 @@ void updateMQTT()
 		{
 			MQTTProcessDescriptor.status = MQTT_ERROR_NO_WIFI;
 			mqttPubSubClient->disconnect();
+			publishBusStatus(busTopicMQTTStatus, MQTT_ERROR_NO_WIFI);
 		}
 
 		timeOfLastMQTTsuccess = millis();
@@ -462,12 +571,7 @@ void updateMQTT()
 		{
 			mqttPubSubClient->disconnect();
 			MQTTProcessDescriptor.status = MQTT_ERROR_LOOP_FAILED;
-		}
-
-		if(!mqttStartCommandsPerformed)
-		{
-			performCommandsInStore(MQTT_CONNECTED_COMMAND_STORE);
-			mqttStartCommandsPerformed = true;
+			publishBusStatus(busTopicMQTTStatus, MQTT_ERROR_LOOP_FAILED);
 		}
 
 		break;
@@ -504,6 +608,7 @@ void updateMQTT()
 	case MQTT_ERROR_CONNECT_ERROR:
 	case MQTT_ERROR_CONNECT_MESSAGE_FAILED:
 	case MQTT_ERROR_LOOP_FAILED:
+	case MQTT_ERROR_NO_MEMORY:
 		if (ulongDiff(millis(), timeOfLastMQTTsuccess) > MQTT_CONNECT_RETRY_INTERVAL_MSECS)
 		{
 			restartMQTT();
@@ -567,6 +672,9 @@ void mqttStatusMessage(char *buffer, int bufferLength)
 	case MQTT_ERROR_LOOP_FAILED:
 		snprintf(buffer, bufferLength, "MQTT error loop failed");
 		break;
+	case MQTT_ERROR_NO_MEMORY:
+		snprintf(buffer, bufferLength, "MQTT error no memory for the client");
+		break;
 	default:
 		snprintf(buffer, bufferLength, "MQTT failed but I'm not sure why: %d", MQTTProcessDescriptor.status);
 		break;
@@ -22,6 +22,7 @@
 #define MQTT_ERROR_CONNECT_MESSAGE_FAILED 711
 #define MQTT_ERROR_LOOP_FAILED 712
 #define MQTT_ERROR_NOT_CONFIGURED 713
+#define MQTT_ERROR_NO_MEMORY 714
 
 #define MQTT_CONNECT_RETRY_INTERVAL_MSECS 60000
 
@@ -32,6 +33,9 @@
 
 #define MQTT_NO_OF_RETRIES 3
 
+// added to the subscribe topic to give the topic for binary commands
+#define MQTT_BINARY_TOPIC_SUFFIX "bin"
+
 #define MQTT_STATUS_OK_MESSAGE_NUMBER 2
 #define MQTT_STATUS_OK_MESSAGE_TEXT "MQTT OK"
 
@@ -55,15 +59,16 @@
 struct MqttSettings
 {
 	char mqttDeviceName[DEVICE_NAME_LENGTH];
-	char mqttServer[SERVER_NAME_LENGTH];
+	// the strings are held in the settings arena
+	char *mqttServer;
 	boolean mqttSecureSockets;
 	int mqttPort;
-	char mqttUser[MQTT_USER_NAME_LENGTH];
-	char mqttPassword[MQTT_PASSWORD_LENGTH];
-	char mqttPublishTopic[MQTT_TOPIC_LENGTH];
-	char mqttSubscribeTopic[MQTT_TOPIC_LENGTH];
-	char mqttReportTopic[MQTT_TOPIC_LENGTH];
-	char mqttTopicPrefix[MQTT_TOPIC_PREFIX_LENGTH];
+	char *mqttUser;
+	char *mqttPassword;
+	char *mqttPublishTopic;
+	char *mqttSubscribeTopic;
+	char *mqttReportTopic;
+	char *mqttTopicPrefix;
 
 	int mqttSecsPerUpdate;
 	int seconds_per_mqtt_retry;
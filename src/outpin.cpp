@@ -119,7 +119,9 @@ struct CommandItem outpinStatusCommandItem = {
     OUTPIN_STATE_COMMAND_OFFSET,
     floatCommand,
     validateFloat0to1,
-    noDefaultAvailable};
+    noDefaultAvailable,
+    NULL,
+    validateFloat0to1CommandValue};
 
 // ************************************* Set pin state
 
@@ -174,22 +176,27 @@ int doSetOutPinCommand(char * destination, unsigned char * settingBase)
 
 // ************************************* Pulse pin state
 
-boolean validateOutpinPulseLen(void *dest, const char *newValueStr)
+boolean validateOutpinPulseLenValue(void *dest, float value)
 {
-	float value;
-
-	if (!validateFloat(&value, newValueStr))
+	if (value < 0 || value > OUTPIN_MAX_HOLD_TIME_SECS)
 	{
 		return false;
 	}
 
-	if (value < 0 || value > OUTPIN_MAX_HOLD_TIME_SECS)
+    putUnalignedFloat(value,(unsigned char *)dest);
+	return true;
+}
+
+boolean validateOutpinPulseLen(void *dest, const char *newValueStr)
+{
+	float value;
+
+	if (!validateFloat(&value, newValueStr))
 	{
 		return false;
 	}
 
-    putUnalignedFloat(value,(unsigned char *)dest);
-	return true;
+	return validateOutpinPulseLenValue(dest, value);
 }
 
 struct CommandItem outpinPulseLenCommandItem = {
@@ -198,7 +205,9 @@ struct CommandItem outpinPulseLenCommandItem = {
     OUTPIN_PULSE_LENGTH_OFFSET,
     floatCommand,
     validateOutpinPulseLen,
-    setDefaultFloatZero};
+    setDefaultFloatZero,
+    NULL,
+    validateOutpinPulseLenValue};
 
 struct CommandItem *pulseOutPinItems[] =
     {
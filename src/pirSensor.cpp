@@ -5,6 +5,7 @@
 #include "mqtt.h"
 #include "controller.h"
 #include "pixels.h"
+#include "inputEdges.h"
 
 struct PirSensorSettings pirSensorSettings;
 
@@ -58,51 +59,46 @@ struct sensorEventBinder PIRSensorListenerFunctions[] = {
 	{"triggered", PIRSENSOR_SEND_ON_TRIGGERED},
 	{"cleared", PIRSENSOR_SEND_ON_CLEAR}};
 
-void readPIRSensor(struct pirSensorReading *pirSensoractiveReading)
-{
+struct InputEdgeQueue pirEdges;
 
-	if (digitalRead(pirSensorSettings.pirSensorPinNo))
-	{
-		if (pirSensorSettings.pirSensorInputPinActiveHigh)
-		{
-			pirSensoractiveReading->triggered = true;
-		}
-		else
-		{
-			pirSensoractiveReading->triggered = false;
-		}
-	}
-	else
-	{
-		if (pirSensorSettings.pirSensorInputPinActiveHigh)
-		{
-			pirSensoractiveReading->triggered = false;
-		}
-		else
-		{
-			pirSensoractiveReading->triggered = true;
-		}
-	}
+void ICACHE_RAM_ATTR pirEdgeInterrupt()
+{
+	pushInputEdge(&pirEdges);
 }
 
-void updatePIRSensor()
+void startPirEdges()
 {
-	struct pirSensorReading *pirSensoractiveReading =
-		(struct pirSensorReading *)pirSensor.activeReading;
+	// the PIR output is clean, so it isn't debounced
+	startInputEdgeQueue(&pirEdges, "PIR", pirSensorSettings.pirSensorPinNo, INPUT,
+						PIR_INPUT_DEBOUNCE_MICROS, pirEdgeInterrupt);
+}
 
-	bool previousReading = pirSensoractiveReading->triggered;
+bool pirLevelTriggered(int level)
+{
+	if (level == HIGH)
+	{
+		return pirSensorSettings.pirSensorInputPinActiveHigh;
+	}
+	return !pirSensorSettings.pirSensorInputPinActiveHigh;
+}
 
-	readPIRSensor(pirSensoractiveReading);
+// applies the next change to the reading - returns false if there isn't one
 
-	pirSensor.millisAtLastReading = millis();
+bool readPIRSensor(struct pirSensorReading *pirSensoractiveReading)
+{
+	int level;
 
-	if (pirSensoractiveReading->triggered == previousReading)
+	if (!getInputEdgeChange(&pirEdges, micros(), &level))
 	{
-		// we have read the PIR but the value has not changed
-		// just return
-		return;
+		return false;
 	}
 
+	pirSensoractiveReading->triggered = pirLevelTriggered(level);
+	return true;
+}
+
+void firePIRSensorListeners(struct pirSensorReading *pirSensoractiveReading)
+{
 	sensorListener *pos = pirSensor.listeners;
 
 	while (pos != NULL)
@@ -123,7 +119,7 @@ void updatePIRSensor()
 				snprintf(messageBuffer, MAX_MESSAGE_LENGTH, "clear");
 			}
 
-			pos->receiveMessage(config->destination, config->optionBuffer);
+			fireSensorListener(pos);
 			pos->lastReadingMillis = pirSensor.millisAtLastReading;
 			pos = pos->nextMessageListener;
 			continue;
@@ -133,7 +129,7 @@ void updatePIRSensor()
 		{
 			if (pirSensoractiveReading->triggered)
 			{
-				pos->receiveMessage(config->destination, config->optionBuffer);
+				fireSensorListener(pos);
 				pos->lastReadingMillis = pirSensor.millisAtLastReading;
 				pos = pos->nextMessageListener;
 				continue;
@@ -144,7 +140,7 @@ void updatePIRSensor()
 		{
 			if (!pirSensoractiveReading->triggered)
 			{
-				pos->receiveMessage(config->destination, config->optionBuffer);
+				fireSensorListener(pos);
 				pos->lastReadingMillis = pirSensor.millisAtLastReading;
 				pos = pos->nextMessageListener;
 				continue;
@@ -154,17 +150,30 @@ void updatePIRSensor()
 	}
 }
 
+void updatePIRSensor()
+{
+	struct pirSensorReading *pirSensoractiveReading =
+		(struct pirSensorReading *)pirSensor.activeReading;
+
+	pirSensor.millisAtLastReading = millis();
+
+	// a trigger that comes and goes between two updates comes out as two changes
+	while (readPIRSensor(pirSensoractiveReading))
+	{
+		firePIRSensorListeners(pirSensoractiveReading);
+	}
+}
+
 void pirSensorTest()
 {
 	struct pirSensorReading *pirSensoractiveReading =
 		(struct pirSensorReading *)pirSensor.activeReading;
 
-	pinMode(pirSensorSettings.pirSensorPinNo, INPUT);
+	startPirEdges();
 
 	displayMessage("PIR Sensor test\nPress the ESC key to end the test");
 
 	int count = 0;
-	bool triggered = false;
 
 	while (true)
 	{
@@ -176,21 +185,14 @@ void pirSensorTest()
 				break;
 			}
 		}
-		readPIRSensor(pirSensoractiveReading);
-
-		if (pirSensoractiveReading->triggered)
+		while (readPIRSensor(pirSensoractiveReading))
 		{
-			if (triggered == false)
+			if (pirSensoractiveReading->triggered)
 			{
 				count++;
 				displayMessage("    triggered: %d\n", count);
-				triggered = true;
 			}
 		}
-		else
-		{
-			triggered = false;
-		}
 		delay(100);
 	}
 
@@ -201,7 +203,7 @@ void startPirSensor()
 {
 	if (pirSensor.activeReading == NULL)
 	{
-		pirSensor.activeReading = new pirSensorReading();
+		pirSensor.activeReading = allocateSensorReading(sizeof(struct pirSensorReading));
 	}
 
 	if (!pirSensorSettings.pirSensorFitted)
@@ -210,7 +212,13 @@ void startPirSensor()
 	}
 	else
 	{
-		pinMode(pirSensorSettings.pirSensorPinNo, INPUT);
+		startPirEdges();
+
+		struct pirSensorReading *pirSensoractiveReading =
+			(struct pirSensorReading *)pirSensor.activeReading;
+
+		pirSensoractiveReading->triggered = pirLevelTriggered(pirEdges.level);
+
 		pirSensor.status = SENSOR_OK;
 	}
 }
@@ -12,6 +12,9 @@
 #include "Leds.h"
 #include "Sprite.h"
 #include "boot.h"
+#include "scheduler.h"
+#include "metrics.h"
+#include "timerWheel.h"
 
 // Some of the colours have been commented out because they don't render well
 // on NeoPixels
@@ -297,7 +300,9 @@ struct CommandItem redCommandItem = {
 	RED_PIXEL_COMMAND_OFFSET,
 	floatCommand,
 	validateFloat0to1,
-	noDefaultAvailable};
+	noDefaultAvailable,
+	NULL,
+	validateFloat0to1CommandValue};
 
 struct CommandItem blueCommandItem = {
 	"blue",
@@ -305,7 +310,9 @@ struct CommandItem blueCommandItem = {
 	BLUE_PIXEL_COMMAND_OFFSET,
 	floatCommand,
 	validateFloat0to1,
-	noDefaultAvailable};
+	noDefaultAvailable,
+	NULL,
+	validateFloat0to1CommandValue};
 
 struct CommandItem greenCommandItem = {
 	"green",
@@ -313,7 +320,9 @@ struct CommandItem greenCommandItem = {
 	GREEN_PIXEL_COMMAND_OFFSET,
 	floatCommand,
 	validateFloat0to1,
-	noDefaultAvailable};
+	noDefaultAvailable,
+	NULL,
+	validateFloat0to1CommandValue};
 
 boolean setDefaultPixelTimeout(void *dest)
 {
@@ -322,22 +331,27 @@ boolean setDefaultPixelTimeout(void *dest)
 	return true;
 }
 
-boolean validatePixelTimeout(void *dest, const char *newValueStr)
+boolean validatePixelTimeoutValue(void *dest, int value)
 {
-	int value;
-
-	if (!validateInt(&value, newValueStr))
+	if (value < 0 || value > 300)
 	{
 		return false;
 	}
 
-	if (value < 0 || value > 300)
+	putUnalignedInt(value, (unsigned char *)dest);
+	return true;
+}
+
+boolean validatePixelTimeout(void *dest, const char *newValueStr)
+{
+	int value;
+
+	if (!validateInt(&value, newValueStr))
 	{
 		return false;
 	}
 
-	*(int *)dest = value;
-	return true;
+	return validatePixelTimeoutValue(dest, value);
 }
 
 struct CommandItem pixelTimeoutCommandItem = {
@@ -346,7 +360,9 @@ struct CommandItem pixelTimeoutCommandItem = {
 	COMMAND_PIXEL_TIMEOUT_OFFSET,
 	integerCommand,
 	validatePixelTimeout,
-	setDefaultPixelTimeout};
+	setDefaultPixelTimeout,
+	validatePixelTimeoutValue,
+	NULL};
 
 boolean setDefaultPixelChangeSteps(void *dest)
 {
@@ -361,7 +377,9 @@ struct CommandItem pixelChangeStepsCommandItem = {
 	SPEED_PIXEL_COMMAND_OFFSET,
 	integerCommand,
 	validateInt,
-	setDefaultPixelChangeSteps};
+	setDefaultPixelChangeSteps,
+	validateIntCommandValue,
+	NULL};
 
 struct CommandItem pixelCommandName = {
 	"pixelCommand",
@@ -401,7 +419,9 @@ struct CommandItem floatValueItem = {
 	FLOAT_VALUE_OFFSET,
 	floatCommand,
 	validateFloat0to1,
-	noDefaultAvailable};
+	noDefaultAvailable,
+	NULL,
+	validateFloat0to1CommandValue};
 
 char *pixelDisplaySelections[] = {"walking", "mask"};
 
@@ -1038,6 +1058,25 @@ void addStatusItem(PixelStatusLevels status)
 	return;
 }
 
+// The hold is ended by a timer on the loop, and the pixels can be updated
+// from the real time task, so the pixels look at the flag rather than
+// being woken by the timer
+
+volatile bool statusDisplayHeld = false;
+
+void endStatusDisplayHold(struct WheelTimer *timer)
+{
+	statusDisplayHeld = false;
+}
+
+struct WheelTimer statusDisplayHoldTimer = {"status display", endStatusDisplayHold};
+
+void holdStatusDisplay(unsigned long holdMillis)
+{
+	statusDisplayHeld = true;
+	scheduleTimer(&statusDisplayHoldTimer, holdMillis);
+}
+
 void initPixel()
 {
 	pixelProcess.status = PIXEL_OFF;
@@ -1080,16 +1119,49 @@ void startPixel()
 void showDeviceStatus();	   // declared in control.h
 boolean getInputSwitchValue(); // declared in inputswitch.h
 
+bool pixelFrameShown = false;
+
 void updateFrame()
 {
 	unsigned long currentMillis = millis();
+
+	if (statusDisplayHeld)
+	{
+		// the frame starts from where it is when the hold ends
+		millisOfLastPixelUpdate = currentMillis;
+		scheduleProcessUpdate(&pixelProcess, MILLIS_BETWEEN_UPDATES);
+		return;
+	}
+
 	unsigned long millisSinceLastUpdate = ulongDiff(currentMillis, millisOfLastPixelUpdate);
 
 	if (millisSinceLastUpdate >= MILLIS_BETWEEN_UPDATES)
 	{
 		frame->update();
 		frame->render();
+		countMetric(&metricFramesRendered);
+
+		// a late update skips the frames it should have shown - the wait
+		// for the first frame includes the rest of the boot so isn't counted
+		if (pixelFrameShown && millisSinceLastUpdate >= 2 * MILLIS_BETWEEN_UPDATES)
+		{
+			addToMetric(&metricFramesDropped, millisSinceLastUpdate / MILLIS_BETWEEN_UPDATES - 1);
+		}
+
 		millisOfLastPixelUpdate = currentMillis;
+		pixelFrameShown = true;
+	}
+
+	// wake up for the next frame
+	millisSinceLastUpdate = ulongDiff(millis(), millisOfLastPixelUpdate);
+
+	if (millisSinceLastUpdate >= MILLIS_BETWEEN_UPDATES)
+	{
+		scheduleProcessUpdate(&pixelProcess, 0);
+	}
+	else
+	{
+		scheduleProcessUpdate(&pixelProcess, MILLIS_BETWEEN_UPDATES - millisSinceLastUpdate);
 	}
 }
 
@@ -1098,6 +1170,7 @@ void updatePixel()
 	switch (pixelProcess.status)
 	{
 	case PIXEL_NO_PIXELS:
+		scheduleProcessUpdate(&pixelProcess, SCHEDULER_IDLE_MILLIS);
 		return;
 	case PIXEL_OK:
 		updateFrame();
@@ -40,6 +40,9 @@ enum PixelStatusLevels
 void addStatusItem(PixelStatusLevels status);
 void beginStatusDisplay(Colour colour);
 void renderStatusDisplay();
+// keeps the status display on the pixels for a while once the frame has
+// started, without holding up the loop
+void holdStatusDisplay(unsigned long holdMillis);
 void setupWalkingColour(Colour colour);
 
 void pixelStatusMessage(struct process * pixelProcess, char * buffer, int bufferLength);
@@ -6,6 +6,7 @@
 #include "controller.h"
 #include "pixels.h"
 #include "buttonsensor.h"
+#include "sensorHistory.h"
 
 struct PotSensorSettings potSensorSettings;
 
@@ -63,13 +64,22 @@ struct SettingItem PotSensorDeadZone = {
 	setDefaultPotDeadZone,
 	validateInt};
 
+struct SettingItem potSensorHistorySetting = {
+	"Pot sensor keeps a history (yes or no)",
+	"potsensorhistory",
+	&potSensorSettings.potSensorHistory,
+	ONOFF_INPUT_LENGTH,
+	yesNo,
+	setFalse,
+	validateYesNo};
 
 struct SettingItem *potSensorSettingItemPointers[] =
 	{
 		&PotSensorInputPinNoSetting,
 		&potSensorFittedSetting,
 		&PotSensorMillisBetweenReadings,
-		&PotSensorDeadZone
+		&PotSensorDeadZone,
+		&potSensorHistorySetting
 	};
 
 struct SettingItemCollection potSensorSettingItems = {
@@ -109,6 +119,9 @@ void updatePOTSensor()
 
 	readPOTSensor(potSensoractiveReading);
 
+	// the history gets every reading, not just the ones outside the dead zone
+	recordSensorHistory(&potSensor, potSensoractiveReading->counter);
+
 	int readingChange = potSensoractiveReading->counter - potSensoractiveReading->previousPotReading;
 
 	if(readingChange < 0)
@@ -146,7 +159,7 @@ void updatePOTSensor()
 			char *messageBuffer = (char *)pos->config->optionBuffer + MESSAGE_START_POSITION;
 			snprintf(messageBuffer, MAX_MESSAGE_LENGTH, "%.2f", resultValue);
 
-			pos->receiveMessage(pos->config->destination, pos->config->optionBuffer);
+			fireSensorListener(pos);
 			pos->lastReadingMillis = buttonSensor.millisAtLastReading;
 			// move on to the next one
 			pos = pos->nextMessageListener;
@@ -191,7 +204,7 @@ void startPotSensor()
 {
 	if (potSensor.activeReading == NULL)
 	{
-		potSensor.activeReading = new potSensorReading();
+		potSensor.activeReading = allocateSensorReading(sizeof(struct potSensorReading));
 	}
 
 	struct potSensorReading *potSensoractiveReading =
@@ -206,6 +219,11 @@ void startPotSensor()
 		potSensoractiveReading->previousPotReading = -potSensorSettings.potDeadZone;
 		potSensor.millisAtLastReading = millis() - potSensorSettings.millisBetweenReadings;
 		potSensor.status = SENSOR_OK;
+
+		if (potSensorSettings.potSensorHistory)
+		{
+			startSensorHistory(&potSensor);
+		}
 	}
 }
 
@@ -20,6 +20,7 @@ struct PotSensorSettings {
 	bool potSensorFitted;
 	int millisBetweenReadings;
 	int potDeadZone;
+	bool potSensorHistory;
 };
 
 extern struct PotSensorSettings potSensorSettings;
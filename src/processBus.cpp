@@ -0,0 +1,157 @@
+#include <Arduino.h>
+
+#include "debug.h"
+#include "utils.h"
+#include "scheduler.h"
+#include "spscQueue.h"
+#include "processBus.h"
+
+struct BusStats busStats;
+
+struct BusMessage
+{
+	unsigned char topic;
+	unsigned char size;
+	// words keep the message aligned for the listeners
+	uint32_t body[(BUS_MAX_MESSAGE_SIZE + 3) / 4];
+};
+
+struct processMessageListener *busTopicListeners[BUS_NO_OF_TOPICS];
+
+unsigned char busQueueSlots[BUS_QUEUE_SLOTS * sizeof(struct BusMessage)];
+
+struct SpscQueue busQueue;
+
+bool busQueueSetup = false;
+
+void setupBusQueue()
+{
+	if (!busQueueSetup)
+	{
+		spscQueueInit(&busQueue, busQueueSlots, sizeof(struct BusMessage), BUS_QUEUE_SLOTS);
+		busQueueSetup = true;
+	}
+}
+
+void subscribeToBusTopic(struct processMessageListener *listener, BusTopic topic)
+{
+	listener->topic = topic;
+	listener->nextMessageListener = NULL;
+
+	if (busTopicListeners[topic] == NULL)
+	{
+		busTopicListeners[topic] = listener;
+		return;
+	}
+
+	struct processMessageListener *addPos = busTopicListeners[topic];
+
+	while (addPos->nextMessageListener != NULL)
+	{
+		addPos = addPos->nextMessageListener;
+	}
+
+	addPos->nextMessageListener = listener;
+}
+
+void unsubscribeFromBusTopic(struct processMessageListener *listener)
+{
+	struct processMessageListener **pos = &busTopicListeners[listener->topic];
+
+	while (*pos != NULL)
+	{
+		if (*pos == listener)
+		{
+			*pos = listener->nextMessageListener;
+			listener->nextMessageListener = NULL;
+			return;
+		}
+		pos = &(*pos)->nextMessageListener;
+	}
+}
+
+bool publishBusMessage(BusTopic topic, const void *message, int size)
+{
+	if (size > BUS_MAX_MESSAGE_SIZE)
+	{
+		TRACELOGLN("Bus message too big");
+		return false;
+	}
+
+	// nothing to do if no one is listening
+	if (busTopicListeners[topic] == NULL)
+	{
+		return true;
+	}
+
+	setupBusQueue();
+
+	struct BusMessage busMessage;
+
+	busMessage.topic = topic;
+	busMessage.size = size;
+	memcpy(busMessage.body, message, size);
+
+	if (!spscQueuePush(&busQueue, &busMessage))
+	{
+		busStats.dropped++;
+		return false;
+	}
+
+	busStats.published++;
+
+	unsigned int depth = spscQueueDepth(&busQueue);
+
+	if (depth > busStats.maxDepth)
+	{
+		busStats.maxDepth = depth;
+	}
+
+	requestSchedulerWake();
+
+	return true;
+}
+
+void publishBusStatus(BusTopic topic, int status)
+{
+	struct BusStatusMessage message = {status};
+
+	publishBusMessage(topic, &message, sizeof(struct BusStatusMessage));
+}
+
+void dispatchBusMessages()
+{
+	if (!busQueueSetup)
+	{
+		return;
+	}
+
+	// messages published by the listeners wait for the next pass
+	unsigned int count = spscQueueDepth(&busQueue);
+
+	struct BusMessage busMessage;
+
+	while (count > 0 && spscQueuePop(&busQueue, &busMessage))
+	{
+		struct processMessageListener *listener = busTopicListeners[busMessage.topic];
+
+		while (listener != NULL)
+		{
+			listener->processMessage(listener, busMessage.body);
+			busStats.delivered++;
+			listener = listener->nextMessageListener;
+		}
+
+		count--;
+	}
+}
+
+void busStatusMessage(char *buffer, int bufferLength)
+{
+	snprintf(buffer, bufferLength, "published:%lu delivered:%lu dropped:%lu max depth:%u of %d",
+			 busStats.published,
+			 busStats.delivered,
+			 busStats.dropped,
+			 busStats.maxDepth,
+			 BUS_QUEUE_SLOTS);
+}
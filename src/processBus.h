@@ -0,0 +1,59 @@
+#pragma once
+
+#include "processes.h"
+
+// Processes can pass small typed messages to each other without building
+// and parsing JSON commands. A message is published on a topic and copied
+// into a bounded queue. The loop dispatches each queued message to the
+// listeners subscribed to its topic, which are all given a pointer to the
+// same copy of the message, in the order they subscribed.
+//
+// Messages are published and dispatched by the main loop only, as the
+// queue has a single producer. A message published while the queue is full
+// is dropped and counted. A listener must not subscribe or unsubscribe
+// while a message is being dispatched to it.
+//
+// The controller listens to the WiFi and MQTT status topics and performs
+// the command stores for connecting and disconnecting.
+
+enum BusTopic
+{
+	busTopicWiFiStatus,
+	busTopicMQTTStatus,
+	busTopicBenchmark,
+	BUS_NO_OF_TOPICS
+};
+
+// must be a power of two
+#define BUS_QUEUE_SLOTS 16
+
+#define BUS_MAX_MESSAGE_SIZE 16
+
+// the message for the WiFi and MQTT status topics - the new process status
+struct BusStatusMessage
+{
+	int status;
+};
+
+struct BusStats
+{
+	unsigned long published;
+	unsigned long delivered;
+	unsigned long dropped;
+	unsigned int maxDepth;
+};
+
+extern struct BusStats busStats;
+
+void subscribeToBusTopic(struct processMessageListener *listener, BusTopic topic);
+void unsubscribeFromBusTopic(struct processMessageListener *listener);
+
+// returns false if the message is too big or the queue is full
+bool publishBusMessage(BusTopic topic, const void *message, int size);
+
+void publishBusStatus(BusTopic topic, int status);
+
+// called from the loop
+void dispatchBusMessages();
+
+void busStatusMessage(char *buffer, int bufferLength);
@@ -6,6 +6,9 @@
 #include "pixels.h"
 #include "utils.h"
 #include "messages.h"
+#include "scheduler.h"
+#include "dualCore.h"
+#include "loopTracer.h"
 
 #define STATUS_DESCRIPTION_LENGTH 200
 
@@ -13,6 +16,10 @@ struct process *activeProcessList = NULL;
 
 struct process *allProcessList = NULL;
 
+// the low priority process to look at first on the next pass on each core -
+// cleared whenever the active list changes
+struct process *nextLowPriorityProcess[2] = {NULL, NULL};
+
 struct process * getAllProcessList(){
 	return allProcessList;
 }
@@ -35,11 +42,15 @@ void addProcessToAllProcessList(struct process *newProcess)
 		}
 		addPos->nextAllProcesses = newProcess;
 	}
+
+	invalidateSettingIndex();
 }
 
 void addProcessToActiveProcessList(struct process *newProcess)
 {
 	newProcess->nextActiveProcess = NULL;
+	nextLowPriorityProcess[0] = NULL;
+	nextLowPriorityProcess[1] = NULL;
 
 	if (activeProcessList == NULL)
 	{
@@ -60,6 +71,8 @@ void addProcessToActiveProcessList(struct process *newProcess)
 void buildActiveProcessListFromMask(int processMask)
 {
 	activeProcessList = NULL;
+	nextLowPriorityProcess[0] = NULL;
+	nextLowPriorityProcess[1] = NULL;
 
 	struct process *processPtr = allProcessList;
 
@@ -88,6 +101,43 @@ struct process *findProcessByName(const char *name)
 	return NULL;
 }
 
+// Process IDs are the position of the process in the list of all processes.
+// The list is built in the same order on every boot of a given build, so the
+// IDs can be used in binary commands in place of process names.
+
+struct process *findProcessByID(int id)
+{
+	struct process *procPtr = allProcessList;
+
+	while (procPtr != NULL)
+	{
+		if (id == 0)
+		{
+			return procPtr;
+		}
+		id--;
+		procPtr = procPtr->nextAllProcesses;
+	}
+	return NULL;
+}
+
+int getProcessID(struct process *proc)
+{
+	struct process *procPtr = allProcessList;
+	int id = 0;
+
+	while (procPtr != NULL)
+	{
+		if (procPtr == proc)
+		{
+			return id;
+		}
+		id++;
+		procPtr = procPtr->nextAllProcesses;
+	}
+	return -1;
+}
+
 struct process *findActiveProcessByName(const char *name)
 {
 	struct process *procPtr = activeProcessList;
@@ -128,6 +178,7 @@ char processStatusBuffer[PROCESS_STATUS_BUFFER_SIZE];
 void startProcess(process *proc)
 {
 	alwaysDisplayMessage("   %s: ", proc->processName);
+	startProcessSchedule(proc);
 	proc->startProcess();
 	proc->getStatusMessage(processStatusBuffer, PROCESS_STATUS_BUFFER_SIZE);
 	alwaysDisplayMessage(" %s\n", processStatusBuffer);
@@ -142,6 +193,7 @@ struct process *startProcessByName(char *name)
 	{
 		if (!targetProcess->beingUpdated)
 		{
+			startProcessSchedule(targetProcess);
 			targetProcess->startProcess();
 			targetProcess->beingUpdated = true;
 		}
@@ -159,8 +211,11 @@ void initialiseAllProcesses()
 	while (procPtr != NULL)
 	{
 		// messageLogf("   initilising: %s\n", procPtr->processName);
-		procPtr->initProcess();
-		DISPLAY_MEMORY_MONITOR(procPtr->processName);
+		if (!procPtr->startPending)
+		{
+			procPtr->initProcess();
+			DISPLAY_MEMORY_MONITOR(procPtr->processName);
+		}
 		procPtr = procPtr->nextAllProcesses;
 	}
 }
@@ -173,31 +228,251 @@ void startProcesses()
 
 	while (procPtr != NULL)
 	{
-		if (procPtr->beingUpdated)
+		// only start processes that aren't active or waiting for a deferred start
+		if (!procPtr->beingUpdated && !procPtr->startPending)
 		{
-			// only start processes that aren't active
-			continue;
+			startProcess(procPtr);
 		}
-		startProcess(procPtr);
 		procPtr = procPtr->nextActiveProcess;
 	}
 }
 
-void updateProcesses()
+bool processStartsAreDeferred = false;
+
+void setProcessDeferredStart(struct process *proc)
+{
+	proc->deferStart = true;
+}
+
+void deferProcessStarts()
+{
+	struct process *procPtr = allProcessList;
+
+	while (procPtr != NULL)
+	{
+		if (procPtr->deferStart)
+		{
+			procPtr->startPending = true;
+		}
+		procPtr = procPtr->nextAllProcesses;
+	}
+
+	processStartsAreDeferred = true;
+}
+
+bool processStartsDeferred()
+{
+	return processStartsAreDeferred;
+}
+
+void startDeferredProcess(struct process *proc)
+{
+	if (!proc->startPending)
+	{
+		return;
+	}
+
+	proc->startPending = false;
+	proc->initProcess();
+
+	if (findActiveProcessByName(proc->processName) != NULL)
+	{
+		startProcess(proc);
+	}
+}
+
+void startDeferredProcesses()
+{
+	alwaysDisplayMessage("Starting deferred processes\n");
+
+	struct process *procPtr = allProcessList;
+
+	while (procPtr != NULL)
+	{
+		startDeferredProcess(procPtr);
+		procPtr = procPtr->nextAllProcesses;
+	}
+
+	processStartsAreDeferred = false;
+}
+
+void setProcessPriority(struct process *proc, ProcessPriority priority, unsigned long updateBudgetMicros)
+{
+	proc->priority = priority;
+	proc->updateBudgetMicros = updateBudgetMicros;
+}
+
+void setProcessCore(struct process *proc, ProcessCore core)
+{
+	proc->core = core;
+}
+
+// With the dual core layout each core updates its own processes. Only the
+// main loop uses the scheduler, so the real time core doesn't record its
+// deadlines there.
+
+#define PROCESS_ANY_CORE -1
+
+bool processOnCore(struct process *procPtr, int core)
+{
+	// a process waiting for a deferred start isn't updated
+	if (procPtr->startPending)
+	{
+		return false;
+	}
+
+	return core == PROCESS_ANY_CORE || (int)procPtr->core == core;
+}
+
+void runProcessUpdate(struct process *procPtr, bool useScheduler)
+{
+	if (useScheduler)
+	{
+		schedulerRecordUpdate(procPtr->processName, procPtr->updateScheduled, procPtr->nextUpdateMillis, millis());
+	}
+
+	procPtr->updateScheduled = false;
+	unsigned long startMicros = micros();
+	procPtr->udpateProcess();
+	procPtr->activeTime = ulongDiff(micros(), startMicros);
+	LOOP_TRACE(traceProcess, procPtr->processName, startMicros);
+	procPtr->totalTime = procPtr->totalTime + procPtr->activeTime/1000;
+	recordUpdateTiming(&procPtr->updateTiming, procPtr->processName, procPtr->activeTime, procPtr->updateBudgetMicros);
+	DISPLAY_MEMORY_MONITOR(procPtr->processName);
+
+	if (!procPtr->updateScheduled)
+	{
+		scheduleProcessUpdate(procPtr, SCHEDULER_DEFAULT_POLL_MILLIS);
+	}
+}
+
+void updateProcessesWithPriority(ProcessPriority priority, int core, unsigned long passMillis)
 {
 	struct process *procPtr = activeProcessList;
+	bool useScheduler = core != realTimeCore;
 
 	while (procPtr != NULL)
 	{
-		unsigned long startMicros = micros();
-		procPtr->udpateProcess();
-		procPtr->activeTime = ulongDiff(micros(), startMicros);
-		procPtr->totalTime = procPtr->totalTime + procPtr->activeTime/1000;
-		DISPLAY_MEMORY_MONITOR(procPtr->processName);
+		if (procPtr->priority == priority && processOnCore(procPtr, core))
+		{
+			if (schedulerItemDue(procPtr->nextUpdateMillis, passMillis))
+			{
+				runProcessUpdate(procPtr, useScheduler);
+			}
+			if (useScheduler)
+			{
+				schedulerNoteDeadline(procPtr->nextUpdateMillis);
+			}
+		}
 		procPtr = procPtr->nextActiveProcess;
 	}
 }
 
+unsigned long lowPriorityProcessesDeferred = 0;
+
+// Low priority processes are taken in turn, starting after the last one that
+// was updated. Once the pass budget is used the rest wait for the next pass.
+// At least one is updated on every pass so they always make progress.
+
+void updateLowPriorityProcesses(int core, unsigned long passMillis)
+{
+	// each core works through its own low priority processes
+	struct process **nextProcess = &nextLowPriorityProcess[core == realTimeCore ? 1 : 0];
+	bool useScheduler = core != realTimeCore;
+
+	if (*nextProcess == NULL)
+	{
+		*nextProcess = activeProcessList;
+	}
+
+	struct process *firstProcess = *nextProcess;
+
+	if (firstProcess == NULL)
+	{
+		return;
+	}
+
+	struct process *procPtr = firstProcess;
+	struct process *lastUpdated = NULL;
+
+	unsigned long startMicros = micros();
+	bool budgetUsed = false;
+
+	do
+	{
+		if (procPtr->priority == lowPriorityProcess && processOnCore(procPtr, core))
+		{
+			if (!budgetUsed && schedulerItemDue(procPtr->nextUpdateMillis, passMillis))
+			{
+				unsigned long expectedMicros = procPtr->updateBudgetMicros;
+
+				if (expectedMicros == 0)
+				{
+					expectedMicros = procPtr->activeTime;
+				}
+
+				if (lastUpdated != NULL &&
+					ulongDiff(micros(), startMicros) + expectedMicros > PROCESS_LOW_PRIORITY_PASS_BUDGET_MICROS)
+				{
+					// start with this one next time
+					budgetUsed = true;
+					*nextProcess = procPtr;
+					lowPriorityProcessesDeferred++;
+				}
+				else
+				{
+					runProcessUpdate(procPtr, useScheduler);
+					lastUpdated = procPtr;
+				}
+			}
+			if (useScheduler)
+			{
+				schedulerNoteDeadline(procPtr->nextUpdateMillis);
+			}
+		}
+
+		procPtr = procPtr->nextActiveProcess;
+
+		if (procPtr == NULL)
+		{
+			procPtr = activeProcessList;
+		}
+
+	} while (procPtr != firstProcess);
+
+	if (!budgetUsed && lastUpdated != NULL)
+	{
+		// carry on after the last one that was updated
+		*nextProcess = lastUpdated->nextActiveProcess;
+	}
+}
+
+void updateProcessesOnCore(int core)
+{
+	unsigned long passMillis = millis();
+
+	updateProcessesWithPriority(highPriorityProcess, core, passMillis);
+	updateProcessesWithPriority(normalPriorityProcess, core, passMillis);
+	updateLowPriorityProcesses(core, passMillis);
+}
+
+void updateProcesses()
+{
+	if (dualCoreTasksRunning())
+	{
+		updateProcessesOnCore(networkCore);
+	}
+	else
+	{
+		updateProcessesOnCore(PROCESS_ANY_CORE);
+	}
+}
+
+void updateRealTimeProcesses()
+{
+	updateProcessesOnCore(realTimeCore);
+}
+
 void dumpProcessStatus()
 {
 	alwaysDisplayMessage("Processes");
@@ -219,7 +494,6 @@ void dumpProcessStatus()
 	}
 }
 
-
 void iterateThroughAllProcesses(void (*func)(process *p))
 {
 	struct process *procPtr = allProcessList;
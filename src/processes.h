@@ -12,13 +12,32 @@
 #define FIRST_SHUTDOWN_PROCESS 16
 #define SECOND_SHUTDOWN_PROCESS 32
 
-// not used at the moment - will allow us to add behaviours to processes
+// Processes are updated in priority order on each pass of the loop. High
+// priority processes (network, input and serial) are updated first, then
+// normal ones. Low priority processes share a time budget on each pass, so
+// a slow one (for example a pixel frame render) is spread over passes
+// rather than holding up the others. The budget given to a low priority
+// process is the time it expects each update to take. A process with a
+// budget that overruns it is counted in its update timing overruns.
+
+enum ProcessPriority { normalPriorityProcess, highPriorityProcess, lowPriorityProcess };
+
+// The core a process is updated on when the dual core layout is in use
+// (see dualCore.h). Otherwise every process is updated by the main loop.
+
+enum ProcessCore { networkCore, realTimeCore };
+
+#define PROCESS_LOW_PRIORITY_PASS_BUDGET_MICROS 5000
+
+// a subscriber to a topic on the process message bus - see processBus.h
 
 struct processMessageListener{
 	char * listenerName;
 	char * destination;
 	void (*processMessage)(processMessageListener * listener, void * value);
 	struct processMessageListener * nextMessageListener;
+	// set by subscribeToBusTopic
+	int topic;
 };
 
 struct process
@@ -45,6 +64,19 @@ struct process
 	processMessageListener * listeners;
 	unsigned char * commandItems;
 	int commandItemSize;
+	// set at run time by the scheduler - see scheduler.h
+	unsigned long nextUpdateMillis;
+	bool updateScheduled;
+	struct UpdateTiming updateTiming;
+	// set by setProcessPriority
+	ProcessPriority priority;
+	unsigned long updateBudgetMicros;
+	// set by setProcessCore
+	ProcessCore core;
+	// set by setProcessDeferredStart
+	bool deferStart;
+	// true while a deferred process is waiting to be initialised and started
+	bool startPending;
 };
 
 void addProcessToAllProcessList(struct process *newProcess);
@@ -52,12 +84,29 @@ void addProcessToActiveProcessList(struct process *newProcess);
 void buildActiveProcessListFromMask(int processMask);
 struct process *findProcessByName(const char *name);
 struct process *findActiveProcessByName(const char *name);
+struct process *findProcessByID(int id);
+int getProcessID(struct process *proc);
 struct process *findProcessSettingCollectionByName(const char *name);
 void initialiseAllProcesses();
 void startProcess(process *proc);
 struct process *startProcessByName(char *name);
 void startProcesses();
 void updateProcesses();
+void setProcessPriority(struct process *proc, ProcessPriority priority, unsigned long updateBudgetMicros);
+void setProcessCore(struct process *proc, ProcessCore core);
+
+// A fast boot initialises and starts the processes marked for a deferred
+// start once the network is up, rather than during startDevice. A deferred
+// process isn't updated until it has started. A command sent to one starts
+// it straight away.
+void setProcessDeferredStart(struct process *proc);
+void deferProcessStarts();
+void startDeferredProcess(struct process *proc);
+void startDeferredProcesses();
+bool processStartsDeferred();
+// updates the processes given to the real time core - used by the real time task
+void updateRealTimeProcesses();
+extern unsigned long lowPriorityProcessesDeferred;
 void dumpProcessStatus();
 void updateProcess(struct process *process);
 void iterateThroughAllProcesses(void (*func)(process *p));
@@ -87,6 +87,35 @@ void buildConfigJson(char *destination, int bufferSize)
 		procPtr = procPtr->nextAllProcesses;
 	}
 
+	// the process IDs can be used in binary commands in place of the names
+
+	snprintf(destination, CONNECTION_MESSAGE_BUFFER_SIZE, "%s],\"processids\":[", destination);
+
+	procPtr = allProcessList;
+	firstItem = true;
+	int processID = 0;
+
+	while (procPtr != NULL)
+	{
+		if (procPtr->commands != NULL)
+		{
+			if (procPtr->statusOK())
+			{
+				if (firstItem)
+				{
+					snprintf(destination, CONNECTION_MESSAGE_BUFFER_SIZE, "%s %d", destination, processID);
+					firstItem = false;
+				}
+				else
+				{
+					snprintf(destination, CONNECTION_MESSAGE_BUFFER_SIZE, "%s,%d", destination, processID);
+				}
+			}
+		}
+		processID++;
+		procPtr = procPtr->nextAllProcesses;
+	}
+
 	snprintf(destination, CONNECTION_MESSAGE_BUFFER_SIZE, "%s],\"sensors\":[", destination);
 
 	sensor *allSensorPtr = allSensorList;
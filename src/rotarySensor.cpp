@@ -7,6 +7,7 @@
 #include "pixels.h"
 #include "buttonsensor.h"
 #include "utils.h"
+#include "sensorHistory.h"
 
 struct RotarySensorSettings rotarySensorSettings;
 
@@ -79,13 +80,23 @@ struct SettingItem rotarySensorInitialValueSetting = {
 	setDefaultRotarySensorInitialValue,
 	validateFloat0to1};
 
+struct SettingItem rotarySensorHistorySetting = {
+	"Rotary sensor keeps a history (yes or no)",
+	"rotarysensorhistory",
+	&rotarySensorSettings.rotarySensorHistory,
+	ONOFF_INPUT_LENGTH,
+	yesNo,
+	setFalse,
+	validateYesNo};
+
 struct SettingItem *rotarySensorSettingItemPointers[] =
 	{
 		&RotarySensorInputPinNoSetting,
 		&RotarySensorClockPinNoSetting,
 		&ROTARYSensorPinNoSetting,
 		&rotarySensorFittedSetting,
-		&rotarySensorInitialValueSetting};
+		&rotarySensorInitialValueSetting,
+		&rotarySensorHistorySetting};
 
 struct SettingItemCollection rotarySensorSettingItems = {
 	"rotarySensor",
@@ -203,6 +214,9 @@ void updateROTARYSensor()
 
 	rotarySensor.millisAtLastReading = millis();
 
+	// the count stays put between turns, so it is kept as a held value
+	recordHeldSensorHistory(&rotarySensor, rotarySensoractiveReading->counter);
+
 	// work through the listeners and post messages where requested
 
 	sensorListener *pos = rotarySensor.listeners;
@@ -217,7 +231,7 @@ void updateROTARYSensor()
 				// send on pressed - is the button pressed now?
 				if (rotarySensoractiveReading->pressed)
 				{
-					pos->receiveMessage(pos->config->destination, pos->config->optionBuffer);
+					fireSensorListener(pos);
 					pos->lastReadingMillis = buttonSensor.millisAtLastReading;
 					// move on to the next one
 					pos = pos->nextMessageListener;
@@ -230,7 +244,7 @@ void updateROTARYSensor()
 				// send on released - is the button released now?
 				if (!rotarySensoractiveReading->pressed)
 				{
-					pos->receiveMessage(pos->config->destination, pos->config->optionBuffer);
+					fireSensorListener(pos);
 					pos->lastReadingMillis = buttonSensor.millisAtLastReading;
 					// move on to the next one
 					pos = pos->nextMessageListener;
@@ -253,7 +267,7 @@ void updateROTARYSensor()
 				char *messageBuffer = (char *)pos->config->optionBuffer + MESSAGE_START_POSITION;
 				snprintf(messageBuffer, MAX_MESSAGE_LENGTH, "%.2f", resultValue);
 
-				pos->receiveMessage(pos->config->destination, pos->config->optionBuffer);
+				fireSensorListener(pos);
 				pos->lastReadingMillis = buttonSensor.millisAtLastReading;
 				// move on to the next one
 				pos = pos->nextMessageListener;
@@ -295,7 +309,7 @@ void startRotarySensor()
 {
 	if (rotarySensor.activeReading == NULL)
 	{
-		rotarySensor.activeReading = new rotarySensorReading();
+		rotarySensor.activeReading = allocateSensorReading(sizeof(struct rotarySensorReading));
 	}
 
 	if (!rotarySensorSettings.rotarySensorFitted)
@@ -310,6 +324,11 @@ void startRotarySensor()
 		pinMode(rotarySensorSettings.rotarySensorSwitchPinNo, INPUT);
 		attachInterrupt(rotarySensorSettings.rotarySensorClockPinNo, clockChange, HIGH);
 		rotarySensor.status = SENSOR_OK;
+
+		if (rotarySensorSettings.rotarySensorHistory)
+		{
+			startSensorHistory(&rotarySensor);
+		}
 	}
 }
 
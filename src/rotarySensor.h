@@ -24,6 +24,7 @@ struct RotarySensorSettings {
 	int rotarySensorSwitchPinNo;
 	bool rotarySensorFitted;
 	float rotarySensorInitialValue;
+	bool rotarySensorHistory;
 };
 
 extern struct RotarySensorSettings rotarySensorSettings;
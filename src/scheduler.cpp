@@ -0,0 +1,163 @@
+#include <Arduino.h>
+
+#include "utils.h"
+#include "processes.h"
+#include "sensors.h"
+#include "scheduler.h"
+
+struct SchedulerStats schedulerStats;
+
+// earliest deadline seen during this pass of the loop
+unsigned long schedulerNextDeadline;
+bool schedulerNextDeadlineSet = false;
+
+// set when an item is woken so that the loop doesn't sleep
+volatile bool schedulerWakeRequested = false;
+
+unsigned long schedulerPassStartMicros = 0;
+
+void scheduleProcessUpdate(struct process *proc, unsigned long millisFromNow)
+{
+	proc->nextUpdateMillis = millis() + millisFromNow;
+	proc->updateScheduled = true;
+}
+
+void wakeProcess(struct process *proc)
+{
+	proc->nextUpdateMillis = millis();
+	proc->updateScheduled = true;
+	schedulerWakeRequested = true;
+	schedulerStats.wakes++;
+}
+
+void scheduleSensorUpdate(struct sensor *s, unsigned long millisFromNow)
+{
+	s->nextUpdateMillis = millis() + millisFromNow;
+	s->updateScheduled = true;
+}
+
+void wakeSensor(struct sensor *s)
+{
+	s->nextUpdateMillis = millis();
+	s->updateScheduled = true;
+	schedulerWakeRequested = true;
+	schedulerStats.wakes++;
+}
+
+void startProcessSchedule(struct process *proc)
+{
+	proc->nextUpdateMillis = millis();
+	proc->updateScheduled = false;
+}
+
+void startSensorSchedule(struct sensor *s)
+{
+	s->nextUpdateMillis = millis();
+	s->updateScheduled = false;
+}
+
+void requestSchedulerWake()
+{
+	schedulerWakeRequested = true;
+}
+
+bool schedulerItemDue(unsigned long nextUpdateMillis, unsigned long now)
+{
+	return (long)(nextUpdateMillis - now) <= 0;
+}
+
+void schedulerNoteDeadline(unsigned long nextUpdateMillis)
+{
+	if (!schedulerNextDeadlineSet || (long)(nextUpdateMillis - schedulerNextDeadline) < 0)
+	{
+		schedulerNextDeadline = nextUpdateMillis;
+		schedulerNextDeadlineSet = true;
+	}
+}
+
+void schedulerRecordUpdate(const char *name, bool scheduled, unsigned long dueMillis, unsigned long startMillis)
+{
+	schedulerStats.updates++;
+
+	// An item that hasn't been updated since it started has no deadline of
+	// its own yet, and the boot holds the loop up for a while after the
+	// sensors and processes start, so its first update isn't counted as late
+	if (!scheduled)
+	{
+		return;
+	}
+
+	unsigned long lateness = ulongDiff(startMillis, dueMillis);
+
+	if (lateness > schedulerStats.worstLatenessMillis)
+	{
+		schedulerStats.worstLatenessMillis = lateness;
+		schedulerStats.worstLatenessName = name;
+	}
+}
+
+void sleepUntilNextDeadline()
+{
+	unsigned long sleepStartMicros = micros();
+
+	if (schedulerPassStartMicros != 0)
+	{
+		schedulerStats.busyMicros += ulongDiff(sleepStartMicros, schedulerPassStartMicros);
+	}
+	schedulerStats.passes++;
+
+	unsigned long latestWake = millis() + SCHEDULER_MAX_SLEEP_MILLIS;
+	unsigned long deadline = latestWake;
+
+	if (schedulerNextDeadlineSet && (long)(schedulerNextDeadline - latestWake) < 0)
+	{
+		deadline = schedulerNextDeadline;
+	}
+
+	bool slept = false;
+
+	// sleep in short steps so that a wake request is seen quickly - delay
+	// also lets the network stack run
+
+	while (!schedulerWakeRequested && (long)(deadline - millis()) > 0)
+	{
+		delay(1);
+		slept = true;
+	}
+
+	if (!slept)
+	{
+		yield();
+	}
+
+	schedulerWakeRequested = false;
+	schedulerNextDeadlineSet = false;
+
+	schedulerPassStartMicros = micros();
+	schedulerStats.sleepMicros += ulongDiff(schedulerPassStartMicros, sleepStartMicros);
+}
+
+void resetSchedulerStats()
+{
+	memset(&schedulerStats, 0, sizeof(schedulerStats));
+}
+
+void schedulerStatusMessage(char *buffer, int bufferLength)
+{
+	unsigned long long totalMicros = schedulerStats.sleepMicros + schedulerStats.busyMicros;
+	int idlePercent = 0;
+
+	if (totalMicros > 0)
+	{
+		idlePercent = (int)((schedulerStats.sleepMicros * 100) / totalMicros);
+	}
+
+	snprintf(buffer, bufferLength,
+			 "passes:%lu updates:%lu wakes:%lu idle:%d%% worst lateness:%lums (%s)",
+			 schedulerStats.passes,
+			 schedulerStats.updates,
+			 schedulerStats.wakes,
+			 idlePercent,
+			 schedulerStats.worstLatenessMillis,
+			 schedulerStats.worstLatenessName == NULL ? "none" : schedulerStats.worstLatenessName);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+// The main loop updates each sensor and process when it is due and then
+// sleeps until the earliest deadline rather than for a fixed time.
+//
+// A sensor or process says when it next needs to be updated by calling
+// scheduleSensorUpdate or scheduleProcessUpdate from its update function.
+// One that doesn't is polled every SCHEDULER_DEFAULT_POLL_MILLIS, which is
+// how everything behaved when the loop had a fixed delay. wakeSensor and
+// wakeProcess make an item due straight away, for use when an event
+// (for example an incoming command) gives it work to do.
+
+struct process;
+struct sensor;
+
+#define SCHEDULER_DEFAULT_POLL_MILLIS 5
+
+// longest the loop will sleep even if nothing is due
+#define SCHEDULER_MAX_SLEEP_MILLIS 1000
+
+// deadline for a sensor or process that is waiting for an event
+#define SCHEDULER_IDLE_MILLIS SCHEDULER_MAX_SLEEP_MILLIS
+
+struct SchedulerStats
+{
+	unsigned long passes;
+	unsigned long updates;
+	unsigned long wakes;
+	unsigned long long sleepMicros;
+	unsigned long long busyMicros;
+	// worst time between an item becoming due and being updated
+	unsigned long worstLatenessMillis;
+	const char *worstLatenessName;
+};
+
+extern struct SchedulerStats schedulerStats;
+
+void scheduleProcessUpdate(struct process *proc, unsigned long millisFromNow);
+void wakeProcess(struct process *proc);
+
+void scheduleSensorUpdate(struct sensor *s, unsigned long millisFromNow);
+void wakeSensor(struct sensor *s);
+
+// called just before a sensor or process is started, which makes it due at
+// once unless its start function schedules its first update itself
+void startProcessSchedule(struct process *proc);
+void startSensorSchedule(struct sensor *s);
+
+// stops the loop sleeping, for work that arrives from outside the loop
+void requestSchedulerWake();
+
+// used by updateSensors and updateProcesses
+bool schedulerItemDue(unsigned long nextUpdateMillis, unsigned long now);
+void schedulerNoteDeadline(unsigned long nextUpdateMillis);
+void schedulerRecordUpdate(const char *name, bool scheduled, unsigned long dueMillis, unsigned long startMillis);
+
+// called at the end of each pass of the main loop
+void sleepUntilNextDeadline();
+
+void resetSchedulerStats();
+void schedulerStatusMessage(char *buffer, int bufferLength);
@@ -0,0 +1,361 @@
+#include <Arduino.h>
+
+#include "debug.h"
+#include "utils.h"
+#include "messages.h"
+#include "timerWheel.h"
+#include "sensorHistory.h"
+
+const unsigned long sensorHistoryPeriodMillis[SENSOR_HISTORY_NO_OF_TIERS] = {1000UL, 60000UL, 3600000UL};
+const int sensorHistoryNoOfBuckets[SENSOR_HISTORY_NO_OF_TIERS] = {SENSOR_HISTORY_SECONDS, SENSOR_HISTORY_MINUTES, SENSOR_HISTORY_HOURS};
+const char *sensorHistoryTierNames[SENSOR_HISTORY_NO_OF_TIERS] = {"s", "m", "h"};
+
+#define SENSOR_HISTORY_NO_OF_BUCKETS (SENSOR_HISTORY_SECONDS + SENSOR_HISTORY_MINUTES + SENSOR_HISTORY_HOURS)
+
+// the history, its raw samples and all its buckets in one allocation
+#define SENSOR_HISTORY_STORAGE_SIZE (sizeof(struct SensorHistory) +                                \
+									 SENSOR_HISTORY_RAW_LENGTH * sizeof(struct SensorHistorySample) + \
+									 SENSOR_HISTORY_NO_OF_BUCKETS * sizeof(struct SensorHistoryBucket))
+
+bool startSensorHistory(struct sensor *s)
+{
+	if (s->history != NULL)
+	{
+		return true;
+	}
+
+	unsigned char *storage = (unsigned char *)calloc(1, SENSOR_HISTORY_STORAGE_SIZE);
+
+	if (storage == NULL)
+	{
+		displayMessage("No room for the %s sensor history\n", s->sensorName);
+		return false;
+	}
+
+	struct SensorHistory *history = (struct SensorHistory *)storage;
+	storage += sizeof(struct SensorHistory);
+
+	history->raw = (struct SensorHistorySample *)storage;
+	storage += SENSOR_HISTORY_RAW_LENGTH * sizeof(struct SensorHistorySample);
+
+	for (int i = 0; i < SENSOR_HISTORY_NO_OF_TIERS; i++)
+	{
+		struct SensorHistoryTier *tier = &history->tiers[i];
+		tier->periodMillis = sensorHistoryPeriodMillis[i];
+		tier->noOfBuckets = sensorHistoryNoOfBuckets[i];
+		tier->buckets = (struct SensorHistoryBucket *)storage;
+		storage += tier->noOfBuckets * sizeof(struct SensorHistoryBucket);
+	}
+
+	s->history = history;
+
+	return true;
+}
+
+void clearSensorHistoryBucket(struct SensorHistoryBucket *bucket)
+{
+	bucket->min = 0;
+	bucket->max = 0;
+	bucket->total = 0;
+	bucket->count = 0;
+}
+
+// Moving on to a new period clears the buckets that the tier skipped over
+// while there were no samples. Each bucket is cleared at most once for
+// each time round the tier, so a sample still costs a fixed amount of work
+// on average.
+
+void addTierSample(struct SensorHistoryTier *tier, uint32_t period, float value)
+{
+	if (!tier->started)
+	{
+		clearSensorHistoryBucket(&tier->buckets[period % tier->noOfBuckets]);
+		tier->newestPeriod = period;
+		tier->started = true;
+	}
+	else if (period != tier->newestPeriod)
+	{
+		uint32_t skipped = period - tier->newestPeriod;
+
+		if (skipped > (uint32_t)tier->noOfBuckets)
+		{
+			skipped = tier->noOfBuckets;
+		}
+
+		for (uint32_t i = 0; i < skipped; i++)
+		{
+			clearSensorHistoryBucket(&tier->buckets[(period - i) % tier->noOfBuckets]);
+		}
+
+		tier->newestPeriod = period;
+	}
+
+	struct SensorHistoryBucket *bucket = &tier->buckets[period % tier->noOfBuckets];
+
+	if (bucket->count == 0)
+	{
+		bucket->min = value;
+		bucket->max = value;
+	}
+	else
+	{
+		if (value < bucket->min)
+		{
+			bucket->min = value;
+		}
+		if (value > bucket->max)
+		{
+			bucket->max = value;
+		}
+	}
+
+	// a full bucket keeps its mean by halving its total and count
+	if (bucket->count == 0xFFFF)
+	{
+		bucket->total = bucket->total / 2;
+		bucket->count = bucket->count / 2;
+	}
+
+	bucket->total += value;
+	bucket->count++;
+}
+
+void addSensorHistorySample(struct SensorHistory *history, float value)
+{
+	uint64_t now = monotonicMillis();
+
+	struct SensorHistorySample *sample = &history->raw[history->rawNext];
+	sample->millis = (unsigned long)now;
+	sample->value = value;
+
+	history->rawNext = (history->rawNext + 1) % SENSOR_HISTORY_RAW_LENGTH;
+
+	if (history->rawCount < SENSOR_HISTORY_RAW_LENGTH)
+	{
+		history->rawCount++;
+	}
+
+	history->samples++;
+
+	for (int i = 0; i < SENSOR_HISTORY_NO_OF_TIERS; i++)
+	{
+		struct SensorHistoryTier *tier = &history->tiers[i];
+		addTierSample(tier, (uint32_t)(now / tier->periodMillis), value);
+	}
+}
+
+void recordHeldSensorHistory(struct sensor *s, float value)
+{
+	struct SensorHistory *history = s->history;
+
+	if (history == NULL)
+	{
+		return;
+	}
+
+	struct SensorHistoryTier *seconds = &history->tiers[historySeconds];
+	uint32_t nowPeriod = (uint32_t)(monotonicMillis() / seconds->periodMillis);
+	float latest;
+
+	if (getLatestSensorHistoryValue(history, &latest) && latest == value && nowPeriod == seconds->newestPeriod)
+	{
+		return;
+	}
+
+	addSensorHistorySample(history, value);
+}
+
+int sensorHistoryTierLength(enum SensorHistoryTierType tier)
+{
+	return sensorHistoryNoOfBuckets[tier];
+}
+
+struct SensorHistoryBucket emptySensorHistoryBucket = {0, 0, 0, 0};
+
+// the bucket for the period, or the empty bucket if the period has no
+// samples or has fallen out of the tier
+
+struct SensorHistoryBucket *findSensorHistoryBucket(struct SensorHistoryTier *tier, uint32_t period)
+{
+	if (!tier->started || (int32_t)(period - tier->newestPeriod) > 0)
+	{
+		return &emptySensorHistoryBucket;
+	}
+
+	if (tier->newestPeriod - period >= (uint32_t)tier->noOfBuckets)
+	{
+		return &emptySensorHistoryBucket;
+	}
+
+	return &tier->buckets[period % tier->noOfBuckets];
+}
+
+void iterateThroughSensorHistoryBuckets(struct SensorHistory *history, enum SensorHistoryTierType tierType, int periods,
+										void (*func)(int age, struct SensorHistoryBucket *bucket))
+{
+	struct SensorHistoryTier *tier = &history->tiers[tierType];
+	uint32_t nowPeriod = (uint32_t)(monotonicMillis() / tier->periodMillis);
+
+	if (periods > tier->noOfBuckets)
+	{
+		periods = tier->noOfBuckets;
+	}
+
+	for (int age = periods - 1; age >= 0; age--)
+	{
+		func(age, findSensorHistoryBucket(tier, nowPeriod - age));
+	}
+}
+
+bool getSensorHistoryStats(struct SensorHistory *history, enum SensorHistoryTierType tierType, int periods,
+						   struct SensorHistoryStats *result)
+{
+	struct SensorHistoryTier *tier = &history->tiers[tierType];
+	uint32_t nowPeriod = (uint32_t)(monotonicMillis() / tier->periodMillis);
+
+	if (periods > tier->noOfBuckets)
+	{
+		periods = tier->noOfBuckets;
+	}
+
+	float total = 0;
+	result->count = 0;
+
+	for (int age = 0; age < periods; age++)
+	{
+		struct SensorHistoryBucket *bucket = findSensorHistoryBucket(tier, nowPeriod - age);
+
+		if (bucket->count == 0)
+		{
+			continue;
+		}
+
+		if (result->count == 0 || bucket->min < result->min)
+		{
+			result->min = bucket->min;
+		}
+
+		if (result->count == 0 || bucket->max > result->max)
+		{
+			result->max = bucket->max;
+		}
+
+		total += bucket->total;
+		result->count += bucket->count;
+	}
+
+	if (result->count == 0)
+	{
+		result->min = 0;
+		result->max = 0;
+		result->mean = 0;
+		return false;
+	}
+
+	result->mean = total / result->count;
+	return true;
+}
+
+bool getLatestSensorHistoryValue(struct SensorHistory *history, float *result)
+{
+	if (history->rawCount == 0)
+	{
+		return false;
+	}
+
+	int latest = (history->rawNext + SENSOR_HISTORY_RAW_LENGTH - 1) % SENSOR_HISTORY_RAW_LENGTH;
+	*result = history->raw[latest].value;
+	return true;
+}
+
+bool decodeSensorHistoryTier(char ch, enum SensorHistoryTierType *tier)
+{
+	for (int i = 0; i < SENSOR_HISTORY_NO_OF_TIERS; i++)
+	{
+		if (tolower(ch) == sensorHistoryTierNames[i][0])
+		{
+			*tier = (enum SensorHistoryTierType)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+const char *sensorHistoryTierName(enum SensorHistoryTierType tier)
+{
+	return sensorHistoryTierNames[tier];
+}
+
+void printSensorHistoryBucket(int age, struct SensorHistoryBucket *bucket)
+{
+	if (bucket->count == 0)
+	{
+		alwaysDisplayMessage("    %3d: no samples\n", age);
+		return;
+	}
+
+	alwaysDisplayMessage("    %3d: min:%.2f max:%.2f mean:%.2f samples:%u\n",
+						 age, bucket->min, bucket->max, bucket->total / bucket->count, bucket->count);
+}
+
+// With no tier this shows the raw samples and the current bucket of each
+// tier. With a tier it shows each of the last periods buckets in the tier.
+
+void printSensorHistory(struct sensor *s, char tierCh, int periods)
+{
+	struct SensorHistory *history = s->history;
+
+	if (history == NULL)
+	{
+		alwaysDisplayMessage("\nThe %s sensor isn't keeping a history\n", s->sensorName);
+		return;
+	}
+
+	enum SensorHistoryTierType tier;
+
+	if (decodeSensorHistoryTier(tierCh, &tier))
+	{
+		alwaysDisplayMessage("\n%s history, last %d buckets of 1%s, oldest first\n",
+							 s->sensorName, periods, sensorHistoryTierName(tier));
+		iterateThroughSensorHistoryBuckets(history, tier, periods, printSensorHistoryBucket);
+		return;
+	}
+
+	alwaysDisplayMessage("\n%s history samples:%lu\n", s->sensorName, history->samples);
+
+	int sampleNo = (history->rawNext + SENSOR_HISTORY_RAW_LENGTH - history->rawCount) % SENSOR_HISTORY_RAW_LENGTH;
+
+	for (int i = 0; i < history->rawCount; i++)
+	{
+		struct SensorHistorySample *sample = &history->raw[sampleNo];
+		alwaysDisplayMessage("    %lu: %.2f\n", sample->millis, sample->value);
+		sampleNo = (sampleNo + 1) % SENSOR_HISTORY_RAW_LENGTH;
+	}
+
+	for (int i = 0; i < SENSOR_HISTORY_NO_OF_TIERS; i++)
+	{
+		struct SensorHistoryStats stats;
+
+		if (getSensorHistoryStats(history, (enum SensorHistoryTierType)i, 1, &stats))
+		{
+			alwaysDisplayMessage("    this 1%s min:%.2f max:%.2f mean:%.2f samples:%lu\n",
+								 sensorHistoryTierNames[i], stats.min, stats.max, stats.mean, stats.count);
+		}
+	}
+}
+
+void sensorHistoryJson(struct sensor *s, enum SensorHistoryTierType tier, int periods, char *buffer, int bufferLength)
+{
+	struct SensorHistoryStats stats;
+
+	if (s->history == NULL || !getSensorHistoryStats(s->history, tier, periods, &stats))
+	{
+		snprintf(buffer, bufferLength, "{\"sensor\":\"%s\",\"tier\":\"%s\",\"periods\":%d,\"count\":0}",
+				 s->sensorName, sensorHistoryTierName(tier), periods);
+		return;
+	}
+
+	snprintf(buffer, bufferLength,
+			 "{\"sensor\":\"%s\",\"tier\":\"%s\",\"periods\":%d,\"count\":%lu,\"min\":%.3f,\"max\":%.3f,\"mean\":%.3f}",
+			 s->sensorName, sensorHistoryTierName(tier), periods, stats.count, stats.min, stats.max, stats.mean);
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "sensors.h"
+
+// A sensor can keep a history of one of its values. The history holds the
+// last SENSOR_HISTORY_RAW_LENGTH samples as they were recorded, and three
+// tiers of buckets holding the min, max and mean of the samples in each
+// second, minute and hour. A sample goes straight into the current bucket
+// of every tier, so recording one costs the same however long the history
+// runs. The storage is allocated once when the history is started and
+// never freed.
+//
+// A sensor that supports history has a setting to turn it on. It starts
+// the history when it starts and records each reading:
+//
+//   if (potSensorSettings.potSensorHistory)
+//       startSensorHistory(&potSensor);
+//   ...
+//   recordSensorHistory(&potSensor, reading);
+//
+// The history console command, the controller history command and
+// @sensor readings in HullOS read it back.
+
+#define SENSOR_HISTORY_RAW_LENGTH 32
+#define SENSOR_HISTORY_SECONDS 60
+#define SENSOR_HISTORY_MINUTES 60
+#define SENSOR_HISTORY_HOURS 24
+
+#define SENSOR_HISTORY_NO_OF_TIERS 3
+
+enum SensorHistoryTierType
+{
+	historySeconds,
+	historyMinutes,
+	historyHours
+};
+
+struct SensorHistoryBucket
+{
+	float min;
+	float max;
+	float total;
+	uint16_t count;
+};
+
+struct SensorHistoryTier
+{
+	unsigned long periodMillis;
+	int noOfBuckets;
+	struct SensorHistoryBucket *buckets;
+	// the period number (time divided by the period) of the newest bucket
+	uint32_t newestPeriod;
+	bool started;
+};
+
+struct SensorHistorySample
+{
+	unsigned long millis;
+	float value;
+};
+
+struct SensorHistory
+{
+	struct SensorHistorySample *raw;
+	int rawNext;
+	int rawCount;
+	unsigned long samples;
+	struct SensorHistoryTier tiers[SENSOR_HISTORY_NO_OF_TIERS];
+};
+
+struct SensorHistoryStats
+{
+	float min;
+	float max;
+	float mean;
+	unsigned long count;
+};
+
+// allocates the history - returns false if there isn't room
+bool startSensorHistory(struct sensor *s);
+
+void addSensorHistorySample(struct SensorHistory *history, float value);
+
+// does nothing if the sensor history isn't running
+inline void recordSensorHistory(struct sensor *s, float value)
+{
+	if (s->history != NULL)
+	{
+		addSensorHistorySample(s->history, value);
+	}
+}
+
+// For a sensor that is read on every update but whose value only changes
+// now and then. The value is recorded when it changes, and otherwise once
+// in each second, so a value that is held still fills the buckets. As each
+// second of a held value counts as one sample, the means are weighted by
+// time, to the nearest second.
+void recordHeldSensorHistory(struct sensor *s, float value);
+
+// the number of buckets in the tier - the most periods it can combine
+int sensorHistoryTierLength(enum SensorHistoryTierType tier);
+
+// the min, max and mean over the last periods buckets of the tier, ending
+// with the bucket for now. Returns false if there were no samples.
+bool getSensorHistoryStats(struct SensorHistory *history, enum SensorHistoryTierType tier, int periods,
+						   struct SensorHistoryStats *result);
+
+// the stats for each of the last periods buckets of the tier, oldest first
+void iterateThroughSensorHistoryBuckets(struct SensorHistory *history, enum SensorHistoryTierType tier, int periods,
+										void (*func)(int age, struct SensorHistoryBucket *bucket));
+
+// returns false if there are no samples
+bool getLatestSensorHistoryValue(struct SensorHistory *history, float *result);
+
+// decodes s, m or h - returns false if the character isn't a tier
+bool decodeSensorHistoryTier(char ch, enum SensorHistoryTierType *tier);
+
+const char *sensorHistoryTierName(enum SensorHistoryTierType tier);
+
+void printSensorHistory(struct sensor *s, char tierCh, int periods);
+
+#define SENSOR_HISTORY_JSON_LENGTH 200
+
+void sensorHistoryJson(struct sensor *s, enum SensorHistoryTierType tier, int periods, char *buffer, int bufferLength);
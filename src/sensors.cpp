@@ -7,15 +7,150 @@
 #include "controller.h"
 #include "utils.h"
 #include "messages.h"
+#include "scheduler.h"
+#include "processes.h"
+#include "dualCore.h"
+#include "blockPool.h"
+#include "loopTracer.h"
 
 struct sensor *activeSensorList = NULL;
 struct sensor *allSensorList = NULL;
-struct sensorListener * deletedSensorListeners = NULL;
+
+// Listeners come from a pool big enough for every listener the controller
+// can store, so making and removing them doesn't fragment the heap
+
+unsigned char sensorListenerPoolStorage[BLOCK_POOL_STORAGE_SIZE(sizeof(struct sensorListener), CONTROLLER_NO_OF_LISTENERS)] BLOCK_POOL_ALIGNED;
+
+struct BlockPool sensorListenerPool = {
+	"sensor listeners",
+	sensorListenerPoolStorage,
+	sizeof(struct sensorListener),
+	CONTROLLER_NO_OF_LISTENERS};
+
+unsigned char sensorReadingPoolStorage[BLOCK_POOL_STORAGE_SIZE(SENSOR_READING_BLOCK_SIZE, SENSOR_READING_POOL_SIZE)] BLOCK_POOL_ALIGNED;
+
+struct BlockPool sensorReadingPool = {
+	"sensor readings",
+	sensorReadingPoolStorage,
+	SENSOR_READING_BLOCK_SIZE,
+	SENSOR_READING_POOL_SIZE};
+
+void * allocateSensorReading(int size)
+{
+	if (size > SENSOR_READING_BLOCK_SIZE)
+	{
+		TRACELOGLN("Sensor reading too big for the pool");
+		return calloc(1, size);
+	}
+
+	return blockPoolAlloc(&sensorReadingPool);
+}
+
+// The trigger lists of every sensor are slices of one static table, handed
+// out as the sensors are added
+
+struct sensorListener *sensorTriggerIndex[SENSOR_TRIGGER_INDEX_SIZE];
+int sensorTriggerIndexUsed = 0;
+
+unsigned char sensorTriggerSlots[SENSOR_TRIGGER_SLOTS_SIZE];
+int sensorTriggerSlotsUsed = 0;
+
+int sensorTriggerSlotBits(int noOfTriggers)
+{
+	int bits = 1;
+
+	while ((1 << bits) < noOfTriggers * 2)
+	{
+		bits++;
+	}
+
+	return bits;
+}
+
+// a multiplicative hash - the top bits of the product pick the slot, so
+// the product must wrap at 32 bits on a 64 bit host as well
+unsigned int sensorTriggerSlot(int trigger, int bits)
+{
+	uint32_t hash = (uint32_t)trigger * 2654435761U;
+	return hash >> (32 - bits);
+}
+
+void mapSensorTriggers(struct sensor *sensor, unsigned char *slots, int bits)
+{
+	unsigned int mask = (1 << bits) - 1;
+
+	memset(slots, 0, 1 << bits);
+
+	for (int i = 0; i < sensor->noOfSensorListenerFunctions; i++)
+	{
+		unsigned int slot = sensorTriggerSlot(sensor->sensorListenerFunctions[i].trigger, bits);
+
+		while (slots[slot] != 0)
+		{
+			slot = (slot + 1) & mask;
+		}
+
+		slots[slot] = i + 1;
+	}
+
+	sensor->triggerSlots = slots;
+	sensor->triggerSlotBits = bits;
+}
+
+void allocateSensorTriggerIndex(struct sensor *newSensor)
+{
+	int size = newSensor->noOfSensorListenerFunctions;
+
+	newSensor->triggerListeners = NULL;
+	newSensor->triggerSlots = NULL;
+
+	if (size == 0)
+	{
+		return;
+	}
+
+	if (sensorTriggerIndexUsed + size <= SENSOR_TRIGGER_INDEX_SIZE)
+	{
+		newSensor->triggerListeners = &sensorTriggerIndex[sensorTriggerIndexUsed];
+		sensorTriggerIndexUsed += size;
+	}
+	else
+	{
+		TRACELOGLN("Sensor trigger index full");
+		newSensor->triggerListeners = (struct sensorListener **)calloc(size, sizeof(struct sensorListener *));
+	}
+
+	int bits = sensorTriggerSlotBits(size);
+	int noOfSlots = 1 << bits;
+	unsigned char *slots;
+
+	if (sensorTriggerSlotsUsed + noOfSlots <= SENSOR_TRIGGER_SLOTS_SIZE)
+	{
+		slots = &sensorTriggerSlots[sensorTriggerSlotsUsed];
+		sensorTriggerSlotsUsed += noOfSlots;
+	}
+	else
+	{
+		TRACELOGLN("Sensor trigger slots full");
+		slots = (unsigned char *)malloc(noOfSlots);
+	}
+
+	if (newSensor->triggerListeners == NULL || slots == NULL)
+	{
+		TRACELOGLN("   no memory for the trigger index");
+		newSensor->triggerListeners = NULL;
+		return;
+	}
+
+	mapSensorTriggers(newSensor, slots, bits);
+}
 
 void addSensorToAllSensorsList(struct sensor *newSensor)
 {
 	newSensor->nextAllSensors = NULL;
 
+	allocateSensorTriggerIndex(newSensor);
+
 	if (allSensorList == NULL)
 	{
 		allSensorList = newSensor;
@@ -30,12 +165,13 @@ void addSensorToAllSensorsList(struct sensor *newSensor)
 		}
 		addPos->nextAllSensors = newSensor;
 	}
+
+	invalidateSettingIndex();
 }
 
-void addListenerToDeletedListeners(struct sensorListener * listener)
+void freeSensorListener(struct sensorListener * listener)
 {
-	listener->nextMessageListener = deletedSensorListeners;
-	deletedSensorListeners = listener;
+	blockPoolFree(&sensorListenerPool, listener);
 }
 
 void clearSensorListener(struct sensorListener * listener)
@@ -44,24 +180,21 @@ void clearSensorListener(struct sensorListener * listener)
 	listener->lastReadingMillis = -1;
 	listener->receiveMessage = NULL;
 	listener->nextMessageListener = NULL;
+	listener->nextTriggerListener = NULL;
+	listener->command = NULL;
+	listener->commandProcess = NULL;
 }
 
 struct sensorListener * getNewSensorListener()
 {
 	TRACELOGLN("Getting a sensor listener");
 
-	sensorListener * result ;
+	sensorListener * result = (sensorListener *) blockPoolAlloc(&sensorListenerPool);
 
-	if(deletedSensorListeners == NULL)
+	if(result == NULL)
 	{
-		TRACELOGLN("   creating a new listener");
-		result = new sensorListener();
-	}
-	else {
-		TRACELOGLN("   reusing a discarded listener");
-		result = deletedSensorListeners;
-		// remove this listener from the list
-		deletedSensorListeners = deletedSensorListeners->nextMessageListener;
+		TRACELOGLN("   no memory for a listener");
+		return NULL;
 	}
 
 	clearSensorListener(result);
@@ -70,8 +203,85 @@ struct sensorListener * getNewSensorListener()
 }
 
 
-// Removes a listener from the sensor and adds the listner to the list of deleted listeners
-// The listeners are recycled if used again
+// Returns the head of the trigger list for the listener, or NULL if the
+// listener's trigger isn't one the sensor provides. The slots are never
+// more than half full, so the probe stops at an empty one.
+
+struct sensorListener **findSensorTriggerList(struct sensor *sensor, int trigger)
+{
+	if (sensor->triggerListeners == NULL || sensor->triggerSlots == NULL)
+	{
+		return NULL;
+	}
+
+	unsigned int mask = (1 << sensor->triggerSlotBits) - 1;
+	unsigned int slot = sensorTriggerSlot(trigger, sensor->triggerSlotBits);
+
+	while (sensor->triggerSlots[slot] != 0)
+	{
+		int entry = sensor->triggerSlots[slot] - 1;
+
+		if (sensor->sensorListenerFunctions[entry].trigger == trigger)
+		{
+			return &sensor->triggerListeners[entry];
+		}
+
+		slot = (slot + 1) & mask;
+	}
+
+	return NULL;
+}
+
+void addTriggerListener(struct sensor *sensor, struct sensorListener *listener)
+{
+	listener->nextTriggerListener = NULL;
+
+	struct sensorListener **pos = findSensorTriggerList(sensor, listener->config->sendOptionMask);
+
+	if (pos == NULL)
+	{
+		TRACELOGLN("Listener trigger not provided by the sensor");
+		return;
+	}
+
+	// add to the end so listeners fire in the order they were added
+	while (*pos != NULL)
+	{
+		pos = &(*pos)->nextTriggerListener;
+	}
+
+	*pos = listener;
+}
+
+void removeTriggerListener(struct sensor *sensor, struct sensorListener *listener)
+{
+	struct sensorListener **pos = findSensorTriggerList(sensor, listener->config->sendOptionMask);
+
+	while (pos != NULL && *pos != NULL)
+	{
+		if (*pos == listener)
+		{
+			*pos = listener->nextTriggerListener;
+			listener->nextTriggerListener = NULL;
+			return;
+		}
+		pos = &(*pos)->nextTriggerListener;
+	}
+}
+
+struct sensorListener *findSensorTriggerListeners(struct sensor *sensor, int trigger)
+{
+	struct sensorListener **list = findSensorTriggerList(sensor, trigger);
+
+	if (list == NULL)
+	{
+		return NULL;
+	}
+
+	return *list;
+}
+
+// Removes a listener from the sensor and gives it back to the listener pool
 
 void removeMessageListenerFromSensor(struct sensor *sensor, struct sensorListener *listener)
 {
@@ -97,12 +307,14 @@ void removeMessageListenerFromSensor(struct sensor *sensor, struct sensorListene
 	// cut this listener out of the list
 	nodeBeforeDel->nextMessageListener = listener->nextMessageListener;
 
-	addListenerToDeletedListeners(listener);
+	removeTriggerListener(sensor, listener);
 
 	TRACELOG("   removing process:");
 	TRACELOG(listener->config->commandProcess);
 	TRACELOG("   removing command:");
 	TRACELOGLN(listener->config->commandName);
+
+	freeSensorListener(listener);
 }
 
 void removeAllMessageListenersFromSensor(struct sensor *sensor)
@@ -123,11 +335,16 @@ void removeAllMessageListenersFromSensor(struct sensor *sensor)
 		// move on to the next node
 		node = node->nextMessageListener;
 		// delete the node we have just left
-		addListenerToDeletedListeners(nodeToDelete);
+		freeSensorListener(nodeToDelete);
 	}
 
 	// clear all the listeners from the sensor
 	sensor->listeners = NULL;
+
+	for (int i = 0; sensor->triggerListeners != NULL && i < sensor->noOfSensorListenerFunctions; i++)
+	{
+		sensor->triggerListeners[i] = NULL;
+	}
 }
 
 void removeAllSensorMessageListeners()
@@ -153,6 +370,8 @@ void addMessageListenerToSensor(struct sensor *sensor, struct sensorListener *li
 		}
 		addPos->nextMessageListener = listener;
 	}
+
+	addTriggerListener(sensor, listener);
 }
 
 void addSensorToActiveSensorsList(struct sensor *newSensor)
@@ -226,6 +445,7 @@ void startSensors()
 	while (activeSensorPtr != NULL)
 	{
 		alwaysDisplayMessage("   %s: ", activeSensorPtr->sensorName);
+		startSensorSchedule(activeSensorPtr);
 		activeSensorPtr->startSensor();
 		activeSensorPtr->getStatusMessage(sensorStatusBuffer, SENSOR_STATUS_BUFFER_SIZE);
 		alwaysDisplayMessage("%s\n", sensorStatusBuffer);
@@ -270,23 +490,86 @@ void startSensorsReading()
 	}
 }
 
-void updateSensors()
+// Only the main loop uses the scheduler, so the sensor deadlines aren't
+// recorded there when the real time task is updating them
+
+void runSensorUpdates(bool useScheduler)
 {
 	sensor *activeSensorPtr = activeSensorList;
 
+	unsigned long passMillis = millis();
+
 	while (activeSensorPtr != NULL)
 	{
 		if (activeSensorPtr->beingUpdated)
 		{
-			unsigned long startMicros = micros();
-			activeSensorPtr->updateSensor();
-			DISPLAY_MEMORY_MONITOR(activeSensorPtr->sensorName);
-			activeSensorPtr->activeTime = ulongDiff(micros(), startMicros);
+			if (schedulerItemDue(activeSensorPtr->nextUpdateMillis, passMillis))
+			{
+				if (useScheduler)
+				{
+					schedulerRecordUpdate(activeSensorPtr->sensorName, activeSensorPtr->updateScheduled,
+										  activeSensorPtr->nextUpdateMillis, millis());
+				}
+
+				activeSensorPtr->updateScheduled = false;
+				unsigned long startMicros = micros();
+				activeSensorPtr->updateSensor();
+				LOOP_TRACE(traceSensor, activeSensorPtr->sensorName, startMicros);
+				DISPLAY_MEMORY_MONITOR(activeSensorPtr->sensorName);
+				activeSensorPtr->activeTime = ulongDiff(micros(), startMicros);
+				recordUpdateTiming(&activeSensorPtr->updateTiming, activeSensorPtr->sensorName, activeSensorPtr->activeTime);
+
+				if (!activeSensorPtr->updateScheduled)
+				{
+					scheduleSensorUpdate(activeSensorPtr, SCHEDULER_DEFAULT_POLL_MILLIS);
+				}
+			}
+			if (useScheduler)
+			{
+				schedulerNoteDeadline(activeSensorPtr->nextUpdateMillis);
+			}
 		}
 		activeSensorPtr = activeSensorPtr->nextActiveSensor;
 	}
 }
 
+void updateSensors()
+{
+	if (dualCoreTasksRunning())
+	{
+		// the real time task looks after the sensors
+		return;
+	}
+
+	runSensorUpdates(true);
+}
+
+void updateRealTimeSensors()
+{
+	runSensorUpdates(false);
+}
+
+int fireSensorListener(struct sensorListener *listener)
+{
+	if (dualCoreTasksRunning())
+	{
+		// a listener that sends its command to another device, or whose
+		// process is on the network core, is performed by the main loop
+		if (listener->config->destination[0] != 0 ||
+			(listener->commandProcess != NULL && listener->commandProcess->core == networkCore))
+		{
+			return forwardListenerToNetworkCore(listener);
+		}
+	}
+
+	if (listener->commandProcess != NULL)
+	{
+		startDeferredProcess(listener->commandProcess);
+	}
+
+	return listener->receiveMessage(listener->config->destination, listener->config->optionBuffer);
+}
+
 void createSensorJson(char *name, char *buffer, int bufferLength)
 {
 	snprintf(buffer, bufferLength, "{ \"dev\":\"%s\"", name);
@@ -470,22 +753,12 @@ void iterateThroughSensorListeners(struct sensor *sensor, void (*func)(struct se
  
 void fireSensorListenersOnTrigger(struct sensor *sensor, int trigger)
 {
-	struct sensorListener *pos = sensor->listeners;
-
-	//messageLogf("      Sensor:%s mask:%d\n", sensor->sensorName, mask);
+	struct sensorListener *pos = findSensorTriggerListeners(sensor, trigger);
 
 	while (pos != NULL)
 	{
-		//messageLogf("        Listener:%s sendoption:%d\n", pos->config->listenerName, pos->config->sendOptionMask);
-		if (pos->config->sendOptionMask == trigger)
-		{
-			//messageLogf("Got a match");
-			// dumpCommand(pos->config->commandProcess, pos->config->commandName, pos->config->optionBuffer);
-
-			pos->receiveMessage(pos->config->destination, pos->config->optionBuffer);
-			//messageLogf("command performed");
-		}
-		pos = pos->nextMessageListener;
+		fireSensorListener(pos);
+		pos = pos->nextTriggerListener;
 	}
 }
 
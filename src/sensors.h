@@ -3,6 +3,7 @@
 #include <Arduino.h>
 #include "settings.h"
 #include "controller.h"
+#include "updateTiming.h"
 
 #define SENSOR_OK 0
 #define SENSOR_OFF 1
@@ -37,8 +38,18 @@ struct sensorListener{
 	unsigned long lastReadingMillis;
 	int (*receiveMessage)(char * destination, unsigned char * options);
 	struct sensorListener * nextMessageListener;
+	// the next listener on the same trigger - see findSensorTriggerListeners
+	struct sensorListener * nextTriggerListener;
+	// the command behind receiveMessage and its process, used to pass the
+	// command to the core that owns the process
+	struct Command * command;
+	struct process * commandProcess;
 };
 
+// Performs the command for a listener. Sensors call this rather than
+// calling receiveMessage directly.
+int fireSensorListener(struct sensorListener * listener);
+
 struct sensorEventBinder{
 	char * listenerName;
 	int trigger;
@@ -68,6 +79,19 @@ struct sensor
 	struct sensorListener * listeners;
 	struct sensorEventBinder * sensorListenerFunctions;
 	int noOfSensorListenerFunctions;
+	// set at run time - one list of listeners for each entry in
+	// sensorListenerFunctions, so a trigger only visits its own listeners
+	struct sensorListener ** triggerListeners;
+	// set at run time - a hash table that maps a trigger straight to its
+	// entry in sensorListenerFunctions - see mapSensorTriggers
+	unsigned char * triggerSlots;
+	int triggerSlotBits;
+	// set at run time by the scheduler - see scheduler.h
+	unsigned long nextUpdateMillis;
+	bool updateScheduled;
+	struct UpdateTiming updateTiming;
+	// NULL unless the sensor keeps a history - see sensorHistory.h
+	struct SensorHistory * history;
 };
 
 void addSensorToAllSensorsList(struct sensor *newSensor);
@@ -79,6 +103,8 @@ void startSensors();
 void dumpSensorStatus();
 void startSensorsReading();
 void updateSensors();
+// updates the sensors from the real time task of the dual core layout
+void updateRealTimeSensors();
 void createSensorJson(char * name, char * buffer, int bufferLength);
 void displaySensorStatus();
 void stopSensors();
@@ -94,8 +120,35 @@ void fireSensorListenersOnTrigger(struct sensor *sensor, int mask);
 struct sensorEventBinder *findSensorListenerByName(struct sensor *s, const char *name);
 struct sensorEventBinder * findSensorEventBinderByTrigger(struct sensor * s, int mask);
 
-void addListenerToDeletedListeners(struct sensorListener * listener);
+// Listeners are indexed by trigger when they are added to a sensor. This
+// returns the first listener for the trigger, and the rest follow through
+// nextTriggerListener. Returns NULL if nothing is listening for the trigger.
+struct sensorListener * findSensorTriggerListeners(struct sensor * sensor, int trigger);
+
+// Room for the trigger lists of all the sensors - a sensor that doesn't fit
+// gets its lists from the heap when it is added
+#define SENSOR_TRIGGER_INDEX_SIZE 64
+
+// The trigger values are sparse - the BME280 ones go up to 0x208 - so each
+// sensor hashes its triggers into a table of slots at least twice the size
+// of its trigger table. A slot holds the trigger's entry number plus one,
+// or zero when it is empty. The BME280 takes 64 slots and the clock 32.
+#define SENSOR_TRIGGER_SLOTS_SIZE 160
+
+// the number of hash bits for a trigger table of the given size
+int sensorTriggerSlotBits(int noOfTriggers);
+// fills in the slots, which must have room for 1 << bits entries
+void mapSensorTriggers(struct sensor *sensor, unsigned char *slots, int bits);
+
+void freeSensorListener(struct sensorListener * listener);
 struct sensorListener * getNewSensorListener();
+
+// Every sensor keeps its active reading in a block from the same pool, so a
+// reading must fit in SENSOR_READING_BLOCK_SIZE bytes
+#define SENSOR_READING_BLOCK_SIZE 80
+#define SENSOR_READING_POOL_SIZE 8
+
+void * allocateSensorReading(int size);
 void removeMessageListenerFromSensor(struct sensor *sensor, struct sensorListener *listener);
 void removeAllMessageListenersFromSensor(struct sensor *sensor);
 void removeAllSensorMessageListeners();
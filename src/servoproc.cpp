@@ -1,6 +1,6 @@
 #include <Arduino.h>
 
-#if defined(ARDUINO_ARCH_ESP8266)
+#if defined(ARDUINO_ARCH_ESP8266) || defined(ARDUINO_ARCH_HOST)
 #include <Servo.h>
 #endif
 
@@ -128,7 +128,9 @@ struct CommandItem servoPositionCommandItem = {
     SERVO_POSITION_COMMAND_OFFSET,
     floatCommand,
     validateFloat0to1,
-    noDefaultAvailable};
+    noDefaultAvailable,
+    NULL,
+    validateFloat0to1CommandValue};
 
 // ************************************* Set servo position
 
@@ -183,22 +185,27 @@ int doSetServoPositionCommand(char * destination, unsigned char * settingBase)
 
 // ************************************ Pulse servo position
 
-bool validateServoPulseLen(void *dest, const char *newValueStr)
+bool validateServoPulseLenValue(void *dest, float value)
 {
-	float value;
-
-	if (!validateFloat(&value, newValueStr))
+	if (value < 0 || value > SERVO_MAX_HOLD_TIME_SECS)
 	{
 		return false;
 	}
 
-	if (value < 0 || value > SERVO_MAX_HOLD_TIME_SECS)
+    putUnalignedFloat(value,(unsigned char *)dest);
+	return true;
+}
+
+bool validateServoPulseLen(void *dest, const char *newValueStr)
+{
+	float value;
+
+	if (!validateFloat(&value, newValueStr))
 	{
 		return false;
 	}
 
-    putUnalignedFloat(value,(unsigned char *)dest);
-	return true;
+	return validateServoPulseLenValue(dest, value);
 }
 
 struct CommandItem servoPulseLenCommandItem = {
@@ -207,7 +214,9 @@ struct CommandItem servoPulseLenCommandItem = {
     SERVO_PULSE_LENGTH_OFFSET,
     floatCommand,
     validateServoPulseLen,
-    noDefaultAvailable};
+    noDefaultAvailable,
+    NULL,
+    validateServoPulseLenValue};
 
 struct CommandItem *pulseServoPositionItems[] =
     {
@@ -21,12 +21,15 @@
 #include "controller.h"
 #include "registration.h"
 #include "HullOS.h"
+#include "settingsSnapshot.h"
+#include "settingsJournal.h"
+#include "settingsArena.h"
 
 // These functions are called to encrypt/decrypt fields of type password
 // They are identical at the momement, but if you want to add some extra
 // salt you can modify them accordingly.
 
-#if defined(ARDUINO_ARCH_ESP32)
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_HOST)
 
 void encryptString(char *destination, int destLength, char *source)
 {
@@ -457,6 +460,39 @@ boolean validateServerName(void *dest, const char *newValueStr)
 	return (validateString((char *)dest, newValueStr, SERVER_NAME_LENGTH));
 }
 
+char *settingTextValue(SettingItem *item)
+{
+	if (item->settingType == arenaText || item->settingType == arenaPassword)
+	{
+		char *text = *(char **)item->value;
+		if (text == NULL)
+		{
+			return (char *)"";
+		}
+		return text;
+	}
+
+	return (char *)item->value;
+}
+
+bool settingIsPassword(SettingItem *item)
+{
+	return item->settingType == password || item->settingType == arenaPassword;
+}
+
+void decryptSettingPassword(SettingItem *item, char *encryptedText)
+{
+	if (item->settingType == arenaPassword)
+	{
+		char passwordBuffer[MAX_SETTING_LENGTH];
+		decryptString(passwordBuffer, item->maxLength, encryptedText);
+		storeArenaString((char **)item->value, passwordBuffer);
+		return;
+	}
+
+	decryptString((char *)item->value, item->maxLength, encryptedText);
+}
+
 void printSettingValue(SettingItem *item, char *buffer, int bufferLength)
 {
 	int *intValuePointer;
@@ -469,10 +505,12 @@ void printSettingValue(SettingItem *item, char *buffer, int bufferLength)
 	{
 
 	case text:
-		snprintf(buffer, bufferLength, "%s", (char *)item->value);
+	case arenaText:
+		snprintf(buffer, bufferLength, "%s", settingTextValue(item));
 		break;
 
 	case password:
+	case arenaPassword:
 		snprintf(buffer, bufferLength, "*****");
 		break;
 
@@ -536,21 +574,69 @@ void dumpSetting(SettingItem *item)
 File saveFile;
 File loadFile;
 
-void saveSettingToFile(SettingItem *item)
+// Number of bytes in the value of a setting. Strings include the terminator.
+
+int settingValueSize(SettingItem *item)
 {
-	char itemBuffer[SETTING_VALUE_OUTPUT_LENGTH];
+	switch (item->settingType)
+	{
+	case text:
+	case password:
+	case arenaText:
+	case arenaPassword:
+		return strlen(settingTextValue(item)) + 1;
+	case integerValue:
+		return sizeof(int);
+	case doubleValue:
+		return sizeof(double);
+	case floatValue:
+		return sizeof(float);
+	case loraKey:
+		return LORA_KEY_LENGTH;
+	case loraID:
+		return sizeof(uint32_t);
+	case yesNo:
+		return sizeof(boolean);
+	default:
+		return 0;
+	}
+}
 
-	if (item->settingType == password)
+unsigned long settingValueCrc(SettingItem *item)
+{
+	if (item->settingType == arenaText || item->settingType == arenaPassword)
+	{
+		return crc32Update(0, (const unsigned char *)settingTextValue(item), settingValueSize(item));
+	}
+
+	return crc32Update(0, (const unsigned char *)item->value, settingValueSize(item));
+}
+
+// Builds the name=value line used for the setting in the settings file
+
+void buildSettingFileLine(SettingItem *item, char *buffer, int bufferLength)
+{
+	char itemBuffer[MAX_SETTING_LENGTH];
+
+	if (settingIsPassword(item))
 	{
 		// need to encrypt the setting item
-		encryptString(itemBuffer, SETTING_VALUE_OUTPUT_LENGTH,
-					  (char *)item->value);
+		encryptString(itemBuffer, MAX_SETTING_LENGTH,
+					  settingTextValue(item));
 	}
 	else
 	{
-		printSettingValue(item, itemBuffer, SETTING_VALUE_OUTPUT_LENGTH);
+		printSettingValue(item, itemBuffer, MAX_SETTING_LENGTH);
 	}
-	saveFile.printf("%s=%s\n", item->formName, itemBuffer);
+	snprintf(buffer, bufferLength, "%s=%s", item->formName, itemBuffer);
+}
+
+void saveSettingToFile(SettingItem *item)
+{
+	char lineBuffer[SETTING_FILE_LINE_LENGTH];
+
+	buildSettingFileLine(item, lineBuffer, SETTING_FILE_LINE_LENGTH);
+	saveFile.printf("%s\n", lineBuffer);
 }
 
 void saveSettingCollectionToFile(SettingItemCollection *settingCollection)
@@ -574,6 +660,77 @@ void saveAllSettingsToFile(char *path)
 	TRACELOGLN("Settings saved");
 }
 
+// Builds the file name for a collection from its name. Characters that
+// can't be used in a file name are replaced with underscores.
+
+void buildSettingCollectionPath(SettingItemCollection *settingCollection, const char *extension, char *dest)
+{
+	char fileName[SETTINGS_COLLECTION_FILE_NAME_LENGTH + 1];
+	int pos;
+
+	for (pos = 0; pos < SETTINGS_COLLECTION_FILE_NAME_LENGTH && settingCollection->collectionName[pos] != 0; pos++)
+	{
+		char ch = settingCollection->collectionName[pos];
+		fileName[pos] = isalnum(ch) ? ch : '_';
+	}
+	fileName[pos] = 0;
+
+	snprintf(dest, SETTINGS_COLLECTION_PATH_LENGTH, "%s/%s%s", SETTINGS_FOLDER, fileName, extension);
+}
+
+// The collection is written to a temporary file which then replaces the
+// old one, so a power failure part way through leaves the old file intact
+
+bool saveSettingCollection(SettingItemCollection *settingCollection)
+{
+	char tempPath[SETTINGS_COLLECTION_PATH_LENGTH];
+	char path[SETTINGS_COLLECTION_PATH_LENGTH];
+
+	if (!LittleFS.exists(SETTINGS_FOLDER))
+	{
+		if (!LittleFS.mkdir(SETTINGS_FOLDER))
+		{
+			TRACELOGLN("Settings folder could not be created");
+			return false;
+		}
+	}
+
+	buildSettingCollectionPath(settingCollection, SETTINGS_COLLECTION_TEMP_EXTENSION, tempPath);
+	buildSettingCollectionPath(settingCollection, SETTINGS_COLLECTION_FILE_EXTENSION, path);
+
+	saveFile = LittleFS.open(tempPath, "w");
+
+	if (!saveFile)
+	{
+		return false;
+	}
+
+	saveSettingCollectionToFile(settingCollection);
+	saveFile.close();
+
+	if (!LittleFS.rename(tempPath, path))
+	{
+		// some file systems won't rename over an existing file
+		LittleFS.remove(path);
+		if (!LittleFS.rename(tempPath, path))
+		{
+			return false;
+		}
+	}
+
+	settingCollection->fileOutOfDate = false;
+	return true;
+}
+
+bool loadSettingCollection(SettingItemCollection *settingCollection)
+{
+	char path[SETTINGS_COLLECTION_PATH_LENGTH];
+
+	buildSettingCollectionPath(settingCollection, SETTINGS_COLLECTION_FILE_EXTENSION, path);
+
+	return loadAllSettingsFromFile(path);
+}
+
 processSettingCommandResult decodeSettingCommand(char *commandStart)
 {
 	char *command = (char *)commandStart;
@@ -598,10 +755,10 @@ processSettingCommandResult decodeSettingCommand(char *commandStart)
 			// move down the input to the new value
 			char *startOfSettingInfo = command + settingNameLength + 1;
 
-			if (setting->settingType == password)
+			if (settingIsPassword(setting))
 			{
 				// need to decode passwords
-				decryptString((char *)setting->value, setting->maxLength, startOfSettingInfo);
+				decryptSettingPassword(setting, startOfSettingInfo);
 				return setOK;
 			}
 
@@ -668,13 +825,15 @@ void appendSettingJSON(SettingItem *item, char *jsonBuffer, int bufferLength)
 	{
 
 	case text:
+	case arenaText:
 		snprintf(jsonBuffer, bufferLength,
 				 "%s\"%s\"",
 				 jsonBuffer,
-				 (char *)item->value);
+				 settingTextValue(item));
 		break;
 
 	case password:
+	case arenaPassword:
 		snprintf(jsonBuffer, bufferLength,
 				 "%s\"******\"",
 				 jsonBuffer);
@@ -861,6 +1020,9 @@ void PrintStorage()
 	iterateThroughSensors(printSettingStorage);
 	alwaysDisplayMessage("Processes");
 	iterateThroughAllProcesses(printProcessStorage);
+	char arenaBuffer[SETTING_ERROR_MESSAGE_LENGTH];
+	settingsArenaStatusMessage(arenaBuffer, SETTING_ERROR_MESSAGE_LENGTH);
+	alwaysDisplayMessage("%s\n", arenaBuffer);
 }
 
 void DumpSettingCollection(SettingItemCollection *settingCollection)
@@ -926,14 +1088,142 @@ void iterateThroughAllSettings(void (*func)(unsigned char *settings, int size))
 	iterateThroughSensorSettings(func);
 }
 
+// Visits every setting in the same order as the settings file
+
+void iterateThroughAllSettingItems(void (*func)(SettingItem *s))
+{
+	iterateThroughSensorSettings(func);
+	iterateThroughProcessSettings(func);
+}
+
+void iterateThroughAllSettingCollections(void (*func)(SettingItemCollection *s))
+{
+	iterateThroughSensorSettingCollections(func);
+	iterateThroughProcessSettingCollections(func);
+}
+
+bool settingCollectionsLoaded;
+
+void loadSettingCollectionFile(SettingItemCollection *settingCollection)
+{
+	if (loadSettingCollection(settingCollection))
+	{
+		settingCollectionsLoaded = true;
+	}
+}
+
+// Loads every collection from its own file. If there are no collection
+// files the old single settings file is split into collection files.
+
+bool loadSettingCollections()
+{
+	settingCollectionsLoaded = false;
+
+	if (LittleFS.exists(SETTINGS_FOLDER))
+	{
+		iterateThroughAllSettingCollections(loadSettingCollectionFile);
+		return settingCollectionsLoaded;
+	}
+
+	if (!loadAllSettingsFromFile(SETTINGS_FILENAME))
+	{
+		return false;
+	}
+
+	// apply any journal written against the old file before it is cleared
+	loadSettingsJournal();
+
+	TRACELOGLN("Splitting the settings file into collections");
+	compactAllSettings();
+	LittleFS.remove(SETTINGS_FILENAME);
+	return true;
+}
+
+struct SettingObserver *settingObservers = NULL;
+
+void addSettingObserver(struct SettingObserver *observer)
+{
+	for (struct SettingObserver *pos = settingObservers; pos != NULL; pos = pos->nextObserver)
+	{
+		if (pos == observer)
+		{
+			// already added
+			return;
+		}
+	}
+
+	observer->notifiedValueCrc = settingValueCrc(observer->item);
+	observer->nextObserver = settingObservers;
+	settingObservers = observer;
+}
+
+void removeSettingObserver(struct SettingObserver *observer)
+{
+	struct SettingObserver **link = &settingObservers;
+
+	while (*link != NULL)
+	{
+		if (*link == observer)
+		{
+			*link = observer->nextObserver;
+			return;
+		}
+		link = &(*link)->nextObserver;
+	}
+}
+
+void notifySettingObservers()
+{
+	struct SettingObserver *observer = settingObservers;
+
+	while (observer != NULL)
+	{
+		// get the next one first in case the observer removes itself
+		struct SettingObserver *next = observer->nextObserver;
+
+		unsigned long crc = settingValueCrc(observer->item);
+
+		if (crc != observer->notifiedValueCrc)
+		{
+			observer->notifiedValueCrc = crc;
+			observer->settingChanged(observer->item);
+		}
+
+		observer = next;
+	}
+}
+
+// Everything that changes settings saves them afterwards, so this is where
+// the observers are told. The settings are written when they have been
+// quiet for a while - see settingsJournal.h
+
 void saveSettings()
 {
-	saveAllSettingsToFile(SETTINGS_FILENAME);
+	notifySettingObservers();
+	requestSettingsSave();
 }
 
 bool loadSettings()
 {
-	return loadAllSettingsFromFile(SETTINGS_FILENAME);
+	if (loadSettingsSnapshot(SETTINGS_SNAPSHOT_FILENAME))
+	{
+		loadSettingsJournal();
+		return true;
+	}
+
+	// No usable snapshot - put the defaults back in case the snapshot was
+	// partly loaded, then use the collection files and make a snapshot from them
+
+	resetSettings();
+
+	if (!loadSettingCollections())
+	{
+		return false;
+	}
+
+	saveSettingsSnapshot(SETTINGS_SNAPSHOT_FILENAME);
+	loadSettingsJournal();
+	return true;
 }
 
 boolean matchSettingCollectionName(SettingItemCollection *settingCollection, const char *name)
@@ -1000,10 +1290,168 @@ SettingItem *findSettingByNameInCollection(SettingItemCollection settingCollecti
 	return NULL;
 }
 
+// The index is an open addressed hash table of setting items keyed on the
+// lower case form name. When it is built it is given at least twice as many
+// slots as there are settings so that searches stay short. It is allocated
+// on the heap and only replaced when more slots are needed. If it can't be
+// allocated the index is abandoned and the settings are searched in turn.
+
+SettingItem **settingIndex = NULL;
+
+int settingIndexSize = 0;
+
+int settingIndexCount;
+
+enum SettingIndexState
+{
+	settingIndexNotBuilt,
+	settingIndexBuilt,
+	settingIndexAbandoned
+};
+
+SettingIndexState settingIndexState = settingIndexNotBuilt;
+
+void invalidateSettingIndex()
+{
+	settingIndexState = settingIndexNotBuilt;
+}
+
+int settingIndexSlots()
+{
+	if (settingIndexState == settingIndexBuilt)
+	{
+		return settingIndexSize;
+	}
+	return 0;
+}
+
+// Hashes the name up to the end of the string or an = character, which
+// starts the value in a name=value command. The length of the name is
+// returned in nameLength.
+
+unsigned int hashSettingName(const char *name, int *nameLength)
+{
+	unsigned long hash = 2166136261UL;
+	int length = 0;
+
+	while (name[length] != 0 && name[length] != '=')
+	{
+		hash ^= (unsigned char)tolower(name[length]);
+		hash *= 16777619UL;
+		length++;
+	}
+
+	*nameLength = length;
+	return (unsigned int)(hash & (settingIndexSize - 1));
+}
+
+bool settingNameMatches(SettingItem *setting, const char *name, int nameLength)
+{
+	return strncasecmp(setting->formName, name, nameLength) == 0 &&
+		   setting->formName[nameLength] == 0;
+}
+
+void addSettingToIndex(SettingItem *setting)
+{
+	int nameLength;
+	unsigned int slot = hashSettingName(setting->formName, &nameLength);
+
+	// there are always more slots than settings, so this finds a space
+	while (true)
+	{
+		SettingItem *entry = settingIndex[slot];
+
+		if (entry == NULL)
+		{
+			settingIndex[slot] = setting;
+			settingIndexCount++;
+			return;
+		}
+
+		if (settingNameMatches(entry, setting->formName, nameLength))
+		{
+			// the first setting with a given name wins, as it does in a search
+			return;
+		}
+
+		slot = (slot + 1) & (settingIndexSize - 1);
+	}
+}
+
+int noOfSettingsToIndex;
+
+void countSettingToIndex(SettingItem *setting)
+{
+	noOfSettingsToIndex++;
+}
+
+void buildSettingIndex()
+{
+	noOfSettingsToIndex = 0;
+	iterateThroughSensorSettings(countSettingToIndex);
+	iterateThroughProcessSettings(countSettingToIndex);
+
+	int size = SETTING_INDEX_MIN_SIZE;
+
+	while (size < noOfSettingsToIndex * 2)
+	{
+		size = size * 2;
+	}
+
+	if (size > settingIndexSize)
+	{
+		free(settingIndex);
+		settingIndex = (SettingItem **)malloc(size * sizeof(SettingItem *));
+
+		if (settingIndex == NULL)
+		{
+			TRACELOGLN("Setting index could not be allocated");
+			settingIndexSize = 0;
+			settingIndexState = settingIndexAbandoned;
+			return;
+		}
+
+		settingIndexSize = size;
+	}
+
+	for (int i = 0; i < settingIndexSize; i++)
+	{
+		settingIndex[i] = NULL;
+	}
+
+	settingIndexCount = 0;
+	settingIndexState = settingIndexBuilt;
+
+	// same search order as the sensor and process lookups
+	iterateThroughSensorSettings(addSettingToIndex);
+	iterateThroughProcessSettings(addSettingToIndex);
+}
+
 SettingItem *findSettingByName(const char *settingName)
 {
 	SettingItem *result;
 
+	if (settingIndexState == settingIndexNotBuilt)
+	{
+		buildSettingIndex();
+	}
+
+	if (settingIndexState == settingIndexBuilt)
+	{
+		int nameLength;
+		unsigned int slot = hashSettingName(settingName, &nameLength);
+
+		while (settingIndex[slot] != NULL)
+		{
+			if (settingNameMatches(settingIndex[slot], settingName, nameLength))
+			{
+				return settingIndex[slot];
+			}
+			slot = (slot + 1) & (settingIndexSize - 1);
+		}
+		return NULL;
+	}
+
 	result = FindSensorSettingByFormName(settingName);
 
 	if (result != NULL)
@@ -1041,6 +1489,8 @@ processSettingCommandResult processSettingCommand(char *commandStart)
 			char *startOfSettingInfo = command + settingNameLength + 1;
 			if (setting->validateValue(setting->value, startOfSettingInfo))
 			{
+				// the setting may not be saved straight away
+				notifySettingObservers();
 				return setOK;
 			}
 			return settingValueInvalid;
@@ -1061,9 +1511,11 @@ void sendSettingItemToJSONString(struct SettingItem *item, char *buffer, int buf
 	switch (item->settingType)
 	{
 	case text:
-		snprintf(buffer, bufferSize, "\"%s\"", (char *)item->value);
+	case arenaText:
+		snprintf(buffer, bufferSize, "\"%s\"", settingTextValue(item));
 		break;
 	case password:
+	case arenaPassword:
 		//snprintf(buffer, bufferSize, "\"%s\"", item->value);
 		snprintf(buffer, bufferSize, "\"******\"");
 		break;
@@ -1139,5 +1591,7 @@ SettingsSetupStatus setupSettings()
 		result = SETTINGS_RESET_TO_DEFAULTS;
 	}
 
+	markAllSettingsSaved();
+
 	return result;
 }
@@ -4,6 +4,16 @@
 #include "FS.h"
 #include <LittleFS.h>
 
+// Each setting collection is stored in its own file in this folder
+#define SETTINGS_FOLDER "/settings"
+#define SETTINGS_COLLECTION_FILE_EXTENSION ".set"
+#define SETTINGS_COLLECTION_TEMP_EXTENSION ".tmp"
+// longest collection name used in a file name
+#define SETTINGS_COLLECTION_FILE_NAME_LENGTH 20
+#define SETTINGS_COLLECTION_PATH_LENGTH 40
+
+// Older versions kept all the settings in this one file. It is read and
+// split into collection files if there are no collection files.
 #define SETTINGS_FILENAME "/Settings.config"
 
 #ifdef DEFAULTS_ON
@@ -51,8 +61,14 @@ extern File loadFile;
 #define LORA_EUI_LENGTH 8
 
 #define MAX_SETTING_LENGTH 300
+// the longest setting name that a line in the settings file makes room for
+#define SETTING_FILE_NAME_LENGTH 40
+// a name=value line in the settings file, with room for the longest value
+#define SETTING_FILE_LINE_LENGTH (SETTING_FILE_NAME_LENGTH + MAX_SETTING_LENGTH + 2)
 
-enum Setting_Type { text, password, integerValue, doubleValue, floatValue, loraKey, loraID, yesNo };
+// The value of an arenaText or arenaPassword setting is a char pointer to the
+// string in the settings arena (see settingsArena.h)
+enum Setting_Type { text, password, integerValue, doubleValue, floatValue, loraKey, loraID, yesNo, arenaText, arenaPassword };
 
 struct SettingItem {
 	char * prompt;
@@ -62,6 +78,8 @@ struct SettingItem {
 	Setting_Type settingType;
 	void (*setDefault)(void * destination);
 	boolean (*validateValue)(void * dest, const char * newValueStr);
+	// CRC of the value when it was last written to the file system - set at run time
+	unsigned long savedValueCrc;
 };
 
 struct SettingItemCollection
@@ -70,8 +88,30 @@ struct SettingItemCollection
 	char * collectionDescription;
 	SettingItem ** settings;
 	int noOfSettings;
+	// set at run time when a setting has changed since the collection file was written
+	bool fileOutOfDate;
 };
 
+// A process can ask to be told when a setting changes so that it can keep
+// working values (for example a pin level or a parsed colour) up to date
+// without re-reading the setting on every update or needing a restart.
+// The observer is supplied by the process and must stay in existence.
+
+struct SettingObserver
+{
+	SettingItem *item;
+	void (*settingChanged)(SettingItem *item);
+	// set when the observer is added and each time it is notified
+	unsigned long notifiedValueCrc;
+	struct SettingObserver *nextObserver;
+};
+
+void addSettingObserver(struct SettingObserver *observer);
+void removeSettingObserver(struct SettingObserver *observer);
+
+// Calls the observers of any settings that have changed since they were last notified
+void notifySettingObservers();
+
 enum processSettingCommandResult { displayedOK, setOK, settingNotFound, settingValueInvalid };
 
 void saveSettings();
@@ -85,10 +125,40 @@ void PrintStorage();
 
 SettingItem* findSettingByName(const char* settingName);
 
+// Settings are found by name using a hash index that is built on the first
+// lookup. It must be rebuilt whenever a sensor or process is added.
+
+// The index is sized when it is built to at least twice the number of
+// settings. Must be a power of two.
+
+#define SETTING_INDEX_MIN_SIZE 64
+
+void invalidateSettingIndex();
+
+// the number of slots in the index, or 0 if the settings are searched in turn
+int settingIndexSlots();
+
 SettingItemCollection * findSettingItemCollectionByName(const char * name);
 boolean matchSettingCollectionName(SettingItemCollection* settingCollection, const char* name);
 boolean matchSettingName(SettingItem* setting, const char* name);
 processSettingCommandResult processSettingCommand(char * command);
+processSettingCommandResult decodeSettingCommand(char *commandStart);
+
+// The characters of a text or password setting of either kind
+char *settingTextValue(SettingItem *item);
+bool settingIsPassword(SettingItem *item);
+void decryptSettingPassword(SettingItem *item, char *encryptedText);
+
+int settingValueSize(SettingItem *item);
+unsigned long settingValueCrc(SettingItem *item);
+void iterateThroughAllSettingItems(void (*func)(SettingItem *s));
+void buildSettingFileLine(SettingItem *item, char *buffer, int bufferLength);
+void saveAllSettingsToFile(char *path);
+bool loadAllSettingsFromFile(char *path);
+void iterateThroughAllSettingCollections(void (*func)(SettingItemCollection *s));
+bool saveSettingCollection(SettingItemCollection *settingCollection);
+bool loadSettingCollection(SettingItemCollection *settingCollection);
+void buildSettingCollectionPath(SettingItemCollection *settingCollection, const char *extension, char *dest);
 
 enum SettingsSetupStatus{
 	SETTINGS_SETUP_OK,
@@ -110,6 +180,9 @@ void appendSettingCollectionJson(SettingItemCollection *settings, char * message
 void appendSettingJSON(SettingItem *item, char *jsonBuffer, int bufferLength);
 
 
+void encryptString(char *destination, int destLength, char *source);
+void decryptString(char *destination, int destLength, char *source);
+
 void setEmptyString(void *dest);
 
 void setFalse(void *dest);
@@ -0,0 +1,226 @@
+#include <Arduino.h>
+#include <strings.h>
+
+#include "debug.h"
+#include "settings.h"
+#include "settingsArena.h"
+
+struct SettingsArenaEntry
+{
+	// NULL when the entry has been released
+	char **owner;
+	// size of the whole entry including this header
+	uint16_t size;
+};
+
+// entries are kept aligned so that the owner pointer can be read directly
+#define SETTINGS_ARENA_ALIGNMENT sizeof(char *)
+
+unsigned char settingsArena[SETTINGS_ARENA_SIZE] __attribute__((aligned(8)));
+
+struct SettingsArenaStats settingsArenaStats;
+
+// owners of empty strings point here rather than into the arena
+char settingsArenaEmptyString[] = "";
+
+bool inSettingsArena(const char *text)
+{
+	return text >= (char *)settingsArena && text < (char *)settingsArena + SETTINGS_ARENA_SIZE;
+}
+
+struct SettingsArenaEntry *settingsArenaEntryAt(int offset)
+{
+	return (struct SettingsArenaEntry *)(settingsArena + offset);
+}
+
+int settingsArenaEntrySize(int textLength)
+{
+	int size = sizeof(struct SettingsArenaEntry) + textLength + 1;
+
+	return (size + SETTINGS_ARENA_ALIGNMENT - 1) & ~(SETTINGS_ARENA_ALIGNMENT - 1);
+}
+
+int settingsArenaOwnedSize(char **owner)
+{
+	if (*owner == NULL || !inSettingsArena(*owner))
+	{
+		return 0;
+	}
+
+	struct SettingsArenaEntry *entry = ((struct SettingsArenaEntry *)*owner) - 1;
+	return entry->size;
+}
+
+// anything that isn't in the arena, the empty string or NULL was copied
+// to the heap
+bool onSettingsHeap(const char *text)
+{
+	return text != NULL && text != settingsArenaEmptyString && !inSettingsArena(text);
+}
+
+void releaseSettingsArenaString(char **owner)
+{
+	if (onSettingsHeap(*owner))
+	{
+		settingsArenaStats.heapStrings--;
+		settingsArenaStats.heapBytes -= strlen(*owner) + 1;
+		free(*owner);
+		*owner = NULL;
+		return;
+	}
+
+	if (*owner == NULL || !inSettingsArena(*owner))
+	{
+		return;
+	}
+
+	struct SettingsArenaEntry *entry = ((struct SettingsArenaEntry *)*owner) - 1;
+	settingsArenaStats.bytesLive -= entry->size;
+	entry->owner = NULL;
+}
+
+// Moves the live entries to the bottom of the arena and tells their owners
+// where their strings have gone.
+
+void compactSettingsArena()
+{
+	int from = 0;
+	int to = 0;
+
+	while (from < settingsArenaStats.bytesInUse)
+	{
+		struct SettingsArenaEntry *entry = settingsArenaEntryAt(from);
+		int size = entry->size;
+
+		if (entry->owner != NULL)
+		{
+			if (to != from)
+			{
+				memmove(settingsArena + to, settingsArena + from, size);
+			}
+			struct SettingsArenaEntry *moved = settingsArenaEntryAt(to);
+			*moved->owner = (char *)(moved + 1);
+			to += size;
+		}
+		from += size;
+	}
+
+	settingsArenaStats.bytesInUse = to;
+	settingsArenaStats.compactions++;
+}
+
+bool storeHeapString(char **owner, const char *text, int length)
+{
+	TRACELOGLN("Settings arena full, using the heap");
+
+	char *copy = (char *)malloc(length + 1);
+
+	if (copy == NULL)
+	{
+		settingsArenaStats.storeFailures++;
+		return false;
+	}
+
+	strcpy(copy, text);
+
+	releaseSettingsArenaString(owner);
+	*owner = copy;
+
+	settingsArenaStats.heapStrings++;
+	settingsArenaStats.heapBytes += length + 1;
+
+	return true;
+}
+
+bool storeArenaString(char **owner, const char *text)
+{
+	char copyBuffer[MAX_SETTING_LENGTH + 1];
+
+	if (text == *owner)
+	{
+		return true;
+	}
+
+	if (inSettingsArena(text))
+	{
+		// the source may move when the arena is compacted
+		snprintf(copyBuffer, MAX_SETTING_LENGTH + 1, "%s", text);
+		text = copyBuffer;
+	}
+
+	int length = strlen(text);
+
+	if (length == 0)
+	{
+		releaseSettingsArenaString(owner);
+		*owner = settingsArenaEmptyString;
+		return true;
+	}
+
+	int size = settingsArenaEntrySize(length);
+
+	if (settingsArenaStats.bytesLive - settingsArenaOwnedSize(owner) + size > SETTINGS_ARENA_SIZE)
+	{
+		return storeHeapString(owner, text, length);
+	}
+
+	releaseSettingsArenaString(owner);
+
+	if (settingsArenaStats.bytesInUse + size > SETTINGS_ARENA_SIZE)
+	{
+		compactSettingsArena();
+	}
+
+	struct SettingsArenaEntry *entry = settingsArenaEntryAt(settingsArenaStats.bytesInUse);
+	entry->owner = owner;
+	entry->size = size;
+
+	char *dest = (char *)(entry + 1);
+	strcpy(dest, text);
+	*owner = dest;
+
+	settingsArenaStats.bytesInUse += size;
+	settingsArenaStats.bytesLive += size;
+
+	if (settingsArenaStats.bytesLive > settingsArenaStats.highWater)
+	{
+		settingsArenaStats.highWater = settingsArenaStats.bytesLive;
+	}
+
+	return true;
+}
+
+boolean validateArenaString(void *dest, const char *newValueStr, int maxLength)
+{
+	if (strlen(newValueStr) > (unsigned int)(maxLength - 1))
+		return false;
+
+	return storeArenaString((char **)dest, newValueStr);
+}
+
+void setDefaultArenaString(void *dest, const char *text)
+{
+	if (!storeArenaString((char **)dest, text))
+	{
+		storeArenaString((char **)dest, "");
+	}
+}
+
+void setEmptyArenaString(void *dest)
+{
+	storeArenaString((char **)dest, "");
+}
+
+void settingsArenaStatusMessage(char *buffer, int bufferLength)
+{
+	snprintf(buffer, bufferLength,
+			 "Settings arena size:%d in use:%d live:%d high water:%d compactions:%lu full:%lu heap strings:%d heap bytes:%d",
+			 SETTINGS_ARENA_SIZE,
+			 settingsArenaStats.bytesInUse,
+			 settingsArenaStats.bytesLive,
+			 settingsArenaStats.highWater,
+			 settingsArenaStats.compactions,
+			 settingsArenaStats.storeFailures,
+			 settingsArenaStats.heapStrings,
+			 settingsArenaStats.heapBytes);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+// String settings of type arenaText and arenaPassword don't reserve a buffer
+// of their maximum length. The setting value is a char pointer which points
+// at the characters in this arena. The maxLength of the setting is only used
+// as a limit when a new value is validated.
+//
+// Each string is held in an entry which starts with the size of the entry
+// and the address of the pointer that owns it. When a string is replaced its
+// old entry is released and when the arena fills up the live entries are
+// moved down and their owners updated. This means that a pointer to an arena
+// string must not be kept across a call that might change a setting - read
+// it from the settings structure each time it is used.
+//
+// Empty strings don't use any arena space.
+//
+// The arena is sized for the values that are normally set, not for every
+// string at its maxLength. A string that doesn't fit in the arena is copied
+// to the heap instead, so any value within maxLength can be stored. The
+// storage command shows how many strings have gone to the heap.
+
+#if defined(ARDUINO_ARCH_ESP32)
+#define SETTINGS_ARENA_SIZE 1024
+#else
+#define SETTINGS_ARENA_SIZE 512
+#endif
+
+struct SettingsArenaStats
+{
+	int bytesInUse;
+	int bytesLive;
+	int highWater;
+	unsigned long compactions;
+	unsigned long storeFailures;
+	// strings that didn't fit in the arena
+	int heapStrings;
+	int heapBytes;
+};
+
+extern struct SettingsArenaStats settingsArenaStats;
+
+// Makes the owner point at a copy of the text. Returns false and leaves the
+// owner unchanged if there is no room for it in the arena or the heap.
+bool storeArenaString(char **owner, const char *text);
+
+// Validate function body for arena strings
+boolean validateArenaString(void *dest, const char *newValueStr, int maxLength);
+
+// Default function body for arena strings. If the default won't fit the
+// value is set to an empty string.
+void setDefaultArenaString(void *dest, const char *text);
+
+void setEmptyArenaString(void *dest);
+
+void settingsArenaStatusMessage(char *buffer, int bufferLength);
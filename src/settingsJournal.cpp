@@ -0,0 +1,253 @@
+#include <Arduino.h>
+#include <strings.h>
+
+#if defined(ARDUINO_ARCH_ESP8266)
+#include "LittleFS.h"
+#endif
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include "FS.h"
+#endif
+
+#include "debug.h"
+#include "utils.h"
+#include "settings.h"
+#include "settingsSnapshot.h"
+#include "settingsJournal.h"
+
+struct SettingsSaveStats settingsSaveStats;
+
+bool settingsSaveRequested = false;
+bool settingsCompactionFailed;
+unsigned long settingsSaveRequestMillis;
+
+void markSettingSaved(SettingItem *item)
+{
+	item->savedValueCrc = settingValueCrc(item);
+}
+
+void markAllSettingsSaved()
+{
+	iterateThroughAllSettingItems(markSettingSaved);
+}
+
+void requestSettingsSave()
+{
+	settingsSaveRequested = true;
+	settingsSaveRequestMillis = millis();
+	settingsSaveStats.saveRequests++;
+}
+
+void updateSettingsSave()
+{
+	if (!settingsSaveRequested)
+	{
+		return;
+	}
+
+	if (ulongDiff(millis(), settingsSaveRequestMillis) < SETTINGS_SAVE_QUIET_MILLIS)
+	{
+		return;
+	}
+
+	commitSettings();
+}
+
+void flushPendingSettings()
+{
+	if (settingsSaveRequested)
+	{
+		commitSettings();
+	}
+}
+
+void saveOutOfDateSettingCollection(SettingItemCollection *settingCollection)
+{
+	if (!settingCollection->fileOutOfDate)
+	{
+		return;
+	}
+
+	if (saveSettingCollection(settingCollection))
+	{
+		char path[SETTINGS_COLLECTION_PATH_LENGTH];
+		buildSettingCollectionPath(settingCollection, SETTINGS_COLLECTION_FILE_EXTENSION, path);
+
+		File collectionFile = LittleFS.open(path, "r");
+		if (collectionFile)
+		{
+			settingsSaveStats.fullWriteBytes += collectionFile.size();
+			collectionFile.close();
+		}
+	}
+	else
+	{
+		settingsCompactionFailed = true;
+	}
+}
+
+void compactSettings()
+{
+	TRACELOGLN("Rewriting the changed setting collections");
+
+	settingsCompactionFailed = false;
+
+	iterateThroughAllSettingCollections(saveOutOfDateSettingCollection);
+
+	if (settingsCompactionFailed)
+	{
+		// keep the journal, it still holds the changes
+		TRACELOGLN("  collection could not be saved");
+		return;
+	}
+
+	// the snapshot must match the collection files before the journal goes
+
+	saveSettingsSnapshot(SETTINGS_SNAPSHOT_FILENAME);
+
+	LittleFS.remove(SETTINGS_JOURNAL_FILENAME);
+
+	markAllSettingsSaved();
+	settingsSaveStats.fullWrites++;
+}
+
+void markSettingCollectionOutOfDate(SettingItemCollection *settingCollection)
+{
+	settingCollection->fileOutOfDate = true;
+}
+
+void compactAllSettings()
+{
+	iterateThroughAllSettingCollections(markSettingCollectionOutOfDate);
+	compactSettings();
+}
+
+File journalFile;
+
+void journalChangedSettings(SettingItemCollection *settingCollection)
+{
+	for (int settingNo = 0; settingNo < settingCollection->noOfSettings; settingNo++)
+	{
+		SettingItem *item = settingCollection->settings[settingNo];
+
+		unsigned long crc = settingValueCrc(item);
+
+		if (crc == item->savedValueCrc)
+		{
+			continue;
+		}
+
+		char lineBuffer[SETTING_FILE_LINE_LENGTH];
+
+		buildSettingFileLine(item, lineBuffer, SETTING_FILE_LINE_LENGTH);
+
+		unsigned long lineCrc = crc32Update(0, (const unsigned char *)lineBuffer, strlen(lineBuffer));
+
+		settingsSaveStats.journalBytes += journalFile.printf("%08lx %s\n", lineCrc, lineBuffer);
+
+		item->savedValueCrc = crc;
+		settingCollection->fileOutOfDate = true;
+	}
+}
+
+void commitSettings()
+{
+	settingsSaveRequested = false;
+
+	if (!LittleFS.exists(SETTINGS_FOLDER))
+	{
+		// nothing to add a journal to
+		compactAllSettings();
+		return;
+	}
+
+	journalFile = LittleFS.open(SETTINGS_JOURNAL_FILENAME, "a");
+
+	if (!journalFile)
+	{
+		compactAllSettings();
+		return;
+	}
+
+	iterateThroughAllSettingCollections(journalChangedSettings);
+
+	size_t journalSize = journalFile.size();
+
+	journalFile.close();
+
+	settingsSaveStats.journalWrites++;
+
+	if (journalSize > SETTINGS_JOURNAL_LIMIT)
+	{
+		compactSettings();
+	}
+}
+
+// A setting replayed from the journal may not be in its collection file, so
+// the collection has to be rewritten when the journal is compacted.
+
+SettingItem *replayedSetting;
+
+void markReplayedSettingCollectionOutOfDate(SettingItemCollection *settingCollection)
+{
+	for (int settingNo = 0; settingNo < settingCollection->noOfSettings; settingNo++)
+	{
+		if (settingCollection->settings[settingNo] == replayedSetting)
+		{
+			settingCollection->fileOutOfDate = true;
+			return;
+		}
+	}
+}
+
+// Applies the journal on top of the settings that have been loaded. Lines
+// that fail their CRC are ignored.
+
+bool loadSettingsJournal()
+{
+	File loadJournal = LittleFS.open(SETTINGS_JOURNAL_FILENAME, "r");
+
+	if (!loadJournal || loadJournal.isDirectory())
+	{
+		return false;
+	}
+
+	while (loadJournal.available())
+	{
+		String line = loadJournal.readStringUntil('\n');
+
+		const char *lineChar = line.c_str();
+
+		if (line.length() < 10 || lineChar[8] != ' ')
+		{
+			continue;
+		}
+
+		unsigned long lineCrc = strtoul(lineChar, NULL, 16);
+		const char *setting = lineChar + 9;
+
+		if (crc32Update(0, (const unsigned char *)setting, strlen(setting)) != lineCrc)
+		{
+			TRACELOG("  damaged journal line:");
+			TRACELOGLN(lineChar);
+			continue;
+		}
+
+		replayedSetting = findSettingByName(setting);
+
+		if (decodeSettingCommand((char *)setting) != setOK)
+		{
+			TRACELOG("  bad journal setting:");
+			TRACELOGLN(setting);
+			continue;
+		}
+
+		if (replayedSetting != NULL)
+		{
+			iterateThroughAllSettingCollections(markReplayedSettingCollectionOutOfDate);
+		}
+	}
+
+	loadJournal.close();
+	return true;
+}
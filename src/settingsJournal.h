@@ -0,0 +1,56 @@
+#pragma once
+
+#include "settings.h"
+
+// saveSettings doesn't write the settings straight away. It asks for a save
+// which is performed once the settings have been left alone for a while,
+// so a burst of changes only causes one write.
+//
+// Only the settings that have changed since they were last written are
+// saved. They are appended to a journal file as name=value lines, each
+// preceded by a CRC so that a line damaged by a power failure is ignored.
+// When the journal gets large the collection files that hold changed
+// settings are rewritten. Each is written to a temporary file which is then
+// renamed over the old one, so there is always a complete file for every
+// collection on the device.
+
+#define SETTINGS_JOURNAL_FILENAME "/Settings.journal"
+
+// journal size that triggers a rewrite of the settings file
+#define SETTINGS_JOURNAL_LIMIT 2048
+
+// time with no changes before pending settings are written
+#define SETTINGS_SAVE_QUIET_MILLIS 2000
+
+struct SettingsSaveStats
+{
+	unsigned long saveRequests;
+	unsigned long journalWrites;
+	unsigned long journalBytes;
+	unsigned long fullWrites;
+	unsigned long fullWriteBytes;
+};
+
+extern struct SettingsSaveStats settingsSaveStats;
+
+void requestSettingsSave();
+
+// called from the main loop to write the settings once they are quiet
+void updateSettingsSave();
+
+// writes any pending settings now - used before a restart
+void flushPendingSettings();
+
+// writes any changed settings now
+void commitSettings();
+
+// rewrites the changed collection files and clears the journal
+void compactSettings();
+
+// rewrites every collection file and clears the journal
+void compactAllSettings();
+
+bool loadSettingsJournal();
+
+// records the current values as the ones in the file system
+void markAllSettingsSaved();
@@ -0,0 +1,260 @@
+#include <Arduino.h>
+#include <strings.h>
+
+#if defined(ARDUINO_ARCH_ESP8266)
+#include "LittleFS.h"
+#endif
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include "FS.h"
+#endif
+
+#include "debug.h"
+#include "utils.h"
+#include "settings.h"
+#include "sensors.h"
+#include "processes.h"
+#include "settingsSnapshot.h"
+#include "settingsArena.h"
+
+unsigned long snapshotLayoutHash;
+
+void hashSettingLayout(SettingItem *item)
+{
+	unsigned char description[3];
+
+	description[0] = (unsigned char)item->settingType;
+	description[1] = (unsigned char)(item->maxLength >> 8);
+	description[2] = (unsigned char)item->maxLength;
+
+	snapshotLayoutHash = crc32Update(snapshotLayoutHash, (const unsigned char *)item->formName, strlen(item->formName));
+	snapshotLayoutHash = crc32Update(snapshotLayoutHash, description, sizeof(description));
+}
+
+unsigned long settingsLayoutHash()
+{
+	snapshotLayoutHash = 0;
+	iterateThroughAllSettingItems(hashSettingLayout);
+	return snapshotLayoutHash;
+}
+
+File snapshotFile;
+
+bool snapshotWriting;
+bool snapshotLoadOK;
+unsigned long snapshotCrc;
+unsigned long snapshotLength;
+
+void snapshotOutput(const unsigned char *data, int length)
+{
+	snapshotCrc = crc32Update(snapshotCrc, data, length);
+	snapshotLength += length;
+
+	if (snapshotWriting)
+	{
+		snapshotFile.write(data, length);
+	}
+}
+
+// Text and password values are stored as a two byte length followed by the
+// string and its terminator. All the other types are stored as their raw bytes.
+
+void snapshotSettingItem(SettingItem *item)
+{
+	char passwordBuffer[MAX_SETTING_LENGTH];
+	const unsigned char *data = (const unsigned char *)item->value;
+	int length;
+
+	if (settingIsPassword(item))
+	{
+		// passwords are held encrypted, as they are in the text file
+		encryptString(passwordBuffer, MAX_SETTING_LENGTH, settingTextValue(item));
+		data = (const unsigned char *)passwordBuffer;
+	}
+	else if (item->settingType == arenaText)
+	{
+		data = (const unsigned char *)settingTextValue(item);
+	}
+
+	switch (item->settingType)
+	{
+	case password:
+	case text:
+	case arenaPassword:
+	case arenaText:
+	{
+		length = strlen((const char *)data) + 1;
+		unsigned char lengthBytes[2];
+		lengthBytes[0] = (unsigned char)(length >> 8);
+		lengthBytes[1] = (unsigned char)length;
+		snapshotOutput(lengthBytes, 2);
+		break;
+	}
+	default:
+		length = settingValueSize(item);
+		break;
+	}
+
+	snapshotOutput(data, length);
+}
+
+bool saveSettingsSnapshot(const char *path)
+{
+	struct SettingsSnapshotHeader header;
+
+	// first pass works out the length and CRC of the values
+
+	snapshotWriting = false;
+	snapshotCrc = 0;
+	snapshotLength = 0;
+	iterateThroughAllSettingItems(snapshotSettingItem);
+
+	header.magic = SETTINGS_SNAPSHOT_MAGIC;
+	header.version = SETTINGS_SNAPSHOT_VERSION;
+	header.layoutHash = settingsLayoutHash();
+	header.dataLength = snapshotLength;
+	header.dataCrc = snapshotCrc;
+
+	snapshotFile = LittleFS.open(path, "w");
+
+	if (!snapshotFile)
+	{
+		TRACELOGLN("Could not create the settings snapshot");
+		return false;
+	}
+
+	snapshotFile.write((const unsigned char *)&header, sizeof(header));
+
+	// second pass writes them
+
+	snapshotWriting = true;
+	snapshotCrc = 0;
+	snapshotLength = 0;
+	iterateThroughAllSettingItems(snapshotSettingItem);
+
+	snapshotFile.close();
+	return true;
+}
+
+bool snapshotInput(unsigned char *dest, int length)
+{
+	if ((int)snapshotFile.read(dest, length) != length)
+	{
+		snapshotLoadOK = false;
+		return false;
+	}
+
+	snapshotCrc = crc32Update(snapshotCrc, dest, length);
+	return true;
+}
+
+void loadSnapshotSettingItem(SettingItem *item)
+{
+	char passwordBuffer[MAX_SETTING_LENGTH];
+	char textBuffer[MAX_SETTING_LENGTH];
+	unsigned char lengthBytes[2];
+	int length;
+
+	if (!snapshotLoadOK)
+	{
+		return;
+	}
+
+	switch (item->settingType)
+	{
+	case text:
+		if (!snapshotInput(lengthBytes, 2))
+			return;
+		length = (lengthBytes[0] << 8) + lengthBytes[1];
+		if (length < 1 || length > item->maxLength)
+		{
+			snapshotLoadOK = false;
+			return;
+		}
+		if (!snapshotInput((unsigned char *)item->value, length))
+			return;
+		((char *)item->value)[length - 1] = 0;
+		break;
+
+	case arenaText:
+		if (!snapshotInput(lengthBytes, 2))
+			return;
+		length = (lengthBytes[0] << 8) + lengthBytes[1];
+		if (length < 1 || length > item->maxLength)
+		{
+			snapshotLoadOK = false;
+			return;
+		}
+		// arena strings are read into a buffer and then stored
+		if (!snapshotInput((unsigned char *)textBuffer, length))
+			return;
+		textBuffer[length - 1] = 0;
+		if (!storeArenaString((char **)item->value, textBuffer))
+		{
+			snapshotLoadOK = false;
+		}
+		break;
+
+	case password:
+	case arenaPassword:
+		if (!snapshotInput(lengthBytes, 2))
+			return;
+		length = (lengthBytes[0] << 8) + lengthBytes[1];
+		if (length < 1 || length > MAX_SETTING_LENGTH)
+		{
+			snapshotLoadOK = false;
+			return;
+		}
+		if (!snapshotInput((unsigned char *)passwordBuffer, length))
+			return;
+		passwordBuffer[length - 1] = 0;
+		decryptSettingPassword(item, passwordBuffer);
+		break;
+
+	default:
+		snapshotInput((unsigned char *)item->value, settingValueSize(item));
+		break;
+	}
+}
+
+bool loadSettingsSnapshot(const char *path)
+{
+	struct SettingsSnapshotHeader header;
+
+	TRACELOG("Loading the settings snapshot:");
+	TRACELOGLN(path);
+
+	snapshotFile = LittleFS.open(path, "r");
+
+	if (!snapshotFile || snapshotFile.isDirectory())
+	{
+		TRACELOGLN("  no snapshot");
+		return false;
+	}
+
+	if (snapshotFile.read((unsigned char *)&header, sizeof(header)) != sizeof(header) ||
+		header.magic != SETTINGS_SNAPSHOT_MAGIC ||
+		header.version != SETTINGS_SNAPSHOT_VERSION ||
+		header.layoutHash != settingsLayoutHash() ||
+		snapshotFile.size() != sizeof(header) + header.dataLength)
+	{
+		TRACELOGLN("  snapshot does not match this firmware");
+		snapshotFile.close();
+		return false;
+	}
+
+	snapshotLoadOK = true;
+	snapshotCrc = 0;
+	iterateThroughAllSettingItems(loadSnapshotSettingItem);
+
+	snapshotFile.close();
+
+	if (!snapshotLoadOK || snapshotCrc != header.dataCrc)
+	{
+		TRACELOGLN("  snapshot damaged");
+		return false;
+	}
+
+	TRACELOGLN("  snapshot loaded");
+	return true;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "settings.h"
+
+// The settings snapshot is a binary copy of all the setting values which is
+// written alongside the text settings file. At boot the values are read
+// straight into the settings without any name lookup or text parsing.
+//
+// The snapshot holds a hash of the names, types and lengths of all the
+// settings so that it is ignored after a firmware change that alters the
+// settings layout, and a CRC of the values so that it is ignored if it
+// is damaged. In either case the text file is loaded instead.
+
+#define SETTINGS_SNAPSHOT_FILENAME "/Settings.bin"
+
+// "HSS1" read as a little endian number
+#define SETTINGS_SNAPSHOT_MAGIC 0x31535348UL
+#define SETTINGS_SNAPSHOT_VERSION 1
+
+struct SettingsSnapshotHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t layoutHash;
+	uint32_t dataLength;
+	uint32_t dataCrc;
+};
+
+unsigned long settingsLayoutHash();
+
+bool saveSettingsSnapshot(const char *path);
+
+// If this returns false the setting values may have been partly
+// overwritten and should be reset before loading them from elsewhere
+
+bool loadSettingsSnapshot(const char *path);
@@ -11,6 +11,7 @@
 #include "pixels.h"
 #include "statusled.h"
 #include "console.h"
+#include "loopTracer.h"
 
 #if defined(ARDUINO_ARCH_ESP32)
 
@@ -312,19 +313,21 @@ void sendCollectionSettingsPage(SettingItemCollection *settingCollection, const
     switch (settingCollection->settings[i]->settingType)
     {
     case text:
+    case arenaText:
       snprintf(settingBuffer, SETTING_BUFFER_SIZE, "<label for='%s'>%s</label> ",
                formName, prompt);
       server->sendContent(settingBuffer);
       snprintf(settingBuffer, SETTING_BUFFER_SIZE, "<input name='%s' id='%s' type ='text' value='%s' style='margin-left: 20px; line-height: 50%%'><br>",
-               formName, formName, (char *)valueRef);
+               formName, formName, settingTextValue(settingCollection->settings[i]));
       server->sendContent(settingBuffer);
       break;
     case password:
+    case arenaPassword:
       snprintf(settingBuffer, SETTING_BUFFER_SIZE, "<label for='%s'>%s</label> ",
                formName, prompt);
       server->sendContent(settingBuffer);
       snprintf(settingBuffer, SETTING_BUFFER_SIZE, "<input name='%s' id='%s' type='password' value='%s' style='margin-left: 20px; line-height: 50%%'><br>",
-               formName, formName, (char *)valueRef);
+               formName, formName, settingTextValue(settingCollection->settings[i]));
       server->sendContent(settingBuffer);
       break;
     case integerValue:
@@ -544,6 +547,21 @@ void handleNotFound()
   }
 }
 
+// The loop trace is still in RAM when the web host is started from the
+// console, so it can be fetched from /trace and saved as a .json file
+
+void sendLoopTraceText(const char *text)
+{
+  server->sendContent(text);
+}
+
+void handleLoopTrace()
+{
+  server->chunkedResponseModeStart(200, F("application/json"));
+  writeLoopTraceJson(sendLoopTraceText);
+  server->chunkedResponseFinalize();
+}
+
 void startHostingConfigWebsite(bool timeout)
 {
 
@@ -588,6 +606,8 @@ void startHostingConfigWebsite(bool timeout)
 
   server->on("/", handleRoot);
 
+  server->on("/trace", handleLoopTrace);
+
   server->on("/inline", []()
              { server->send(200, "text/plain", "this works as well"); });
 
@@ -0,0 +1,57 @@
+#include <Arduino.h>
+#include <string.h>
+
+#include "spscQueue.h"
+
+void spscQueueInit(struct SpscQueue *queue, unsigned char *slots, int itemSize, unsigned int noOfSlots)
+{
+	queue->slots = slots;
+	queue->itemSize = itemSize;
+	queue->noOfSlots = noOfSlots;
+	queue->head = 0;
+	queue->tail = 0;
+	queue->pushFailures = 0;
+}
+
+// pushed from interrupt handlers, so it has to stay in RAM
+bool ICACHE_RAM_ATTR spscQueuePush(struct SpscQueue *queue, const void *item)
+{
+	unsigned int head = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+	unsigned int tail = __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+
+	if (head - tail >= queue->noOfSlots)
+	{
+		queue->pushFailures++;
+		return false;
+	}
+
+	unsigned char *slot = queue->slots + (head & (queue->noOfSlots - 1)) * queue->itemSize;
+	memcpy(slot, item, queue->itemSize);
+
+	// the item must be in the slot before the consumer can see it
+	__atomic_store_n(&queue->head, head + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+bool spscQueuePop(struct SpscQueue *queue, void *item)
+{
+	unsigned int tail = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+	unsigned int head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+
+	if (head == tail)
+	{
+		return false;
+	}
+
+	unsigned char *slot = queue->slots + (tail & (queue->noOfSlots - 1)) * queue->itemSize;
+	memcpy(item, slot, queue->itemSize);
+
+	// the slot can't be reused until the item has been copied out
+	__atomic_store_n(&queue->tail, tail + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+unsigned int spscQueueDepth(struct SpscQueue *queue)
+{
+	return __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE) - __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+// A single producer, single consumer queue of fixed size items. One task
+// may push and one other task may pop without any locks. It only uses the
+// compiler atomic builtins so it builds on any GCC target.
+//
+// The head is only written by the producer and the tail only by the
+// consumer. They count up forever and are masked to find the slot, so the
+// number of slots must be a power of two.
+//
+// The push can be called from an interrupt handler as long as only that
+// handler pushes to the queue.
+
+struct SpscQueue
+{
+	unsigned char *slots;
+	int itemSize;
+	unsigned int noOfSlots;
+	unsigned int head;
+	unsigned int tail;
+	// only written by the producer
+	unsigned long pushFailures;
+};
+
+// slots must hold noOfSlots * itemSize bytes
+void spscQueueInit(struct SpscQueue *queue, unsigned char *slots, int itemSize, unsigned int noOfSlots);
+
+// copies itemSize bytes into the queue - returns false if the queue is full
+bool spscQueuePush(struct SpscQueue *queue, const void *item);
+
+// copies the oldest item out of the queue - returns false if it is empty
+bool spscQueuePop(struct SpscQueue *queue, void *item);
+
+unsigned int spscQueueDepth(struct SpscQueue *queue);
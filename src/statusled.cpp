@@ -6,6 +6,7 @@
 #include "processes.h"
 #include "messages.h"
 #include "printer.h"
+#include "scheduler.h"
 
 unsigned long millisAtLastFlash;
 unsigned long flashDurationInMillis = 0;
@@ -34,7 +35,7 @@ struct SettingItem statusLedOutputPinActiveLowSetting = {
     &statusLedSettings.statusLedOutputPinActiveLow,
     ONOFF_INPUT_LENGTH,
     yesNo,
-	#if defined(ARDUINO_ARCH_ESP32)
+	#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_HOST)
     setFalse,
     #endif
 	#if defined(ARDUINO_ARCH_ESP8266)
@@ -63,15 +64,18 @@ struct SettingItemCollection statusLedSettingItems = {
     statusLedSettingItemPointers,
     sizeof(statusLedSettingItemPointers) / sizeof(struct SettingItem *)};
 
+// The pin and the level that lights the led are worked out from the settings
+// when the hardware is set up and again whenever the settings change
+
+int statusLedPin;
+bool statusLedOnLevel;
+
 void statusLedOff()
 {
     if (!ledLit)
         return;
 
-    if (statusLedSettings.statusLedOutputPinActiveLow)
-        digitalWrite(statusLedSettings.statusLedOutputPin, true);
-    else
-        digitalWrite(statusLedSettings.statusLedOutputPin, false);
+    digitalWrite(statusLedPin, !statusLedOnLevel);
 
     ledLit = false;
 }
@@ -81,13 +85,7 @@ void statusLedOn()
     if (ledLit)
         return;
 
-    if (statusLedSettings.statusLedOutputPinActiveLow)
-    {
-        digitalWrite(statusLedSettings.statusLedOutputPin, false);
-    }
-    else{
-        digitalWrite(statusLedSettings.statusLedOutputPin, true);
-    }
+    digitalWrite(statusLedPin, statusLedOnLevel);
 
     ledLit = true;
 }
@@ -109,6 +107,8 @@ void startstatusLedFlash(int flashLength)
     millisAtLastFlash = millis();
 
     flashDurationInMillis = flashLength;
+
+    wakeProcess(&statusLedProcess);
 }
 
 void updateStatusLedFlash()
@@ -125,6 +125,28 @@ void updateStatusLedFlash()
         statusLedToggle();
 }
 
+// The led only needs attention when the next flash is due
+
+void scheduleStatusLedUpdate()
+{
+    if (flashDurationInMillis == 0)
+    {
+        scheduleProcessUpdate(&statusLedProcess, SCHEDULER_IDLE_MILLIS);
+        return;
+    }
+
+    unsigned long millisSinceLastFlash = millis() - millisAtLastFlash;
+
+    if (millisSinceLastFlash > flashDurationInMillis)
+    {
+        scheduleProcessUpdate(&statusLedProcess, 0);
+    }
+    else
+    {
+        scheduleProcessUpdate(&statusLedProcess, flashDurationInMillis - millisSinceLastFlash + 1);
+    }
+}
+
 #define DIGIT_FLASH_INTERVAL 400
 #define DIGIT_GAP 500
 
@@ -164,6 +186,7 @@ void setFlashLength(int flashLength)
     millisAtLastFlash = millis();
     flashDurationInMillis = flashLength;
     statusLedOn();
+    wakeProcess(&statusLedProcess);
 }
 
 void displayMessageOnStatusLed(int messageNumber, ledFlashBehaviour severity, char *messageText)
@@ -200,8 +223,35 @@ void displayMessageOnStatusLed(int messageNumber, ledFlashBehaviour severity, ch
     setFlashLength(length);
 }
 
+void statusLedPinSettingChanged(SettingItem *item)
+{
+    // put the old pin out and move the led to the new one
+    digitalWrite(statusLedPin, !statusLedOnLevel);
+    statusLedPin = statusLedSettings.statusLedOutputPin;
+    pinMode(statusLedPin, OUTPUT);
+    digitalWrite(statusLedPin, ledLit ? statusLedOnLevel : !statusLedOnLevel);
+}
+
+void statusLedLevelSettingChanged(SettingItem *item)
+{
+    statusLedOnLevel = !statusLedSettings.statusLedOutputPinActiveLow;
+    digitalWrite(statusLedPin, ledLit ? statusLedOnLevel : !statusLedOnLevel);
+}
+
+struct SettingObserver statusLedPinObserver = {
+    &statusLedOutputPinSetting,
+    statusLedPinSettingChanged};
+
+struct SettingObserver statusLedLevelObserver = {
+    &statusLedOutputPinActiveLowSetting,
+    statusLedLevelSettingChanged};
+
 void initStatusLedHardware(){
-    pinMode(statusLedSettings.statusLedOutputPin, OUTPUT);
+    statusLedPin = statusLedSettings.statusLedOutputPin;
+    statusLedOnLevel = !statusLedSettings.statusLedOutputPinActiveLow;
+    pinMode(statusLedPin, OUTPUT);
+    addSettingObserver(&statusLedPinObserver);
+    addSettingObserver(&statusLedLevelObserver);
 }
 
 void initStatusLed()
@@ -247,6 +297,7 @@ void updateStatusLed()
 {
     if (statusLedProcess.status == STATUS_LED_STOPPED)
     {
+        scheduleProcessUpdate(&statusLedProcess, SCHEDULER_IDLE_MILLIS);
         return ;
     }
 
@@ -256,6 +307,8 @@ void updateStatusLed()
     }
 
     updateStatusLedFlash();
+
+    scheduleStatusLedUpdate();
 }
 
 void stopstatusLed()
@@ -0,0 +1,452 @@
+#include <Arduino.h>
+
+#include "debug.h"
+#include "messages.h"
+#include "scheduler.h"
+#include "timerWheel.h"
+
+struct TimerWheel timerWheel;
+
+bool timerWheelSetUp = false;
+
+#if defined(ARDUINO_ARCH_ESP32)
+
+portMUX_TYPE timerWheelClockMux = portMUX_INITIALIZER_UNLOCKED;
+
+#define ENTER_TIMER_WHEEL_CLOCK() portENTER_CRITICAL(&timerWheelClockMux)
+#define EXIT_TIMER_WHEEL_CLOCK() portEXIT_CRITICAL(&timerWheelClockMux)
+
+#else
+
+// one core, and the clock isn't read from interrupts
+#define ENTER_TIMER_WHEEL_CLOCK()
+#define EXIT_TIMER_WHEEL_CLOCK()
+
+#endif
+
+void timerWheelInit(struct TimerWheel *wheel, unsigned long (*readMillis)())
+{
+	memset(wheel, 0, sizeof(struct TimerWheel));
+	wheel->readMillis = readMillis;
+	wheel->lastMillis = (uint32_t)readMillis();
+	wheel->currentTick = wheel->lastMillis / TIMER_WHEEL_TICK_MILLIS;
+	wheel->targetTick = wheel->currentTick;
+}
+
+// The clock is read inside the critical section as well. A task that read
+// it outside and was then held up could come in with a time older than the
+// last one and count a wrap that never happened.
+
+uint64_t timerWheelMillis(struct TimerWheel *wheel)
+{
+	ENTER_TIMER_WHEEL_CLOCK();
+
+	uint32_t now = (uint32_t)wheel->readMillis();
+
+	if (now < wheel->lastMillis)
+	{
+		wheel->wraps++;
+	}
+
+	wheel->lastMillis = now;
+
+	uint64_t result = ((uint64_t)wheel->wraps << 32) | now;
+
+	EXIT_TIMER_WHEEL_CLOCK();
+
+	return result;
+}
+
+uint64_t timerWheelNowTick(struct TimerWheel *wheel)
+{
+	return timerWheelMillis(wheel) / TIMER_WHEEL_TICK_MILLIS;
+}
+
+void unlinkTimer(struct WheelTimer *timer)
+{
+	*timer->previousNext = timer->next;
+
+	if (timer->next != NULL)
+	{
+		timer->next->previousNext = timer->previousNext;
+	}
+
+	timer->next = NULL;
+	timer->previousNext = NULL;
+}
+
+void insertTimer(struct TimerWheel *wheel, struct WheelTimer *timer)
+{
+	uint64_t expires = timer->expiresTick;
+
+	// a timer that is already due goes in the slot for the current tick
+	if (expires < wheel->currentTick)
+	{
+		expires = wheel->currentTick;
+	}
+
+	uint64_t delta = expires - wheel->currentTick;
+
+	int level = 0;
+
+	while (level < TIMER_WHEEL_LEVELS - 1 &&
+		   delta >= ((uint64_t)1 << ((level + 1) * TIMER_WHEEL_SLOT_BITS)))
+	{
+		level++;
+	}
+
+	uint64_t wheelSpan = (uint64_t)1 << (TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOT_BITS);
+
+	if (delta >= wheelSpan)
+	{
+		// too far away for the wheel - wait in the furthest slot and be
+		// put back in when that slot is spread over the levels below
+		expires = wheel->currentTick + wheelSpan - 1;
+	}
+
+	int slot = (expires >> (level * TIMER_WHEEL_SLOT_BITS)) & (TIMER_WHEEL_SLOTS - 1);
+
+	struct WheelTimer **head = &wheel->slots[level][slot];
+
+	timer->next = *head;
+	timer->previousNext = head;
+
+	if (*head != NULL)
+	{
+		(*head)->previousNext = &timer->next;
+	}
+
+	*head = timer;
+}
+
+void timerWheelSchedule(struct TimerWheel *wheel, struct WheelTimer *timer, unsigned long delayMillis, unsigned long periodMillis)
+{
+	if (timer->previousNext != NULL)
+	{
+		cancelTimer(timer);
+	}
+
+	uint64_t expires = (timerWheelMillis(wheel) + delayMillis + TIMER_WHEEL_TICK_MILLIS - 1) / TIMER_WHEEL_TICK_MILLIS;
+
+	// a timer started by a callback can't fire again in the same tick
+	if (wheel->firing && expires <= wheel->currentTick)
+	{
+		expires = wheel->currentTick + 1;
+	}
+
+	timer->periodMillis = periodMillis;
+	timer->expiresTick = expires;
+	timer->wheel = wheel;
+
+	insertTimer(wheel, timer);
+
+	wheel->activeTimers++;
+}
+
+void cancelTimer(struct WheelTimer *timer)
+{
+	if (timer->previousNext == NULL)
+	{
+		return;
+	}
+
+	unlinkTimer(timer);
+
+	timer->wheel->activeTimers--;
+}
+
+bool timerActive(struct WheelTimer *timer)
+{
+	return timer->previousNext != NULL;
+}
+
+// puts the timers in a slot back into the wheel, which moves them down a level
+
+void cascadeTimers(struct TimerWheel *wheel, int level)
+{
+	int slot = (wheel->currentTick >> (level * TIMER_WHEEL_SLOT_BITS)) & (TIMER_WHEEL_SLOTS - 1);
+
+	struct WheelTimer *timer = wheel->slots[level][slot];
+
+	wheel->slots[level][slot] = NULL;
+
+	while (timer != NULL)
+	{
+		struct WheelTimer *next = timer->next;
+		insertTimer(wheel, timer);
+		timer = next;
+	}
+}
+
+void fireTimers(struct TimerWheel *wheel)
+{
+	int slot = wheel->currentTick & (TIMER_WHEEL_SLOTS - 1);
+
+	struct WheelTimer **head = &wheel->slots[0][slot];
+
+	// take one timer at a time, as a callback can change the slot
+
+	while (*head != NULL)
+	{
+		struct WheelTimer *timer = *head;
+
+		unlinkTimer(timer);
+		wheel->activeTimers--;
+
+		if (timer->periodMillis != 0)
+		{
+			uint64_t periodTicks = (timer->periodMillis + TIMER_WHEEL_TICK_MILLIS - 1) / TIMER_WHEEL_TICK_MILLIS;
+
+			timer->expiresTick = timer->expiresTick + periodTicks;
+
+			if (timer->expiresTick <= wheel->targetTick)
+			{
+				// skip the periods that were missed
+				timer->expiresTick = wheel->targetTick + 1;
+			}
+
+			insertTimer(wheel, timer);
+			wheel->activeTimers++;
+		}
+
+		wheel->timersFired++;
+		timer->callback(timer);
+	}
+}
+
+void timerWheelUpdate(struct TimerWheel *wheel)
+{
+	wheel->targetTick = timerWheelNowTick(wheel);
+
+	if (wheel->activeTimers == 0)
+	{
+		// nothing to fire so there's no need to step through the ticks
+		if (wheel->currentTick <= wheel->targetTick)
+		{
+			wheel->currentTick = wheel->targetTick + 1;
+		}
+		return;
+	}
+
+	wheel->firing = true;
+
+	while (wheel->currentTick <= wheel->targetTick)
+	{
+		// spread the next slot of each level over the one below as the
+		// level below comes round to its start
+
+		for (int level = 1; level < TIMER_WHEEL_LEVELS; level++)
+		{
+			if ((wheel->currentTick & (((uint64_t)1 << (level * TIMER_WHEEL_SLOT_BITS)) - 1)) != 0)
+			{
+				break;
+			}
+			cascadeTimers(wheel, level);
+		}
+
+		fireTimers(wheel);
+
+		wheel->currentTick++;
+	}
+
+	wheel->firing = false;
+}
+
+// the earliest tick at which something might happen - a timer in the next
+// few level 0 slots, or the next time level 0 comes round
+
+uint64_t timerWheelNextTick(struct TimerWheel *wheel)
+{
+	uint64_t tick = wheel->currentTick;
+
+	do
+	{
+		if (wheel->slots[0][tick & (TIMER_WHEEL_SLOTS - 1)] != NULL)
+		{
+			return tick;
+		}
+		tick++;
+	} while ((tick & (TIMER_WHEEL_SLOTS - 1)) != 0);
+
+	return tick;
+}
+
+void setUpTimerWheel()
+{
+	if (!timerWheelSetUp)
+	{
+		timerWheelInit(&timerWheel, millis);
+		timerWheelSetUp = true;
+	}
+}
+
+uint64_t monotonicMillis()
+{
+	setUpTimerWheel();
+	return timerWheelMillis(&timerWheel);
+}
+
+void scheduleTimer(struct WheelTimer *timer, unsigned long delayMillis, unsigned long periodMillis)
+{
+	setUpTimerWheel();
+	timerWheelSchedule(&timerWheel, timer, delayMillis, periodMillis);
+}
+
+void updateTimers()
+{
+	setUpTimerWheel();
+
+	timerWheelUpdate(&timerWheel);
+
+	if (timerWheel.activeTimers != 0)
+	{
+		// the low 32 bits of the tick time are a millis() value
+		schedulerNoteDeadline((unsigned long)(timerWheelNextTick(&timerWheel) * TIMER_WHEEL_TICK_MILLIS));
+	}
+}
+
+void timerWheelStatusMessage(char *buffer, int bufferLength)
+{
+	uint64_t now = monotonicMillis();
+
+	snprintf(buffer, bufferLength, "active:%d fired:%lu uptime:%lus millis wraps:%lu",
+			 timerWheel.activeTimers,
+			 timerWheel.timersFired,
+			 (unsigned long)(now / 1000),
+			 (unsigned long)timerWheel.wraps);
+}
+
+// The self test drives a wheel from a fake clock that starts just before
+// millis() wraps
+
+// 32 bits like millis() on the device, so that it wraps on the host too
+uint32_t fakeTimerMillis;
+
+unsigned long readFakeTimerMillis()
+{
+	return fakeTimerMillis;
+}
+
+struct TimerTestRecord
+{
+	int fired;
+	uint64_t firstFiredMillis;
+	uint64_t lastFiredMillis;
+};
+
+struct TimerWheel testWheel;
+
+void recordTestTimer(struct WheelTimer *timer)
+{
+	struct TimerTestRecord *record = (struct TimerTestRecord *)timer->context;
+
+	uint64_t now = timerWheelMillis(&testWheel);
+
+	if (record->fired == 0)
+	{
+		record->firstFiredMillis = now;
+	}
+	record->lastFiredMillis = now;
+	record->fired++;
+}
+
+bool timerTestCheck(const char *name, bool passed)
+{
+	alwaysDisplayMessage("    %s: %s\n", passed ? "pass" : "FAIL", name);
+	return passed;
+}
+
+void runTestClock(unsigned long millisToRun, unsigned long stepMillis)
+{
+	for (unsigned long run = 0; run < millisToRun; run += stepMillis)
+	{
+		fakeTimerMillis += stepMillis;
+		timerWheelUpdate(&testWheel);
+	}
+}
+
+bool timerWheelSelfTest()
+{
+	bool passed = true;
+
+	alwaysDisplayMessage("\nTimer wheel self test\n");
+
+	fakeTimerMillis = 0xFFFFFFFF - 5000;
+	timerWheelInit(&testWheel, readFakeTimerMillis);
+
+	uint64_t start = timerWheelMillis(&testWheel);
+
+	fakeTimerMillis += 10000;
+
+	uint64_t afterWrap = timerWheelMillis(&testWheel);
+
+	passed &= timerTestCheck("monotonic millis across the wrap", afterWrap == start + 10000 && testWheel.wraps == 1);
+
+	// start on a tick so that the firing times are exact
+	fakeTimerMillis = 0xFFFFFFFF - 5005;
+	timerWheelInit(&testWheel, readFakeTimerMillis);
+	start = timerWheelMillis(&testWheel);
+
+	struct TimerTestRecord oneShotRecord = {0};
+	struct TimerTestRecord periodicRecord = {0};
+	struct TimerTestRecord longRecord = {0};
+	struct TimerTestRecord cancelledRecord = {0};
+
+	struct WheelTimer oneShot = {"one shot", recordTestTimer, &oneShotRecord};
+	struct WheelTimer periodic = {"periodic", recordTestTimer, &periodicRecord};
+	struct WheelTimer longTimer = {"long", recordTestTimer, &longRecord};
+	struct WheelTimer cancelled = {"cancelled", recordTestTimer, &cancelledRecord};
+
+	timerWheelSchedule(&testWheel, &oneShot, 7000, 0);
+	timerWheelSchedule(&testWheel, &periodic, 250, 250);
+	timerWheelSchedule(&testWheel, &longTimer, 100000, 0);
+	timerWheelSchedule(&testWheel, &cancelled, 3000, 0);
+
+	runTestClock(2000, 10);
+	cancelTimer(&cancelled);
+
+	runTestClock(8000, 10);
+
+	passed &= timerTestCheck("one shot fires once across the wrap",
+							 oneShotRecord.fired == 1 &&
+								 oneShotRecord.firstFiredMillis >= start + 7000 &&
+								 oneShotRecord.firstFiredMillis < start + 7000 + TIMER_WHEEL_TICK_MILLIS * 2);
+
+	passed &= timerTestCheck("periodic timer keeps time across the wrap",
+							 periodicRecord.fired == 40 &&
+								 periodicRecord.lastFiredMillis >= start + 10000 &&
+								 periodicRecord.lastFiredMillis < start + 10000 + TIMER_WHEEL_TICK_MILLIS * 2);
+
+	passed &= timerTestCheck("cancelled timer doesn't fire", cancelledRecord.fired == 0);
+
+	cancelTimer(&periodic);
+
+	// the long timer is in level 2 - run on in bigger steps
+	runTestClock(100000, 50);
+
+	passed &= timerTestCheck("long timer moves down the levels and fires",
+							 longRecord.fired == 1 &&
+								 longRecord.firstFiredMillis >= start + 100000 &&
+								 longRecord.firstFiredMillis < start + 100000 + 50 + TIMER_WHEEL_TICK_MILLIS);
+
+	// a periodic timer held up for a minute fires once and then keeps its period
+
+	periodicRecord.fired = 0;
+	timerWheelSchedule(&testWheel, &periodic, 250, 250);
+	fakeTimerMillis += 60000;
+	timerWheelUpdate(&testWheel);
+
+	bool skipped = periodicRecord.fired == 1;
+
+	runTestClock(1000, 10);
+
+	passed &= timerTestCheck("periodic timer skips missed periods", skipped && periodicRecord.fired == 5);
+
+	cancelTimer(&periodic);
+
+	passed &= timerTestCheck("no timers left running", testWheel.activeTimers == 0);
+
+	alwaysDisplayMessage("Timer wheel self test %s\n", passed ? "passed" : "FAILED");
+
+	return passed;
+}
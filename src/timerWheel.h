@@ -0,0 +1,90 @@
+#pragma once
+
+#include <Arduino.h>
+
+// millis() wraps round after 49.7 days, so a deadline made by adding to it
+// and compared with > goes wrong at the wrap. monotonicMillis extends
+// millis() to 64 bits by counting the wraps, which works as long as it is
+// read at least once every 49 days (the loop reads it on every pass). The
+// clock is taken as 32 bits whatever the size of unsigned long, so it wraps
+// in the same place on the host as on the device. The sensors and the
+// processes on the real time task read it too, so the wrap count is
+// updated in a critical section.
+//
+// Timers are kept in a hierarchical timer wheel. Level 0 has a slot for
+// each of the next 64 ticks, level 1 a slot for each of the next 64 blocks
+// of 64 ticks and so on. Starting or cancelling a timer is O(1). When level
+// 0 comes round to its first slot the next slot of level 1 is spread over
+// level 0, and so on up the levels. With a 10 millisecond tick the four
+// levels cover 46 hours. A longer timer waits in the top level and is
+// moved down as it gets closer.
+//
+// A timer belongs to its caller and is usually a static aggregate:
+//
+//   void flashLed(struct WheelTimer *timer);
+//   struct WheelTimer flashTimer = {"flash", flashLed};
+//
+//   scheduleTimer(&flashTimer, 500, 500);   // every half second
+//
+// Callbacks are called from updateTimers in the loop and may schedule or
+// cancel any timer. A periodic timer that falls more than a period behind
+// (because the loop was held up) skips the periods it missed.
+
+#define TIMER_WHEEL_TICK_MILLIS 10
+#define TIMER_WHEEL_SLOT_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_SLOT_BITS)
+#define TIMER_WHEEL_LEVELS 4
+
+struct TimerWheel;
+
+struct WheelTimer
+{
+	const char *name;
+	void (*callback)(struct WheelTimer *timer);
+	void *context;
+	// set by scheduleTimer
+	unsigned long periodMillis;
+	uint64_t expiresTick;
+	struct WheelTimer *next;
+	struct WheelTimer **previousNext;
+	struct TimerWheel *wheel;
+};
+
+struct TimerWheel
+{
+	unsigned long (*readMillis)();
+	uint32_t lastMillis;
+	uint32_t wraps;
+	// every tick before this one has been processed
+	uint64_t currentTick;
+	// the tick that updateTimers is catching up to
+	uint64_t targetTick;
+	bool firing;
+	int activeTimers;
+	unsigned long timersFired;
+	struct WheelTimer *slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+};
+
+extern struct TimerWheel timerWheel;
+
+// a wheel driven by its own clock - used by the self test
+void timerWheelInit(struct TimerWheel *wheel, unsigned long (*readMillis)());
+uint64_t timerWheelMillis(struct TimerWheel *wheel);
+void timerWheelSchedule(struct TimerWheel *wheel, struct WheelTimer *timer, unsigned long delayMillis, unsigned long periodMillis);
+void timerWheelUpdate(struct TimerWheel *wheel);
+
+uint64_t monotonicMillis();
+
+// a period of zero makes a one shot timer - scheduling a timer that is
+// already running restarts it
+void scheduleTimer(struct WheelTimer *timer, unsigned long delayMillis, unsigned long periodMillis = 0);
+void cancelTimer(struct WheelTimer *timer);
+bool timerActive(struct WheelTimer *timer);
+
+// called from the loop
+void updateTimers();
+
+void timerWheelStatusMessage(char *buffer, int bufferLength);
+
+// runs the timers on a fake clock across the millis wrap and prints the results
+bool timerWheelSelfTest();
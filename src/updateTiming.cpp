@@ -0,0 +1,108 @@
+#include <Arduino.h>
+
+#include "debug.h"
+#include "utils.h"
+#include "messages.h"
+#include "controller.h"
+#include "updateTiming.h"
+
+int updateTimingBucket(unsigned long micros)
+{
+	int bucket = 0;
+	unsigned long value = micros >> UPDATE_TIMING_FIRST_BUCKET_SHIFT;
+
+	while (value != 0 && bucket < UPDATE_TIMING_NO_OF_BUCKETS - 1)
+	{
+		value = value >> 1;
+		bucket++;
+	}
+
+	return bucket;
+}
+
+unsigned long updateTimingBucketStart(int bucket)
+{
+	if (bucket == 0)
+	{
+		return 0;
+	}
+
+	return 1UL << (bucket + UPDATE_TIMING_FIRST_BUCKET_SHIFT - 1);
+}
+
+void recordUpdateTiming(struct UpdateTiming *timing, const char *name, unsigned long micros, unsigned long budgetMicros)
+{
+	int bucket = updateTimingBucket(micros);
+
+	if (timing->buckets[bucket] == 0xFFFF)
+	{
+		for (int i = 0; i < UPDATE_TIMING_NO_OF_BUCKETS; i++)
+		{
+			timing->buckets[i] = timing->buckets[i] / 2;
+		}
+	}
+
+	timing->buckets[bucket]++;
+	timing->updates++;
+
+	if (micros > timing->maxMicros)
+	{
+		timing->maxMicros = micros;
+	}
+
+	if (budgetMicros == 0)
+	{
+		budgetMicros = controllerSettings.updateBudgetMicros;
+	}
+
+	if (micros <= budgetMicros)
+	{
+		timing->consecutiveOverruns = 0;
+		return;
+	}
+
+	timing->overruns++;
+	timing->consecutiveOverruns++;
+
+	if (timing->consecutiveOverruns >= controllerSettings.overrunLogCount)
+	{
+		displayMessage("%s overran the %lu microsecond update budget %d times running, last update %lu microseconds\n",
+					   name, budgetMicros, timing->consecutiveOverruns, micros);
+		timing->consecutiveOverruns = 0;
+	}
+}
+
+void clearUpdateTiming(struct UpdateTiming *timing)
+{
+	memset(timing, 0, sizeof(struct UpdateTiming));
+}
+
+void updateTimingText(struct UpdateTiming *timing, char *buffer, int bufferLength)
+{
+	snprintf(buffer, bufferLength, "updates:%lu max:%luus overruns:%lu", timing->updates, timing->maxMicros, timing->overruns);
+
+	for (int i = 0; i < UPDATE_TIMING_NO_OF_BUCKETS; i++)
+	{
+		if (timing->buckets[i] != 0)
+		{
+			snprintf(buffer, bufferLength, "%s %lu+:%u", buffer, updateTimingBucketStart(i), timing->buckets[i]);
+		}
+	}
+}
+
+void updateTimingJson(const char *name, struct UpdateTiming *timing, char *buffer, int bufferLength)
+{
+	snprintf(buffer, bufferLength, "{\"name\":\"%s\",\"updates\":%lu,\"max\":%lu,\"overruns\":%lu,\"hist\":[",
+			 name, timing->updates, timing->maxMicros, timing->overruns);
+
+	for (int i = 0; i < UPDATE_TIMING_NO_OF_BUCKETS; i++)
+	{
+		if (i != 0)
+		{
+			snprintf(buffer, bufferLength, "%s,", buffer);
+		}
+		snprintf(buffer, bufferLength, "%s%u", buffer, timing->buckets[i]);
+	}
+
+	snprintf(buffer, bufferLength, "%s]}", buffer);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Each sensor and process keeps a histogram of how long its update
+// function takes. Bucket 0 holds updates shorter than 16 microseconds and
+// each bucket after that covers twice the range of the one before. The
+// last bucket holds everything from 16 milliseconds up.
+//
+// An update that takes longer than the budget in the controller settings
+// is an overrun. A sensor or process that overruns several times in a row
+// is logged.
+
+#define UPDATE_TIMING_NO_OF_BUCKETS 12
+#define UPDATE_TIMING_FIRST_BUCKET_SHIFT 4
+
+#define UPDATE_TIMING_DEFAULT_BUDGET_MICROS 10000
+#define UPDATE_TIMING_DEFAULT_OVERRUN_LOG_COUNT 5
+
+struct UpdateTiming
+{
+	// the buckets are halved when one fills up so they keep their shape
+	uint16_t buckets[UPDATE_TIMING_NO_OF_BUCKETS];
+	unsigned long updates;
+	unsigned long maxMicros;
+	unsigned long overruns;
+	uint16_t consecutiveOverruns;
+};
+
+int updateTimingBucket(unsigned long micros);
+
+// lower limit of a bucket in microseconds
+unsigned long updateTimingBucketStart(int bucket);
+
+// a budget of zero means use the budget in the controller settings
+void recordUpdateTiming(struct UpdateTiming *timing, const char *name, unsigned long micros, unsigned long budgetMicros = 0);
+
+void clearUpdateTiming(struct UpdateTiming *timing);
+
+void updateTimingText(struct UpdateTiming *timing, char *buffer, int bufferLength);
+
+void updateTimingJson(const char *name, struct UpdateTiming *timing, char *buffer, int bufferLength);
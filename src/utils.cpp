@@ -83,6 +83,12 @@ int getUnalignedInt(unsigned char *source)
     return result;
 }
 
+void putUnalignedInt(int ival, unsigned char *dest)
+{
+    unsigned char *source = (unsigned char *)&ival;
+    memcpy(dest, source, sizeof(int));
+}
+
 float getUnalignedFloat(unsigned char *source)
 {
     float result;
@@ -109,6 +115,32 @@ void putUnalignedDouble(double dval, unsigned char *dest)
     memcpy(dest, source, sizeof(double));
 }
 
+// Standard CRC-32 (as used by zip). Start with a crc of 0 and pass the
+// result back in to continue over more data. Bitwise to save flash.
+
+unsigned long crc32Update(unsigned long crc, const unsigned char *data, int length)
+{
+    crc = ~crc & 0xFFFFFFFFUL;
+
+    for (int i = 0; i < length; i++)
+    {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++)
+        {
+            if (crc & 1)
+            {
+                crc = (crc >> 1) ^ 0xEDB88320UL;
+            }
+            else
+            {
+                crc = crc >> 1;
+            }
+        }
+    }
+
+    return ~crc & 0xFFFFFFFFUL;
+}
+
 int currentHeap;
 
 void start_memory_monitor()
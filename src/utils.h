@@ -15,12 +15,15 @@ bool strContains(char* searchMe,char* findMe);
 
 int getUnalignedInt(unsigned char * source);
 
+void putUnalignedInt(int ival, unsigned char * dest);
+
 float getUnalignedFloat(unsigned char * source);
 
 void putUnalignedFloat(float fval, unsigned char * dest);
 
 float getUnalignedDouble(unsigned char *source);
 void putUnalignedDouble(double dval, unsigned char *dest);
+unsigned long crc32Update(unsigned long crc, const unsigned char *data, int length);
 void start_memory_monitor();
 void display_memory_monitor( char * item);
 
@@ -74,3 +77,16 @@ void display_memory_monitor( char * item);
 
 #endif
 
+#if defined(ARDUINO_ARCH_HOST)
+
+// the host simulation, built against the Arduino shim in sim/shim
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <PubSubClient.h>
+
+#define PROC_ID (unsigned long)ESP.getChipId()
+#define PROC_NAME "HOST"
+
+#endif
+